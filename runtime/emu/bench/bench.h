@@ -0,0 +1,55 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench.h
+// Desc   : Micro Benchmarks.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BenchTimer class
+///////////////////////////////////////////////////////////////////////////////
+class BenchTimer
+{
+public:
+    BenchTimer() { Start(); }
+
+    inline void Start() { m_Start = Clock::now(); }
+
+    // Start()からの経過時間を秒単位で返す.
+    inline double GetElapsedSec() const
+    { return std::chrono::duration<double>(Clock::now() - m_Start).count(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point m_Start;
+};
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を数値として取得します. 無ければ既定値を返します.
+//-----------------------------------------------------------------------------
+inline uint64_t GetBenchArg(int argc, char** argv, int index, uint64_t defaultValue)
+{
+    if (index >= argc)
+    { return defaultValue; }
+
+    auto value = strtoull(argv[index], nullptr, 0);
+    return (value != 0) ? value : defaultValue;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmarks
+//-----------------------------------------------------------------------------
+bool RunCpuBench    (int argc, char** argv);    // 命令ディスパッチのMIPS.
+bool RunBankBench   (int argc, char** argv);    // ROMバンク切り替えの速度.
+bool RunPixelBench  (int argc, char** argv);    // 1ラインあたりのタイル・ピクセル変換の時間.
+bool RunFpsBench    (int argc, char** argv);    // ウィンドウ無しでのフレームレート.
+bool RunLibraryBench(int argc, char** argv);    // ROMライブラリの走査時間と再走査の確認.
+bool RunLoadBench   (int argc, char** argv);    // ROMファイルの読み込み時間.
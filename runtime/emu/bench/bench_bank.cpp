@@ -0,0 +1,216 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench_bank.cpp
+// Desc   : ROM Bank Switching Benchmark.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <mem.h>
+#include <cpu.h>
+#include <mapper.h>
+#include <cartridge.h>
+#include <bench.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint64_t kDefaultCycles  = 100 * 1000 * 1000;  // 既定の実行サイクル数.
+static constexpr uint8_t  kRomSizeCode    = 0x06;               // 2MB(128バンク).
+static constexpr uint32_t kRomBankSize    = 0x4000;             // ROMバンクのサイズ.
+static constexpr uint16_t kProgramAddress = 0x0150;             // プログラムの配置先.
+
+// MBC5のROMバンクを1命令おきに切り替えながら, 各バンクの先頭バイトを足し合わせる.
+static const uint8_t kProgram[] = {
+    0x06, 0x00,         // 0150 : LD B, 0
+    0x0E, 0x01,         // 0152 : LD C, 1
+    0x79,               // 0154 : LD A, C
+    0xEA, 0x00, 0x20,   // 0155 : LD (0x2000), A
+    0xFA, 0x00, 0x40,   // 0158 : LD A, (0x4000)
+    0x80,               // 015B : ADD A, B
+    0x47,               // 015C : LD B, A
+    0x0C,               // 015D : INC C
+    0x20, 0xF4,         // 015E : JR NZ, 0154
+    0xC3, 0x52, 0x01,   // 0160 : JP 0152
+};
+
+// ヘッダーチェックで参照される任天堂ロゴ.
+static const uint8_t kLogo[48] = {
+    0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83,
+    0x00, 0x0C, 0x00, 0x0D, 0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E,
+    0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99, 0xBB, 0xBB, 0x67, 0x63,
+    0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E,
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CopyMapper class
+///////////////////////////////////////////////////////////////////////////////
+class CopyMapper
+{
+public:
+    uint64_t SwitchCount = 0;
+
+    // ポインタでのマウントに置き換える前と同じく, 選択したバンクを固定のバッファにコピーする.
+    bool Init(const Cartridge* rom, Memory* memory)
+    {
+        m_pRom     = rom;
+        m_pStaging = static_cast<uint8_t*>(malloc(kRomBankSize));
+        if (m_pStaging == nullptr)
+        { return false; }
+
+        memcpy(m_pStaging, GetRomBank(rom, 1), kRomBankSize);
+        memory->MountRomBank0(GetRomBank(rom, 0), kRomBankSize);
+        memory->MountRomBank1(m_pStaging, kRomBankSize, 1);
+        memory->SetPageHandler(0x0000, 0x8000, nullptr, &OnWrite, this);
+        return true;
+    }
+
+    void Term()
+    {
+        if (m_pStaging != nullptr)
+        {
+            free(m_pStaging);
+            m_pStaging = nullptr;
+        }
+    }
+
+private:
+    const Cartridge*    m_pRom      = nullptr;
+    uint8_t*            m_pStaging  = nullptr;
+
+    static void OnWrite(void* pUser, uint16_t address, uint8_t value)
+    {
+        // MBC5のROMバンク下位8bitだけを扱う.
+        if ((address >> 12) != 2)
+        { return; }
+
+        auto pThis = static_cast<CopyMapper*>(pUser);
+        auto bank  = value & (GetRomBankCount(pThis->m_pRom) - 1);
+        memcpy(pThis->m_pStaging, GetRomBank(pThis->m_pRom, bank), kRomBankSize);
+        pThis->SwitchCount++;
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      バンクの先頭バイトにバンク番号を持つMBC5の合成ROMを作成します.
+//-----------------------------------------------------------------------------
+Cartridge* CreateRom()
+{
+    auto size = 32u * 1024u * (1u << kRomSizeCode);
+    auto data = static_cast<uint8_t*>(malloc(size));
+    if (data == nullptr)
+    { return nullptr; }
+
+    memset(data, 0, size);
+    for(uint32_t bank=0; bank<size/kRomBankSize; ++bank)
+    { data[bank * kRomBankSize] = uint8_t(bank); }
+
+    auto rom = reinterpret_cast<Cartridge*>(data);
+    rom->Header.EntryPoint[0] = 0x00;   // NOP
+    rom->Header.EntryPoint[1] = 0xC3;   // JP 0x0150
+    rom->Header.EntryPoint[2] = uint8_t(kProgramAddress & 0xFF);
+    rom->Header.EntryPoint[3] = uint8_t(kProgramAddress >> 8);
+    memcpy(rom->Header.Logo, kLogo, sizeof(kLogo));
+    rom->Header.CartridgeType = CARTRIDGE_MBC5;
+    rom->Header.RomSize       = kRomSizeCode;
+    rom->Header.RamSize       = NO_RAM;
+    memcpy(data + kProgramAddress, kProgram, sizeof(kProgram));
+
+    return rom;
+}
+
+//-----------------------------------------------------------------------------
+//      合成ROMを実行し, 経過時間を返します.
+//-----------------------------------------------------------------------------
+bool RunRom(Memory& memory, uint64_t cycles, uint8_t& checksum, double& sec)
+{
+    Cpu cpu;
+    if (!cpu.Init())
+    { return false; }
+
+    cpu.SetMemory(&memory);
+    cpu.SetPC(0x0100);
+    cpu.SetSP(0xFFFE);
+
+    BenchTimer timer;
+    while (cpu.GetConsumedCycles() < cycles)
+    { cpu.RunCycles(cycles - cpu.GetConsumedCycles()); }
+    sec = timer.GetElapsedSec();
+
+    checksum = cpu.GetB();
+    cpu.Term();
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      ROMバンクの切り替えを多用する合成ROMの実行速度を計測します.
+//-----------------------------------------------------------------------------
+bool RunBankBench(int argc, char** argv)
+{
+    auto cycles = GetBenchArg(argc, argv, 1, kDefaultCycles);
+
+    auto rom = CreateRom();
+    if (rom == nullptr)
+    {
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    auto result = false;
+    uint8_t  copySum = 0, mapSum = 0;
+    double   copySec = 0.0, mapSec = 0.0;
+    uint64_t switches = 0;
+
+    // 変更前 : バンクを切り替えるたびに16KBをコピーする.
+    {
+        Memory memory;
+        CopyMapper mapper;
+        if (memory.Init() && mapper.Init(rom, &memory))
+        {
+            result   = RunRom(memory, cycles, copySum, copySec);
+            switches = mapper.SwitchCount;
+        }
+        mapper.Term();
+        memory.Term();
+    }
+
+    // 変更後 : マッパーがページテーブルのポインタを差し替える.
+    if (result)
+    {
+        Memory memory;
+        Mapper mapper;
+        result = memory.Init() && mapper.Init(rom, &memory) && RunRom(memory, cycles, mapSum, mapSec);
+        mapper.Term();
+        memory.Term();
+    }
+
+    free(rom);
+
+    if (!result)
+    {
+        printf("Error : Benchmark setup failed.\n");
+        return false;
+    }
+
+    if (copySum != mapSum)
+    {
+        printf("Error : Checksum mismatch. copy = %02X, map = %02X\n", copySum, mapSum);
+        return false;
+    }
+
+    printf("bank : %llu cycles, %llu bank switches\n",
+        (unsigned long long)cycles, (unsigned long long)switches);
+    printf("    %-24s %8.2f M switches/s\n", "copy (before)",   double(switches) / copySec * 1e-6);
+    printf("    %-24s %8.2f M switches/s (x%.2f)\n", "pointer (after)", double(switches) / mapSec * 1e-6, copySec / mapSec);
+    return true;
+}
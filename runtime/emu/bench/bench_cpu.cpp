@@ -0,0 +1,323 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench_cpu.cpp
+// Desc   : Instruction Dispatch Benchmark.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <mem.h>
+#include <cpu.h>
+#include <bench.h>
+#include <bench_baseline_cpu.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint64_t kDefaultCycles  = 400 * 1000 * 1000;  // 既定の実行サイクル数.
+static constexpr uint16_t kProgramAddress = 0xC000;             // プログラムを置くWRAMのアドレス.
+static constexpr uint32_t kStraightUnits  = 8;                  // 直線コードの繰り返し数.
+
+// テーブル化する前の実装は分岐もCBプレフィックス命令も未実装なので,
+// 当時実装済みだった転送・演算命令だけで直線コードを作る.
+// (HL)と(DE)は当時のレジスタ配置(上位と下位が逆)でもWRAMを指す値にしておく.
+static const uint8_t kStraightHead[] = {
+    0x16, 0xD4,         // LD D, 0xD4
+    0x1E, 0xC9,         // LD E, 0xC9
+    0x26, 0xC8,         // LD H, 0xC8
+    0x2E, 0xD0,         // LD L, 0xD0
+};
+
+// 16命令, 112サイクル.
+static const uint8_t kStraightUnit[] = {
+    0x7E,               // LD A, (HL)
+    0x47,               // LD B, A
+    0xE6, 0x0F,         // AND 0x0F
+    0x4F,               // LD C, A
+    0x78,               // LD A, B
+    0xAA,               // XOR D
+    0xB3,               // OR E
+    0x12,               // LD (DE), A
+    0x04,               // INC B
+    0x81,               // ADD A, C
+    0x3D,               // DEC A
+    0xEA, 0x00, 0xD8,   // LD (0xD800), A
+    0xFA, 0x01, 0xD8,   // LD A, (0xD801)
+    0x26, 0xC8,         // LD H, 0xC8
+    0x2E, 0xD0,         // LD L, 0xD0
+    0x77,               // LD (HL), A
+};
+
+static const uint8_t kStraightTail[] = {
+    0xC3, 0x00, 0xC0,   // JP C000
+};
+
+static constexpr uint32_t kStraightCommands = 4 + kStraightUnits * 16;         // JPを除く1周の命令数.
+static constexpr uint32_t kStraightCycles   = 32 + kStraightUnits * 112 + 16;  // JPを含む1周のサイクル数.
+
+// 転送・演算・CBプレフィックス・条件分岐を混ぜた合成ループ.
+// 1周あたり515命令, 3104サイクル.
+static const uint8_t kLoopProgram[] = {
+    0x21, 0x00, 0xD0,   // C000 : LD HL, 0xD000
+    0x1E, 0x40,         // C003 : LD E, 0x40
+    0x7B,               // C005 : LD A, E
+    0x81,               // C006 : ADD A, C
+    0xAA,               // C007 : XOR D
+    0x22,               // C008 : LD (HL+), A
+    0x4F,               // C009 : LD C, A
+    0xCB, 0x11,         // C00A : RL C
+    0x1D,               // C00C : DEC E
+    0x20, 0xF6,         // C00D : JR NZ, C005
+    0xC3, 0x00, 0xC0,   // C00F : JP C000
+};
+
+static constexpr uint32_t kLoopCommands = 515;      // 1周の命令数.
+static constexpr uint32_t kLoopCycles   = 3104;     // 1周のサイクル数.
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Target structure
+///////////////////////////////////////////////////////////////////////////////
+struct Target
+{
+    const char*     Name;       //!< 表示名.
+    EXECUTION_MODE  Mode;       //!< 実行方式.
+    ACCURACY        Accuracy;   //!< サイクル精度.
+};
+
+static const Target kTargets[] = {
+    { "table (m-cycle)",        EXECUTION_MODE_INTERPRETER, ACCURACY_MCYCLE },
+    { "table (instruction)",    EXECUTION_MODE_INTERPRETER, ACCURACY_INSTRUCTION },
+    { "recompiler",             EXECUTION_MODE_RECOMPILER,  ACCURACY_INSTRUCTION },
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CpuState structure
+///////////////////////////////////////////////////////////////////////////////
+struct CpuState
+{
+    uint16_t    AF;         //!< AFレジスタ.
+    uint16_t    BC;         //!< BCレジスタ.
+    uint16_t    DE;         //!< DEレジスタ.
+    uint16_t    HL;         //!< HLレジスタ.
+    uint16_t    PC;         //!< プログラムカウンタ.
+    uint64_t    Cycles;     //!< 消費サイクル数.
+};
+
+//-----------------------------------------------------------------------------
+//      プログラムをWRAMに配置します.
+//-----------------------------------------------------------------------------
+bool SetupMemory(Memory& memory, const uint8_t* program, uint32_t size)
+{
+    if (!memory.Init())
+    { return false; }
+
+    for(uint32_t i=0; i<size; ++i)
+    { memory.Write8(uint16_t(kProgramAddress + i), program[i]); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      直線コードを作成します.
+//-----------------------------------------------------------------------------
+uint32_t BuildStraightProgram(uint8_t* program)
+{
+    uint32_t size = 0;
+    auto append = [&](const uint8_t* data, uint32_t count)
+    {
+        for(uint32_t i=0; i<count; ++i)
+        { program[size++] = data[i]; }
+    };
+
+    append(kStraightHead, sizeof(kStraightHead));
+    for(uint32_t i=0; i<kStraightUnits; ++i)
+    { append(kStraightUnit, sizeof(kStraightUnit)); }
+    append(kStraightTail, sizeof(kStraightTail));
+    return size;
+}
+
+//-----------------------------------------------------------------------------
+//      テーブル化する前のswitch方式で直線コードを実行し, 経過時間を返します.
+//-----------------------------------------------------------------------------
+bool RunBaseline(const uint8_t* program, uint32_t size, uint64_t commands, double& sec)
+{
+    Memory memory;
+    if (!SetupMemory(memory, program, size))
+    { return false; }
+
+    BaselineCpu cpu;
+    cpu.SetMemory(&memory);
+    cpu.SetPC(kProgramAddress);
+
+    // 当時はJPが未実装なので, 末尾のJPに達したら呼び出し側で先頭へ戻す.
+    auto end = uint16_t(kProgramAddress + size - sizeof(kStraightTail));
+
+    BenchTimer timer;
+    for(uint64_t i=0; i<commands; ++i)
+    {
+        cpu.Execute();
+        if (cpu.GetPC() == end)
+        { cpu.SetPC(kProgramAddress); }
+    }
+    sec = timer.GetElapsedSec();
+
+    memory.Term();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      CPUクラスでプログラムを実行し, 経過時間と最終状態を返します.
+//-----------------------------------------------------------------------------
+bool RunCpu
+(
+    const Target&   target,
+    const uint8_t*  program,
+    uint32_t        size,
+    uint64_t        cycles,
+    CpuState&       state,
+    double&         sec
+)
+{
+    Memory memory;
+    if (!SetupMemory(memory, program, size))
+    { return false; }
+
+    Cpu cpu;
+    if (!cpu.Init())
+    { return false; }
+
+    cpu.SetMemory(&memory);
+    cpu.SetAccuracy(target.Accuracy);
+    if (!cpu.SetExecutionMode(target.Mode))
+    { return false; }
+
+    cpu.SetPC(kProgramAddress);
+    cpu.SetSP(0xFFFE);
+
+    BenchTimer timer;
+    while (cpu.GetConsumedCycles() < cycles)
+    { cpu.RunCycles(cycles - cpu.GetConsumedCycles()); }
+    sec = timer.GetElapsedSec();
+
+    state.AF     = cpu.GetAF();
+    state.BC     = cpu.GetBC();
+    state.DE     = cpu.GetDE();
+    state.HL     = cpu.GetHL();
+    state.PC     = cpu.GetPC();
+    state.Cycles = cpu.GetConsumedCycles();
+
+    cpu.Term();
+    memory.Term();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      全ての実行方式でプログラムを実行し, MIPSを表示します.
+//-----------------------------------------------------------------------------
+bool RunTargets
+(
+    const uint8_t*  program,
+    uint32_t        size,
+    uint64_t        cycles,
+    uint64_t        commands,
+    double          baseMips
+)
+{
+    auto     result   = true;
+    auto     hasState = false;
+    CpuState expected = {};
+
+    for(auto& target : kTargets)
+    {
+        if (target.Mode == EXECUTION_MODE_RECOMPILER && !Recompiler::IsSupported())
+        {
+            printf("    %-24s (not supported)\n", target.Name);
+            continue;
+        }
+
+        CpuState state = {};
+        double   sec   = 0.0;
+        if (!RunCpu(target, program, size, cycles, state, sec))
+        {
+            printf("Error : %s setup failed.\n", target.Name);
+            result = false;
+            continue;
+        }
+
+        // 同じサイクル数で止めたので, 全てのレジスタが一致するはず.
+        if (!hasState)
+        {
+            expected = state;
+            hasState = true;
+        }
+        else if (state.AF != expected.AF || state.BC != expected.BC || state.DE != expected.DE
+              || state.HL != expected.HL || state.PC != expected.PC || state.Cycles != expected.Cycles)
+        {
+            printf("Error : %s register mismatch. PC = %04X (expected %04X), AF = %04X (expected %04X)\n",
+                target.Name, state.PC, expected.PC, state.AF, expected.AF);
+            result = false;
+            continue;
+        }
+
+        auto mips = double(commands) / sec * 1e-6;
+        if (baseMips == 0.0)
+        { baseMips = mips; }
+
+        printf("    %-24s %8.2f MIPS (x%.2f)\n", target.Name, mips, mips / baseMips);
+    }
+
+    return result;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      命令ディスパッチのMIPSを計測します.
+//-----------------------------------------------------------------------------
+bool RunCpuBench(int argc, char** argv)
+{
+    auto cycles = GetBenchArg(argc, argv, 1, kDefaultCycles);
+    auto result = true;
+
+    // 直線コード. テーブル化する前のswitch方式を基準にする.
+    {
+        uint8_t program[256];
+        auto size       = BuildStraightProgram(program);
+        auto iterations = cycles / kStraightCycles;
+        auto commands   = iterations * (kStraightCommands + 1);
+
+        printf("cpu : straight-line, %llu cycles, %llu instructions\n",
+            (unsigned long long)(iterations * kStraightCycles), (unsigned long long)commands);
+
+        // 当時の実装は命令の結果が正しくない(フラグをHとCレジスタに書き込む等)ので, 状態は比較しない.
+        double sec = 0.0;
+        if (!RunBaseline(program, size, iterations * kStraightCommands, sec))
+        { return false; }
+
+        auto baseMips = double(iterations * kStraightCommands) / sec * 1e-6;
+        printf("    %-24s %8.2f MIPS\n", "baseline (switch)", baseMips);
+
+        result &= RunTargets(program, size, iterations * kStraightCycles, commands, baseMips);
+    }
+
+    // 分岐とCBプレフィックス命令を含むループ. 当時の実装では実行できないので, 最初の方式を基準にする.
+    {
+        auto iterations = cycles / kLoopCycles;
+        auto commands   = iterations * kLoopCommands;
+
+        printf("cpu : loop, %llu cycles, %llu instructions\n",
+            (unsigned long long)(iterations * kLoopCycles), (unsigned long long)commands);
+
+        result &= RunTargets(kLoopProgram, sizeof(kLoopProgram), iterations * kLoopCycles, commands, 0.0);
+    }
+
+    return result;
+}
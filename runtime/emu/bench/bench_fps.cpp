@@ -0,0 +1,266 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench_fps.cpp
+// Desc   : Headless Frame Rate Benchmark.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <emu.h>
+#include <bench.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint64_t kDefaultFrames  = 3000;       // 既定の計測フレーム数.
+static constexpr uint32_t kWarmupFrames   = 60;         // 計測前に実行するフレーム数.
+static constexpr uint32_t kRomSize        = 0x8000;     // 合成ROMのサイズ(ROMのみ, 32KB).
+static constexpr uint16_t kCopyAddress    = 0x0200;     // 転送ルーチン.
+static constexpr uint16_t kVBlankAddress  = 0x0210;     // VBlank割り込みの処理.
+static constexpr uint16_t kProgramAddress = 0x0150;     // メインプログラム.
+static constexpr uint16_t kVramData       = 0x4000;     // VRAMに転送するデータ(8KB).
+static constexpr uint16_t kOamData        = 0x6000;     // OAMに転送するデータ(160バイト).
+
+// VRAMとOAMを埋めてからBG・ウィンドウ・スプライトを全て表示し,
+// VBlankごとにスクロールさせながらHALTで待つ.
+static const uint8_t kProgram[] = {
+    0xF3,               // 0150 : DI
+    0x31, 0xFE, 0xFF,   // 0151 : LD SP, 0xFFFE
+    0xAF,               // 0154 : XOR A
+    0xE0, 0x40,         // 0155 : LDH (LCDC), A
+    0x21, 0x00, 0x40,   // 0157 : LD HL, 0x4000
+    0x11, 0x00, 0x80,   // 015A : LD DE, 0x8000
+    0x01, 0x00, 0x20,   // 015D : LD BC, 0x2000
+    0xCD, 0x00, 0x02,   // 0160 : CALL 0x0200
+    0x21, 0x00, 0x60,   // 0163 : LD HL, 0x6000
+    0x11, 0x00, 0xFE,   // 0166 : LD DE, 0xFE00
+    0x01, 0xA0, 0x00,   // 0169 : LD BC, 0x00A0
+    0xCD, 0x00, 0x02,   // 016C : CALL 0x0200
+    0x3E, 0xE4,         // 016F : LD A, 0xE4
+    0xE0, 0x47,         // 0171 : LDH (BGP), A
+    0x3E, 0xD2,         // 0173 : LD A, 0xD2
+    0xE0, 0x48,         // 0175 : LDH (OBP0), A
+    0x3E, 0x1B,         // 0177 : LD A, 0x1B
+    0xE0, 0x49,         // 0179 : LDH (OBP1), A
+    0x3E, 0x28,         // 017B : LD A, 40
+    0xE0, 0x4A,         // 017D : LDH (WY), A
+    0x3E, 0x32,         // 017F : LD A, 50
+    0xE0, 0x4B,         // 0181 : LDH (WX), A
+    0x3E, 0x01,         // 0183 : LD A, 0x01
+    0xE0, 0xFF,         // 0185 : LDH (IE), A
+    0xAF,               // 0187 : XOR A
+    0xE0, 0x0F,         // 0188 : LDH (IF), A
+    0x3E, 0xF3,         // 018A : LD A, 0xF3
+    0xE0, 0x40,         // 018C : LDH (LCDC), A
+    0xFB,               // 018E : EI
+    0x76,               // 018F : HALT
+    0x18, 0xFD,         // 0190 : JR 018F
+};
+
+// HLからDEへBCバイト転送する.
+static const uint8_t kCopy[] = {
+    0x2A,               // 0200 : LD A, (HL+)
+    0x12,               // 0201 : LD (DE), A
+    0x13,               // 0202 : INC DE
+    0x0B,               // 0203 : DEC BC
+    0x78,               // 0204 : LD A, B
+    0xB1,               // 0205 : OR C
+    0x20, 0xF8,         // 0206 : JR NZ, 0200
+    0xC9,               // 0208 : RET
+};
+
+// SCXを増やしSCYを減らす.
+static const uint8_t kVBlank[] = {
+    0xF5,               // 0210 : PUSH AF
+    0xF0, 0x43,         // 0211 : LDH A, (SCX)
+    0x3C,               // 0213 : INC A
+    0xE0, 0x43,         // 0214 : LDH (SCX), A
+    0xF0, 0x42,         // 0216 : LDH A, (SCY)
+    0x3D,               // 0218 : DEC A
+    0xE0, 0x42,         // 0219 : LDH (SCY), A
+    0xF1,               // 021B : POP AF
+    0xD9,               // 021C : RETI
+};
+
+// ヘッダーチェックで参照される任天堂ロゴ.
+static const uint8_t kLogo[48] = {
+    0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83,
+    0x00, 0x0C, 0x00, 0x0D, 0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E,
+    0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99, 0xBB, 0xBB, 0x67, 0x63,
+    0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E,
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Config structure
+///////////////////////////////////////////////////////////////////////////////
+struct Config
+{
+    const char*     Name;       //!< 表示名.
+    PPU_RENDERER    Renderer;   //!< PPUの描画方式.
+    bool            Render;     //!< 描画するかどうか.
+    bool            Thread;     //!< 描画スレッドを使うかどうか.
+};
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const Config kConfigs[] = {
+    { "scanline",           PPU_RENDERER_SCANLINE,  true,   false },
+    { "scanline + thread",  PPU_RENDERER_SCANLINE,  true,   true  },
+    { "fifo",               PPU_RENDERER_FIFO,      true,   false },
+    { "timing only",        PPU_RENDERER_SCANLINE,  false,  false },
+};
+
+//-----------------------------------------------------------------------------
+//      合成ROMを作成します.
+//-----------------------------------------------------------------------------
+Cartridge* CreateRom()
+{
+    auto data = static_cast<uint8_t*>(malloc(kRomSize));
+    if (data == nullptr)
+    { return nullptr; }
+
+    memset(data, 0, kRomSize);
+
+    // 結果を再現できるように固定の種を使う.
+    uint32_t seed = 0x2468ACE1;
+    auto next = [&seed]()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+
+    // タイルデータ・タイルマップは乱数で埋める.
+    for(uint32_t i=0; i<0x2000; ++i)
+    { data[kVramData + i] = uint8_t(next()); }
+
+    // スプライトは画面内に収まる位置に置く.
+    for(uint32_t i=0; i<40; ++i)
+    {
+        auto oam = data + kOamData + i * 4;
+        oam[0] = uint8_t(16 + next() % 144);
+        oam[1] = uint8_t(8  + next() % 160);
+        oam[2] = uint8_t(next());
+        oam[3] = uint8_t(next() & 0xF0);
+    }
+
+    // リセットとエントリーポイントはどちらもメインプログラムへ飛ぶ.
+    static const uint8_t kJumpMain  [] = { 0xC3, uint8_t(kProgramAddress & 0xFF), uint8_t(kProgramAddress >> 8) };
+    static const uint8_t kJumpVBlank[] = { 0xC3, uint8_t(kVBlankAddress  & 0xFF), uint8_t(kVBlankAddress  >> 8) };
+    memcpy(data + 0x0000, kJumpMain,   sizeof(kJumpMain));
+    memcpy(data + 0x0040, kJumpVBlank, sizeof(kJumpVBlank));
+    memcpy(data + 0x0100, kJumpMain,   sizeof(kJumpMain));
+    memcpy(data + kProgramAddress, kProgram, sizeof(kProgram));
+    memcpy(data + kCopyAddress,    kCopy,    sizeof(kCopy));
+    memcpy(data + kVBlankAddress,  kVBlank,  sizeof(kVBlank));
+
+    auto rom = reinterpret_cast<Cartridge*>(data);
+    memcpy(rom->Header.Logo, kLogo, sizeof(kLogo));
+    rom->Header.CartridgeType  = CARTRIDGE_ROM_ONLY;
+    rom->Header.RomSize        = 0;
+    rom->Header.RamSize        = NO_RAM;
+    rom->Header.HeaderCheckSum = CalcHeaderCheckSum(rom->Header);
+
+    return rom;
+}
+
+//-----------------------------------------------------------------------------
+//      指定した設定でフレームレートを計測します.
+//-----------------------------------------------------------------------------
+bool RunConfig(const Cartridge* rom, const Config& config, uint64_t frames, double& fps)
+{
+    Emulator emulator;
+    auto result = emulator.Init() && emulator.SetRom(rom);
+    if (result)
+    {
+        emulator.SetPpuRenderer(config.Renderer);
+        emulator.SetRenderEnable(config.Render);
+        result = !config.Thread || emulator.SetPpuThread(true);
+    }
+
+    if (result)
+    {
+        emulator.RunFrames(kWarmupFrames);
+
+        BenchTimer timer;
+        emulator.RunFrames(uint32_t(frames));
+        fps = double(frames) / timer.GetElapsedSec();
+    }
+
+    emulator.SetPpuThread(false);
+    emulator.SetRom(nullptr);
+    emulator.Term();
+    return result;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      ウィンドウを作らずにフレームレートを計測します.
+//-----------------------------------------------------------------------------
+bool RunFpsBench(int argc, char** argv)
+{
+    auto frames = GetBenchArg(argc, argv, 1, kDefaultFrames);
+
+    // ROMのパスを指定した場合はそれを使う.
+    Cartridge* rom    = nullptr;
+    auto       loaded = argc > 2;
+    if (loaded)
+    {
+        if (!LoadCartridge(argv[2], &rom))
+        { return false; }
+    }
+    else
+    {
+        rom = CreateRom();
+        if (rom == nullptr)
+        {
+            printf("Error : Out of Memory.\n");
+            return false;
+        }
+    }
+
+    printf("fps : %llu frames, %s\n", (unsigned long long)frames, loaded ? argv[2] : "synthetic rom");
+
+    auto   result = true;
+    double base   = 0.0;
+    for(auto& config : kConfigs)
+    {
+        double fps = 0.0;
+        if (!RunConfig(rom, config, frames, fps))
+        {
+            // 描画スレッドを作れない環境では飛ばす.
+            if (config.Thread)
+            { printf("    %-20s (not supported)\n", config.Name); }
+            else
+            {
+                printf("Error : %s setup failed.\n", config.Name);
+                result = false;
+            }
+            continue;
+        }
+
+        // 最初の設定(シングルスレッドのスキャンライン描画)を基準にする.
+        if (base == 0.0)
+        { base = fps; }
+
+        printf("    %-20s %10.1f fps %8.1f us/frame (x%.2f)\n", config.Name, fps, 1e6 / fps, fps / base);
+    }
+
+    if (loaded)
+    { UnloadCartridge(rom); }
+    else
+    { free(rom); }
+
+    return result;
+}
@@ -0,0 +1,93 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench_library.cpp
+// Desc   : ROM Library Scan Benchmark.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <library.h>
+#include <bench.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      ディレクトリを走査し, 結果を表示します.
+//-----------------------------------------------------------------------------
+bool ScanLibrary(Library& library, const char* name, const char* directory)
+{
+    BenchTimer timer;
+    if (!library.Scan(directory))
+    {
+        printf("Error : Library::Scan() Failed. directory = %s\n", directory);
+        return false;
+    }
+
+    printf("    %-24s %8.2f ms, %u files, %u hashed\n",
+        name, timer.GetElapsedSec() * 1e3, library.GetCount(), library.GetHashedCount());
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      ROMライブラリの走査時間を計測し, 再走査でハッシュ計算が省かれることを確認します.
+//-----------------------------------------------------------------------------
+bool RunLibraryBench(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("library : skipped (no directory)\n");
+        return true;
+    }
+
+    auto directory = argv[1];
+    auto index     = (argc > 2) ? argv[2] : nullptr;
+    printf("library : %s\n", directory);
+
+    Library library;
+    if (!ScanLibrary(library, "first scan", directory))
+    { return false; }
+
+    // 何も変更していないので, 全てのファイルが前回の結果を再利用するはず.
+    if (!ScanLibrary(library, "rescan", directory))
+    { return false; }
+
+    if (library.GetHashedCount() != 0)
+    {
+        printf("Error : Rescan hashed %u unchanged files.\n", library.GetHashedCount());
+        return false;
+    }
+
+    // インデックスファイルを指定した場合は, 書き出して読み直した結果でも確認する.
+    if (index == nullptr)
+    { return true; }
+
+    if (!library.Save(index))
+    {
+        printf("Error : Library::Save() Failed. path = %s\n", index);
+        return false;
+    }
+
+    Library reloaded;
+    if (!reloaded.Load(index))
+    {
+        printf("Error : Library::Load() Failed. path = %s\n", index);
+        return false;
+    }
+
+    if (!ScanLibrary(reloaded, "rescan (loaded index)", directory))
+    { return false; }
+
+    if (reloaded.GetHashedCount() != 0 || reloaded.GetCount() != library.GetCount())
+    {
+        printf("Error : Rescan after Load() hashed %u files.\n", reloaded.GetHashedCount());
+        return false;
+    }
+
+    return true;
+}
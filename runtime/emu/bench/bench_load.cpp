@@ -0,0 +1,160 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench_load.cpp
+// Desc   : Cartridge Load Latency Benchmark.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <platform.h>
+#include <cartridge.h>
+#include <bench.h>
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif//PLATFORM_LINUX
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint32_t kIterations = 20;     // 1ファイルあたりの計測回数.
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LoadResult structure
+///////////////////////////////////////////////////////////////////////////////
+struct LoadResult
+{
+    double      LoadSec;    //!< LoadCartridge()の時間の合計.
+    double      TouchSec;   //!< イメージ全体を読み終えるまでの時間の合計.
+    double      UnloadSec;  //!< UnloadCartridge()の時間の合計.
+    uint32_t    Size;       //!< イメージのサイズ.
+};
+
+//-----------------------------------------------------------------------------
+//      ファイルをページキャッシュから追い出します.
+//-----------------------------------------------------------------------------
+bool DropFileCache(const char* path)
+{
+#if PLATFORM_LINUX
+    auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    { return false; }
+
+    // 書き込み中のページは追い出せないので, 先に書き出しておく.
+    fdatasync(fd);
+    auto result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return result;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      読み込みと解放の時間を計測します.
+//-----------------------------------------------------------------------------
+bool MeasureLoad(const char* path, bool cold, LoadResult& result)
+{
+    result = {};
+
+    for(uint32_t i=0; i<kIterations; ++i)
+    {
+        if (cold && !DropFileCache(path))
+        { return false; }
+
+        Cartridge* rom = nullptr;
+        BenchTimer timer;
+        if (!LoadCartridge(path, &rom))
+        { return false; }
+        result.LoadSec += timer.GetElapsedSec();
+
+        // マップした場合は参照して初めてファイルが読まれるので, 全体を読み終えるまでも計る.
+        timer.Start();
+        auto     data = reinterpret_cast<const volatile uint8_t*>(rom);
+        auto     size = GetRomSize(rom);
+        uint32_t sum  = 0;
+        for(uint32_t offset=0; offset<size; offset+=64)
+        { sum += data[offset]; }
+        result.TouchSec += timer.GetElapsedSec();
+        result.Size      = size;
+        (void)sum;
+
+        timer.Start();
+        UnloadCartridge(rom);
+        result.UnloadSec += timer.GetElapsedSec();
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      計測結果を表示します.
+//-----------------------------------------------------------------------------
+void PrintResult(const char* name, const LoadResult& result)
+{
+    auto loadUs  = result.LoadSec   / kIterations * 1e6;
+    auto touchUs = result.TouchSec  / kIterations * 1e6;
+    auto freeUs  = result.UnloadSec / kIterations * 1e6;
+    printf("    %-6s load %10.1f us, touch %10.1f us, unload %8.1f us, total %10.1f us\n",
+        name, loadUs, touchUs, freeUs, loadUs + touchUs + freeUs);
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      ROMファイルの読み込み時間をウォームキャッシュとコールドキャッシュで計測します.
+//-----------------------------------------------------------------------------
+bool RunLoadBench(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("load : skipped (no rom)\n");
+        return true;
+    }
+
+    // 生のファイル・.gz・.zipを並べて渡せば, 同じ条件で比べられる.
+    auto result = true;
+    for(auto i=1; i<argc; ++i)
+    {
+        auto path = argv[i];
+
+        // 1回読んでページキャッシュに載せる. 読めないファイルはここで弾く.
+        Cartridge* rom = nullptr;
+        if (!LoadCartridge(path, &rom))
+        {
+            result = false;
+            continue;
+        }
+        UnloadCartridge(rom);
+
+        LoadResult warm = {};
+        if (!MeasureLoad(path, false, warm))
+        {
+            result = false;
+            continue;
+        }
+
+        printf("load : %s, %u bytes, %u iterations\n", path, warm.Size, kIterations);
+        PrintResult("warm", warm);
+
+        LoadResult cold = {};
+        if (!MeasureLoad(path, true, cold))
+        {
+            printf("    %-6s (not supported)\n", "cold");
+            continue;
+        }
+
+        PrintResult("cold", cold);
+    }
+
+    return result;
+}
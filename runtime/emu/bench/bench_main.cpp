@@ -0,0 +1,70 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench_main.cpp
+// Desc   : Benchmark Entry Point.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <bench.h>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// BenchEntry structure
+///////////////////////////////////////////////////////////////////////////////
+struct BenchEntry
+{
+    const char* Name;                               //!< コマンドラインで指定する名前.
+    const char* Usage;                              //!< 引数の説明.
+    bool      (*Run)(int argc, char** argv);        //!< 実行関数. argv[0]はベンチマーク名.
+};
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const BenchEntry kBenches[] = {
+    { "cpu",        "[cycles]",             &RunCpuBench },
+    { "bank",       "[cycles]",             &RunBankBench },
+    { "pixel",      "[lines]",              &RunPixelBench },
+    { "fps",        "[frames] [rom]",       &RunFpsBench },
+    { "library",    "directory [index]",    &RunLibraryBench },
+    { "load",       "rom [rom...]",         &RunLoadBench },
+};
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    // 名前を省略した場合は全てを既定の引数で実行する.
+    if (argc < 2)
+    {
+        auto result = true;
+        for(auto& entry : kBenches)
+        {
+            char* args[] = { const_cast<char*>(entry.Name) };
+            result &= entry.Run(1, args);
+        }
+        return result ? 0 : 1;
+    }
+
+    for(auto& entry : kBenches)
+    {
+        if (strcmp(argv[1], entry.Name) == 0)
+        { return entry.Run(argc - 1, argv + 1) ? 0 : 1; }
+    }
+
+    printf("Usage : gbbench [name] [args...]\n");
+    for(auto& entry : kBenches)
+    { printf("    %-8s %s\n", entry.Name, entry.Usage); }
+
+    return 1;
+}
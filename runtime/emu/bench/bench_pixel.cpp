@@ -0,0 +1,153 @@
+﻿//-----------------------------------------------------------------------------
+// File   : bench_pixel.cpp
+// Desc   : Pixel Conversion Kernel Benchmark.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <pixel.h>
+#include <ppu.h>
+#include <bench.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint64_t kDefaultLines = 2 * 1000 * 1000;  // 既定の計測ライン数.
+static constexpr uint32_t kLineTiles    = 21;               // SCXで端数が出ると1ラインで21枚にまたがる.
+static constexpr uint32_t kTileBytes    = 16;               // タイル1枚のデータサイズ.
+
+static const char* kKernelNames[] = {
+    "scalar",   // PIXEL_KERNEL_SCALAR
+    "ssse3",    // PIXEL_KERNEL_SSSE3
+    "avx2",     // PIXEL_KERNEL_AVX2
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LineData structure
+///////////////////////////////////////////////////////////////////////////////
+struct LineData
+{
+    uint8_t     Tiles  [kLineTiles * kTileBytes];   //!< 1ライン分のタイルデータ.
+    uint8_t     Decoded[kLineTiles * 64];           //!< 変換後のカラー番号.
+    uint8_t     Indices[Ppu::DisplayWidth];         //!< ラインのカラー番号.
+    uint32_t    Palette[16];                        //!< 出力形式のパレット.
+    uint32_t    Pixels [Ppu::DisplayWidth];         //!< 出力先.
+};
+
+//-----------------------------------------------------------------------------
+//      乱数で入力を埋めます.
+//-----------------------------------------------------------------------------
+void FillLine(LineData& line)
+{
+    // 結果を再現できるように固定の種を使う.
+    uint32_t seed = 0x12345678;
+    auto next = [&seed]()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+
+    for(auto& value : line.Tiles)
+    { value = uint8_t(next()); }
+    for(auto& value : line.Indices)
+    { value = uint8_t(next() % 12); }
+    for(auto& value : line.Palette)
+    { value = next() | 0xFF000000; }
+
+    memset(line.Decoded, 0, sizeof(line.Decoded));
+    memset(line.Pixels,  0, sizeof(line.Pixels));
+}
+
+//-----------------------------------------------------------------------------
+//      1ライン分のタイル変換を行います.
+//-----------------------------------------------------------------------------
+inline void DecodeLine(LineData& line)
+{
+    for(uint32_t i=0; i<kLineTiles; ++i)
+    { DecodeTile(line.Tiles + i * kTileBytes, line.Decoded + i * 64); }
+}
+
+//-----------------------------------------------------------------------------
+//      1ライン分のピクセル変換を行います.
+//-----------------------------------------------------------------------------
+inline void ConvertLine(LineData& line)
+{ ConvertPixels(line.Indices, line.Palette, line.Pixels, Ppu::DisplayWidth); }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      1ラインあたりのタイル変換とピクセル変換の時間を計測します.
+//-----------------------------------------------------------------------------
+bool RunPixelBench(int argc, char** argv)
+{
+    auto lines    = GetBenchArg(argc, argv, 1, kDefaultLines);
+    auto original = GetPixelKernel();
+
+    // 表引きの結果を正解として, 各命令セットの出力を比べる.
+    static LineData expected;
+    FillLine(expected);
+    SetPixelKernel(PIXEL_KERNEL_SCALAR);
+    DecodeLine(expected);
+    ConvertLine(expected);
+
+    printf("pixel : %llu lines, %u tiles + %u pixels per line\n",
+        (unsigned long long)lines, kLineTiles, Ppu::DisplayWidth);
+
+    auto result = true;
+    for(auto kernel : { PIXEL_KERNEL_SCALAR, PIXEL_KERNEL_SSSE3, PIXEL_KERNEL_AVX2 })
+    {
+        if (!SetPixelKernel(kernel))
+        {
+            printf("    %-8s (not supported)\n", kKernelNames[kernel]);
+            continue;
+        }
+
+        static LineData line;
+        FillLine(line);
+        DecodeLine(line);
+        ConvertLine(line);
+        if (memcmp(line.Decoded, expected.Decoded, sizeof(line.Decoded)) != 0
+         || memcmp(line.Pixels,  expected.Pixels,  sizeof(line.Pixels))  != 0)
+        {
+            printf("Error : %s output mismatch.\n", kKernelNames[kernel]);
+            result = false;
+            continue;
+        }
+
+        // 入力を少しずつ変えながら呼び出して, 同じ結果の使い回しを防ぐ.
+        BenchTimer timer;
+        for(uint64_t i=0; i<lines; ++i)
+        {
+            line.Tiles[i % sizeof(line.Tiles)]++;
+            DecodeLine(line);
+        }
+        auto decodeSec = timer.GetElapsedSec();
+
+        timer.Start();
+        for(uint64_t i=0; i<lines; ++i)
+        {
+            line.Indices[i % Ppu::DisplayWidth] ^= 0x1;
+            ConvertLine(line);
+        }
+        auto convertSec = timer.GetElapsedSec();
+
+        auto decodeNs  = decodeSec  / double(lines) * 1e9;
+        auto convertNs = convertSec / double(lines) * 1e9;
+        printf("    %-8s decode %8.1f ns/line, convert %8.1f ns/line, total %8.1f ns/line\n",
+            kKernelNames[kernel], decodeNs, convertNs, decodeNs + convertNs);
+    }
+
+    SetPixelKernel(original);
+    return result;
+}
@@ -0,0 +1,62 @@
+﻿//-----------------------------------------------------------------------------
+// File   : battery.h
+// Desc   : Battery-Backed RAM.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BatteryRam class
+///////////////////////////////////////////////////////////////////////////////
+class BatteryRam
+{
+public:
+    static constexpr uint32_t BlockSize = 0x2000;   //!< 書き出し単位(RAMバンクのサイズ).
+
+    BatteryRam() = default;
+    ~BatteryRam() { Term(); }
+
+    //-------------------------------------------------------------------------
+    //! @brief      セーブファイルを開き, RAMとして使用するメモリを準備します.
+    //!
+    //! @param[in]      path        セーブファイルのパス(無ければ作成).
+    //! @param[in]      sizeInBytes RAMのサイズ.
+    //! @retval true    初期化に成功.
+    //! @retval false   ファイルを開けないか, メモリの確保に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const char* path, uint32_t sizeInBytes);
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      変更された範囲を記録します.
+    //-------------------------------------------------------------------------
+    void MarkDirty(uint32_t offset, uint32_t sizeInBytes);
+
+    //-------------------------------------------------------------------------
+    //! @brief      変更された範囲だけをファイルに書き出します.
+    //!
+    //! @param[in]      wait        書き出しの完了を待つかどうか.
+    //! @retval true    書き出しに成功(変更が無い場合も含む).
+    //! @retval false   書き出しに失敗.
+    //-------------------------------------------------------------------------
+    bool Flush(bool wait);
+
+    uint8_t* GetData() const { return m_pData; }
+    uint32_t GetSize() const { return m_SizeInBytes; }
+    bool IsDirty() const { return m_DirtyBlocks != 0; }
+
+private:
+    uint8_t*    m_pData         = nullptr;  // RAMの内容(Linuxではファイルをマップしたメモリ).
+    uint32_t    m_SizeInBytes   = 0;
+    uint32_t    m_DirtyBlocks   = 0;        // 未書き出しのブロック(ビットごとにBlockSize単位).
+    char*       m_pPath         = nullptr;  // セーブファイルのパス(マップできない環境で使用).
+
+    BatteryRam(const BatteryRam&) = delete;
+    void operator = (const BatteryRam&) = delete;
+};
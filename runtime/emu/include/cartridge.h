@@ -8,6 +8,7 @@
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
+#include <cstddef>
 #include <cstdint>
 
 
@@ -111,13 +112,17 @@ struct CartridgeHeader
 ///////////////////////////////////////////////////////////////////////////////
 struct Cartridge
 {
-    CartridgeHeader Header;     //!< カートリッジヘッダー.
-    uint8_t         Data[1];    //!< カートリッジデータ.
+    uint8_t         Vectors[0x100]; //!< RST・割り込みベクタ.
+    CartridgeHeader Header;         //!< カートリッジヘッダー.
+    uint8_t         Data[1];        //!< カートリッジデータ.
 };
 
 //-----------------------------------------------------------------------------
 //! @brief      カートリッジをロードします.
 //! 
+//! @note       同じROMは読み込み済みのイメージを参照数付きで共有します.
+//!             Linuxではファイルを読み取り専用でマップするので, データは書き換えないでください.
+//! 
 //! @param[in]      path        ファイルパス.
 //! @param[out]     cartridge   カートリッジデータの格納先.
 //! @retval true    ロードに成功.
@@ -128,6 +133,8 @@ bool LoadCartridge(const char* path, Cartridge** cartridge);
 //-----------------------------------------------------------------------------
 //! @brief      カートリッジデータを解放します.
 //! 
+//! @note       参照数が0になった時点でイメージを破棄します.
+//! 
 //! @param[in]      cartridge   カートリッジデータ.
 //-----------------------------------------------------------------------------
 void UnloadCartridge(Cartridge*& cartridge);
@@ -140,3 +147,45 @@ void UnloadCartridge(Cartridge*& cartridge);
 //-----------------------------------------------------------------------------
 uint32_t GetRomSize(const Cartridge* cartridge);
 
+//-----------------------------------------------------------------------------
+//! @brief      ヘッダーの任天堂ロゴが正しいかどうかを判定します.
+//! 
+//! @param[in]      header      カートリッジヘッダー.
+//! @retval true    ロゴが一致.
+//! @retval false   ロゴが不一致.
+//-----------------------------------------------------------------------------
+bool IsValidLogo(const CartridgeHeader& header);
+
+//-----------------------------------------------------------------------------
+//! @brief      ヘッダーチェックサム(0x134-0x14C)を計算します.
+//! 
+//! @param[in]      header      カートリッジヘッダー.
+//! @return     チェックサムを返却します.
+//-----------------------------------------------------------------------------
+uint8_t CalcHeaderCheckSum(const CartridgeHeader& header);
+
+//-----------------------------------------------------------------------------
+//! @brief      グローバルチェックサム(0x14E-0x14Fを除く全バイトの和)を計算します.
+//! 
+//! @param[in]      binary      ROMイメージ.
+//! @param[in]      size        ROMイメージのサイズ.
+//! @return     チェックサムを返却します.
+//-----------------------------------------------------------------------------
+uint16_t CalcGlobalCheckSum(const uint8_t* binary, size_t size);
+
+//-----------------------------------------------------------------------------
+//! @brief      ROMバンクの先頭を取得します.
+//! 
+//! @param[in]      cartridge   カートリッジデータ.
+//! @param[in]      bank        ROMバンク番号(バンク数を超える場合は折り返す).
+//! @return     16KBのROMバンクの先頭を返却します.
+//-----------------------------------------------------------------------------
+const uint8_t* GetRomBank(const Cartridge* cartridge, uint32_t bank);
+
+//-----------------------------------------------------------------------------
+//! @brief      ROMバンク数を取得します.
+//! 
+//! @param[in]      cartridge   カートリッジデータ.
+//! @return     16KB単位のバンク数を返却します.
+//-----------------------------------------------------------------------------
+uint32_t GetRomBankCount(const Cartridge* cartridge);
@@ -9,7 +9,36 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <cstdint>
+#include <cstddef>
+#include <array>
+#include <utility>
 #include <mem.h>
+#include <recompiler.h>
+#include <profiler.h>
+
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+#ifndef CPU_ENABLE_LAZY_FLAGS
+#define CPU_ENABLE_LAZY_FLAGS   (1)     // フラグを読み取られるまで計算しない.
+#endif
+
+#ifndef CPU_ENABLE_THREADED_DISPATCH
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_ENABLE_THREADED_DISPATCH    (1)     // computed gotoによるスレッデッドディスパッチ.
+#else
+#define CPU_ENABLE_THREADED_DISPATCH    (0)
+#endif
+#endif
+
+#ifndef CPU_ENABLE_IDLE_LOOP_SKIP
+#define CPU_ENABLE_IDLE_LOOP_SKIP   (1)     // ポーリングループを検出して次のイベントまで読み飛ばす.
+#endif
+
+#ifndef CPU_ENABLE_PROFILER
+#define CPU_ENABLE_PROFILER         (1)     // 命令単位のプロファイラを接続可能にする.
+#endif
 
 
 inline uint16_t ToU16(uint8_t hiWord, uint8_t loWord)
@@ -22,6 +51,39 @@ inline void FromU16(uint8_t& hiWord, uint8_t& loWord, uint16_t value)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// EXECUTION_MODE enum
+///////////////////////////////////////////////////////////////////////////////
+enum EXECUTION_MODE
+{
+    EXECUTION_MODE_INTERPRETER  = 0,    //!< インタプリタ.
+    EXECUTION_MODE_RECOMPILER   = 1,    //!< 動的再コンパイル(非対応環境ではインタプリタ).
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ACCURACY enum
+///////////////////////////////////////////////////////////////////////////////
+enum ACCURACY
+{
+    ACCURACY_INSTRUCTION    = 0,    //!< 命令の完了時にまとめてサイクルを加算する(高速).
+    ACCURACY_MCYCLE         = 1,    //!< メモリアクセスごとにMサイクル単位で進める(高精度).
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// INTERRUPT enum
+///////////////////////////////////////////////////////////////////////////////
+enum INTERRUPT
+{
+    INTERRUPT_VBLANK    = 0x01,     //!< VBlank.
+    INTERRUPT_LCD_STAT  = 0x02,     //!< LCDステータス.
+    INTERRUPT_TIMER     = 0x04,     //!< タイマー.
+    INTERRUPT_SERIAL    = 0x08,     //!< シリアル転送完了.
+    INTERRUPT_JOYPAD    = 0x10,     //!< ジョイパッド入力.
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Cpu class
 ///////////////////////////////////////////////////////////////////////////////
@@ -47,8 +109,8 @@ public:
         {
             struct 
             {
-                uint8_t B;  //!< Bレジスタ.
-                uint8_t C;  //!< Cレジスタ.
+                uint8_t C;  //!< Cレジスタ(下位バイト).
+                uint8_t B;  //!< Bレジスタ(上位バイト).
             };
             uint16_t    BC = 0;
         };
@@ -56,8 +118,8 @@ public:
         {
             struct
             {
-                uint8_t D;  //!< Dレジスタ.
-                uint8_t E;  //!< Eレジスタ.
+                uint8_t E;  //!< Eレジスタ(下位バイト).
+                uint8_t D;  //!< Dレジスタ(上位バイト).
             };
             uint16_t DE = 0;
         };
@@ -65,8 +127,8 @@ public:
         {
             struct 
             {
-                uint8_t H;  //!< Hレジスタ.
-                uint8_t L;  //!< Lレジスタ.
+                uint8_t L;  //!< Lレジスタ(下位バイト).
+                uint8_t H;  //!< Hレジスタ(上位バイト).
             };
             uint16_t HL = 0;
         };
@@ -74,8 +136,8 @@ public:
         {
             struct
             {
-                uint8_t         A;  //!< アキュムレータ.
-                FlagRegister    F;  //!< フラグレジスタ.
+                FlagRegister    F;  //!< フラグレジスタ(下位バイト).
+                uint8_t         A;  //!< アキュムレータ(上位バイト).
             };
             uint16_t AF = 0;
         };
@@ -91,52 +153,61 @@ public:
         uint8_t     TimerControl    = 0;    // TAC.
     };
 
+    // Mサイクルごとに呼ばれる周辺機器の更新処理.
+    using TickHandler = void (*)(void* pUser, uint64_t cycles);
+
     Cpu() = default;
 
+    bool Init();
+    void Term();
+
     inline uint8_t GetA() const { return m_Register.A; }
-    inline uint8_t GetF() const { return m_Register.F.Value; }
+    inline uint8_t GetF() const { return ComputeFlags(); }
     inline uint8_t GetB() const { return m_Register.B; }
     inline uint8_t GetC() const { return m_Register.C; }
     inline uint8_t GetD() const { return m_Register.D; }
     inline uint8_t GetE() const { return m_Register.E; }
     inline uint8_t GetH() const { return m_Register.H; }
     inline uint8_t GetL() const { return m_Register.L; }
-    inline uint16_t GetAF() const { return m_Register.AF; }
+    inline uint16_t GetAF() const { auto reg = m_Register; reg.F.Value = ComputeFlags(); return reg.AF; }
     inline uint16_t GetBC() const { return m_Register.BC; }
     inline uint16_t GetDE() const { return m_Register.DE; }
     inline uint16_t GetHL() const { return m_Register.HL; }
     inline uint16_t GetSP() const { return m_Register.SP; }
     inline uint16_t GetPC() const { return m_Register.PC; }
-    inline bool GetFlagZ() const { return !!m_Register.F.Z; }
-    inline bool GetFlagN() const { return !!m_Register.F.N; }
-    inline bool GetFlagH() const { return !!m_Register.F.H; }
-    inline bool GetFlagC() const { return !!m_Register.F.C; }
+    inline bool GetFlagZ() const { return (ComputeFlags() & FlagMaskZ) != 0; }
+    inline bool GetFlagN() const { return (ComputeFlags() & FlagMaskN) != 0; }
+    inline bool GetFlagH() const { return (ComputeFlags() & FlagMaskH) != 0; }
+    inline bool GetFlagC() const { return ComputeCarry() != 0; }
 
     inline void SetA(uint8_t value) { m_Register.A = value; }
-    inline void SetF(uint8_t value) { m_Register.F.Value = value; }
+    inline void SetF(uint8_t value) { DiscardFlags(); m_Register.F.Value = value; }
     inline void SetB(uint8_t value) { m_Register.B = value; }
     inline void SetC(uint8_t value) { m_Register.C = value; }
     inline void SetD(uint8_t value) { m_Register.D = value; }
     inline void SetE(uint8_t value) { m_Register.E = value; }
     inline void SetH(uint8_t value) { m_Register.H = value; }
     inline void SetL(uint8_t value) { m_Register.L = value; }
-    inline void SetAF(uint16_t value) { m_Register.AF = value; }
+    inline void SetAF(uint16_t value) { DiscardFlags(); m_Register.AF = value; }
     inline void SetBC(uint16_t value) { m_Register.BC = value; }
     inline void SetDE(uint16_t value) { m_Register.DE = value; }
     inline void SetHL(uint16_t value) { m_Register.HL = value; }
     inline void SetSP(uint16_t value) { m_Register.SP = value; }
     inline void SetPC(uint16_t value) { m_Register.PC = value; }
-    inline void SetFlagZ(bool value) { m_Register.F.Z = value ? 1 : 0; }
-    inline void SetFlagN(bool value) { m_Register.F.N = value ? 1 : 0; }
-    inline void SetFlagH(bool value) { m_Register.F.H = value ? 1 : 0; }
-    inline void SetFlagC(bool value) { m_Register.F.C = value ? 1 : 0; }
-    inline void CheckZero(uint8_t  val) { if (val == 0) { m_Register.F.Z = 1; } }
-    inline void CheckZero(uint16_t val) { if (val == 0) { m_Register.F.Z = 1; } }
+    inline void SetFlagZ(bool value) { MaterializeFlags(); m_Register.F.Z = value ? 1 : 0; }
+    inline void SetFlagN(bool value) { MaterializeFlags(); m_Register.F.N = value ? 1 : 0; }
+    inline void SetFlagH(bool value) { MaterializeFlags(); m_Register.F.H = value ? 1 : 0; }
+    inline void SetFlagC(bool value) { MaterializeFlags(); m_Register.F.C = value ? 1 : 0; }
+    inline void CheckZero(uint8_t  val) { SetFlagZ(val == 0); }
+    inline void CheckZero(uint16_t val) { SetFlagZ(val == 0); }
 
     inline bool IsEnableColor() const { return m_EnableColor; }
     inline bool IsEnableSuper() const { return m_EnableSuper; }
 
-    inline uint8_t GetConsumedCycles() const { return m_ConsumedCycles; }
+    inline uint64_t GetConsumedCycles() const { return m_ConsumedCycles; }
+
+    inline void SetNextEventCycle(uint64_t cycle) { m_NextEventCycle = cycle; }
+    inline uint64_t GetNextEventCycle() const { return m_NextEventCycle; }
 
     inline uint8_t  Read8 (uint16_t address) const { return m_pMemory->Read8 (address); }
     inline uint16_t Read16(uint16_t address) const { return m_pMemory->Read16(address); }
@@ -152,37 +223,213 @@ public:
 
     inline void SetMemory(Memory* memory) { m_pMemory = memory; }
 
-    void Execute(); // 命令を実行する.
+    void RequestInterrupt(INTERRUPT value);
+    inline bool IsHalted() const { return m_EnablePowerSave; }
+
+    bool SetExecutionMode(EXECUTION_MODE mode);
+    inline EXECUTION_MODE GetExecutionMode() const { return m_ExecutionMode; }
+
+    // ACCURACY_MCYCLEでは1命令ずつ逐次実行し, 動的再コンパイルとポーリングループの省略は行わない.
+    inline void SetAccuracy(ACCURACY value) { m_Accuracy = value; }
+    inline ACCURACY GetAccuracy() const { return m_Accuracy; }
+
+    inline void SetTickHandler(TickHandler handler, void* pUser)
+    {
+        m_pTickHandler = handler;
+        m_pTickUser    = pUser;
+    }
+
+    // プロファイラの接続中は1命令ずつ逐次実行し, 動的再コンパイルとポーリングループの省略は行わない.
+    inline void SetProfiler(Profiler* profiler) { m_pProfiler = profiler; }
+    inline Profiler* GetProfiler() const { return m_pProfiler; }
+
+    void Execute(); // 命令を1つ実行する.
+
+    // 指定サイクル数か次のイベントに達するまで実行し, 実際に消費したサイクル数を返す.
+    uint64_t RunCycles(uint64_t budget);
 
 private:
+    static constexpr uint8_t FlagMaskZ = 0x80;
+    static constexpr uint8_t FlagMaskN = 0x40;
+    static constexpr uint8_t FlagMaskH = 0x20;
+    static constexpr uint8_t FlagMaskC = 0x10;
+
+    static constexpr uint16_t AddressIF = 0xFF0F;   //!< 割り込み要求フラグ.
+    static constexpr uint16_t AddressIE = 0xFFFF;   //!< 割り込み許可フラグ.
+
+    // 条件コード.
+    enum CONDITION : uint8_t
+    {
+        CONDITION_NZ,       // Zフラグが0.
+        CONDITION_Z,        // Zフラグが1.
+        CONDITION_NC,       // Cフラグが0.
+        CONDITION_C,        // Cフラグが1.
+        CONDITION_ALWAYS,   // 無条件.
+    };
+
+    // フラグを最後に更新した演算の種類.
+    enum FLAG_OP : uint8_t
+    {
+        FLAG_OP_NONE,   // Fレジスタの値がそのまま有効.
+        FLAG_OP_ADD,    // ADD, ADC.
+        FLAG_OP_SUB,    // SUB, SBC, CP.
+        FLAG_OP_AND,    // AND.
+        FLAG_OP_OR,     // OR, XOR.
+        FLAG_OP_INC,    // INC.
+        FLAG_OP_DEC,    // DEC.
+    };
+
+    struct LazyFlags
+    {
+        uint8_t     Op;     //!< FLAG_OP.
+        uint8_t     Lhs;    //!< 左オペランド(AND/ORは演算結果).
+        uint8_t     Rhs;    //!< 右オペランド.
+        uint8_t     Carry;  //!< キャリー入力(INC/DECは保持するCフラグ).
+    };
+
+    using Handler      = void (Cpu::*)();
+    using HandlerTable = std::array<Handler, 256>;
+
+    static constexpr uint32_t BlockCacheSize   = 2048;  //!< デコードキャッシュのエントリ数(2のべき乗).
+    static constexpr uint8_t  MaxBlockCommands = 16;    //!< 1ブロックあたりの最大命令数.
+    static constexpr uint16_t RecompileThreshold = 16;  //!< 再コンパイルするまでの実行回数.
+    static constexpr uint32_t RecompilerCodeSize = 4 * 1024 * 1024; //!< 変換済みコード領域のサイズ.
+
+    struct DecodedCommand
+    {
+        Handler     Func;       //!< 実行ハンドラ.
+        uint16_t    Operand;    //!< オペランド.
+        uint8_t     OpCode;     //!< オペコード.
+        uint8_t     Length;     //!< 命令長.
+        uint8_t     Cycles;     //!< 消費サイクル数.
+    };
+
+    struct DecodedBlock
+    {
+        uint16_t            PC;                 //!< 先頭アドレス.
+        uint16_t            Bank;               //!< ROMバンク番号.
+        uint32_t            Version;            //!< デコード時のページ書き込み世代.
+        uint8_t             Count;              //!< 命令数(0なら無効).
+        uint8_t             NativeCount;        //!< ネイティブコードで実行する先頭からの命令数.
+        uint8_t             IdleCycles;         //!< ポーリングループ1周分のサイクル数(0ならループではない).
+        uint16_t            NativeCycles;       //!< ネイティブコード部分の最大消費サイクル数.
+        uint16_t            NativeLength;       //!< ネイティブコード部分のバイト数.
+        uint16_t            HitCount;           //!< 実行回数.
+        uint32_t            NativeGeneration;   //!< 変換時のコード領域の世代.
+        Recompiler::Entry   pNative;            //!< ネイティブコード.
+        uint8_t*            pNativeChain;       //!< 他のブロックから直接ジャンプする入口.
+        DecodedCommand      Commands[MaxBlockCommands];
+    };
+
+    static const HandlerTable s_CommandTable[2];    // 命令テーブル(ACCURACYごと).
+    static const HandlerTable s_PrefixTable[2];     // CBプレフィックス命令テーブル(ACCURACYごと).
+
     Register    m_Register          = {};
     Timer       m_Timer             = {};
     bool        m_EnableColor       = false;
     bool        m_EnableSuper       = false;
     bool        m_EnablePowerSave   = false;
     bool        m_EnableInterrputs  = false;
-    uint8_t     m_ConsumedCycles    = 0;
+    bool        m_DeferredEI        = false;    // EIの次の命令の後で割り込みを許可する.
+    uint64_t    m_ConsumedCycles    = 0;    // 電源投入からの累積サイクル数.
+    uint64_t    m_NextEventCycle    = UINT64_MAX;   // 次のイベント発生サイクル.
+    uint16_t    m_Operand           = 0;    // デコード済みオペランド.
+    LazyFlags   m_LazyFlags         = {};   // 未評価のフラグ演算.
     Memory*     m_pMemory           = nullptr;
-
-    void ExecuteCommand(uint8_t opCode);
-    void ExecutePrefixCommand(uint8_t opCode);
+    DecodedBlock*   m_pBlocks       = nullptr;  // デコードキャッシュ.
+    EXECUTION_MODE  m_ExecutionMode = EXECUTION_MODE_INTERPRETER;
+    Recompiler      m_Recompiler;
+    Recompiler::Context m_NativeContext = {};   // 変換済みコードの実行時の状態.
+    uint8_t*        m_pLinkSite     = nullptr;  // 最後に通った未接続の分岐.
+    uint16_t        m_LinkPC        = 0;        // m_pLinkSiteの分岐先.
+    uint32_t        m_LinkGeneration = 0;       // m_pLinkSiteを記録した時のコード領域の世代.
+    ACCURACY        m_Accuracy      = ACCURACY_INSTRUCTION;
+    TickHandler     m_pTickHandler  = nullptr;
+    void*           m_pTickUser     = nullptr;
+    Profiler*       m_pProfiler     = nullptr;
+
+    template<ACCURACY Accuracy> void RunUntil(uint64_t limit);
+    template<ACCURACY Accuracy> void ExecuteCommand(uint8_t opCode);
+    template<ACCURACY Accuracy> void ExecuteNext();
+    template<ACCURACY Accuracy> void ExecutePrefixCommand(uint8_t opCode);
+    template<ACCURACY Accuracy> void ServiceInterrupt(uint8_t pending);
+    uint8_t GetPendingInterrupts() const;
+    void ExecuteBlock(const DecodedBlock& block, uint32_t index, uint64_t limit);
+    uint32_t ExecuteNative(DecodedBlock& block, uint64_t limit);
+    bool CompileBlock(DecodedBlock& block);
+    static uint8_t ReadNative (void* pUser, uint16_t address);
+    static bool    WriteNative(void* pUser, uint16_t address, uint8_t value);
+
+    DecodedBlock* FindBlock(uint16_t pc);
+    void DecodeBlock(DecodedBlock& block, uint16_t pc, uint16_t bank);
+    bool IsValidBlock(const DecodedBlock& block) const;
+    uint8_t GetIdleCycles(const DecodedBlock& block) const;
+
+    inline bool IsProfiling() const
+    {
+    #if CPU_ENABLE_PROFILER
+        return m_pProfiler != nullptr;
+    #else
+        return false;
+    #endif
+    }
+
+    inline uint16_t GetBankOf(uint16_t address) const
+    { return (address >= 0x4000 && address < 0x8000) ? m_pMemory->GetRomBank() : 0; }
+
+    template<ACCURACY Accuracy, uint8_t OpCode> void Command();
+    template<ACCURACY Accuracy, uint8_t OpCode> void PrefixCommand();
+    template<uint8_t OpCode> void ExecuteDecoded(const DecodedCommand& cmd);
+
+    // バスアクセス. ACCURACY_MCYCLEではアクセスの前に1Mサイクル進める.
+    template<ACCURACY Accuracy> void     Tick();
+    template<ACCURACY Accuracy> void     Idle();                // 内部動作のみのMサイクル.
+    template<ACCURACY Accuracy> uint8_t  BusRead8  (uint16_t address);
+    template<ACCURACY Accuracy> uint16_t BusRead16 (uint16_t address);
+    template<ACCURACY Accuracy> void     BusWrite8 (uint16_t address, uint8_t  value);
+    template<ACCURACY Accuracy> void     BusWrite16(uint16_t address, uint16_t value);
+
+    // オペコードのビットフィールドで指定されるオペランド.
+    template<ACCURACY Accuracy, uint8_t Index> uint8_t GetR8();    // B, C, D, E, H, L, (HL), A
+    template<ACCURACY Accuracy, uint8_t Index> void    SetR8(uint8_t value);
+    template<uint8_t Index> uint16_t& R16();                        // BC, DE, HL, SP
+    template<uint8_t Cond>  bool      Condition() const;            // NZ, Z, NC, C, (無条件)
+
+    template<ACCURACY Accuracy, size_t... Index>
+    static constexpr HandlerTable MakeCommandTable(std::index_sequence<Index...>);
+    template<ACCURACY Accuracy, size_t... Index>
+    static constexpr HandlerTable MakePrefixTable(std::index_sequence<Index...>);
 
     uint8_t  n () const;
     uint16_t nn() const;
 
-    void Carry (uint8_t lhs, uint8_t rhs);
-    void Borrow(uint8_t lhs, uint8_t rhs);
+    uint8_t ComputeFlags() const;
+    uint8_t ComputeCarry() const;
+    bool    ComputeZero () const;
+    void MaterializeFlags();
+    inline void DiscardFlags() { m_LazyFlags.Op = FLAG_OP_NONE; }
+    inline void RecordFlags(FLAG_OP op, uint8_t lhs, uint8_t rhs, uint8_t carry)
+    {
+        m_LazyFlags.Op    = op;
+        m_LazyFlags.Lhs   = lhs;
+        m_LazyFlags.Rhs   = rhs;
+        m_LazyFlags.Carry = carry;
+    #if !CPU_ENABLE_LAZY_FLAGS
+        MaterializeFlags();
+    #endif
+    }
 
     // 8-Bit Loads
     void LD(uint8_t& lhs, uint8_t rhs);
 
     // 16-Bit Loads
     void LD  (uint16_t& lhs, uint16_t rhs);
-    void LDHL(uint16_t  lhs,  uint8_t  rhs);
-    void PUSH(uint16_t  val);
-    void POP (uint16_t& val);
+    void LDHL(uint8_t   rhs);
+    template<ACCURACY Accuracy> void PUSH(uint16_t  val);
+    template<ACCURACY Accuracy> void POP (uint16_t& val);
 
     // 8-Bit ALU
+    template<uint8_t Op> void ALU(uint8_t rhs);   // ADD, ADC, SUB, SBC, AND, XOR, OR, CP
     void ADD(uint8_t& lhs, uint8_t rhs);
     void ADC(uint8_t& lhs, uint8_t rhs);
     void SUB(uint8_t& lhs, uint8_t rhs);
@@ -198,9 +445,10 @@ private:
     void ADD(uint16_t& lhs, uint16_t rhs);
     void INC(uint16_t& val);
     void DEC(uint16_t& val);
+    uint16_t OffsetSP(uint8_t rhs);
 
     // Miscellaneous
-    void SWAP(uint8_t& lhs, uint8_t& rhs);
+    void SWAP(uint8_t& val);
     void DAA ();
     void CPL ();
     void CCF ();
@@ -212,35 +460,31 @@ private:
     void EI  ();
 
     // Rotates & Shifts
-    void RLCA();
-    void RLA();
-    void RRCA();
-    void RRA();
-    void RLC(uint8_t& lhs, uint8_t rhs);
-    void RL (uint8_t& lhs, uint8_t rhs);
-    void RRC(uint8_t& lhs, uint8_t rhs);
-    void RR (uint8_t& lhs, uint8_t rhs);
-    void SLA(uint8_t& lhs, uint8_t rsh);
-    void SAR(uint8_t& lhs, uint8_t rhs);
-    void SRL(uint8_t& lhs, uint8_t rhs);
+    template<uint8_t Op> void ROT(uint8_t& val);  // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL
+    void RLC(uint8_t& val);
+    void RL (uint8_t& val);
+    void RRC(uint8_t& val);
+    void RR (uint8_t& val);
+    void SLA(uint8_t& val);
+    void SRA(uint8_t& val);
+    void SRL(uint8_t& val);
 
     // Bit OpCodes.
-    void BIT(uint8_t& lhs, uint8_t rhs);
-    void SET(uint8_t& lhs, uint8_t rhs);
-    void RES(uint8_t& lhs, uint8_t rhs);
+    void BIT(uint8_t bit, uint8_t  val);
+    void SET(uint8_t bit, uint8_t& val);
+    void RES(uint8_t bit, uint8_t& val);
 
     // Jumps
-    void JP(bool flag, uint8_t  addr);
-    void JP(bool flag, uint16_t addr);
+    template<ACCURACY Accuracy, uint8_t Cond> void JP(uint16_t addr);
+    template<ACCURACY Accuracy, uint8_t Cond> void JR(uint8_t  offset);
 
     // Calls
-    void CALL(bool flag, uint16_t addr);
+    template<ACCURACY Accuracy, uint8_t Cond> void CALL(uint16_t addr);
 
     // Restarts
-    void RST(uint8_t addr);
+    template<ACCURACY Accuracy> void RST(uint16_t addr);
 
     // Returns.
-    void RET(bool flag);
-    void RETI();
-  
+    template<ACCURACY Accuracy, uint8_t Cond> void RET();
+    template<ACCURACY Accuracy> void RETI();
 };
@@ -5,17 +5,17 @@
 //-----------------------------------------------------------------------------
 #pragma once
 
-#define PLATFORM_WIN64 (1)
-
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
 #include <cstdint>
+#include <platform.h>
 #include <cpu.h>
 #include <ppu.h>
 #include <apu.h>
 #include <mem.h>
 #include <cartridge.h>
+#include <mapper.h>
 
 #if PLATFORM_WIN64
 #include <Windows.h>
@@ -44,10 +44,29 @@ public:
     Emulator () = default;
     ~Emulator() = default;
 
+    bool Init();
+    void Term();
     void Run();
-
+    void RunFrame();
+
+    // countフレーム実行し, 最後のrenderFramesフレームだけは描画を無効にしていても描画する.
+    void RunFrames(uint32_t count, uint32_t renderFrames = 0);
+
+    uint64_t GetCycles() const { return m_CPU.GetConsumedCycles(); }
+
+    void SetAccuracy(ACCURACY value);
+    ACCURACY GetAccuracy() const { return m_CPU.GetAccuracy(); }
+    void SetProfiler(Profiler* profiler) { m_CPU.SetProfiler(profiler); }
+    void SetPpuRenderer(PPU_RENDERER value) { m_PPU.SetRenderer(value); }
+    PPU_RENDERER GetPpuRenderer() const { return m_PPU.GetRenderer(); }
+    void SetRenderEnable(bool value) { m_PPU.SetRenderEnable(value); }
+    bool IsRenderEnabled() const { return m_PPU.IsRenderEnabled(); }
+    bool SetPpuThread(bool enable) { return m_PPU.SetThreadEnable(enable); }
+    bool IsPpuThreadEnabled() const { return m_PPU.IsThreadEnabled(); }
     const Memory& GetMemory() const { return m_Memory; }
-    void SetRom(const Cartridge* rom);
+    bool SetRom(const Cartridge* rom, const char* savePath = nullptr);
+    void SetSaveInterval(uint32_t frames) { m_SaveInterval = frames; }
+    void SetRtcMode(RTC_MODE mode) { m_Mapper.SetRtcMode(mode); }
     void SetJoyPad(uint8_t value);
 
 private:
@@ -58,7 +77,10 @@ private:
     Ppu                 m_PPU       = {};
     Apu                 m_APU       = {};
     Memory              m_Memory    = {};
+    Mapper              m_Mapper;
     const Cartridge*    m_ROM       = nullptr;
+    uint32_t            m_SaveInterval  = 60;   // セーブファイルへの書き出し間隔(フレーム数, 0なら終了時のみ).
+    uint32_t            m_SaveFrames    = 0;    // 前回の書き出しからのフレーム数.
 
 #if PLATFORM_WIN64
     HINSTANCE m_hInst = nullptr;
@@ -71,11 +93,12 @@ private:
     bool InitWnd (uint32_t w, uint32_t h);
     void TermWnd ();
     void MainLoop();
-
-    bool Init();
-    void Term();
     void Update();
 
+    static void OnTick(void* pUser, uint64_t cycles);
+    static uint64_t OnGetCycles(void* pUser);
+    static void OnSchedule(void* pUser, uint64_t cycle);
+
 #if PLATFORM_WIN64
     static LRESULT CALLBACK MsgProc(HWND hWnd, UINT msg, WPARAM wp, LPARAM lp);
 #endif
@@ -0,0 +1,36 @@
+﻿//-----------------------------------------------------------------------------
+// File   : hash.h
+// Desc   : CRC32 / SHA-1.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+
+
+//-----------------------------------------------------------------------------
+//! @brief      CRC32(ZIPと同じ多項式)を計算します.
+//!
+//! @note       PCLMULQDQが使える環境では畳み込みで計算します.
+//!
+//! @param[in]      data        データ.
+//! @param[in]      size        データサイズ.
+//! @param[in]      crc         継続して計算する場合は前回の結果.
+//! @return     CRC32を返却します.
+//-----------------------------------------------------------------------------
+uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0);
+
+//-----------------------------------------------------------------------------
+//! @brief      SHA-1を計算します.
+//!
+//! @note       SHA拡張命令が使える環境ではそれを使って計算します.
+//!
+//! @param[in]      data        データ.
+//! @param[in]      size        データサイズ.
+//! @param[out]     digest      ダイジェスト(20バイト)の格納先.
+//-----------------------------------------------------------------------------
+void Sha1(const void* data, size_t size, uint8_t digest[20]);
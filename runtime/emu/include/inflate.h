@@ -0,0 +1,132 @@
+﻿//-----------------------------------------------------------------------------
+// File   : inflate.h
+// Desc   : Streaming DEFLATE Decoder.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// INFLATE_RESULT enum
+///////////////////////////////////////////////////////////////////////////////
+enum INFLATE_RESULT
+{
+    INFLATE_DONE        = 0,    //!< ストリームの終端まで展開した.
+    INFLATE_MORE_OUTPUT = 1,    //!< 出力先が一杯になった.
+    INFLATE_ERROR       = 2,    //!< データが壊れている.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Inflater class
+///////////////////////////////////////////////////////////////////////////////
+class Inflater
+{
+public:
+    //-------------------------------------------------------------------------
+    //! @brief      入力データを読み込む関数です.
+    //!
+    //! @return     読み込んだバイト数を返却します(0なら終端).
+    //-------------------------------------------------------------------------
+    using ReadHandler = size_t (*)(void* pUser, uint8_t* buffer, size_t size);
+
+    static constexpr uint32_t InputBufferSize = 64 * 1024;  //!< 一度に読み込むサイズ.
+
+    Inflater() = default;
+    ~Inflater() { Term(); }
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pRead       入力データの読み込み関数.
+    //! @param[in]      pUser       読み込み関数に渡すユーザーデータ.
+    //! @retval true    初期化に成功.
+    //! @retval false   メモリの確保に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(ReadHandler pRead, void* pUser);
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      DEFLATEストリームを展開します.
+    //!
+    //! @note       参照する過去のデータは出力先から直接読むので, 呼び出しをまたいで
+    //!             出力済みのデータを同じ位置に保持してください.
+    //!
+    //! @param[out]     output      出力先.
+    //! @param[in]      outputSize  出力先のサイズ.
+    //! @param[in,out]  position    出力済みのバイト数.
+    //! @return     展開結果を返却します.
+    //-------------------------------------------------------------------------
+    INFLATE_RESULT Inflate(uint8_t* output, size_t outputSize, size_t& position);
+
+    //-------------------------------------------------------------------------
+    //! @brief      圧縮されていないデータを読み込みます(コンテナのヘッダー用).
+    //!
+    //! @param[out]     buffer      格納先(nullptrなら読み飛ばす).
+    //! @param[in]      size        読み込むバイト数.
+    //! @retval true    読み込みに成功.
+    //! @retval false   入力が足りない.
+    //-------------------------------------------------------------------------
+    bool Read(void* buffer, size_t size);
+
+private:
+    //=========================================================================
+    // Huffman structure
+    //=========================================================================
+    static constexpr uint32_t FastBits = 9;     // 1回の表引きで復号する符号長.
+
+    struct Huffman
+    {
+        uint16_t    Fast[1 << FastBits];        // 下位4bit=符号長, 上位=シンボル(0なら長い符号).
+        uint16_t    Count[16];                  // 符号長ごとのシンボル数.
+        uint16_t    Symbol[288];                // 符号順に並べたシンボル.
+    };
+
+    //=========================================================================
+    // STATE enum
+    //=========================================================================
+    enum STATE
+    {
+        STATE_HEADER,       // ブロックヘッダー待ち.
+        STATE_STORED,       // 非圧縮ブロック.
+        STATE_HUFFMAN,      // 圧縮ブロック.
+        STATE_DONE,         // 最終ブロックの終端.
+    };
+
+    ReadHandler m_pRead         = nullptr;
+    void*       m_pUser         = nullptr;
+    uint8_t*    m_pInput        = nullptr;  // 入力バッファ.
+    size_t      m_InputPos      = 0;
+    size_t      m_InputSize     = 0;
+    bool        m_InputEnd      = false;    // 入力を最後まで読み込んだ.
+    uint64_t    m_BitBuffer     = 0;        // 未消費のビット(LSBから順に使う).
+    uint32_t    m_BitCount      = 0;
+    bool        m_Overrun       = false;    // 入力の終端を超えて読もうとした.
+    STATE       m_State         = STATE_HEADER;
+    bool        m_Final         = false;    // 最終ブロックかどうか.
+    uint32_t    m_StoredLength  = 0;        // 非圧縮ブロックの残りバイト数.
+    uint32_t    m_CopyLength    = 0;        // 出力先が一杯で中断した一致の残り長さ.
+    uint32_t    m_CopyDistance  = 0;        // 中断した一致の距離.
+    Huffman     m_LitLen        = {};       // リテラル・長さ符号.
+    Huffman     m_Distance      = {};       // 距離符号.
+
+    bool FillInput();
+    void FillBits();
+    uint32_t PeekBits(uint32_t count);
+    uint32_t ReadBits(uint32_t count);
+    int  Decode(const Huffman& huffman);
+    int  Peek(const Huffman& huffman, uint32_t& length);
+    bool ReadBlockHeader();
+    bool ReadDynamicTables();
+
+    static bool Build(Huffman& huffman, const uint8_t* lengths, uint32_t count);
+
+    Inflater(const Inflater&) = delete;
+    void operator = (const Inflater&) = delete;
+};
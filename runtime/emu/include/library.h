@@ -0,0 +1,98 @@
+﻿//-----------------------------------------------------------------------------
+// File   : library.h
+// Desc   : ROM Library Index.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LIBRARY_FLAG enum
+///////////////////////////////////////////////////////////////////////////////
+enum LIBRARY_FLAG
+{
+    LIBRARY_FLAG_VALID_LOGO         = 0x01,     //!< 任天堂ロゴが一致.
+    LIBRARY_FLAG_VALID_HEADER_SUM   = 0x02,     //!< ヘッダーチェックサムが一致.
+    LIBRARY_FLAG_VALID_GLOBAL_SUM   = 0x04,     //!< グローバルチェックサムが一致.
+    LIBRARY_FLAG_VALID_SIZE         = 0x08,     //!< ファイルサイズがヘッダーのROMサイズと一致.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// LibraryEntry structure
+///////////////////////////////////////////////////////////////////////////////
+struct LibraryEntry
+{
+    uint64_t    Size;               //!< ファイルサイズ.
+    int64_t     ModifiedTime;       //!< 更新日時(ファイルシステム依存の単位).
+    uint32_t    PathOffset;         //!< 文字列テーブル内のパスの位置.
+    uint32_t    Crc32;              //!< ファイル全体のCRC32.
+    uint8_t     Sha1[20];           //!< ファイル全体のSHA-1.
+    uint8_t     Title[16];          //!< ヘッダーのタイトル(終端文字無し).
+    uint8_t     CartridgeType;      //!< カートリッジタイプ.
+    uint8_t     RomSize;            //!< ROMサイズ.
+    uint8_t     RamSize;            //!< RAMサイズ.
+    uint8_t     Flags;              //!< LIBRARY_FLAGの組み合わせ.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Library class
+///////////////////////////////////////////////////////////////////////////////
+class Library
+{
+public:
+    Library() = default;
+    ~Library() { Term(); }
+
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      インデックスファイルを読み込みます.
+    //!
+    //! @param[in]      path        インデックスファイルのパス.
+    //! @retval true    読み込みに成功.
+    //! @retval false   ファイルが無いか, 形式が不正.
+    //-------------------------------------------------------------------------
+    bool Load(const char* path);
+
+    //-------------------------------------------------------------------------
+    //! @brief      インデックスファイルに書き出します.
+    //!
+    //! @param[in]      path        インデックスファイルのパス.
+    //! @retval true    書き出しに成功.
+    //! @retval false   書き出しに失敗.
+    //-------------------------------------------------------------------------
+    bool Save(const char* path) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ディレクトリ以下のROMを走査してインデックスを更新します.
+    //!
+    //! @note       パス・サイズ・更新日時が一致するファイルは前回の結果を再利用し,
+    //!             変更されたファイルだけを複数スレッドでハッシュ計算します.
+    //!
+    //! @param[in]      directory   走査するディレクトリ.
+    //! @param[in]      threadCount ハッシュ計算のスレッド数(0なら論理コア数).
+    //! @retval true    走査に成功.
+    //! @retval false   ディレクトリを開けないか, メモリの確保に失敗.
+    //-------------------------------------------------------------------------
+    bool Scan(const char* directory, uint32_t threadCount = 0);
+
+    uint32_t GetCount() const { return m_Count; }
+    uint32_t GetHashedCount() const { return m_HashedCount; }
+    const LibraryEntry& GetEntry(uint32_t index) const { return m_pEntries[index]; }
+    const char* GetPath(uint32_t index) const { return m_pStrings + m_pEntries[index].PathOffset; }
+
+private:
+    LibraryEntry*   m_pEntries      = nullptr;
+    uint32_t        m_Count         = 0;
+    char*           m_pStrings      = nullptr;  // パスの文字列テーブル(終端文字込みで連結).
+    uint32_t        m_StringSize    = 0;
+    uint32_t        m_HashedCount   = 0;        // 直前の走査でハッシュを計算したファイル数.
+
+    Library(const Library&) = delete;
+    void operator = (const Library&) = delete;
+};
@@ -0,0 +1,120 @@
+﻿//-----------------------------------------------------------------------------
+// File   : mapper.h
+// Desc   : Memory Bank Controller.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <mem.h>
+#include <cartridge.h>
+#include <battery.h>
+#include <rtc.h>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MAPPER_TYPE enum
+///////////////////////////////////////////////////////////////////////////////
+enum MAPPER_TYPE
+{
+    MAPPER_ROM_ONLY = 0,    //!< バンク切り替え無し.
+    MAPPER_MBC1     = 1,    //!< MBC1.
+    MAPPER_MBC2     = 2,    //!< MBC2(512x4bit内蔵RAM).
+    MAPPER_MBC3     = 3,    //!< MBC3.
+    MAPPER_MBC5     = 4,    //!< MBC5.
+    MAPPER_HUC1     = 5,    //!< HuC1(赤外線通信は非対応).
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Mapper class
+///////////////////////////////////////////////////////////////////////////////
+class Mapper
+{
+public:
+    Mapper() = default;
+    ~Mapper() { Term(); }
+
+    //-------------------------------------------------------------------------
+    //! @brief      カートリッジタイプからマッパーを決定し, メモリに接続します.
+    //!
+    //! @param[in]      rom         カートリッジデータ.
+    //! @param[in]      memory      接続先のメモリ.
+    //! @param[in]      savePath    バッテリーバックアップ付きRAMのセーブファイル(nullptrなら保存しない).
+    //! @retval true    初期化に成功.
+    //! @retval false   非対応のカートリッジタイプか, 外部RAMの確保に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const Cartridge* rom, Memory* memory, const char* savePath = nullptr);
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      バッテリーバックアップ付きRAMの変更をセーブファイルに書き出します.
+    //!
+    //! @param[in]      wait        書き出しの完了を待つかどうか.
+    //-------------------------------------------------------------------------
+    void FlushRam(bool wait);
+
+    //-------------------------------------------------------------------------
+    //! @brief      RTCが参照する累積サイクル数の取得関数を設定します(Initより前に呼び出します).
+    //-------------------------------------------------------------------------
+    void SetClock(Rtc::ClockHandler pClock, void* pUser) { m_pClock = pClock; m_pClockUser = pUser; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      RTCの進め方を設定します.
+    //-------------------------------------------------------------------------
+    void SetRtcMode(RTC_MODE mode);
+
+    MAPPER_TYPE GetType() const { return m_Type; }
+
+    uint8_t* GetRam() const { return m_pRam; }
+    uint32_t GetRamSize() const { return m_RamSize; }
+
+    static bool GetMapperType(uint8_t cartridgeType, MAPPER_TYPE& type);
+    static bool HasBattery(uint8_t cartridgeType);
+    static bool HasTimer(uint8_t cartridgeType);
+
+private:
+    const Cartridge*    m_pRom          = nullptr;
+    Memory*             m_pMemory       = nullptr;
+    MAPPER_TYPE         m_Type          = MAPPER_ROM_ONLY;
+    uint32_t            m_RomBankCount  = 0;        // 16KB単位のROMバンク数.
+    uint8_t*            m_pRam          = nullptr;  // 外部RAM.
+    uint32_t            m_RamSize       = 0;        // 外部RAMのサイズ.
+    uint32_t            m_RamBankCount  = 0;        // 8KB単位のRAMバンク数.
+    bool                m_RamEnable     = false;    // 外部RAMへのアクセス許可.
+    uint8_t             m_BankLow       = 1;        // ROMバンク番号の下位(MBC1ではBANK1).
+    uint8_t             m_BankHigh      = 0;        // ROMバンク番号の上位・RAMバンク番号(MBC1ではBANK2).
+    uint8_t             m_RamBank       = 0;        // RAMバンク番号.
+    uint8_t             m_BankMode      = 0;        // MBC1のバンキングモード.
+    uint32_t            m_CurrentBank0  = 0;        // 0x0000-0x3FFFにマウント中のバンク.
+    uint32_t            m_CurrentBank1  = 0;        // 0x4000-0x7FFFにマウント中のバンク.
+    uint32_t            m_MappedRamBank = UINT32_MAX;   // 0xA000-0xBFFFにマウント中のRAMバンク.
+    uint32_t            m_RamVersion    = 0;        // マウント時点の外部RAMページの書き込み世代.
+    BatteryRam          m_Battery;                  // セーブファイル.
+    bool                m_HasRtc        = false;    // MBC3のRTCを搭載しているか.
+    Rtc                 m_Rtc;                      // MBC3のRTC.
+    RTC_MODE            m_RtcMode       = RTC_MODE_CYCLE;
+    Rtc::ClockHandler   m_pClock        = nullptr;
+    void*               m_pClockUser    = nullptr;
+
+    void MountRom(uint32_t bank0, uint32_t bank1);
+    void MountRam(bool enable, uint32_t bank);
+    void CollectRamWrites();
+    void SaveRtc();
+    uint32_t GetRamVersion() const;
+
+    // バンクレジスタの処理はマッパーごとにコンパイル時に特殊化する.
+    template<MAPPER_TYPE Type> void WriteRegister(uint16_t address, uint8_t value);
+    template<MAPPER_TYPE Type> static void OnWriteRegister(void* pUser, uint16_t address, uint8_t value);
+
+    static uint8_t ReadMBC2Ram (void* pUser, uint16_t address);
+    static void    WriteMBC2Ram(void* pUser, uint16_t address, uint8_t value);
+    static uint8_t ReadRtc (void* pUser, uint16_t address);
+    static void    WriteRtc(void* pUser, uint16_t address, uint8_t value);
+
+    Mapper(const Mapper&) = delete;
+    void operator = (const Mapper&) = delete;
+};
@@ -9,6 +9,7 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <cstdint>
+#include <cstring>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -17,31 +18,154 @@
 class Memory
 {
 public:
+    // 副作用のあるページ・I/Oレジスタのアクセス処理.
+    using ReadHandler  = uint8_t (*)(void* pUser, uint16_t address);
+    using WriteHandler = void    (*)(void* pUser, uint16_t address, uint8_t value);
+
+    static constexpr uint32_t PageSize  = 0x100;    //!< ページサイズ.
+    static constexpr uint32_t PageCount = 0x100;    //!< ページ数.
+
     Memory() = default;
     ~Memory() = default;
 
     bool Init();
     void Term();
 
-    uint8_t  Read8 (uint16_t address) const;
-    uint16_t Read16(uint16_t address) const;
+    // 直接参照できるページは1回のテーブル引きで読み書きし, それ以外はハンドラで処理する.
+    inline uint8_t Read8(uint16_t address) const
+    {
+        auto page = m_pReadPages[address >> 8];
+        if (page != nullptr)
+        { return page[address & 0xFF]; }
+
+        return ReadHandled(address);
+    }
+
+    inline uint16_t Read16(uint16_t address) const
+    {
+        // ページ境界を跨ぐ場合とアドレス空間の末尾(0xFFFF)は1バイトずつ読む.
+        auto page = m_pReadPages[address >> 8];
+        if (page != nullptr && (address & 0xFF) != 0xFF)
+        {
+            uint16_t result = 0;
+            memcpy(&result, page + (address & 0xFF), sizeof(result));
+            return result;
+        }
+
+        return uint16_t(Read8(address) | (Read8(uint16_t(address + 1)) << 8));
+    }
+
+    inline void Write8(uint16_t address, uint8_t value)
+    {
+        auto page = m_pWritePages[address >> 8];
+        if (page != nullptr)
+        {
+            page[address & 0xFF] = value;
+            Touch(address);
+            return;
+        }
 
-    void Write8 (uint16_t address, uint8_t  value);
-    void Write16(uint16_t address, uint16_t value);
+        WriteHandled(address, value);
+    }
 
-    void Inc8 (uint16_t address);
-    void Inc16(uint16_t address);
+    inline void Write16(uint16_t address, uint16_t value)
+    {
+        Write8(address, uint8_t(value & 0xFF));
+        Write8(uint16_t(address + 1), uint8_t(value >> 8));
+    }
 
-    void Dec8 (uint16_t address);
-    void Dec16(uint16_t address);
+    inline void Inc8 (uint16_t address) { Write8 (address, uint8_t (Read8 (address) + 1)); }
+    inline void Inc16(uint16_t address) { Write16(address, uint16_t(Read16(address) + 1)); }
 
+    inline void Dec8 (uint16_t address) { Write8 (address, uint8_t (Read8 (address) - 1)); }
+    inline void Dec16(uint16_t address) { Write16(address, uint16_t(Read16(address) - 1)); }
+
+    // ROMデータはコピーせずに参照するので, マウント中は解放しないこと.
     void MountRomBank0(const uint8_t* data, uint32_t sizeInBytes);
-    void MountRomBank1(const uint8_t* data, uint32_t sizeInBytes);
+    void MountRomBank1(const uint8_t* data, uint32_t sizeInBytes, uint16_t bank);
+
+    // 外部RAM(0xA000-0xBFFF)をマウントする. 8KBに満たない場合は繰り返し, nullptrならオープンバス.
+    void MountRam(uint8_t* data, uint32_t sizeInBytes);
+
+    // ハンドラ経由で内容を書き換えたページのデコードキャッシュを無効化する.
+    void Invalidate(uint16_t address, uint32_t sizeInBytes) { Touch(address, sizeInBytes); }
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定範囲のページを直接参照するメモリを設定します.
+    //!
+    //! @param[in]      address     先頭アドレス(ページ境界).
+    //! @param[in]      sizeInBytes サイズ(ページサイズの倍数).
+    //! @param[in]      pRead       読み取り先(nullptrならハンドラで処理).
+    //! @param[in]      pWrite      書き込み先(nullptrならハンドラで処理).
+    //-------------------------------------------------------------------------
+    void MapPages(uint16_t address, uint32_t sizeInBytes, const uint8_t* pRead, uint8_t* pWrite);
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定範囲のページのハンドラを設定します.
+    //!
+    //! @param[in]      address     先頭アドレス(ページ境界).
+    //! @param[in]      sizeInBytes サイズ(ページサイズの倍数).
+    //! @param[in]      pRead       読み取りハンドラ(nullptrなら0xFFを返す).
+    //! @param[in]      pWrite      書き込みハンドラ(nullptrなら書き込みを無視).
+    //! @param[in]      pUser       ハンドラに渡すユーザーデータ.
+    //-------------------------------------------------------------------------
+    void SetPageHandler(uint16_t address, uint32_t sizeInBytes, ReadHandler pRead, WriteHandler pWrite, void* pUser);
+
+    //-------------------------------------------------------------------------
+    //! @brief      I/Oレジスタ(0xFF00-0xFF7F)のハンドラを設定します.
+    //!
+    //! @param[in]      address     I/Oレジスタのアドレス.
+    //! @param[in]      pRead       読み取りハンドラ(nullptrなら格納値を返す).
+    //! @param[in]      pWrite      書き込みハンドラ(nullptrならそのまま格納).
+    //! @param[in]      pUser       ハンドラに渡すユーザーデータ.
+    //-------------------------------------------------------------------------
+    void SetIoHandler(uint16_t address, ReadHandler pRead, WriteHandler pWrite, void* pUser);
 
     const uint8_t* GetBuffer() const { return m_Buffer; }
 
+    uint16_t GetRomBank() const { return m_RomBank; }
+    uint32_t GetPageVersion(uint8_t page) const { return m_PageVersion[page]; }
+    const uint32_t* GetPageVersions() const { return m_PageVersion; }
+
+    // 変換済みコードはページテーブルを直接引き, 直接書き込んだページの世代も自分で進める.
+    const uint8_t* const* GetReadPages () const { return m_pReadPages; }
+    uint8_t* const*       GetWritePages() const { return m_pWritePages; }
+    uint32_t*             GetPageVersions()     { return m_PageVersion; }
+
+    // IE/IFへの書き込み世代. 変化したら割り込み要求が変わった可能性がある.
+    uint32_t GetInterruptVersion() const { return m_InterruptVersion; }
+
 private:
-    uint8_t*    m_Buffer        = nullptr;
-    uint32_t    m_SizeInBytes   = 0;
-};
+    struct Handler
+    {
+        ReadHandler     pRead;      //!< 読み取りハンドラ.
+        WriteHandler    pWrite;     //!< 書き込みハンドラ.
+        void*           pUser;      //!< ユーザーデータ.
+    };
 
+    static constexpr uint16_t IoRegisterCount = 0x80;   //!< I/Oレジスタ数(0xFF00-0xFF7F).
+
+    uint8_t*        m_Buffer                        = nullptr;
+    uint32_t        m_SizeInBytes                   = 0;
+    uint16_t        m_RomBank                       = 1;    // 切り替え可能領域にマウント中のROMバンク番号.
+    uint32_t        m_PageVersion[PageCount]        = {};   // 256バイト単位の書き込み世代(デコードキャッシュの無効化判定用).
+    uint32_t        m_InterruptVersion              = 0;    // IE/IFへの書き込み世代(ブロック実行の打ち切り判定用).
+    const uint8_t*  m_pReadPages [PageCount]        = {};   // ページ先頭へのポインタ(nullptrはハンドラで処理).
+    uint8_t*        m_pWritePages[PageCount]        = {};   // ページ先頭へのポインタ(nullptrはハンドラで処理).
+    Handler         m_PageHandlers[PageCount]       = {};   // ページ単位のハンドラ.
+    Handler         m_IoHandlers[IoRegisterCount]   = {};   // I/Oレジスタ単位のハンドラ.
+
+    void Touch(uint16_t address) { m_PageVersion[address >> 8]++; }
+    void Touch(uint16_t address, uint32_t sizeInBytes);
+    void MountRom(uint16_t address, const uint8_t* data, uint32_t sizeInBytes);
+
+    uint8_t ReadHandled (uint16_t address) const;
+    void    WriteHandled(uint16_t address, uint8_t value);
+
+    static void    WriteEcho(void* pUser, uint16_t address, uint8_t value);
+    static uint8_t ReadOam  (void* pUser, uint16_t address);
+    static void    WriteOam (void* pUser, uint16_t address, uint8_t value);
+    static uint8_t ReadHigh (void* pUser, uint16_t address);
+    static void    WriteHigh(void* pUser, uint16_t address, uint8_t value);
+    static void    WriteDMA (void* pUser, uint16_t address, uint8_t value);
+};
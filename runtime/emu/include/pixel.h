@@ -0,0 +1,64 @@
+﻿//-----------------------------------------------------------------------------
+// File   : pixel.h
+// Desc   : Pixel Conversion Kernels.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PIXEL_KERNEL enum
+///////////////////////////////////////////////////////////////////////////////
+enum PIXEL_KERNEL
+{
+    PIXEL_KERNEL_SCALAR = 0,    //!< 表引き.
+    PIXEL_KERNEL_SSSE3  = 1,    //!< SSSE3.
+    PIXEL_KERNEL_AVX2   = 2,    //!< AVX2(タイル変換はSSSE3).
+};
+
+
+//-----------------------------------------------------------------------------
+//! @brief      タイル1枚分の2枚のビットプレーンを8x8ピクセルのカラー番号に変換します.
+//!
+//! @note       SSSE3が使える環境では2行ずつまとめて変換します.
+//!
+//! @param[in]      data        タイルデータ(16バイト).
+//! @param[out]     pixels      カラー番号(64バイト, 左上から行順).
+//-----------------------------------------------------------------------------
+void DecodeTile(const uint8_t* data, uint8_t* pixels);
+
+//-----------------------------------------------------------------------------
+//! @brief      カラー番号の並びをパレットで出力形式のピクセルに変換します.
+//!
+//! @note       AVX2・SSSE3が使える環境ではパレットをチャンネルごとの表にして
+//!             バイト単位のシャッフルで変換します.
+//!
+//! @param[in]      indices     カラー番号(0-15).
+//! @param[in]      palette     16色分の出力形式の色.
+//! @param[out]     pixels      出力先.
+//! @param[in]      count       ピクセル数.
+//-----------------------------------------------------------------------------
+void ConvertPixels(const uint8_t* indices, const uint32_t palette[16], uint32_t* pixels, size_t count);
+
+//-----------------------------------------------------------------------------
+//! @brief      変換に使う命令セットを切り替えます.
+//!
+//! @note       起動時にはCPUが対応する最上位の命令セットが選ばれています.
+//!             描画中のスレッドがあるときは呼び出さないでください.
+//!
+//! @param[in]      kernel      使用する命令セット.
+//! @retval true    切り替えに成功.
+//! @retval false   CPUが対応していない.
+//-----------------------------------------------------------------------------
+bool SetPixelKernel(PIXEL_KERNEL kernel);
+
+//-----------------------------------------------------------------------------
+//! @brief      変換に使っている命令セットを取得します.
+//-----------------------------------------------------------------------------
+PIXEL_KERNEL GetPixelKernel();
@@ -0,0 +1,30 @@
+﻿//-----------------------------------------------------------------------------
+// File   : platform.h
+// Desc   : Platform Definitions.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Platform
+//-----------------------------------------------------------------------------
+#if defined(_WIN64)
+    #define PLATFORM_WIN64  (1)
+#else
+    #define PLATFORM_WIN64  (0)
+#endif
+
+#if defined(__linux__)
+    #define PLATFORM_LINUX  (1)
+#else
+    #define PLATFORM_LINUX  (0)
+#endif
+
+//-----------------------------------------------------------------------------
+// Architecture
+//-----------------------------------------------------------------------------
+#if defined(__x86_64__) || defined(_M_X64)
+    #define ARCH_X64        (1)
+#else
+    #define ARCH_X64        (0)
+#endif
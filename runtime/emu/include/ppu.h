@@ -10,6 +10,28 @@
 //-----------------------------------------------------------------------------
 #include <cstdint>
 #include <mem.h>
+#include <scanline.h>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PPU_MODE enum
+///////////////////////////////////////////////////////////////////////////////
+enum PPU_MODE
+{
+    PPU_MODE_HBLANK     = 0,    //!< HBlank.
+    PPU_MODE_VBLANK     = 1,    //!< VBlank.
+    PPU_MODE_OAM_SCAN   = 2,    //!< OAMサーチ.
+    PPU_MODE_TRANSFER   = 3,    //!< 画素転送.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PPU_RENDERER enum
+///////////////////////////////////////////////////////////////////////////////
+enum PPU_RENDERER
+{
+    PPU_RENDERER_SCANLINE   = 0,    //!< 画素転送の終了時に1ライン分をまとめて描画する(モード3は固定長).
+    PPU_RENDERER_FIFO       = 1,    //!< ピクセルFIFOを1ドットずつ進める(ライン途中のレジスタ変更とモード3の延長を再現).
+};
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -18,16 +40,161 @@
 class Ppu
 {
 public:
+    // 累積サイクル数の取得処理.
+    using ClockHandler = uint64_t (*)(void* pUser);
+
+    // 実行中にモードの切り替え予定が早まったことの通知処理.
+    using ScheduleHandler = void (*)(void* pUser, uint64_t cycle);
+
     static constexpr uint8_t    DisplayWidth  = 160;    //!< 表示横幅.
     static constexpr uint8_t    DisplayHeight = 144;    //!< 表示縦幅.
     static constexpr uint16_t   BufferWidth   = 256;    //!< バッファ横幅.
     static constexpr uint16_t   BufferHeight  = 256;    //!< バッファ縦幅.
+    static constexpr uint32_t   CyclesPerLine  = 456;   //!< 1ライン当たりのサイクル数.
+    static constexpr uint32_t   LinesPerFrame  = 154;   //!< 1フレーム当たりのライン数(VBlank期間を含む).
+    static constexpr uint32_t   CyclesPerFrame = CyclesPerLine * LinesPerFrame; //!< 1フレーム当たりのサイクル数.
+    static constexpr uint32_t   VBlankCycle    = CyclesPerLine * DisplayHeight; //!< フレーム先頭からVBlank開始までのサイクル数.
+    static constexpr uint32_t   OamScanCycles  = 80;    //!< モード2のサイクル数.
+    static constexpr uint32_t   TransferCycles = 172;   //!< モード3のサイクル数(スプライトによる延長は考慮しない).
 
     Ppu() = default;
 
-    void Execute() {}
+    //-------------------------------------------------------------------------
+    //! @brief      LCDレジスタのハンドラをメモリに接続し, 状態を初期化します.
+    //!
+    //! @note       SetMemoryとSetClockより後に呼び出してください.
+    //-------------------------------------------------------------------------
+    bool Init();
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      現在のサイクルまでモードを進め, 画素転送を終えたラインを描画します.
+    //-------------------------------------------------------------------------
+    void Execute();
+
     void SetMemory(Memory* value) { m_Memory = value; }
+    void SetClock(ClockHandler pClock, void* pUser) { m_pClock = pClock; m_pClockUser = pUser; }
+    void SetScheduler(ScheduleHandler pSchedule, void* pUser) { m_pSchedule = pSchedule; m_pScheduleUser = pUser; }
+
+    // 次にモードが切り替わるサイクル(LCDが無効ならUINT64_MAX).
+    uint64_t GetNextEventCycle() const { return m_NextEventCycle; }
+
+    // 指定サイクルより後で最初にVBlankが始まるサイクル(LCDが無効でも同じ周期で数える).
+    uint64_t GetNextVBlankCycle(uint64_t cycles) const;
+
+    // 次のラインの画素転送から切り替わる.
+    void SetRenderer(PPU_RENDERER value) { m_Renderer = value; }
+    PPU_RENDERER GetRenderer() const { return m_Renderer; }
+
+    // 無効にするとモード・LYの進行と割り込みだけを行い, タイルの取得とフレームバッファへの書き込みを省く.
+    // フレームバッファは最後に描画した内容のままで, 有効にしたラインから描画し直す.
+    void SetRenderEnable(bool value) { m_RenderEnable = value; }
+    bool IsRenderEnabled() const { return m_RenderEnable; }
+
+    PPU_MODE GetMode() const { return m_Mode; }
+    uint8_t GetLY() const { return m_LY; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      スキャンライン方式の描画を別スレッドで行うかどうかを設定します.
+    //!
+    //! @note       描画スレッドは画素転送を終えたラインを後から描画するので,
+    //!             フレームバッファを参照する前にFlushを呼び出してください.
+    //!
+    //! @retval true    設定に成功.
+    //! @retval false   描画スレッドの開始に失敗.
+    //-------------------------------------------------------------------------
+    bool SetThreadEnable(bool value);
+    bool IsThreadEnabled() const { return m_Thread.IsRunning(); }
+
+    // 描画スレッドに積んだラインを全て描画し終えるまで待ちます.
+    void Flush() { m_Thread.Flush(); }
+
+    // 160x144のRGBA8(下位バイトからR, G, B, A).
+    const uint32_t* GetFrameBuffer() const { return m_FrameBuffer; }
 
 private:
-    Memory*     m_Memory = nullptr;
-};
\ No newline at end of file
+    //=========================================================================
+    // ObjPixel structure
+    //=========================================================================
+    struct ObjPixel
+    {
+        uint8_t     Color;                  // カラー番号(0なら透明).
+        uint8_t     Attr;                   // スプライトの属性.
+    };
+
+    //=========================================================================
+    // Fifo structure
+    //=========================================================================
+    struct Fifo
+    {
+        uint64_t    Cycle;                  // 進めたサイクル.
+        uint8_t     X;                      // 出力したピクセル数.
+        uint8_t     Discard;                // 出力せずに捨てるピクセル数.
+        uint8_t     FetchStep;              // BGフェッチャーの進行(0-5で取得, 6で転送待ち).
+        uint8_t     FetchX;                 // 次に取得するタイルの列.
+        uint8_t     FetchTile;              // 取得したタイル番号.
+        uint8_t     FetchLow;               // 取得したタイルデータの下位プレーン.
+        uint8_t     FetchHigh;              // 取得したタイルデータの上位プレーン.
+        bool        Dummy;                  // ライン先頭の空読み中.
+        bool        Window;                 // ウィンドウを取得中.
+        uint8_t     BgPixels[8];            // BGのFIFO.
+        uint8_t     BgCount;                // BGのFIFOの残り.
+        ObjPixel    ObjPixels[8];           // スプライトのFIFO(先頭が次に出力するピクセル).
+        uint8_t     ObjHead;                // スプライトのFIFOの先頭.
+        int8_t      ObjSprite;              // 取得中のスプライト(-1なら取得していない).
+        uint8_t     ObjFetch;               // スプライトの取得に掛けたドット数.
+        uint16_t    ObjDone;                // 取得済みのスプライト(ビット単位).
+        uint8_t     Sprites[LineRenderer::SpritesPerLine];  // ラインに掛かるスプライト(優先度の順).
+        uint8_t     SpriteCount;
+    };
+
+    Memory*         m_Memory            = nullptr;
+    ClockHandler    m_pClock            = nullptr;
+    void*           m_pClockUser        = nullptr;
+    ScheduleHandler m_pSchedule         = nullptr;
+    void*           m_pScheduleUser     = nullptr;
+    PPU_MODE        m_Mode              = PPU_MODE_HBLANK;
+    uint64_t        m_NextEventCycle    = UINT64_MAX;   // 次のモード切り替え.
+    uint64_t        m_FrameStart        = 0;            // 現在のフレームのライン0の開始サイクル.
+    uint64_t        m_LineStart         = 0;            // 現在のラインの開始サイクル.
+    PPU_RENDERER    m_Renderer          = PPU_RENDERER_SCANLINE;
+    PPU_RENDERER    m_LineRenderer      = PPU_RENDERER_SCANLINE;   // 現在のラインの描画方式.
+    bool            m_RenderEnable      = true;         // 描画するかどうか.
+    uint8_t         m_Lcdc              = 0;            // LCDC.
+    uint8_t         m_Stat              = 0;            // STATの割り込み許可と一致フラグ(bit2-6).
+    uint8_t         m_LY                = 0;            // LY.
+    uint8_t         m_Lyc               = 0;            // LYC.
+    uint8_t         m_Scy               = 0;            // SCY.
+    uint8_t         m_Scx               = 0;            // SCX.
+    uint8_t         m_Bgp               = 0;            // BGP.
+    uint8_t         m_Obp0              = 0;            // OBP0.
+    uint8_t         m_Obp1              = 0;            // OBP1.
+    uint8_t         m_Wy                = 0;            // WY.
+    uint8_t         m_Wx                = 0;            // WX.
+    uint8_t         m_WindowLine        = 0;            // ウィンドウの内部ラインカウンタ.
+    bool            m_StatLine          = false;        // STAT割り込み信号(立ち上がりで割り込みを要求).
+    uint32_t        m_FrameBuffer[DisplayWidth * DisplayHeight] = {};
+
+    LineRenderer    m_Lines;                            // スキャンライン方式の描画.
+    RenderThread    m_Thread;                           // スキャンライン方式の描画スレッド.
+
+    Fifo            m_Fifo = {};
+
+    uint64_t GetCycles() const;
+    void Step();
+    void SetLcdc(uint8_t value);
+    void UpdateStatLine();
+    void RequestInterrupt(uint8_t value);
+    LineRegisters LatchRegisters() const;
+
+    void BeginFifo(uint64_t cycle);
+    void RunFifo(uint64_t cycles);
+    void TickFifo();
+    void StepFetcher();
+    int  FindSprite() const;
+    void MergeSprite();
+    void PushPixel();
+
+    static uint8_t ReadRegister (void* pUser, uint16_t address);
+    static void    WriteRegister(void* pUser, uint16_t address, uint8_t value);
+};
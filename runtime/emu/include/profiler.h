@@ -0,0 +1,100 @@
+﻿//-----------------------------------------------------------------------------
+// File   : profiler.h
+// Desc   : Guest Instruction Profiler.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Profiler class
+///////////////////////////////////////////////////////////////////////////////
+class Profiler
+{
+public:
+    static constexpr uint32_t DefaultCapacity = 4096;   //!< 初期エントリ数(2のべき乗).
+    static constexpr uint32_t OpCodeCount     = 512;    //!< オペコード数(0x100以降はCBプレフィックス命令).
+
+    struct Counter
+    {
+        uint64_t    Count;      //!< 実行回数.
+        uint64_t    Cycles;     //!< 消費サイクル数.
+    };
+
+    struct Entry
+    {
+        uint16_t    Bank;       //!< ROMバンク番号(切り替え可能領域以外は0).
+        uint16_t    PC;         //!< 命令の先頭アドレス.
+        uint16_t    OpCode;     //!< 最後に実行したオペコード.
+        uint16_t    Reserved;   //!< 予約(0).
+        Counter     Value;      //!< 集計値.
+    };
+
+    Profiler() = default;
+    ~Profiler() { Term(); }
+
+    bool Init(uint32_t capacity = DefaultCapacity);
+    void Term();
+    void Reset();
+
+    //-------------------------------------------------------------------------
+    //! @brief      命令の実行を記録します.
+    //!
+    //! @param[in]      bank        ROMバンク番号.
+    //! @param[in]      pc          命令の先頭アドレス.
+    //! @param[in]      opCode      オペコード(CBプレフィックス命令は0x100 + 2バイト目).
+    //! @param[in]      cycles      消費サイクル数.
+    //-------------------------------------------------------------------------
+    void Record(uint16_t bank, uint16_t pc, uint16_t opCode, uint64_t cycles);
+
+    void RecordInterrupt(uint64_t cycles) { m_Interrupt.Count++; m_Interrupt.Cycles += cycles; }
+    void RecordHalt     (uint64_t cycles) { m_Halt.Cycles += cycles; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      消費サイクル数の多い順に並べたテキストレポートを出力します.
+    //!
+    //! @param[in]      path        出力ファイルパス.
+    //! @param[in]      maxEntries  出力するアドレスの最大数(0なら全て).
+    //! @retval true    出力に成功.
+    //! @retval false   出力に失敗.
+    //-------------------------------------------------------------------------
+    bool WriteReport(const char* path, uint32_t maxEntries) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      集計結果をバイナリ形式で保存します.
+    //-------------------------------------------------------------------------
+    bool Save(const char* path) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      保存済みの集計結果を読み込み, 現在の集計に加算します.
+    //!
+    //! @param[in]      path        Save()で保存したファイルパス.
+    //! @retval true    読み込みに成功.
+    //! @retval false   ファイルが無いか, 形式が異なる.
+    //-------------------------------------------------------------------------
+    bool Merge(const char* path);
+
+    uint32_t GetEntryCount() const { return m_Count; }
+    const Counter& GetOpCode(uint16_t opCode) const { return m_OpCodes[opCode]; }
+    const Counter& GetInterrupt() const { return m_Interrupt; }
+    const Counter& GetHalt() const { return m_Halt; }
+
+private:
+    Entry*      m_pEntries                  = nullptr;  // (Bank, PC)をキーとするハッシュテーブル(Count=0は空き).
+    uint32_t    m_Capacity                  = 0;
+    uint32_t    m_Count                     = 0;
+    Counter     m_OpCodes[OpCodeCount]      = {};
+    Counter     m_Interrupt                 = {};       // 割り込みの処理.
+    Counter     m_Halt                      = {};       // HALT/STOPで停止していた期間.
+
+    Entry* Find(uint16_t bank, uint16_t pc);
+    bool Grow();
+
+    Profiler(const Profiler&) = delete;
+    void operator = (const Profiler&) = delete;
+};
@@ -0,0 +1,115 @@
+﻿//-----------------------------------------------------------------------------
+// File   : recompiler.h
+// Desc   : Dynamic Recompiler.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Recompiler class
+///////////////////////////////////////////////////////////////////////////////
+class Recompiler
+{
+public:
+    // 直接参照できないページ(I/Oレジスタ等)へのアクセス処理. 書き込みはfalseを返すと実行を打ち切る.
+    using ReadFunc  = uint8_t (*)(void* pUser, uint16_t address);
+    using WriteFunc = bool    (*)(void* pUser, uint16_t address, uint8_t value);
+
+    //! 変換済みコードが参照する実行時の状態.
+    struct Context
+    {
+        void*                   pRegister;      //!< Cpu::Register.
+        const uint8_t* const*   pReadPages;     //!< 読み取り用のページテーブル.
+        uint8_t* const*         pWritePages;    //!< 書き込み用のページテーブル.
+        uint32_t*               pPageVersions;  //!< ページの書き込み世代.
+        ReadFunc                pRead;          //!< ハンドラ経由の読み取り.
+        WriteFunc               pWrite;         //!< ハンドラ経由の書き込み.
+        void*                   pUser;          //!< pRead, pWriteに渡すユーザーデータ.
+        uint64_t                Cycles;         //!< 累積サイクル数.
+        uint64_t                Limit;          //!< これを超える前にブロックの入口で止まる.
+        uint8_t*                pLink;          //!< 最後に通った未接続の分岐(接続先を書き換える位置).
+        uint16_t                RomBank;        //!< 実行中のROMバンク番号.
+    };
+
+    //! 変換済みコードのエントリーポイント.
+    //! ブロックの途中の変換できない命令で止まった場合は1, それ以外で戻った場合は0を返す.
+    using Entry = uint32_t (*)(Context* pContext);
+
+    struct Command
+    {
+        uint8_t     OpCode;     //!< オペコード.
+        uint16_t    Operand;    //!< オペランド.
+        uint8_t     Length;     //!< 命令長.
+        uint8_t     Cycles;     //!< 消費サイクル数.
+    };
+
+    struct Block
+    {
+        const Command*  pCommands;  //!< デコード済み命令列.
+        uint32_t        Count;      //!< 命令数.
+        uint16_t        PC;         //!< 先頭アドレス.
+        uint16_t        Bank;       //!< ROMバンク番号(0x4000-0x7FFFのブロックのみ照合).
+        uint32_t        Version;    //!< デコード時のページ書き込み世代.
+        bool            Chainable;  //!< 分岐先のブロックへ直接つなぐかどうか.
+    };
+
+    struct Result
+    {
+        Entry       pEntry;     //!< エントリーポイント.
+        uint8_t*    pChain;     //!< 他のブロックから直接ジャンプする入口.
+        uint8_t     Count;      //!< 変換できた先頭からの命令数.
+        uint8_t     Length;     //!< 変換できた命令のバイト数.
+        uint16_t    Cycles;     //!< 変換できた命令の最大消費サイクル数(分岐成立時).
+    };
+
+    Recompiler() = default;
+    ~Recompiler() { Term(); }
+
+    static bool IsSupported();
+
+    bool Init(uint32_t sizeInBytes);
+    void Term();
+    void Reset();
+
+    //-------------------------------------------------------------------------
+    //! @brief      基本ブロックの先頭から変換可能な命令をネイティブコードに変換します.
+    //!
+    //! @param[in]      block       変換するブロック.
+    //! @param[out]     result      変換結果.
+    //! @retval true    1命令以上の変換に成功.
+    //! @retval false   変換できる命令が無いか, コード領域が不足.
+    //-------------------------------------------------------------------------
+    bool Compile(const Block& block, Result& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      未接続の分岐を変換済みブロックの入口へつなぎます.
+    //!
+    //! @param[in]      pSite       Context::pLinkに記録された分岐の位置.
+    //! @param[in]      pTarget     接続先(Result::pChain).
+    //! @retval true    接続に成功.
+    //! @retval false   接続に失敗.
+    //-------------------------------------------------------------------------
+    bool Link(uint8_t* pSite, uint8_t* pTarget);
+
+    //! コード領域をリセットするたびに進む世代番号(古いエントリーポイントの検出用).
+    uint32_t GetGeneration() const { return m_Generation; }
+
+    bool IsInitialized() const { return m_pCode != nullptr; }
+
+private:
+    uint8_t*    m_pCode         = nullptr;
+    uint32_t    m_SizeInBytes   = 0;
+    uint32_t    m_Offset        = 0;
+    uint32_t    m_Generation    = 0;
+
+    bool Protect(uint8_t* pBegin, uint8_t* pEnd, bool writable);
+
+    Recompiler(const Recompiler&) = delete;
+    void operator = (const Recompiler&) = delete;
+};
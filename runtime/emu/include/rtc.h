@@ -0,0 +1,112 @@
+﻿//-----------------------------------------------------------------------------
+// File   : rtc.h
+// Desc   : MBC3 Real Time Clock.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// RTC_MODE enum
+///////////////////////////////////////////////////////////////////////////////
+enum RTC_MODE
+{
+    RTC_MODE_CYCLE  = 0,    //!< エミュレータのサイクル数で時計を進める(早送りしても決定的).
+    RTC_MODE_HOST   = 1,    //!< ホストの時刻に同期する.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Rtc class
+///////////////////////////////////////////////////////////////////////////////
+class Rtc
+{
+public:
+    static constexpr uint32_t CyclesPerSecond = 4194304;   //!< 1秒当たりのサイクル数.
+    static constexpr uint32_t SaveSize        = 48;        //!< セーブファイル末尾に付加する状態のサイズ.
+
+    using ClockHandler = uint64_t (*)(void* pUser);
+
+    Rtc() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      時計を初期化します.
+    //!
+    //! @param[in]      mode        時計の進め方.
+    //! @param[in]      pClock      累積サイクル数の取得関数.
+    //! @param[in]      pUser       取得関数に渡すユーザーデータ.
+    //-------------------------------------------------------------------------
+    void Init(RTC_MODE mode, ClockHandler pClock, void* pUser);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ラッチレジスタへの書き込みを処理します(0→1でラッチ).
+    //-------------------------------------------------------------------------
+    void WriteLatch(uint8_t value);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ラッチされたレジスタを読み取ります.
+    //!
+    //! @param[in]      index       レジスタ番号(0x08-0x0C).
+    //-------------------------------------------------------------------------
+    uint8_t Read(uint8_t index) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      カウンタに書き込みます.
+    //!
+    //! @param[in]      index       レジスタ番号(0x08-0x0C).
+    //! @param[in]      value       書き込む値.
+    //-------------------------------------------------------------------------
+    void Write(uint8_t index, uint8_t value);
+
+    //-------------------------------------------------------------------------
+    //! @brief      状態をセーブ形式で書き出します.
+    //!
+    //! @retval true    前回の書き出しから内容が変化した.
+    //! @retval false   内容に変化が無い.
+    //-------------------------------------------------------------------------
+    bool Save(uint8_t* data);
+
+    //-------------------------------------------------------------------------
+    //! @brief      セーブ形式から状態を読み込みます.
+    //!
+    //! @retval true    読み込みに成功.
+    //! @retval false   有効な状態が保存されていない.
+    //-------------------------------------------------------------------------
+    bool Load(const uint8_t* data);
+
+    void SetMode(RTC_MODE mode);
+    RTC_MODE GetMode() const { return m_Mode; }
+
+private:
+    //=========================================================================
+    // Registers structure
+    //=========================================================================
+    struct Registers
+    {
+        uint8_t     Seconds;    // 0x08 : 秒(0-59).
+        uint8_t     Minutes;    // 0x09 : 分(0-59).
+        uint8_t     Hours;      // 0x0A : 時(0-23).
+        uint8_t     DayLow;     // 0x0B : 日の下位8bit.
+        uint8_t     DayHigh;    // 0x0C : bit0=日の最上位, bit6=停止, bit7=日の桁あふれ.
+    };
+
+    RTC_MODE        m_Mode          = RTC_MODE_CYCLE;
+    ClockHandler    m_pClock        = nullptr;
+    void*           m_pUser         = nullptr;
+    Registers       m_Counter       = {};       // 動作中のカウンタ.
+    Registers       m_Latched       = {};       // ラッチされた値.
+    uint8_t         m_LatchValue    = 0xFF;     // ラッチレジスタに最後に書き込まれた値.
+    uint64_t        m_LastCycle     = 0;        // 最後にカウンタを進めた時点のサイクル数.
+    uint64_t        m_SubCycles     = 0;        // 1秒未満の端数サイクル.
+    int64_t         m_LastTime      = 0;        // 最後にカウンタを進めた時点のホスト時刻.
+
+    void Update();
+    void Advance(uint64_t seconds);
+    void Tick();
+    uint64_t GetCycles() const;
+};
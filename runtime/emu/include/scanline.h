@@ -0,0 +1,208 @@
+﻿//-----------------------------------------------------------------------------
+// File   : scanline.h
+// Desc   : Scanline Renderer.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <spsc.h>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LineRegisters structure
+///////////////////////////////////////////////////////////////////////////////
+struct LineRegisters
+{
+    uint8_t     LY;                 //!< 描画するライン.
+    uint8_t     Lcdc;               //!< LCDC.
+    uint8_t     Scy;                //!< SCY.
+    uint8_t     Scx;                //!< SCX.
+    uint8_t     Bgp;                //!< BGP.
+    uint8_t     Obp0;               //!< OBP0.
+    uint8_t     Obp1;               //!< OBP1.
+    uint8_t     Wy;                 //!< WY.
+    uint8_t     Wx;                 //!< WX.
+    uint8_t     WindowLine;         //!< ウィンドウの内部ラインカウンタ.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LineRenderer class
+///////////////////////////////////////////////////////////////////////////////
+//  1ライン分のレジスタとVRAM・OAMから, 1ライン分のピクセルをまとめて描画する.
+//  展開済みのタイルとラインごとのスプライトのリストは, ページの書き込み世代で
+//  変更を検出して必要な分だけ作り直す.
+class LineRenderer
+{
+public:
+    static constexpr uint32_t   Width           = 160;  //!< 1ラインのピクセル数.
+    static constexpr uint32_t   Height          = 144;  //!< 表示するライン数.
+    static constexpr uint32_t   TileCount       = 384;  //!< VRAMのタイル数(0x8000-0x97FF).
+    static constexpr uint32_t   SpritesPerLine  = 10;   //!< 1ラインに表示できるスプライト数.
+
+    //! DMGの4階調(RGBA8).
+    static constexpr uint32_t   Shades[4] = { 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555, 0xFF000000 };
+
+    LineRenderer() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      参照するメモリを設定します.
+    //!
+    //! @param[in]      mem         64KBのアドレス空間(VRAMとOAMを参照する).
+    //! @param[in]      versions    256バイト単位の書き込み世代.
+    //-------------------------------------------------------------------------
+    void SetSource(const uint8_t* mem, const uint32_t* versions);
+
+    // 次の描画でタイルとスプライトのリストを全て作り直します.
+    void Reset()
+    {
+        m_TileDirty   = true;
+        m_SpriteDirty = true;
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      1ライン分を描画します.
+    //!
+    //! @param[in]      regs        画素転送の終了時点のレジスタ.
+    //! @param[out]     pixels      出力先(Width個のRGBA8).
+    //-------------------------------------------------------------------------
+    void Render(const LineRegisters& regs, uint32_t* pixels);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ラインに掛かるスプライトを優先度の順に取得します.
+    //!
+    //! @param[in]      ly          ライン.
+    //! @param[in]      lcdc        LCDC(スプライトの高さを決める).
+    //! @param[out]     count       スプライト数.
+    //! @return     OAM番号の配列を返却します.
+    //-------------------------------------------------------------------------
+    const uint8_t* GetSprites(uint32_t ly, uint8_t lcdc, uint32_t& count);
+
+    // ウィンドウが表示されるラインかどうか(内部ラインカウンタを進めるかどうか).
+    static bool IsWindowLine(const LineRegisters& regs);
+
+    // タイルマップのタイル番号をキャッシュの番号に変換します.
+    static uint32_t GetTileIndex(uint8_t tile, uint32_t base)
+    {
+        // 0x8800方式では0x80-0xFFが0x8800-0x8FFF, 0x00-0x7Fが0x9000-0x97FFを指す.
+        return (tile & 0x80) ? tile : base + tile;
+    }
+
+private:
+    // タイルデータが載るページ数.
+    static constexpr uint32_t TilePageCount = TileCount * 16 / 256;
+
+    const uint8_t*  m_pMemory           = nullptr;
+    const uint32_t* m_pVersions         = nullptr;
+    bool            m_TileDirty         = true;         // 書き込み世代によらずタイルを展開し直す.
+    bool            m_SpriteDirty       = true;         // 書き込み世代によらずスプライトのリストを作り直す.
+
+    // タイルデータをカラー番号に展開したキャッシュ.
+    // VRAMへの書き込みはページの書き込み世代で検出し, 内容が変わったタイルだけ展開し直す.
+    uint8_t         m_TileCache  [TileCount][8][8]  = {};   // 行ごとの8ピクセルのカラー番号.
+    uint8_t         m_TileData   [TileCount][16]    = {};   // 展開元のタイルデータ.
+    uint32_t        m_TileVersion[TilePageCount]    = {};   // 展開時点のページの書き込み世代.
+
+    // ラインごとに表示するスプライトのOAM番号(優先度の順).
+    // OAMへの書き込み・DMA転送とスプライトのサイズ変更があったときだけ作り直す.
+    uint8_t         m_LineSprites    [Height][SpritesPerLine] = {};
+    uint8_t         m_LineSpriteCount[Height] = {};
+    uint32_t        m_OamVersion        = 0;            // 作成時点のOAMの書き込み世代.
+    uint8_t         m_ObjSize           = 0;            // 作成時点のLCDCのスプライトサイズ.
+
+    void UpdateTiles();
+    void UpdateSprites(uint8_t lcdc);
+    void MergeSprites(const LineRegisters& regs, uint8_t* line);
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// RenderThread class
+///////////////////////////////////////////////////////////////////////////////
+//  ラインの描画を別スレッドで行う.
+//  CPUスレッドは画素転送の終了時点のレジスタと, 前回から書き換えられたVRAM・OAMの
+//  ページをコマンドとしてキューに積み, 描画スレッドは自前のVRAM・OAMの写しに
+//  反映しながら順に描画する. 描画処理は同じなので結果は単一スレッドと一致する.
+class RenderThread
+{
+public:
+    static constexpr uint32_t QueueSize = 1024;     //!< キューに積めるコマンド数.
+
+    RenderThread() = default;
+    ~RenderThread() { Term(); }
+
+    //-------------------------------------------------------------------------
+    //! @brief      描画スレッドを開始します.
+    //!
+    //! @param[in]      mem         CPU側の64KBのアドレス空間.
+    //! @param[in]      versions    CPU側の256バイト単位の書き込み世代.
+    //! @param[out]     pixels      描画先のフレームバッファ.
+    //! @retval true    開始に成功.
+    //! @retval false   メモリの確保に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const uint8_t* mem, const uint32_t* versions, uint32_t* pixels);
+
+    // 積んだコマンドを全て処理してからスレッドを終了します.
+    void Term();
+
+    bool IsRunning() const { return m_pShadow != nullptr; }
+
+    // 1ライン分の描画を積みます(CPUスレッド).
+    void Submit(const LineRegisters& regs);
+
+    // 積んだ描画が全て終わるまで待ちます(CPUスレッド).
+    void Flush();
+
+private:
+    //=========================================================================
+    // COMMAND_TYPE enum
+    //=========================================================================
+    enum COMMAND_TYPE : uint8_t
+    {
+        COMMAND_PAGE,       // VRAM・OAMの1ページを写しに反映する.
+        COMMAND_LINE,       // 1ライン分を描画する.
+        COMMAND_QUIT,       // スレッドを終了する.
+    };
+
+    //=========================================================================
+    // Command structure
+    //=========================================================================
+    struct Command
+    {
+        COMMAND_TYPE    Type;
+        uint8_t         Page;           // COMMAND_PAGEのページ番号.
+        LineRegisters   Regs;           // COMMAND_LINEのレジスタ.
+        uint8_t         Data[256];      // COMMAND_PAGEのページの内容.
+    };
+
+    SpscQueue<Command>      m_Queue;
+    LineRenderer            m_Renderer;
+    std::thread             m_Thread;
+    std::mutex              m_Lock;
+    std::condition_variable m_Wakeup;
+    std::atomic<bool>       m_Sleeping  { false };  // 描画スレッドが待機している.
+    std::atomic<uint64_t>   m_Done      { 0 };      // 処理し終えたコマンド数.
+    uint64_t                m_Submitted = 0;        // 積んだコマンド数(CPUスレッドのみ).
+
+    const uint8_t*  m_pMemory   = nullptr;          // CPU側のメモリ.
+    const uint32_t* m_pVersions = nullptr;          // CPU側の書き込み世代.
+    uint32_t*       m_pPixels   = nullptr;          // 描画先.
+    uint8_t*        m_pShadow   = nullptr;          // 描画スレッド側のVRAM・OAMの写し(64KBのアドレス空間).
+    uint32_t        m_ShadowVersion[256] = {};      // 写しの書き込み世代.
+    uint32_t        m_SentVersion  [256] = {};      // 最後に送ったページの書き込み世代(CPUスレッドのみ).
+
+    Command* Reserve();
+    void Push();
+    void Main();
+
+    RenderThread(const RenderThread&) = delete;
+    void operator = (const RenderThread&) = delete;
+};
@@ -0,0 +1,97 @@
+﻿//-----------------------------------------------------------------------------
+// File   : spsc.h
+// Desc   : Lock-Free Single-Producer Single-Consumer Queue.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+#include <atomic>
+#include <type_traits>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SpscQueue class
+///////////////////////////////////////////////////////////////////////////////
+//  生産者・消費者がそれぞれ1スレッドに限られるリングバッファ.
+//  要素は領域内で直接組み立てて公開するので, 大きな要素でもコピーは1回で済む.
+template<typename T>
+class SpscQueue
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SpscQueue requires trivially copyable elements.");
+
+public:
+    SpscQueue() = default;
+    ~SpscQueue() { Term(); }
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      capacity    格納できる要素数(2の累乗).
+    //! @retval true    初期化に成功.
+    //! @retval false   メモリの確保に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t capacity)
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+        Term();
+        m_pItems = static_cast<T*>(malloc(sizeof(T) * capacity));
+        if (m_pItems == nullptr)
+        { return false; }
+
+        m_Mask = capacity - 1;
+        m_Head.store(0, std::memory_order_relaxed);
+        m_Tail.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Term()
+    {
+        free(m_pItems);
+        m_pItems = nullptr;
+    }
+
+    // 生産者: 書き込み先を取得します(一杯ならnullptr). 書き終えたらPushで公開します.
+    T* Reserve()
+    {
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_Head.load(std::memory_order_acquire) > m_Mask)
+        { return nullptr; }
+
+        return &m_pItems[tail & m_Mask];
+    }
+
+    void Push()
+    { m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // 消費者: 先頭の要素を取得します(空ならnullptr). 使い終えたらPopで解放します.
+    const T* Peek() const
+    {
+        auto head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_Tail.load(std::memory_order_acquire))
+        { return nullptr; }
+
+        return &m_pItems[head & m_Mask];
+    }
+
+    void Pop()
+    { m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool IsEmpty() const
+    { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire); }
+
+private:
+    T*                      m_pItems    = nullptr;
+    uint32_t                m_Mask      = 0;
+    alignas(64) std::atomic<uint32_t> m_Head { 0 };     // 消費者だけが進める(キャッシュラインを分ける).
+    alignas(64) std::atomic<uint32_t> m_Tail { 0 };     // 生産者だけが進める.
+
+    SpscQueue(const SpscQueue&) = delete;
+    void operator = (const SpscQueue&) = delete;
+};
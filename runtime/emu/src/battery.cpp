@@ -0,0 +1,258 @@
+﻿//-----------------------------------------------------------------------------
+// File   : battery.cpp
+// Desc   : Battery-Backed RAM.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <platform.h>
+#include <battery.h>
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif//PLATFORM_LINUX
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint32_t kMaxSize = BatteryRam::BlockSize * 32;   // 追跡できる最大サイズ.
+
+#if !PLATFORM_LINUX
+//-----------------------------------------------------------------------------
+//      ファイルを開きます.
+//-----------------------------------------------------------------------------
+FILE* OpenFile(const char* path, const char* mode)
+{
+    FILE* fp = nullptr;
+#if PLATFORM_WIN64
+    if (fopen_s(&fp, path, mode) != 0)
+    { fp = nullptr; }
+#else
+    fp = fopen(path, mode);
+#endif
+    return fp;
+}
+#endif//!PLATFORM_LINUX
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BatteryRam class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool BatteryRam::Init(const char* path, uint32_t sizeInBytes)
+{
+    assert(path != nullptr);
+    assert(sizeInBytes > 0 && sizeInBytes <= kMaxSize);
+
+    if (m_pData != nullptr)
+    { Term(); }
+
+#if PLATFORM_LINUX
+    // ファイルを共有マップしておけば, 書き込みはページキャッシュに載るだけで済む.
+    // 書き出しはmsyncで変更されたブロックだけを対象にする.
+    auto fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        printf("Error : Open Save File Failed. path = %s\n", path);
+        return false;
+    }
+
+    struct stat info = {};
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        printf("Error : Open Save File Failed. path = %s\n", path);
+        return false;
+    }
+
+    // 足りない分は伸ばす. 後ろに付加情報があるファイルは切り詰めない.
+    auto loaded = (uint64_t(info.st_size) < sizeInBytes) ? uint32_t(info.st_size) : sizeInBytes;
+    if (uint64_t(info.st_size) < sizeInBytes && ftruncate(fd, sizeInBytes) != 0)
+    {
+        close(fd);
+        printf("Error : Resize Save File Failed. path = %s\n", path);
+        return false;
+    }
+
+    auto ptr = mmap(nullptr, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        printf("Error : Map Save File Failed. path = %s\n", path);
+        return false;
+    }
+
+    m_pData       = static_cast<uint8_t*>(ptr);
+    m_SizeInBytes = sizeInBytes;
+    m_DirtyBlocks = 0;
+
+    // 新規作成や伸ばした部分は未初期化のSRAMと同じく0xFFで埋める.
+    if (loaded < sizeInBytes)
+    {
+        memset(m_pData + loaded, 0xFF, sizeInBytes - loaded);
+        MarkDirty(loaded, sizeInBytes - loaded);
+    }
+#else
+    // マップできない環境ではメモリに読み込み, 変更されたブロックだけを書き戻す.
+    auto length = strlen(path) + 1;
+    m_pPath = static_cast<char*>(malloc(length));
+    m_pData = static_cast<uint8_t*>(malloc(sizeInBytes));
+    if (m_pPath == nullptr || m_pData == nullptr)
+    {
+        Term();
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    memcpy(m_pPath, path, length);
+    memset(m_pData, 0xFF, sizeInBytes);
+    m_SizeInBytes = sizeInBytes;
+    m_DirtyBlocks = 0;
+
+    auto fp = OpenFile(path, "rb");
+    if (fp != nullptr)
+    {
+        // 短いファイルは足りない分を0xFFのまま書き戻す.
+        auto loaded = uint32_t(fread(m_pData, 1, sizeInBytes, fp));
+        fclose(fp);
+
+        if (loaded < sizeInBytes)
+        { MarkDirty(loaded, sizeInBytes - loaded); }
+    }
+    else
+    {
+        // 新規作成.
+        fp = OpenFile(path, "wb");
+        if (fp == nullptr)
+        {
+            Term();
+            printf("Error : Open Save File Failed. path = %s\n", path);
+            return false;
+        }
+
+        fwrite(m_pData, sizeInBytes, 1, fp);
+        fclose(fp);
+    }
+#endif
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void BatteryRam::Term()
+{
+    if (m_pData != nullptr)
+    {
+        // 残っている変更を書き出してから破棄する.
+        Flush(true);
+
+    #if PLATFORM_LINUX
+        munmap(m_pData, m_SizeInBytes);
+    #else
+        free(m_pData);
+    #endif
+        m_pData = nullptr;
+    }
+
+    if (m_pPath != nullptr)
+    {
+        free(m_pPath);
+        m_pPath = nullptr;
+    }
+
+    m_SizeInBytes = 0;
+    m_DirtyBlocks = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      変更された範囲を記録します.
+//-----------------------------------------------------------------------------
+void BatteryRam::MarkDirty(uint32_t offset, uint32_t sizeInBytes)
+{
+    if (sizeInBytes == 0 || offset >= m_SizeInBytes)
+    { return; }
+
+    auto first = offset / BlockSize;
+    auto last  = (offset + sizeInBytes - 1) / BlockSize;
+    for(auto i=first; i<=last && i<32; ++i)
+    { m_DirtyBlocks |= (1u << i); }
+}
+
+//-----------------------------------------------------------------------------
+//      変更された範囲だけをファイルに書き出します.
+//-----------------------------------------------------------------------------
+bool BatteryRam::Flush(bool wait)
+{
+    if (m_pData == nullptr)
+    { return false; }
+
+    // 変更が無ければシステムコールも発行しない.
+    if (m_DirtyBlocks == 0)
+    { return true; }
+
+#if PLATFORM_LINUX
+    // MS_ASYNCは書き出しを予約するだけなので, 実行中に呼んでもI/O待ちで止まらない.
+    auto flags  = wait ? MS_SYNC : MS_ASYNC;
+    auto result = true;
+    for(uint32_t i=0; i<32; ++i)
+    {
+        if ((m_DirtyBlocks & (1u << i)) == 0)
+        { continue; }
+
+        auto offset = i * BlockSize;
+        auto size   = m_SizeInBytes - offset;
+        if (size > BlockSize)
+        { size = BlockSize; }
+
+        if (msync(m_pData + offset, size, flags) != 0)
+        { result = false; }
+    }
+#else
+    // 待たずに書き出す手段が無いので, 変更されたブロックだけを同期的に書き戻す.
+    (void)wait;
+    auto fp = OpenFile(m_pPath, "r+b");
+    if (fp == nullptr)
+    { return false; }
+
+    auto result = true;
+    for(uint32_t i=0; i<32; ++i)
+    {
+        if ((m_DirtyBlocks & (1u << i)) == 0)
+        { continue; }
+
+        auto offset = i * BlockSize;
+        auto size   = m_SizeInBytes - offset;
+        if (size > BlockSize)
+        { size = BlockSize; }
+
+        if (fseek(fp, long(offset), SEEK_SET) != 0 || fwrite(m_pData + offset, size, 1, fp) != 1)
+        { result = false; }
+    }
+
+    fclose(fp);
+#endif
+
+    if (result)
+    { m_DirtyBlocks = 0; }
+
+    return result;
+}
@@ -8,10 +8,23 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <cstdio>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
+#include <mutex>
+#include <algorithm>
+#include <platform.h>
 #include <cartridge.h>
+#include <hash.h>
+#include <inflate.h>
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif//PLATFORM_LINUX
 
 
 //-----------------------------------------------------------------------------
@@ -31,94 +44,636 @@ static constexpr uint8_t kNintendoLogo[48] = {
     0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E,
 };
 
+static constexpr size_t   kHeaderEnd         = 0x150;        // ヘッダーの終端(検証に必要なサイズ).
+static constexpr uint8_t  kMaxRomSize        = 0x08;         // ROMサイズの最大値(8MB, 512バンク).
+static constexpr uint32_t kZipLocalSignature = 0x04034B50;   // zipのローカルファイルヘッダー.
+static constexpr uint32_t kZipDescSignature  = 0x08074B50;   // zipのデータディスクリプタ.
+
+///////////////////////////////////////////////////////////////////////////////
+// ARCHIVE_TYPE enum
+///////////////////////////////////////////////////////////////////////////////
+enum ARCHIVE_TYPE
+{
+    ARCHIVE_NONE    = 0,    //!< 圧縮されていない.
+    ARCHIVE_GZIP    = 1,    //!< gzip.
+    ARCHIVE_ZIP     = 2,    //!< zip.
+};
+
 //=== サイズチェック ===.
 static_assert(sizeof(CartridgeHeader) == 0x50); // 0x100 - 0x14F.
+static_assert(offsetof(Cartridge, Header) == CARTRIDGE_HEADER_OFFSET);
 
-} // namespace
+///////////////////////////////////////////////////////////////////////////////
+// RomEntry structure
+///////////////////////////////////////////////////////////////////////////////
+struct RomEntry
+{
+    RomEntry*   pNext;          //!< 次のエントリ.
+    Cartridge*  pCartridge;     //!< ROMイメージ.
+    size_t      Size;           //!< ROMイメージのサイズ.
+    uint32_t    RefCount;       //!< 参照数.
+    bool        Mapped;         //!< ファイルをマップしているかどうか.
+    uint64_t    Device;         //!< デバイス番号(ファイルマップ時).
+    uint64_t    Inode;          //!< iノード番号(ファイルマップ時).
+    int64_t     ModifiedTime;   //!< 更新日時(ファイルマップ時).
+    char*       pPath;          //!< ファイルパス(読み込み時).
+};
 
 //-----------------------------------------------------------------------------
-//      カートリッジを読み込みます.
+// Global Variables.
 //-----------------------------------------------------------------------------
-bool LoadCartridge(const char* path, Cartridge** cartridge)
+// 同じROMを複数のエミュレータで共有するためのプロセス全体のプール.
+// ROMイメージは読み取り専用なので, 参照数が0になるまで同じメモリを返す.
+std::mutex  g_RomPoolLock;
+RomEntry*   g_pRomPool = nullptr;
+
+//-----------------------------------------------------------------------------
+//      ROMイメージのヘッダーを検証します.
+//-----------------------------------------------------------------------------
+bool ValidateHeader(const Cartridge* rom)
 {
-    assert(path != nullptr);
-    assert(cartridge != nullptr);
+    // ロゴチェック.
+    if (!IsValidLogo(rom->Header))
+    {
+        printf("Error : Invalid Cartridge Data.\n");
+        return false;
+    }
 
-    uint8_t* binary = nullptr;
-    int64_t  size   = 0;
+    // チェックサム.
+    if (CalcHeaderCheckSum(rom->Header) != rom->Header.HeaderCheckSum)
+    {
+        printf("Error : Invalid Header Check Sum.\n");
+        return false;
+    }
 
-    // ファイル読み込み.
+    // ROMサイズはこの値から確保量を決めるので, 実在しない値は受け付けない.
+    if (rom->Header.RomSize > kMaxRomSize)
     {
-        FILE* fp = nullptr;
-        auto err = fopen_s(&fp, path, "rb");
-        if (err != 0)
-        {
-            printf_s("Error : Load Cartridge Failed. path = %s\n", path);
-            return false;
-        }
+        printf("Error : Invalid Rom Size. value = 0x%02X\n", rom->Header.RomSize);
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ROMイメージを検証します.
+//-----------------------------------------------------------------------------
+bool ValidateCartridge(const uint8_t* binary, size_t size)
+{
+    // ヘッダーまで無ければ検証できない.
+    if (size < sizeof(Cartridge))
+    {
+        printf("Error : Invalid Cartridge Data.\n");
+        return false;
+    }
+
+    auto rom = reinterpret_cast<const Cartridge*>(binary);
+    if (!ValidateHeader(rom))
+    { return false; }
 
-        fseek(fp, CARTRIDGE_HEADER_OFFSET, SEEK_SET);
-        auto cur = ftell(fp);
-        fseek(fp, 0, SEEK_END);
-        auto end = ftell(fp);
-        fseek(fp, CARTRIDGE_HEADER_OFFSET, SEEK_SET);
+    // ROMサイズをチェック.
+    auto romSize = GetRomSize(rom);
+    if (romSize != size)
+    {
+        printf("Error : Rom Size Not Match.\n");
+        return false;
+    }
 
-        auto size = end - cur;
-        assert(size > 0);
+    return true;
+}
 
-        binary = static_cast<uint8_t*>(malloc(size));
-        if (binary == nullptr)
+//-----------------------------------------------------------------------------
+//      プールにエントリを追加します(g_RomPoolLockを取得して呼び出すこと).
+//-----------------------------------------------------------------------------
+RomEntry* AddRomEntry(Cartridge* cartridge, size_t size, bool mapped)
+{
+    auto entry = static_cast<RomEntry*>(malloc(sizeof(RomEntry)));
+    if (entry == nullptr)
+    { return nullptr; }
+
+    memset(entry, 0, sizeof(RomEntry));
+    entry->pNext      = g_pRomPool;
+    entry->pCartridge = cartridge;
+    entry->Size       = size;
+    entry->RefCount   = 1;
+    entry->Mapped     = mapped;
+
+    g_pRomPool = entry;
+    return entry;
+}
+
+//-----------------------------------------------------------------------------
+//      読み込み済みのイメージをパスで検索します(g_RomPoolLockを取得して呼び出すこと).
+//-----------------------------------------------------------------------------
+bool FindReadEntry(const char* path, Cartridge** cartridge)
+{
+    // 同じパスなら読み込み済みのイメージを共有する.
+    for(auto entry = g_pRomPool; entry != nullptr; entry = entry->pNext)
+    {
+        if (!entry->Mapped && strcmp(entry->pPath, path) == 0)
         {
-            fclose(fp);
-            printf_s("Error : Out of Memory.\n");
-            return false;
+            entry->RefCount++;
+            (*cartridge) = entry->pCartridge;
+            return true;
         }
+    }
 
-        fread(binary, size, 1, fp);
-        fclose(fp);
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+//      メモリに読み込んだイメージをパスと共にプールに追加します.
+//-----------------------------------------------------------------------------
+bool AddReadEntry(const char* path, uint8_t* binary, size_t size, Cartridge** cartridge)
+{
+    auto length = strlen(path) + 1;
+    auto copy   = static_cast<char*>(malloc(length));
+    if (copy == nullptr)
+    {
+        free(binary);
+        printf("Error : Out of Memory.\n");
+        return false;
     }
 
-    auto rom = reinterpret_cast<Cartridge*>(binary);
-    assert(rom != nullptr);
+    memcpy(copy, path, length);
 
-    // ロゴチェック.
-    if (memcmp(rom->Header.Logo, kNintendoLogo, sizeof(kNintendoLogo) != 0))
+    std::lock_guard<std::mutex> locker(g_RomPoolLock);
+
+    // 読み込んでいる間に他のスレッドが同じファイルを追加していれば, そちらを共有する.
+    if (FindReadEntry(path, cartridge))
     {
-        printf_s("Error : Invalid Cartridge Data.");
-        UnloadCartridge(rom);
+        free(copy);
+        free(binary);
+        return true;
+    }
+
+    auto entry = AddRomEntry(reinterpret_cast<Cartridge*>(binary), size, false);
+    if (entry == nullptr)
+    {
+        free(copy);
+        free(binary);
+        printf("Error : Out of Memory.\n");
         return false;
     }
 
-    // チェックサム.
+    entry->pPath = copy;
+
+    (*cartridge) = entry->pCartridge;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      読み込み済みのイメージをパスで検索し, あれば共有します.
+//-----------------------------------------------------------------------------
+bool ShareReadEntry(const char* path, Cartridge** cartridge)
+{
+    std::lock_guard<std::mutex> locker(g_RomPoolLock);
+    return FindReadEntry(path, cartridge);
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを開きます.
+//-----------------------------------------------------------------------------
+FILE* OpenFile(const char* path)
+{
+    FILE* fp = nullptr;
+#if PLATFORM_WIN64
+    if (fopen_s(&fp, path, "rb") != 0)
+    { fp = nullptr; }
+#else
+    fp = fopen(path, "rb");
+#endif
+    return fp;
+}
+
+//-----------------------------------------------------------------------------
+//      ROMファイルをメモリに読み込みます.
+//-----------------------------------------------------------------------------
+bool ReadCartridge(const char* path, Cartridge** cartridge)
+{
+    if (ShareReadEntry(path, cartridge))
+    { return true; }
+
+    auto fp = OpenFile(path);
+    if (fp == nullptr)
+    {
+        printf("Error : Load Cartridge Failed. path = %s\n", path);
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    auto end = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (end <= 0)
+    {
+        fclose(fp);
+        printf("Error : Invalid Cartridge Data.\n");
+        return false;
+    }
+
+    auto size   = size_t(end);
+    auto binary = static_cast<uint8_t*>(malloc(size));
+    if (binary == nullptr)
     {
-        uint8_t checkSum = 0;
-        for(uint8_t i=0x34; i<=0x4C; ++i)
-        { checkSum = checkSum - binary[i] - 1; }
+        fclose(fp);
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    auto read = fread(binary, size, 1, fp);
+    fclose(fp);
 
-        if (checkSum != rom->Header.HeaderCheckSum)
+    if (read != 1 || !ValidateCartridge(binary, size))
+    {
+        free(binary);
+        return false;
+    }
+
+    return AddReadEntry(path, binary, size, cartridge);
+}
+
+#if PLATFORM_LINUX
+//-----------------------------------------------------------------------------
+//      マップ済みのイメージをファイルの識別情報で検索します(g_RomPoolLockを取得して呼び出すこと).
+//-----------------------------------------------------------------------------
+bool FindMappedEntry(const struct stat& info, int64_t mtime, Cartridge** cartridge)
+{
+    // 同じファイル(デバイスとiノードが一致し, 更新されていない)ならマップを共有する.
+    for(auto entry = g_pRomPool; entry != nullptr; entry = entry->pNext)
+    {
+        if (entry->Mapped
+         && entry->Device       == uint64_t(info.st_dev)
+         && entry->Inode        == uint64_t(info.st_ino)
+         && entry->ModifiedTime == mtime
+         && entry->Size         == size_t(info.st_size))
         {
-            printf_s("Error : Invalid Header Check Sum.\n");
-            UnloadCartridge(rom);
-            return false;
+            entry->RefCount++;
+            (*cartridge) = entry->pCartridge;
+            return true;
         }
     }
 
-    // ROMサイズをチェック.
-    auto romSize = GetRomSize(rom);
-    if (romSize != (size + CARTRIDGE_HEADER_OFFSET))
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+//      ROMファイルを読み取り専用でマップします.
+//-----------------------------------------------------------------------------
+bool MapCartridge(const char* path, Cartridge** cartridge)
+{
+    auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        printf("Error : Load Cartridge Failed. path = %s\n", path);
+        return false;
+    }
+
+    struct stat info = {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        close(fd);
+        printf("Error : Load Cartridge Failed. path = %s\n", path);
+        return false;
+    }
+
+    auto size  = size_t(info.st_size);
+    auto mtime = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+
+    // プールのロックは検索と追加の間だけ取り, マップと検証は他のスレッドを止めずに行う.
+    auto shared = false;
+    {
+        std::lock_guard<std::mutex> locker(g_RomPoolLock);
+        shared = FindMappedEntry(info, mtime, cartridge);
+    }
+
+    if (shared)
+    {
+        close(fd);
+        return true;
+    }
+
+    // ページキャッシュを直接参照するので, 複数プロセスで起動しても物理メモリは1つで済む.
+    auto ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    { return ReadCartridge(path, cartridge); }  // マップできないファイルシステムでは読み込む.
+
+    // マップしたままヘッダーを検証する.
+    if (!ValidateCartridge(static_cast<const uint8_t*>(ptr), size))
     {
-        printf_s("Error : Rom Size Not Match.\n");
-        UnloadCartridge(rom);
+        munmap(ptr, size);
         return false;
     }
 
-    // 読み取りデータを格納.
+    std::lock_guard<std::mutex> locker(g_RomPoolLock);
+
+    // マップしている間に他のスレッドが同じファイルを追加していれば, そちらを共有する.
+    if (FindMappedEntry(info, mtime, cartridge))
+    {
+        munmap(ptr, size);
+        return true;
+    }
+
+    auto rom   = static_cast<Cartridge*>(ptr);
+    auto entry = AddRomEntry(rom, size, true);
+    if (entry == nullptr)
+    {
+        munmap(ptr, size);
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    entry->Device       = uint64_t(info.st_dev);
+    entry->Inode        = uint64_t(info.st_ino);
+    entry->ModifiedTime = mtime;
+
     (*cartridge) = rom;
+    return true;
+}
+#endif//PLATFORM_LINUX
+
+//-----------------------------------------------------------------------------
+//      リトルエンディアンの値を読み込みます.
+//-----------------------------------------------------------------------------
+inline uint16_t LoadU16(const uint8_t* data)
+{ return uint16_t(data[0] | (data[1] << 8)); }
+
+inline uint32_t LoadU32(const uint8_t* data)
+{ return uint32_t(LoadU16(data)) | (uint32_t(LoadU16(data + 2)) << 16); }
+
+//-----------------------------------------------------------------------------
+//      ファイルの先頭から圧縮形式を判定します.
+//-----------------------------------------------------------------------------
+ARCHIVE_TYPE GetArchiveType(const char* path)
+{
+    auto fp = OpenFile(path);
+    if (fp == nullptr)
+    { return ARCHIVE_NONE; }
+
+    uint8_t magic[4] = {};
+    auto read = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+
+    if (read >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+    { return ARCHIVE_GZIP; }
+
+    if (read == 4 && LoadU32(magic) == kZipLocalSignature)
+    { return ARCHIVE_ZIP; }
+
+    return ARCHIVE_NONE;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルから読み込みます(展開処理の入力).
+//-----------------------------------------------------------------------------
+size_t ReadFileChunk(void* pUser, uint8_t* buffer, size_t size)
+{ return fread(buffer, 1, size, static_cast<FILE*>(pUser)); }
+
+//-----------------------------------------------------------------------------
+//      終端文字まで読み飛ばします.
+//-----------------------------------------------------------------------------
+bool SkipString(Inflater& inflater)
+{
+    uint8_t c = 0;
+    do
+    {
+        if (!inflater.Read(&c, 1))
+        { return false; }
+    } while(c != 0);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      gzipのヘッダーを読み飛ばします.
+//-----------------------------------------------------------------------------
+bool SkipGzipHeader(Inflater& inflater)
+{
+    uint8_t header[10];
+    if (!inflater.Read(header, sizeof(header)) || header[2] != 8)   // 8 = DEFLATE.
+    { return false; }
+
+    auto flags = header[3];
+    if (flags & 0x04)   // FEXTRA.
+    {
+        uint8_t length[2];
+        if (!inflater.Read(length, sizeof(length)) || !inflater.Read(nullptr, LoadU16(length)))
+        { return false; }
+    }
+
+    if ((flags & 0x08) && !SkipString(inflater))   // FNAME.
+    { return false; }
+
+    if ((flags & 0x10) && !SkipString(inflater))   // FCOMMENT.
+    { return false; }
+
+    if ((flags & 0x02) && !inflater.Read(nullptr, 2))  // FHCRC.
+    { return false; }
 
-    // 正常終了.
     return true;
 }
 
+//-----------------------------------------------------------------------------
+//      ROMファイルの拡張子かどうか判定します.
+//-----------------------------------------------------------------------------
+bool IsRomFileName(const char* name, size_t length)
+{
+    static const char* kExtensions[] = { ".gb", ".gbc", ".sgb" };
+    for(auto ext : kExtensions)
+    {
+        auto extLength = strlen(ext);
+        if (length < extLength)
+        { continue; }
+
+        auto match = true;
+        for(size_t i=0; i<extLength && match; ++i)
+        {
+            auto c = name[length - extLength + i];
+            if (c >= 'A' && c <= 'Z')
+            { c = char(c + ('a' - 'A')); }
+            match = (c == ext[i]);
+        }
+
+        if (match)
+        { return true; }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+//      zipのローカルファイルヘッダーを辿ってROMのエントリを探します.
+//-----------------------------------------------------------------------------
+bool FindZipEntry(Inflater& inflater, uint16_t& flags, uint16_t& method, uint32_t& crc, uint32_t& size)
+{
+    // セントラルディレクトリを読むにはファイル末尾へのシークが要るので, 先頭から順に辿る.
+    for(;;)
+    {
+        uint8_t header[30];
+        if (!inflater.Read(header, sizeof(header)) || LoadU32(header) != kZipLocalSignature)
+        { return false; }
+
+        flags       = LoadU16(header + 6);
+        method      = LoadU16(header + 8);
+        crc         = LoadU32(header + 14);
+        auto packed = LoadU32(header + 18);
+        size        = LoadU32(header + 22);
+
+        char name[256];
+        auto nameLength  = LoadU16(header + 26);
+        auto extraLength = LoadU16(header + 28);
+        auto readLength  = std::min<size_t>(nameLength, sizeof(name));
+        if (!inflater.Read(name, readLength) || !inflater.Read(nullptr, nameLength - readLength + extraLength))
+        { return false; }
+
+        if (IsRomFileName(name, readLength) && (method == 0 || method == 8))
+        { return true; }
+
+        // サイズがデータディスクリプタにしか無いエントリは読み飛ばせない.
+        if ((flags & 0x08) || !inflater.Read(nullptr, packed))
+        { return false; }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮されたROMファイルを展開しながら読み込みます.
+//-----------------------------------------------------------------------------
+bool InflateCartridge(const char* path, ARCHIVE_TYPE type, Cartridge** cartridge)
+{
+    if (ShareReadEntry(path, cartridge))
+    { return true; }
+
+    auto fp = OpenFile(path);
+    if (fp == nullptr)
+    {
+        printf("Error : Load Cartridge Failed. path = %s\n", path);
+        return false;
+    }
+
+    Inflater inflater;
+    if (!inflater.Init(&ReadFileChunk, fp))
+    {
+        fclose(fp);
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    uint16_t flags  = 0;
+    uint16_t method = 8;
+    uint32_t crc    = 0;
+    uint32_t size   = 0;
+    auto found = (type == ARCHIVE_ZIP)
+        ? FindZipEntry(inflater, flags, method, crc, size)
+        : SkipGzipHeader(inflater);
+    if (!found)
+    {
+        fclose(fp);
+        printf("Error : Invalid Archive Data. path = %s\n", path);
+        return false;
+    }
+
+    // 先頭のチャンクだけ展開してヘッダーを検証し, ROMサイズ分を1回だけ確保する.
+    // 以降はその領域へ直接展開するので, バンクのマウントはそのまま参照できる.
+    auto stored = (method == 0);
+    uint8_t head[kHeaderEnd];
+    size_t  pos = 0;
+    auto result = stored
+        ? (inflater.Read(head, sizeof(head)) ? INFLATE_MORE_OUTPUT : INFLATE_ERROR)
+        : inflater.Inflate(head, sizeof(head), pos);
+
+    auto rom = reinterpret_cast<const Cartridge*>(head);
+    if (result != INFLATE_MORE_OUTPUT || !ValidateHeader(rom))
+    {
+        fclose(fp);
+        printf("Error : Invalid Cartridge Data. path = %s\n", path);
+        return false;
+    }
+
+    auto romSize = size_t(GetRomSize(rom));
+    if (type == ARCHIVE_ZIP && !(flags & 0x08) && size != romSize)
+    {
+        fclose(fp);
+        printf("Error : Rom Size Not Match.\n");
+        return false;
+    }
+
+    auto binary = static_cast<uint8_t*>(malloc(romSize));
+    if (binary == nullptr)
+    {
+        fclose(fp);
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    memcpy(binary, head, sizeof(head));
+    pos    = sizeof(head);
+    result = stored
+        ? (inflater.Read(binary + pos, romSize - pos) ? INFLATE_DONE : INFLATE_ERROR)
+        : inflater.Inflate(binary, romSize, pos);
+    if (stored)
+    { pos = romSize; }
+
+    // 末尾のCRCで展開結果を確認する.
+    uint8_t trailer[8] = {};
+    auto valid = (result == INFLATE_DONE && pos == romSize);
+    if (valid && type == ARCHIVE_GZIP)
+    {
+        valid = inflater.Read(trailer, 8) && LoadU32(trailer + 4) == uint32_t(romSize);
+        crc   = LoadU32(trailer);
+    }
+    else if (valid && (flags & 0x08))
+    {
+        valid = inflater.Read(trailer, 4);
+        if (valid && LoadU32(trailer) == kZipDescSignature)
+        { valid = inflater.Read(trailer, 4); }
+        crc = LoadU32(trailer);
+    }
+    fclose(fp);
+
+    if (!valid)
+    {
+        free(binary);
+        printf("Error : Rom Size Not Match.\n");
+        return false;
+    }
+
+    if (Crc32(binary, romSize) != crc)
+    {
+        free(binary);
+        printf("Error : Invalid Archive Check Sum. path = %s\n", path);
+        return false;
+    }
+
+    return AddReadEntry(path, binary, romSize, cartridge);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+//      カートリッジを読み込みます.
+//-----------------------------------------------------------------------------
+bool LoadCartridge(const char* path, Cartridge** cartridge)
+{
+    assert(path != nullptr);
+    assert(cartridge != nullptr);
+
+    // ROMバンクはデータを直接参照してマウントするので, ベクタ領域を含むイメージ全体を保持する.
+    // ファイルの読み込みと展開はロックせずに行い, プールの検索と追加の間だけロックする.
+
+    // 圧縮されたファイルはマップできないので, 展開したイメージをメモリに置く.
+    auto archive = GetArchiveType(path);
+    if (archive != ARCHIVE_NONE)
+    { return InflateCartridge(path, archive, cartridge); }
+
+#if PLATFORM_LINUX
+    return MapCartridge(path, cartridge);
+#else
+    return ReadCartridge(path, cartridge);
+#endif
+}
+
 //-----------------------------------------------------------------------------
 //      カートリッジデータを解放します.
 //-----------------------------------------------------------------------------
@@ -127,8 +682,32 @@ void UnloadCartridge(Cartridge*& cartridge)
     if (cartridge == nullptr)
         return;
 
-    free(cartridge);
+    std::lock_guard<std::mutex> locker(g_RomPoolLock);
+
+    RomEntry** ppLink = &g_pRomPool;
+    while ((*ppLink) != nullptr && (*ppLink)->pCartridge != cartridge)
+    { ppLink = &(*ppLink)->pNext; }
+
+    auto entry = (*ppLink);
+    assert(entry != nullptr);   // LoadCartridge()で読み込んだデータ以外は渡さないこと.
     cartridge = nullptr;
+
+    if (entry == nullptr || --entry->RefCount > 0)
+    { return; }
+
+    (*ppLink) = entry->pNext;
+
+#if PLATFORM_LINUX
+    if (entry->Mapped)
+    { munmap(entry->pCartridge, entry->Size); }
+    else
+    { free(entry->pCartridge); }
+#else
+    free(entry->pCartridge);
+#endif
+
+    free(entry->pPath);
+    free(entry);
 }
 
 //-----------------------------------------------------------------------------
@@ -140,3 +719,63 @@ uint32_t GetRomSize(const Cartridge* cartridge)
     return 32 * 1024 * (1 << cartridge->Header.RomSize);
 }
 
+//-----------------------------------------------------------------------------
+//      ヘッダーの任天堂ロゴが正しいかどうかを判定します.
+//-----------------------------------------------------------------------------
+bool IsValidLogo(const CartridgeHeader& header)
+{ return memcmp(header.Logo, kNintendoLogo, sizeof(kNintendoLogo)) == 0; }
+
+//-----------------------------------------------------------------------------
+//      ヘッダーチェックサムを計算します.
+//-----------------------------------------------------------------------------
+uint8_t CalcHeaderCheckSum(const CartridgeHeader& header)
+{
+    // タイトルからROMバージョンまで(0x134-0x14C).
+    auto binary = header.Title;
+    auto size   = offsetof(CartridgeHeader, HeaderCheckSum) - offsetof(CartridgeHeader, Title);
+
+    uint8_t checkSum = 0;
+    for(size_t i=0; i<size; ++i)
+    { checkSum = checkSum - binary[i] - 1; }
+
+    return checkSum;
+}
+
+//-----------------------------------------------------------------------------
+//      グローバルチェックサムを計算します.
+//-----------------------------------------------------------------------------
+uint16_t CalcGlobalCheckSum(const uint8_t* binary, size_t size)
+{
+    static constexpr size_t kOffset = CARTRIDGE_HEADER_OFFSET + offsetof(CartridgeHeader, GlobalCheckSum);
+
+    // 16bitに収まるので, 途中で桁あふれしても結果は変わらない.
+    uint32_t checkSum = 0;
+    for(size_t i=0; i<size; ++i)
+    { checkSum += binary[i]; }
+
+    if (size >= kOffset + 2)
+    { checkSum -= binary[kOffset] + binary[kOffset + 1]; }
+
+    return uint16_t(checkSum);
+}
+
+//-----------------------------------------------------------------------------
+//      ROMバンクの先頭を取得します.
+//-----------------------------------------------------------------------------
+const uint8_t* GetRomBank(const Cartridge* cartridge, uint32_t bank)
+{
+    assert(cartridge != nullptr);
+
+    // バンク数は2のべき乗なので, 範囲外のバンク番号は上位ビットを無視する.
+    auto index = bank & (GetRomBankCount(cartridge) - 1);
+    return reinterpret_cast<const uint8_t*>(cartridge) + index * 0x4000;
+}
+
+//-----------------------------------------------------------------------------
+//      ROMバンク数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t GetRomBankCount(const Cartridge* cartridge)
+{
+    assert(cartridge != nullptr);
+    return GetRomSize(cartridge) / 0x4000;
+}
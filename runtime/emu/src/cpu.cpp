@@ -7,9 +7,148 @@
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
 #include <cpu.h>
 
-// Game Boy CPU Manual Page.89まで実装.
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+
+// 命令長(オペコードを含むバイト数).
+static constexpr uint8_t kCommandLength[256] = {
+//  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1, // 0x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 1x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 2x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 3x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 4x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 5x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 6x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 7x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 8x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 9x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // Ax
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // Bx
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1, // Cx
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1, // Dx
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1, // Ex
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1, // Fx
+};
+
+// 消費サイクル数(条件分岐は不成立時の値).
+static constexpr uint8_t kCommandCycles[256] = {
+//  x0  x1  x2  x3  x4  x5  x6  x7  x8  x9  xA  xB  xC  xD  xE  xF
+     4, 12,  8,  8,  4,  4,  8,  4, 20,  8,  8,  8,  4,  4,  8,  4, // 0x
+     4, 12,  8,  8,  4,  4,  8,  4, 12,  8,  8,  8,  4,  4,  8,  4, // 1x
+     8, 12,  8,  8,  4,  4,  8,  4,  8,  8,  8,  8,  4,  4,  8,  4, // 2x
+     8, 12,  8,  8, 12, 12, 12,  4,  8,  8,  8,  8,  4,  4,  8,  4, // 3x
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 4x
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 5x
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 6x
+     8,  8,  8,  8,  8,  8,  4,  8,  4,  4,  4,  4,  4,  4,  8,  4, // 7x
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 8x
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 9x
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // Ax
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // Bx
+     8, 12, 12, 16, 12, 16,  8, 16,  8, 16, 12,  4, 12, 24,  8, 16, // Cx
+     8, 12, 12,  0, 12, 16,  8, 16,  8, 16, 12,  0, 12,  0,  8, 16, // Dx
+    12, 12,  8,  0,  0, 16,  8, 16, 16,  4, 16,  0,  0,  0,  8, 16, // Ex
+    12, 12,  8,  4,  0, 16,  8, 16, 12,  8, 16,  4,  0,  0,  8, 16, // Fx
+};
+
+//-----------------------------------------------------------------------------
+//      CBプレフィックス命令の消費サイクル数を求めます(CBのフェッチ分は除く).
+//-----------------------------------------------------------------------------
+constexpr uint8_t GetPrefixCycles(uint8_t opCode)
+{
+    // (HL)以外はレジスタ操作.
+    if ((opCode & 0x07) != 0x06)
+    { return 4; }
+
+    // BIT b,(HL)は読み取りのみ.
+    return ((opCode >> 6) == 0x01) ? 8 : 12;
+}
+
+template<size_t... Index>
+constexpr std::array<uint8_t, 256> MakePrefixCycles(std::index_sequence<Index...>)
+{ return std::array<uint8_t, 256>{ { GetPrefixCycles(uint8_t(Index))... } }; }
+
+static constexpr auto kPrefixCycles = MakePrefixCycles(std::make_index_sequence<256>());
+
+//-----------------------------------------------------------------------------
+//      Fレジスタの値を生成します.
+//-----------------------------------------------------------------------------
+constexpr uint8_t MakeFlags(bool z, bool n, bool h, bool c)
+{ return uint8_t((z ? 0x80 : 0) | (n ? 0x40 : 0) | (h ? 0x20 : 0) | (c ? 0x10 : 0)); }
+
+//-----------------------------------------------------------------------------
+//      基本ブロックを終端させる命令かどうか判定します.
+//-----------------------------------------------------------------------------
+constexpr bool IsBlockTerminator(uint8_t opCode)
+{
+    switch(opCode)
+    {
+    // JR
+    case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+    // JP
+    case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9:
+    // CALL
+    case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+    // RET, RETI
+    case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9:
+    // RST
+    case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+    // HALT, STOP, DI, EI
+    case 0x76: case 0x10: case 0xF3: case 0xFB:
+        return true;
+
+    default:
+        // 未定義命令.
+        return kCommandCycles[opCode] == 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      メモリに書き込む可能性のある命令かどうか判定します.
+//-----------------------------------------------------------------------------
+//  ブロックが古くなるのは自己書き換えとバンク切り替えで, どちらも書き込みで起きる.
+//  IE/IFの変更も書き込みなので, それ以外の命令の後は判定を省ける.
+constexpr bool IsMemoryWrite(uint8_t opCode)
+{
+    switch(opCode)
+    {
+    // LD (BC),A  LD (DE),A  LD (HL+),A  LD (HL-),A  LD (nn),SP
+    case 0x02: case 0x12: case 0x22: case 0x32: case 0x08:
+    // INC (HL)  DEC (HL)  LD (HL),n
+    case 0x34: case 0x35: case 0x36:
+    // LD (HL),r
+    case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x77:
+    // PUSH
+    case 0xC5: case 0xD5: case 0xE5: case 0xF5:
+    // LDH (n),A  LD (C),A  LD (nn),A
+    case 0xE0: case 0xE2: case 0xEA:
+    // CBプレフィックス命令は(HL)を書き換える場合がある.
+    case 0xCB:
+        return true;
+
+    default:
+        // CALL, RSTは分岐なのでブロックの末尾にしか現れない.
+        return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      デコードキャッシュのインデックスを求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t GetBlockIndex(uint16_t pc, uint16_t bank, uint32_t size)
+{ return (pc ^ (uint32_t(bank) * 0x9E37u)) & (size - 1); }
+
+} // namespace
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -17,1569 +156,1201 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 
-void Cpu::Execute()
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool Cpu::Init()
 {
-    // 低電力モードの場合は実行しない.
-    if (m_EnablePowerSave)
-    { return; }
+    if (m_pBlocks != nullptr)
+    { Term(); }
 
-    // 命令をフェッチ.
-    auto cmd = Read8(m_Register.PC);
-    if (cmd != 0xCB)
+    auto size = sizeof(DecodedBlock) * BlockCacheSize;
+    m_pBlocks = static_cast<DecodedBlock*>(malloc(size));
+    if (m_pBlocks == nullptr)
+    { return false; }
+
+    memset(m_pBlocks, 0, size);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void Cpu::Term()
+{
+    m_Recompiler.Term();
+    m_ExecutionMode = EXECUTION_MODE_INTERPRETER;
+
+    if (m_pBlocks != nullptr)
     {
-        ExecuteCommand(cmd);
+        free(m_pBlocks);
+        m_pBlocks = nullptr;
     }
-    else
+}
+
+//-----------------------------------------------------------------------------
+//      実行モードを設定します.
+//-----------------------------------------------------------------------------
+bool Cpu::SetExecutionMode(EXECUTION_MODE mode)
+{
+    if (mode == EXECUTION_MODE_RECOMPILER)
     {
-        cmd = Read8(m_Register.PC + 1);
-        ExecutePrefixCommand(cmd);
+        if (!Recompiler::IsSupported())
+        { return false; }
+
+        if (!m_Recompiler.IsInitialized() && !m_Recompiler.Init(RecompilerCodeSize))
+        { return false; }
     }
+
+    m_ExecutionMode = mode;
+    return true;
 }
 
+//-----------------------------------------------------------------------------
+//      命令を1つ実行します.
+//-----------------------------------------------------------------------------
+void Cpu::Execute()
+{
+    // どの命令も1サイクル以上消費するので, 1命令だけ実行して戻る.
+    if (m_Accuracy == ACCURACY_MCYCLE)
+    { RunUntil<ACCURACY_MCYCLE>(m_ConsumedCycles + 1); }
+    else
+    { RunUntil<ACCURACY_INSTRUCTION>(m_ConsumedCycles + 1); }
+}
+
+//-----------------------------------------------------------------------------
+//      指定サイクル数か次のイベントに達するまで実行します.
+//-----------------------------------------------------------------------------
+uint64_t Cpu::RunCycles(uint64_t budget)
+{
+    auto start = m_ConsumedCycles;
+    auto limit = start + budget;
+    if (limit > m_NextEventCycle)
+    { limit = m_NextEventCycle; }
+
+    if (m_Accuracy == ACCURACY_MCYCLE)
+    { RunUntil<ACCURACY_MCYCLE>(limit); }
+    else
+    { RunUntil<ACCURACY_INSTRUCTION>(limit); }
+
+    return m_ConsumedCycles - start;
+}
+
+template<ACCURACY Accuracy>
+void Cpu::RunUntil(uint64_t limit)
+{
+    auto event = m_NextEventCycle;
+    while (m_ConsumedCycles < limit)
+    {
+        // 実行中の書き込みで周辺機器の次のイベントが早まった場合は, そこで止まる.
+        if (m_NextEventCycle != event)
+        {
+            event = m_NextEventCycle;
+            if (event < limit)
+            {
+                limit = event;
+                continue;
+            }
+        }
+
+        // 割り込み要求があればHALTから復帰し, 許可されていれば割り込みを処理する.
+        if (m_EnableInterrputs || m_EnablePowerSave)
+        {
+            auto pending = GetPendingInterrupts();
+            if (pending != 0)
+            {
+                m_EnablePowerSave = false;
+                if (m_EnableInterrputs)
+                {
+                    auto start = m_ConsumedCycles;
+                    ServiceInterrupt<Accuracy>(pending);
+                    if (IsProfiling())
+                    { m_pProfiler->RecordInterrupt(m_ConsumedCycles - start); }
+                    continue;
+                }
+            }
+        }
+
+        // 低電力モードの間は命令を実行せずに時間だけ進める.
+        if (m_EnablePowerSave)
+        {
+            auto start = m_ConsumedCycles;
+
+            // Mサイクル単位の場合は周辺機器からの割り込み要求で途中復帰できるようにする.
+            // 命令単位の場合もMサイクルの境界を保つため, limit以上の最初の4の倍数まで進める.
+            if constexpr (Accuracy == ACCURACY_MCYCLE)
+            { Idle<Accuracy>(); }
+            else
+            { m_ConsumedCycles += (limit - m_ConsumedCycles + 3) & ~uint64_t(3); }
+
+            if (IsProfiling())
+            { m_pProfiler->RecordHalt(m_ConsumedCycles - start); }
+            continue;
+        }
+
+        // EIは次の命令を実行してから有効になる.
+        if (m_DeferredEI)
+        {
+            m_DeferredEI       = false;
+            m_EnableInterrputs = true;
+            ExecuteNext<Accuracy>();
+            continue;
+        }
+
+        // Mサイクル単位の場合は命令ごとに割り込みを判定するため逐次実行.
+        // プロファイル中も命令ごとに記録するため逐次実行.
+        if (Accuracy == ACCURACY_MCYCLE || IsProfiling())
+        {
+            ExecuteNext<Accuracy>();
+            continue;
+        }
+
+        // デコード済みのブロックがあればそちらを実行.
+        auto block = FindBlock(m_Register.PC);
+        if (block != nullptr)
+        {
+            // 変換済みの先頭部分はネイティブコードで実行し, 残りをインタプリタで実行.
+            uint32_t index = 0;
+            if (m_ExecutionMode == EXECUTION_MODE_RECOMPILER)
+            { index = ExecuteNative(*block, limit); }
+
+            ExecuteBlock(*block, index, limit);
+
+        #if CPU_ENABLE_IDLE_LOOP_SKIP
+            // ポーリングループを1周した直後は状態が不動点になっているので,
+            // 次のイベントの直前までの周回はサイクル数だけ進める.
+            if (block->IdleCycles != 0 && m_Register.PC == block->PC && m_ConsumedCycles < limit)
+            {
+                auto count = (limit - m_ConsumedCycles - 1) / block->IdleCycles;
+                m_ConsumedCycles += count * block->IdleCycles;
+            }
+        #endif
+            continue;
+        }
+
+        // キャッシュできない領域は逐次実行.
+        ExecuteNext<Accuracy>();
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      割り込みを要求します.
+//-----------------------------------------------------------------------------
+void Cpu::RequestInterrupt(INTERRUPT value)
+{ Write8(AddressIF, Read8(AddressIF) | uint8_t(value)); }
+
+//-----------------------------------------------------------------------------
+//      要求されていて, かつ許可されている割り込みを取得します.
+//-----------------------------------------------------------------------------
+uint8_t Cpu::GetPendingInterrupts() const
+{ return Read8(AddressIE) & Read8(AddressIF) & 0x1F; }
+
+//-----------------------------------------------------------------------------
+//      割り込みを処理します.
+//-----------------------------------------------------------------------------
+template<ACCURACY Accuracy>
+void Cpu::ServiceInterrupt(uint8_t pending)
+{
+    // 優先度はビット番号の小さい順.
+    uint8_t index = 0;
+    while ((pending & (1 << index)) == 0)
+    { index++; }
+
+    Write8(AddressIF, Read8(AddressIF) & ~uint8_t(1 << index));
+    m_EnableInterrputs = false;
+
+    // 2Mサイクルの待機, PCの退避(内部動作を含む3Mサイクル)の計5Mサイクル.
+    Idle<Accuracy>();
+    Idle<Accuracy>();
+    PUSH<Accuracy>(m_Register.PC);
+    m_Register.PC = uint16_t(0x40 + index * 8);
+
+    if constexpr (Accuracy == ACCURACY_INSTRUCTION)
+    { m_ConsumedCycles += 20; }
+}
+
+template<ACCURACY Accuracy>
 void Cpu::ExecuteCommand(uint8_t opCode)
 {
-    switch(opCode)
-    {
-    case 0x00: {} break;
-    // LD BC,nn
-    case 0x01:
-    {
-        LD(m_Register.BC, nn());
-        m_ConsumedCycles += 12;
-    } break;
-    // LD (BC),A
-    case 0x02:
-    {
-        Write8(GetBC(), m_Register.A);
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x03: {} break;
-    // INC B
-    case 0x04: 
-    {
-        INC(m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // DEC B
-    case 0x05:
-    {
-        DEC(m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD B,n
-    case 0x06: 
-    {
-        LD(m_Register.B, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x07: {} break;
-    // LD (nn),SP
-    case 0x08:
-    {
-        Write16(nn(), m_Register.SP);
-        m_ConsumedCycles += 20;
-    } break;
-    case 0x09: {} break;
-    // LD A,(BC)
-    case 0x0A:
-    {
-        LD(m_Register.A, Read8(GetBC()));
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x0B: {} break;
-    // INC C
-    case 0x0C:
-    {
-        INC(m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // DEC C
-    case 0x0D:
-    {
-        DEC(m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,n
-    case 0x0E:
-    {
-        LD(m_Register.C, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x0F: {} break;
+    // オペランドをデコード.
+    auto length = kCommandLength[opCode];
+    if (length == 2)
+    { m_Operand = Read8(m_Register.PC + 1); }
+    else if (length == 3)
+    { m_Operand = Read16(m_Register.PC + 1); }
 
-    //-------------------------------------------------------------------------
+    m_Register.PC += length;
 
-    case 0x10: {} break;
-    // LD DE,nn
-    case 0x11:
-    {
-        LD(m_Register.DE, nn());
-        m_ConsumedCycles += 12;
-    } break;
-    // LD (DE),A
-    case 0x12:
-    {
-        Write8(GetDE(), m_Register.A);
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x13: {} break;
-    // INC D
-    case 0x14:
-    {
-        INC(m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // DEC D
-    case 0x15:
-    {
-        DEC(m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD D,n
-    case 0x16:
-    {
-        LD(m_Register.D, n());
-       m_ConsumedCycles += 8;
-    } break;
-    case 0x17: {} break;
-    case 0x18: {} break;
-    case 0x19: {} break;
-    // LD A,(DE)
-    case 0x1A:
-    {
-        LD(m_Register.A, Read8(GetDE()));
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x1B: {} break;
-    // INC E
-    case 0x1C:
-    {
-        INC(m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // DEC E
-    case 0x1D:
-    {
-        DEC(m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E,n
-    case 0x1E:
-    {
-        LD(m_Register.E, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x1F: {} break;
-
-    case 0x20: {} break;
-    // LD HL,nn
-    case 0x21:
-    {
-        LD(m_Register.HL, nn());
-        m_ConsumedCycles += 12;
-    } break;
-    // LDI (HL),A
-    case 0x22:
-    {
-        Write8(GetHL(), m_Register.A);
-        Inc8(GetHL());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x23: {} break;
-    // INC H
-    case 0x24:
-    {
-        INC(m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // DEC H
-    case 0x25:
-    {
-        DEC(m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD H,n
-    case 0x26:
+    // 命令フェッチ分のMサイクル.
+    if constexpr (Accuracy == ACCURACY_MCYCLE)
     {
-        LD(m_Register.H, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x27: {} break;
-    case 0x28: {} break;
-    case 0x29: {} break;
-    // LDI A,(HL)
-    case 0x2A:
-    {
-        LD(m_Register.A, Read8(GetHL()));
-        Inc8(GetHL());
-        m_ConsumedCycles +=8;
-    } break;
-    case 0x2B: {} break;
-    // INC L
-    case 0x2C:
-    {
-        INC(m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // DEC L
-    case 0x2D:
-    {
-        DEC(m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L,n
-    case 0x2E:
-    {
-        LD(m_Register.L, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x2F: {} break;
+        for(auto i=0; i<length; ++i)
+        { Tick<Accuracy>(); }
+    }
 
-    //-------------------------------------------------------------------------
+    // テーブル引きで実行.
+    (this->*s_CommandTable[Accuracy][opCode])();
 
-    case 0x30: {} break;
-    case 0x31: {} break;
-    // LDD (HL),A
-    case 0x32: 
-    {
-        Write8(GetHL(), m_Register.A);
-        Dec8(GetHL());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x33: {} break;
-    // INC (HL).
-    case 0x34:
-    {
-        auto hl = Read8(m_Register.HL);
-        INC(hl);
-        Write8(m_Register.HL, hl);
-        m_ConsumedCycles += 12;
-    } break;
-    // DEC (HL).
-    case 0x35:
-    {
-        auto hl = Read8(m_Register.HL);
-        DEC(hl);
-        Write8(m_Register.HL, hl);
-        m_ConsumedCycles += 12;
-    } break;
-    // LD (HL),n
-    case 0x36:
-    {
-        Write8(GetHL(), n());
-        m_ConsumedCycles += 12;
-    } break;
-    case 0x37: {} break;
-    case 0x38: {} break;
-    case 0x39: {} break;
-    // LDD A,(HL)
-    case 0x3A:
-    {
-        LD(m_Register.A, Read8(GetHL()));
-        Dec8(GetHL());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x3B: {} break;
-    // INC A
-    case 0x3C:
-    {
-        INC(m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    case 0x3D: {} break;
-    // LD A,#
-    case 0x3E:
-    {
-    } break;
-    case 0x3F: {} break;
+    if constexpr (Accuracy == ACCURACY_INSTRUCTION)
+    { m_ConsumedCycles += kCommandCycles[opCode]; }
+}
 
-    //-------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//      PCが指す命令を1つ実行します.
+//-----------------------------------------------------------------------------
+template<ACCURACY Accuracy>
+void Cpu::ExecuteNext()
+{
+    auto pc     = m_Register.PC;
+    auto opCode = Read8(pc);
+
+#if CPU_ENABLE_PROFILER
+    if (m_pProfiler != nullptr)
+    {
+        // CBプレフィックス命令は2バイト目で区別する.
+        auto index = uint16_t(opCode);
+        if (opCode == 0xCB)
+        { index = 0x100 | Read8(uint16_t(pc + 1)); }
+
+        auto bank  = GetBankOf(pc);
+        auto start = m_ConsumedCycles;
+        ExecuteCommand<Accuracy>(opCode);
+        m_pProfiler->Record(bank, pc, index, m_ConsumedCycles - start);
+        return;
+    }
+#endif
 
+    ExecuteCommand<Accuracy>(opCode);
+}
 
-    // LD B,B
-    case 0x40:
-    {
-        LD(m_Register.B, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD B,C
-    case 0x41:
-    {
-        LD(m_Register.B, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD B,D
-    case 0x42:
-    {
-        LD(m_Register.B, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD B,E
-    case 0x43:
-    {
-        LD(m_Register.B, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD B,H
-    case 0x44:
-    {
-        LD(m_Register.B, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD B,L
-    case 0x45:
-    {
-        LD(m_Register.B, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD B,(HL)
-    case 0x46:
-    {
-        LD(m_Register.B, Read8(GetHL()));
-        m_ConsumedCycles += 8;
-    } break;
-    // LD B,A
-    case 0x47: 
-    {
-        LD(m_Register.B, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,B
-    case 0x48:
-    {
-        LD(m_Register.C, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,C
-    case 0x49:
-    {
-        LD(m_Register.C, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,D
-    case 0x4A:
-    {
-        LD(m_Register.C, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,E
-    case 0x4B:
-    {
-        LD(m_Register.C, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,H
-    case 0x4C:
-    {
-        LD(m_Register.C, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,L
-    case 0x4D:
-    {
-        LD(m_Register.C, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD C,(HL)
-    case 0x4E:
-    {
-        LD(m_Register.C, Read8(GetHL()));
-        m_ConsumedCycles += 8;
-    } break;
-    // LD C,A
-    case 0x4F:
-    {
-        LD(m_Register.C, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
+template<ACCURACY Accuracy>
+void Cpu::ExecutePrefixCommand(uint8_t opCode)
+{
+    // テーブル引きで実行.
+    (this->*s_PrefixTable[Accuracy][opCode])();
 
-    //-------------------------------------------------------------------------
+    if constexpr (Accuracy == ACCURACY_INSTRUCTION)
+    { m_ConsumedCycles += kPrefixCycles[opCode]; }
+}
 
-    // LD D,B
-    case 0x50:
-    {
-        LD(m_Register.D, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD D,C
-    case 0x51:
-    {
-        LD(m_Register.D, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD D,D
-    case 0x52: 
-    {
-        LD(m_Register.D, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD D,E
-    case 0x53:
-    {
-        LD(m_Register.D, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD D,H
-    case 0x54:
-    {
-        LD(m_Register.D, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD D,L
-    case 0x55:
-    {
-        LD(m_Register.D, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD D, (HL)
-    case 0x56:
-    {
-        LD(m_Register.D, Read8(GetHL()));
-        m_ConsumedCycles += 8;
-    } break;
-    // LD D,A
-    case 0x57:
-    {
-        LD(m_Register.D, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E,B
-    case 0x58:
-    {
-        LD(m_Register.E, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E,C
-    case 0x59:
-    {
-        LD(m_Register.E, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E,D
-    case 0x5A:
-    {
-        LD(m_Register.E, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E,E
-    case 0x5B: 
-    {
-        LD(m_Register.E, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E,H
-    case 0x5C:
-    {
-        LD(m_Register.E, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E,L
-    case 0x5D:
-    {
-        LD(m_Register.E, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD E, (HL)
-    case 0x5E:
-    {
-        LD(m_Register.E, Read8(GetHL()));
-        m_ConsumedCycles += 8;
-    } break;
-    // LD E,A
-    case 0x5F:
+uint32_t Cpu::ExecuteNative(DecodedBlock& block, uint64_t limit)
+{
+    // コード領域がリセットされていたら数え直す.
+    auto generation = m_Recompiler.GetGeneration();
+    if (block.NativeGeneration != generation)
+    {
+        block.NativeGeneration = generation;
+        block.pNative          = nullptr;
+        block.pNativeChain     = nullptr;
+        block.HitCount         = 0;
+    }
+
+    if (block.pNative == nullptr)
     {
-        LD(m_Register.E, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
+        // 十分に実行されたブロックだけ変換する. 変換できなかったブロックは再試行しない.
+        if (block.HitCount > RecompileThreshold)
+        { return 0; }
 
-    //-------------------------------------------------------------------------
+        if (++block.HitCount <= RecompileThreshold)
+        { return 0; }
 
-    // LD H,B
-    case 0x60:
-    {
-        LD(m_Register.H, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD H,C
-    case 0x61:
-    {
-        LD(m_Register.H, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD H,D
-    case 0x62:
-    {
-        LD(m_Register.H, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD H,E
-    case 0x63: 
-    {
-        LD(m_Register.H, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD H,H
-    case 0x64:
-    {
-        LD(m_Register.H, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD H,L
-    case 0x65:
-    {
-        LD(m_Register.H, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD H,(HL)
-    case 0x66:
-    {
-        LD(m_Register.H, Read8(GetHL()));
-        m_ConsumedCycles += 8;
-    } break;
-    // LD H,A
-    case 0x67:
-    {
-        LD(m_Register.H, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L,B
-    case 0x68:
-    {
-        LD(m_Register.L, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L,C
-    case 0x69:
-    {
-        LD(m_Register.L, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L,D
-    case 0x6A:
-    {
-        LD(m_Register.L, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L,E
-    case 0x6B:
-    {
-        LD(m_Register.L, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L, H
-    case 0x6C:
-    {
-        LD(m_Register.L, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L,L
-    case 0x6D:
-    {
-        LD(m_Register.L, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD L,(HL)
-    case 0x6E:
-    {
-        LD(m_Register.L, Read8(GetHL()));
-        m_ConsumedCycles += 8;
-    } break;
-    // LD L,A
-    case 0x6F: 
+        if (!CompileBlock(block))
+        { return 0; }
+    }
+
+    // 直前に抜けた分岐がこのブロックへ来ていたら, 次からは直接ジャンプさせる.
+    // 全体を変換できたブロックだけを対象にし, ポーリングループは周回の省略のためディスパッチャへ戻す.
+    if (m_pLinkSite != nullptr)
     {
-        LD(m_Register.L, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
+        if (m_LinkPC == block.PC && m_LinkGeneration == generation
+         && block.NativeCount == block.Count && block.IdleCycles == 0)
+        { m_Recompiler.Link(m_pLinkSite, block.pNativeChain); }
 
-    //-------------------------------------------------------------------------
+        m_pLinkSite = nullptr;
+    }
 
-    // LD (HL),B
-    case 0x70:
-    {
-        Write8(GetHL(), m_Register.B);
-        m_ConsumedCycles += 8;
-    } break;
-    // LD (HL),C
-    case 0x71:
-    {
-        Write8(GetHL(), m_Register.C);
-        m_ConsumedCycles += 8;
-    } break;
-    // LD (HL),D
-    case 0x72:
-    {
-        Write8(GetHL(), m_Register.D);
-        m_ConsumedCycles += 8;
-    } break;
-    // LD (HL),E
-    case 0x73:
-    {
-        Write8(GetHL(), m_Register.E);
-        m_ConsumedCycles += 8;
-    } break;
-    // LD (HL),H
-    case 0x74:
-    {
-        Write8(GetHL(), m_Register.H);
-        m_ConsumedCycles += 8;
-    } break;
-    // LD (HL),L
-    case 0x75:
-    {
-        Write8(GetHL(), m_Register.L);
-        m_ConsumedCycles += 8;
-    } break;
-    case 0x76: {} break;
-    // LD (HL),A
-    case 0x77:
-    {
-        Write8(GetHL(), m_Register.A);
-        m_ConsumedCycles += 8;
-    } break;
-    // LD A,B
-    case 0x78:
-    {
-        LD(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD A,C
-    case 0x79:
-    {
-        LD(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD A,D
-    case 0x7A:
-    {
-        LD(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD A,E
-    case 0x7B:
-    {
-        LD(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD A,H
-    case 0x7C:
-    {
-        LD(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD A,L
-    case 0x7D:
-    {
-        LD(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // LD A,(HL)
-    case 0x7E:
-    {
-        LD(m_Register.A, Read8(GetHL()));
-        m_ConsumedCycles += 8;
-    } break;
-    // LD A,A
-    case 0x7F:
-    {
-        LD(m_Register.A, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
+    // 途中で止められないので, 予算を超える場合はインタプリタで1命令ずつ実行する.
+    if (block.NativeCycles > limit - m_ConsumedCycles)
+    { return 0; }
+
+    // 変換済みコードはブロックの入口ごとに予算とページ世代を確かめ, 超える場合や古い場合はここへ戻る.
+    // 割り込み要求を変えうる書き込みはハンドラ経由で止まるので, 割り込みの判定はディスパッチャ側で行う.
+    // ネイティブコードはFレジスタを直接読み書きするので, 未評価のフラグを反映しておく.
+    MaterializeFlags();
+
+    auto& context = m_NativeContext;
+    context.pRegister     = &m_Register;
+    context.pReadPages    = m_pMemory->GetReadPages();
+    context.pWritePages   = m_pMemory->GetWritePages();
+    context.pPageVersions = m_pMemory->GetPageVersions();
+    context.pRead         = &Cpu::ReadNative;
+    context.pWrite        = &Cpu::WriteNative;
+    context.pUser         = this;
+    context.Cycles        = m_ConsumedCycles;
+    context.Limit         = limit;
+    context.pLink         = nullptr;
+    context.RomBank       = m_pMemory->GetRomBank();
+
+    auto start   = m_ConsumedCycles;
+    auto stopped = block.pNative(&context);
+    m_ConsumedCycles = context.Cycles;
+
+    if (context.pLink != nullptr)
+    {
+        m_pLinkSite      = context.pLink;
+        m_LinkPC         = m_Register.PC;
+        m_LinkGeneration = generation;
+    }
 
-    //-------------------------------------------------------------------------
+    // 入口で戻った場合は, インタプリタで先頭から実行する.
+    if (m_ConsumedCycles == start)
+    { return 0; }
 
-    // ADD A,B
-    case 0x80:
-    {
-        ADD(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADD A,C
-    case 0x81:
-    {
-        ADD(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADD A,D
-    case 0x82:
-    {
-        ADD(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADD A,E
-    case 0x83:
-    {
-        ADD(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADD A,H
-    case 0x84:
-    {
-        ADD(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADD A,L
-    case 0x85:
-    {
-        ADD(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADD A,(HL)
-    case 0x86:
-    {
-        ADD(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    // ADD A,A
-    case 0x87:
-    {
-        ADD(m_Register.A, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADC A,B
-    case 0x88:
-    {
-        ADC(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADC A,C
-    case 0x89:
-    {
-        ADC(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADC A,D
-    case 0x8A:
-    {
-        ADC(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADC A,E
-    case 0x8B:
-    {
-        ADC(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADC A,H
-    case 0x8C:
-    {
-        ADC(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADC A, L
-    case 0x8D:
-    {
-        ADC(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // ADC A,(HL)
-    case 0x8E:
-    {
-        ADC(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    // ADC A,A
-    case 0x8F:
-    {
-        ADC(m_Register.A, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
+    // このブロックの変換できない命令で止まった場合は, 続きをインタプリタで実行する.
+    if (stopped != 0 && m_Register.PC == uint16_t(block.PC + block.NativeLength) && m_ConsumedCycles < limit)
+    { return block.NativeCount; }
 
-    //-------------------------------------------------------------------------
+    return block.Count;
+}
 
-    // SUB A,B
-    case 0x90:
-    {
-        SUB(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // SUB A,C
-    case 0x91:
-    {
-        SUB(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // SUB A,D
-    case 0x92:
-    {
-        SUB(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // SUB A,E
-    case 0x93:
-    {
-        SUB(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // SUB A,H
-    case 0x94:
-    {
-        SUB(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // SUB A,L
-    case 0x95:
-    {
-        SUB(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // SUB A,(HL)
-    case 0x96:
-    {
-        SUB(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    // SUB A,A
-    case 0x97:
-    {
-        SUB(m_Register.A, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    // SBC A,B
-    case 0x98:
-    {
-        SBC(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // SBC A,C
-    case 0x99:
-    {
-        SBC(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // SBC A,D
-    case 0x9A:
-    {
-        SBC(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // SBC A,E
-    case 0x9B: 
-    {
-        SBC(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // SBC A,H
-    case 0x9C:
-    {
-        SBC(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // SBC A,L
-    case 0x9D:
-    {
-        SBC(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // SBC A,(HL)
-    case 0x9E:
-    {
-        SBC(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    // SBC A,A
-    case 0x9F:
+bool Cpu::CompileBlock(DecodedBlock& block)
+{
+    Recompiler::Command commands[MaxBlockCommands];
+    for(auto i=0u; i<block.Count; ++i)
     {
-        SBC(m_Register.A, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
+        commands[i].OpCode  = block.Commands[i].OpCode;
+        commands[i].Operand = block.Commands[i].Operand;
+        commands[i].Length  = block.Commands[i].Length;
+        commands[i].Cycles  = block.Commands[i].Cycles;
+    }
 
-    //-------------------------------------------------------------------------
+    Recompiler::Block source = {};
+    source.pCommands = commands;
+    source.Count     = block.Count;
+    source.PC        = block.PC;
+    source.Bank      = block.Bank;
+    source.Version   = block.Version;
+    source.Chainable = (block.IdleCycles == 0);   // ポーリングループは周回を省略するため毎回戻る.
+
+    Recompiler::Result result = {};
+    if (!m_Recompiler.Compile(source, result))
+    { return false; }
+
+    block.pNative          = result.pEntry;
+    block.pNativeChain     = result.pChain;
+    block.NativeCount      = result.Count;
+    block.NativeLength     = result.Length;
+    block.NativeCycles     = result.Cycles;
+    block.NativeGeneration = m_Recompiler.GetGeneration();
+    return true;
+}
 
-    // AND A,B
-    case 0xA0:
-    {
-        AND(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // AND A,C
-    case 0xA1:
-    {
-        AND(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // AND A,D
-    case 0xA2:
-    {
-        AND(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // AND A,E
-    case 0xA3:
-    {
-        AND(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // AND A,H
-    case 0xA4:
-    {
-        AND(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // AND A,L
-    case 0xA5:
-    {
-        AND(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // AND A,(HL)
-    case 0xA6:
-    {
-        AND(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    // AND A,A
-    case 0xA7:
-    {
-        AND(m_Register.A, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    // XOR A,B
-    case 0xA8:
-    {
-        XOR(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // XOR A,C
-    case 0xA9:
-    {
-        XOR(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // XOR A,D
-    case 0xAA:
-    {
-        XOR(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // XOR A,E
-    case 0xAB:
-    {
-        XOR(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // XOR A,H
-    case 0xAC:
-    {
-        XOR(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // XOR A,L
-    case 0xAD:
-    {
-        XOR(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // XOR A,(HL)
-    case 0xAE:
-    {
-        XOR(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xAF: {} break;
+//-----------------------------------------------------------------------------
+//      変換済みコードからのハンドラ経由の読み取り.
+//-----------------------------------------------------------------------------
+uint8_t Cpu::ReadNative(void* pUser, uint16_t address)
+{
+    auto self = static_cast<Cpu*>(pUser);
+    self->m_ConsumedCycles = self->m_NativeContext.Cycles;
+    return self->Read8(address);
+}
+
+//-----------------------------------------------------------------------------
+//      変換済みコードからのハンドラ経由の書き込み.
+//-----------------------------------------------------------------------------
+//  割り込み要求・ROMバンク・次のイベントのいずれかが変わった場合はfalseを返して止める.
+bool Cpu::WriteNative(void* pUser, uint16_t address, uint8_t value)
+{
+    auto self       = static_cast<Cpu*>(pUser);
+    auto memory     = self->m_pMemory;
+    auto interrupts = memory->GetInterruptVersion();
+    auto bank       = memory->GetRomBank();
+    auto event      = self->m_NextEventCycle;
+
+    self->m_ConsumedCycles = self->m_NativeContext.Cycles;
+    self->Write8(address, value);
+
+    return memory->GetInterruptVersion() == interrupts
+        && memory->GetRomBank()          == bank
+        && self->m_NextEventCycle        == event;
+}
+
+//=============================================================================
+// Decode Cache.
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//      指定アドレスから始まるデコード済みブロックを取得します.
+//-----------------------------------------------------------------------------
+Cpu::DecodedBlock* Cpu::FindBlock(uint16_t pc)
+{
+    if (m_pBlocks == nullptr)
+    { return nullptr; }
+
+    // エコーRAMはWRAM側のページ世代で無効化されないので, OAM・I/Oレジスタ・HRAMのページは
+    // 書き込みが頻繁なのでキャッシュしない.
+    if (pc >= 0xE000)
+    { return nullptr; }
+
+    auto bank  = GetBankOf(pc);
+    auto& block = m_pBlocks[GetBlockIndex(pc, bank, BlockCacheSize)];
+    if (block.PC != pc || block.Bank != bank || !IsValidBlock(block))
+    { DecodeBlock(block, pc, bank); }
+
+    return (block.Count > 0) ? &block : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      基本ブロックをデコードします.
+//-----------------------------------------------------------------------------
+void Cpu::DecodeBlock(DecodedBlock& block, uint16_t pc, uint16_t bank)
+{
+    block.PC      = pc;
+    block.Bank    = bank;
+    block.Version = m_pMemory->GetPageVersion(uint8_t(pc >> 8));
+    block.Count   = 0;
+
+    block.NativeCount       = 0;
+    block.NativeCycles      = 0;
+    block.NativeLength      = 0;
+    block.IdleCycles        = 0;
+    block.HitCount          = 0;
+    block.NativeGeneration  = 0;
+    block.pNative           = nullptr;
+    block.pNativeChain      = nullptr;
+
+    // ページを跨ぐ命令は含めない(無効化判定を1ページで済ませるため).
+    uint32_t address = pc;
+    uint32_t end     = (pc & 0xFF00) + 0x100;
+
+    while(block.Count < MaxBlockCommands)
+    {
+        auto opCode = Read8(uint16_t(address));
+        auto length = kCommandLength[opCode];
+        if (address + length > end)
+        { break; }
+
+        auto& cmd = block.Commands[block.Count++];
+        cmd.OpCode  = opCode;
+        cmd.Length  = length;
+        cmd.Operand = 0;
+        if (length == 2)
+        { cmd.Operand = Read8(uint16_t(address + 1)); }
+        else if (length == 3)
+        { cmd.Operand = Read16(uint16_t(address + 1)); }
+
+        if (opCode == 0xCB)
+        {
+            // プレフィックス命令はハンドラを直接引いておく.
+            auto prefix = uint8_t(cmd.Operand);
+            cmd.Func   = s_PrefixTable[ACCURACY_INSTRUCTION][prefix];
+            cmd.Cycles = kCommandCycles[opCode] + kPrefixCycles[prefix];
+        }
+        else
+        {
+            cmd.Func   = s_CommandTable[ACCURACY_INSTRUCTION][opCode];
+            cmd.Cycles = kCommandCycles[opCode];
+        }
+
+        address += length;
+        if (IsBlockTerminator(opCode))
+        { break; }
+    }
+
+    block.IdleCycles = GetIdleCycles(block);
+}
+
+//-----------------------------------------------------------------------------
+//      ポーリングループ1周分のサイクル数を求めます.
+//-----------------------------------------------------------------------------
+//  LY, STAT, IFを読んで比較し, 先頭へ戻るだけのブロックを対象とする.
+//  書き込みを含まず, Aとフラグは読み込んだ値だけで決まるので, 1周した後の状態は
+//  読み込んだ値が変わらない限り変化しない. I/Oレジスタはイベント境界でしか
+//  更新されないため, 次のイベントまでの周回は結果を変えずに省略できる.
+uint8_t Cpu::GetIdleCycles(const DecodedBlock& block) const
+{
+#if CPU_ENABLE_IDLE_LOOP_SKIP
+    if (block.Count == 0)
+    { return 0; }
+
+    uint32_t cycles = 0;
+    uint32_t length = 0;
+    for(auto i=0u; i<block.Count - 1u; ++i)
+    {
+        auto& cmd = block.Commands[i];
+        if (i == 0)
+        {
+            // 先頭はI/Oレジスタの読み込み.
+            uint16_t address = 0;
+            if (cmd.OpCode == 0xF0)         // LDH A,(n)
+            { address = 0xFF00 + uint8_t(cmd.Operand); }
+            else if (cmd.OpCode == 0xFA)    // LD A,(nn)
+            { address = cmd.Operand; }
+
+            if (address != 0xFF44 && address != 0xFF41 && address != AddressIF)
+            { return 0; }
+        }
+        else
+        {
+            // 比較・マスクのみ.
+            switch(cmd.OpCode)
+            {
+            case 0xFE:  // CP n
+            case 0xE6:  // AND n
+            case 0xA7:  // AND A
+            case 0xB7:  // OR A
+                break;
+
+            case 0xCB:  // BIT b,A
+                if ((cmd.Operand & 0xC7) != 0x47)
+                { return 0; }
+                break;
+
+            default:
+                return 0;
+            }
+        }
+
+        cycles += cmd.Cycles;
+        length += cmd.Length;
+    }
+
+    // 末尾は先頭へ戻る分岐(読み込みを含まない場合は自分自身への無条件分岐のみ).
+    auto& last = block.Commands[block.Count - 1];
+    uint16_t target = 0;
+    bool conditional = false;
+    switch(last.OpCode)
+    {
+    case 0x20: case 0x28: case 0x30: case 0x38:
+        conditional = true;
+        [[fallthrough]];
+    case 0x18:
+        target = uint16_t(block.PC + length + last.Length + int8_t(last.Operand));
+        break;
+
+    case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+        conditional = true;
+        [[fallthrough]];
+    case 0xC3:
+        target = last.Operand;
+        break;
+
+    default:
+        return 0;
+    }
 
-    //-------------------------------------------------------------------------
+    if (target != block.PC)
+    { return 0; }
 
-    // OR A,B
-    case 0xB0:
-    {
-        OR(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // OR A,C
-    case 0xB1:
-    {
-        OR(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // OR A,D
-    case 0xB2:
-    {
-        OR(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // OR A,E
-    case 0xB3:
-    {
-        OR(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // OR A,H
-    case 0xB4:
-    {
-        OR(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // OR A,L
-    case 0xB5:
-    {
-        OR(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // OR A,(HL)
-    case 0xB6:
-    {
-        OR(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    // OR A,A
-    case 0xB7:
-    {
-        OR(m_Register.A, m_Register.A);
-        m_ConsumedCycles += 4;
-    } break;
-    // CP A,B
-    case 0xB8:
-    {
-        CP(m_Register.A, m_Register.B);
-        m_ConsumedCycles += 4;
-    } break;
-    // CP A,C
-    case 0xB9:
-    {
-        CP(m_Register.A, m_Register.C);
-        m_ConsumedCycles += 4;
-    } break;
-    // CP A,D
-    case 0xBA:
-    {
-        CP(m_Register.A, m_Register.D);
-        m_ConsumedCycles += 4;
-    } break;
-    // CP A,E
-    case 0xBB:
-    {
-        CP(m_Register.A, m_Register.E);
-        m_ConsumedCycles += 4;
-    } break;
-    // CP A,H
-    case 0xBC:
-    {
-        CP(m_Register.A, m_Register.H);
-        m_ConsumedCycles += 4;
-    } break;
-    // CP A,L
-    case 0xBD:
-    {
-        CP(m_Register.A, m_Register.L);
-        m_ConsumedCycles += 4;
-    } break;
-    // CP A,(HL)
-    case 0xBE:
-    {
-        CP(m_Register.A, Read8(m_Register.HL));
-        m_ConsumedCycles += 8;
-    } break;
-    // CP A,A
-    case 0xBF:
+    // 条件分岐は成立時のサイクル数.
+    cycles += last.Cycles + (conditional ? 4 : 0);
+    return (cycles <= 0xFF) ? uint8_t(cycles) : 0;
+#else
+    return 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      デコード済みブロックが現在のメモリ内容と一致するか判定します.
+//-----------------------------------------------------------------------------
+bool Cpu::IsValidBlock(const DecodedBlock& block) const
+{
+    return block.Count   > 0
+        && block.Bank    == GetBankOf(block.PC)
+        && block.Version == m_pMemory->GetPageVersion(uint8_t(block.PC >> 8));
+}
+
+//=============================================================================
+// Bus Access.
+//=============================================================================
+
+// ACCURACY_INSTRUCTIONではサイクルは命令の完了時にテーブルから加算するので何もしない.
+
+template<ACCURACY Accuracy>
+inline void Cpu::Tick()
+{
+    if constexpr (Accuracy == ACCURACY_MCYCLE)
     {
-        CP(m_Register.A, m_Register.A);
         m_ConsumedCycles += 4;
-    } break;
+        if (m_pTickHandler != nullptr)
+        { m_pTickHandler(m_pTickUser, m_ConsumedCycles); }
+    }
+}
 
-    //-------------------------------------------------------------------------
+template<ACCURACY Accuracy>
+inline void Cpu::Idle()
+{ Tick<Accuracy>(); }
 
-    case 0xC0: {} break;
-    // POP BC
-    case 0xC1:
-    {
-        POP(m_Register.BC);
-        m_ConsumedCycles += 12;
-    } break;
-    case 0xC2: {} break;
-    case 0xC3: {} break;
-    case 0xC4: {} break;
-    // PUSH BC
-    case 0xC5:
-    {
-        PUSH(m_Register.BC);
-        m_ConsumedCycles += 16;
-    } break;
-    // ADD A,#
-    case 0xC6:
-    {
-        ADD(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xC7: {} break;
-    case 0xC8: {} break;
-    case 0xC9: {} break;
-    case 0xCA: {} break;
-    case 0xCB: {} break;
-    case 0xCC: {} break;
-    case 0xCD: {} break;
-    // ADC A,#
-    case 0xCE:
-    {
-        ADC(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xCF: {} break;
+template<ACCURACY Accuracy>
+inline uint8_t Cpu::BusRead8(uint16_t address)
+{
+    Tick<Accuracy>();
+    return Read8(address);
+}
 
-    //-------------------------------------------------------------------------
+template<ACCURACY Accuracy>
+inline uint16_t Cpu::BusRead16(uint16_t address)
+{
+    uint16_t lo = BusRead8<Accuracy>(address);
+    uint16_t hi = BusRead8<Accuracy>(address + 1);
+    return uint16_t((hi << 8) | lo);
+}
 
-    case 0xD0: {} break;
-    // POP DE
-    case 0xD1:
-    {
-        POP(m_Register.DE);
-        m_ConsumedCycles += 12;
-    } break;
-    case 0xD2: {} break;
-    case 0xD3: {} break;
-    case 0xD4: {} break;
-    // PUSH DE
-    case 0xD5:
-    {
-        PUSH(m_Register.DE);
-        m_ConsumedCycles += 16;    
-    } break;
-    // SUB A,#
-    case 0xD6:
-    {
-        SUB(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xD7: {} break;
-    case 0xD8: {} break;
-    case 0xD9: {} break;
-    case 0xDA: {} break;
-    case 0xDB: {} break;
-    case 0xDC: {} break;
-    case 0xDD: {} break;
-    // SBC A,#
-    case 0xDE:
-    {
-        SBC(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xDF: {} break;
+template<ACCURACY Accuracy>
+inline void Cpu::BusWrite8(uint16_t address, uint8_t value)
+{
+    Tick<Accuracy>();
+    Write8(address, value);
+}
 
-    //-------------------------------------------------------------------------
+template<ACCURACY Accuracy>
+inline void Cpu::BusWrite16(uint16_t address, uint16_t value)
+{
+    BusWrite8<Accuracy>(address,     uint8_t(value));
+    BusWrite8<Accuracy>(address + 1, uint8_t(value >> 8));
+}
 
-    // LDH (n),A
-    case 0xE0:
-    {
-        Write8(0xFF00 + n(), m_Register.A);
-        m_ConsumedCycles += 12;
-    } break;
-    // POP HL
-    case 0xE1:
-    {
-        POP(m_Register.HL);
-        m_ConsumedCycles += 12;
-    } break;
-    // LD (C),A
-    case 0xE2:
-    {
-        Write8(0xFF + m_Register.C, m_Register.A);
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xE3: {} break;
-    case 0xE4: {} break;
-    // PUSH HL
-    case 0xE5:
-    {
-        PUSH(m_Register.HL);
-        m_ConsumedCycles += 16;
-    } break;
-    // AND A,#
-    case 0xE6:
-    {
-        AND(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xE7: {} break;
-    case 0xE8: {} break;
-    case 0xE9: {} break;
-    // LD (nn), A
-    case 0xEA:
-    {
-        Write16(nn(), m_Register.A);
-        m_ConsumedCycles += 16;
-    } break;
-    case 0xEB: {} break;
-    case 0xEC: {} break;
-    case 0xED: {} break;
-    // XOR A,#
-    case 0xEE:
-    {
-        XOR(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xEF: {} break;
+//=============================================================================
+// Operands.
+//=============================================================================
 
-    //-------------------------------------------------------------------------
+// 8bitレジスタ(r). 6は(HL)が指すメモリ.
+template<ACCURACY Accuracy, uint8_t Index>
+inline uint8_t Cpu::GetR8()
+{
+    static_assert(Index < 8, "Invalid register index.");
+    if constexpr (Index == 0) { return m_Register.B; }
+    if constexpr (Index == 1) { return m_Register.C; }
+    if constexpr (Index == 2) { return m_Register.D; }
+    if constexpr (Index == 3) { return m_Register.E; }
+    if constexpr (Index == 4) { return m_Register.H; }
+    if constexpr (Index == 5) { return m_Register.L; }
+    if constexpr (Index == 6) { return BusRead8<Accuracy>(m_Register.HL); }
+    if constexpr (Index == 7) { return m_Register.A; }
+}
 
-    // LDH A,(n)
-    case 0xF0:
-    {
-        LD(m_Register.A, Read8(0xFF00 + n()));
-        m_ConsumedCycles += 12;
-    } break;
-    case 0xF1:
-    {
-        POP(m_Register.AF);
-        m_ConsumedCycles += 12;
-    } break;
-    // LD A,(C)
-    case 0xF2:
-    {
-        LD(m_Register.A, Read8(m_Register.C));
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xF3: {} break;
-    case 0xF4: {} break;
-    // PUSH AF
-    case 0xF5:
+template<ACCURACY Accuracy, uint8_t Index>
+inline void Cpu::SetR8(uint8_t value)
+{
+    static_assert(Index < 8, "Invalid register index.");
+    if constexpr (Index == 0) { m_Register.B = value; }
+    if constexpr (Index == 1) { m_Register.C = value; }
+    if constexpr (Index == 2) { m_Register.D = value; }
+    if constexpr (Index == 3) { m_Register.E = value; }
+    if constexpr (Index == 4) { m_Register.H = value; }
+    if constexpr (Index == 5) { m_Register.L = value; }
+    if constexpr (Index == 6) { BusWrite8<Accuracy>(m_Register.HL, value); }
+    if constexpr (Index == 7) { m_Register.A = value; }
+}
+
+// 16bitレジスタ(rr).
+template<uint8_t Index>
+inline uint16_t& Cpu::R16()
+{
+    static_assert(Index < 4, "Invalid register pair index.");
+    if constexpr (Index == 0) { return m_Register.BC; }
+    if constexpr (Index == 1) { return m_Register.DE; }
+    if constexpr (Index == 2) { return m_Register.HL; }
+    if constexpr (Index == 3) { return m_Register.SP; }
+}
+
+// 条件コード(cc).
+template<uint8_t Cond>
+inline bool Cpu::Condition() const
+{
+    if constexpr (Cond == CONDITION_NZ)     { return !ComputeZero(); }
+    if constexpr (Cond == CONDITION_Z)      { return  ComputeZero(); }
+    if constexpr (Cond == CONDITION_NC)     { return ComputeCarry() == 0; }
+    if constexpr (Cond == CONDITION_C)      { return ComputeCarry() != 0; }
+    if constexpr (Cond == CONDITION_ALWAYS) { return true; }
+}
+
+//=============================================================================
+// Commands.
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//      オペコードのビットフィールドから命令を生成します.
+//-----------------------------------------------------------------------------
+//  オペコードを xxyyyzzz (p = y >> 1, q = y & 1) に分解し, 同じ形式の命令を
+//  オペランドごとに特殊化する. 命令の定義は1つで, メモリアクセスと内部動作の
+//  Mサイクルの扱いだけをAccuracyで切り替える.
+template<ACCURACY Accuracy, uint8_t OpCode>
+void Cpu::Command()
+{
+    constexpr uint8_t x = OpCode >> 6;
+    constexpr uint8_t y = (OpCode >> 3) & 0x07;
+    constexpr uint8_t z = OpCode & 0x07;
+    constexpr uint8_t p = y >> 1;
+    constexpr uint8_t q = y & 0x01;
+
+    if constexpr (x == 0)
+    {
+        if constexpr (z == 0)
+        {
+            if constexpr (y == 0)
+            {
+                // NOP
+            }
+            else if constexpr (y == 1)
+            {
+                // LD (nn),SP
+                BusWrite16<Accuracy>(nn(), m_Register.SP);
+            }
+            else if constexpr (y == 2)
+            {
+                // STOP
+                STOP();
+            }
+            else
+            {
+                // JR n, JR cc,n
+                JR<Accuracy, (y == 3) ? CONDITION_ALWAYS : (y - 4)>(n());
+            }
+        }
+        else if constexpr (z == 1)
+        {
+            if constexpr (q == 0)
+            {
+                // LD rr,nn
+                LD(R16<p>(), nn());
+            }
+            else
+            {
+                // ADD HL,rr
+                ADD(m_Register.HL, R16<p>());
+                Idle<Accuracy>();
+            }
+        }
+        else if constexpr (z == 2)
+        {
+            // LD (BC),A / LD (DE),A / LDI (HL),A / LDD (HL),A とその逆方向.
+            auto addr = (p < 2) ? R16<p>() : m_Register.HL;
+            if constexpr (q == 0)
+            { BusWrite8<Accuracy>(addr, m_Register.A); }
+            else
+            { LD(m_Register.A, BusRead8<Accuracy>(addr)); }
+
+            if constexpr (p == 2)
+            { INC(m_Register.HL); }
+            else if constexpr (p == 3)
+            { DEC(m_Register.HL); }
+        }
+        else if constexpr (z == 3)
+        {
+            // INC rr / DEC rr
+            if constexpr (q == 0)
+            { INC(R16<p>()); }
+            else
+            { DEC(R16<p>()); }
+            Idle<Accuracy>();
+        }
+        else if constexpr (z == 4 || z == 5)
+        {
+            // INC r / DEC r
+            auto val = GetR8<Accuracy, y>();
+            if constexpr (z == 4)
+            { INC(val); }
+            else
+            { DEC(val); }
+            SetR8<Accuracy, y>(val);
+        }
+        else if constexpr (z == 6)
+        {
+            // LD r,n
+            SetR8<Accuracy, y>(n());
+        }
+        else
+        {
+            if constexpr (y < 4)
+            {
+                // RLCA, RRCA, RLA, RRA (CB版と異なりZフラグは常に0).
+                ROT<y>(m_Register.A);
+                m_Register.F.Z = 0;
+            }
+            else if constexpr (y == 4)
+            { DAA(); }
+            else if constexpr (y == 5)
+            { CPL(); }
+            else if constexpr (y == 6)
+            { SCF(); }
+            else
+            { CCF(); }
+        }
+    }
+    else if constexpr (x == 1)
+    {
+        if constexpr (OpCode == 0x76)
+        {
+            // HALT (LD (HL),(HL)の位置).
+            HALT();
+        }
+        else
+        {
+            // LD r,r'
+            SetR8<Accuracy, y>(GetR8<Accuracy, z>());
+        }
+    }
+    else if constexpr (x == 2)
     {
-        PUSH(m_Register.AF);
-        m_ConsumedCycles += 16;
-    } break;
-    // OR A,#
-    case 0xF6:
+        // ALU A,r
+        ALU<y>(GetR8<Accuracy, z>());
+    }
+    else
     {
-        OR(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xF7: {} break;
-    // LDHL SP,n
-    case 0xF8:
+        if constexpr (z == 0)
+        {
+            if constexpr (y < 4)
+            {
+                // RET cc
+                RET<Accuracy, y>();
+            }
+            else if constexpr (y == 4)
+            {
+                // LDH (n),A
+                BusWrite8<Accuracy>(0xFF00 + n(), m_Register.A);
+            }
+            else if constexpr (y == 5)
+            {
+                // ADD SP,n
+                m_Register.SP = OffsetSP(n());
+                Idle<Accuracy>();
+                Idle<Accuracy>();
+            }
+            else if constexpr (y == 6)
+            {
+                // LDH A,(n)
+                LD(m_Register.A, BusRead8<Accuracy>(0xFF00 + n()));
+            }
+            else
+            {
+                // LDHL SP,n
+                LDHL(n());
+                Idle<Accuracy>();
+            }
+        }
+        else if constexpr (z == 1)
+        {
+            if constexpr (q == 0)
+            {
+                // POP rr
+                if constexpr (p == 3)
+                {
+                    // Fレジスタの下位4bitは常に0.
+                    uint16_t value;
+                    POP<Accuracy>(value);
+                    SetAF(value & 0xFFF0);
+                }
+                else
+                { POP<Accuracy>(R16<p>()); }
+            }
+            else if constexpr (p == 0)
+            {
+                // RET
+                RET<Accuracy, CONDITION_ALWAYS>();
+            }
+            else if constexpr (p == 1)
+            {
+                // RETI
+                RETI<Accuracy>();
+            }
+            else if constexpr (p == 2)
+            {
+                // JP (HL)
+                m_Register.PC = m_Register.HL;
+            }
+            else
+            {
+                // LD SP,HL
+                LD(m_Register.SP, m_Register.HL);
+                Idle<Accuracy>();
+            }
+        }
+        else if constexpr (z == 2)
+        {
+            if constexpr (y < 4)
+            {
+                // JP cc,nn
+                JP<Accuracy, y>(nn());
+            }
+            else if constexpr (y == 4)
+            {
+                // LD (C),A
+                BusWrite8<Accuracy>(0xFF00 + m_Register.C, m_Register.A);
+            }
+            else if constexpr (y == 5)
+            {
+                // LD (nn),A
+                BusWrite8<Accuracy>(nn(), m_Register.A);
+            }
+            else if constexpr (y == 6)
+            {
+                // LD A,(C)
+                LD(m_Register.A, BusRead8<Accuracy>(0xFF00 + m_Register.C));
+            }
+            else
+            {
+                // LD A,(nn)
+                LD(m_Register.A, BusRead8<Accuracy>(nn()));
+            }
+        }
+        else if constexpr (z == 3)
+        {
+            if constexpr (y == 0)
+            {
+                // JP nn
+                JP<Accuracy, CONDITION_ALWAYS>(nn());
+            }
+            else if constexpr (y == 1)
+            {
+                // PREFIX CB
+                ExecutePrefixCommand<Accuracy>(n());
+            }
+            else if constexpr (y == 6)
+            {
+                // DI
+                DI();
+            }
+            else if constexpr (y == 7)
+            {
+                // EI
+                EI();
+            }
+        }
+        else if constexpr (z == 4)
+        {
+            if constexpr (y < 4)
+            {
+                // CALL cc,nn
+                CALL<Accuracy, y>(nn());
+            }
+        }
+        else if constexpr (z == 5)
+        {
+            if constexpr (q == 0)
+            {
+                // PUSH rr
+                if constexpr (p == 3)
+                {
+                    MaterializeFlags();
+                    PUSH<Accuracy>(m_Register.AF);
+                }
+                else
+                { PUSH<Accuracy>(R16<p>()); }
+            }
+            else if constexpr (p == 0)
+            {
+                // CALL nn
+                CALL<Accuracy, CONDITION_ALWAYS>(nn());
+            }
+        }
+        else if constexpr (z == 6)
+        {
+            // ALU A,n
+            ALU<y>(n());
+        }
+        else
+        {
+            // RST n
+            RST<Accuracy>(y * 8);
+        }
+    }
+
+    // 残りは未定義命令.
+}
+
+//=============================================================================
+// Prefix Commands.
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//      オペコードのビットフィールドからCBプレフィックス命令を生成します.
+//-----------------------------------------------------------------------------
+template<ACCURACY Accuracy, uint8_t OpCode>
+void Cpu::PrefixCommand()
+{
+    constexpr uint8_t x = OpCode >> 6;
+    constexpr uint8_t y = (OpCode >> 3) & 0x07;
+    constexpr uint8_t z = OpCode & 0x07;
+
+    auto val = GetR8<Accuracy, z>();
+    if constexpr (x == 0)
     {
-        LDHL(m_Register.SP, n());
-        m_ConsumedCycles += 12;
-    } break;
-    // LD SP,HL
-    case 0xF9:
+        // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL
+        ROT<y>(val);
+        SetR8<Accuracy, z>(val);
+    }
+    else if constexpr (x == 1)
     {
-        LD(m_Register.SP, m_Register.HL);
-        m_ConsumedCycles += 8;
-    } break;
-    // LD A,(nn)
-    case 0xFA:
+        // BIT b,r
+        BIT(y, val);
+    }
+    else if constexpr (x == 2)
     {
-        LD(m_Register.A, Read8(nn()));
-        m_ConsumedCycles += 16;
-    } break;
-    case 0xFB: {} break;
-    case 0xFC: {} break;
-    case 0xFD: {} break;
-    // CP A,#
-    case 0xFE:
+        // RES b,r
+        RES(y, val);
+        SetR8<Accuracy, z>(val);
+    }
+    else
     {
-        CP(m_Register.A, n());
-        m_ConsumedCycles += 8;
-    } break;
-    case 0xFF: {} break;
+        // SET b,r
+        SET(y, val);
+        SetR8<Accuracy, z>(val);
+    }
+}
 
-    //-------------------------------------------------------------------------
+uint8_t Cpu::n() const
+{ return uint8_t(m_Operand); }
 
+uint16_t Cpu::nn() const
+{ return m_Operand; }
 
-    default:
+//-----------------------------------------------------------------------------
+//      未評価の演算を含めたFレジスタの値を求めます.
+//-----------------------------------------------------------------------------
+uint8_t Cpu::ComputeFlags() const
+{
+    auto& lazy = m_LazyFlags;
+    uint8_t flags = 0;
+
+    switch(lazy.Op)
+    {
+    case FLAG_OP_NONE:
+        return m_Register.F.Value;
+
+    case FLAG_OP_ADD:
+        {
+            uint32_t result = uint32_t(lazy.Lhs) + lazy.Rhs + lazy.Carry;
+            if ((result & 0xFF) == 0)
+            { flags |= FlagMaskZ; }
+            if ((lazy.Lhs & 0x0F) + (lazy.Rhs & 0x0F) + lazy.Carry > 0x0F)
+            { flags |= FlagMaskH; }
+            if (result > 0xFF)
+            { flags |= FlagMaskC; }
+        }
+        break;
+
+    case FLAG_OP_SUB:
+        {
+            int result = int(lazy.Lhs) - int(lazy.Rhs) - lazy.Carry;
+            flags |= FlagMaskN;
+            if ((result & 0xFF) == 0)
+            { flags |= FlagMaskZ; }
+            if (int(lazy.Lhs & 0x0F) - int(lazy.Rhs & 0x0F) - lazy.Carry < 0)
+            { flags |= FlagMaskH; }
+            if (result < 0)
+            { flags |= FlagMaskC; }
+        }
+        break;
+
+    case FLAG_OP_AND:
+        {
+            flags |= FlagMaskH;
+            if (lazy.Lhs == 0)
+            { flags |= FlagMaskZ; }
+        }
+        break;
+
+    case FLAG_OP_OR:
+        {
+            if (lazy.Lhs == 0)
+            { flags |= FlagMaskZ; }
+        }
+        break;
+
+    case FLAG_OP_INC:
+        {
+            if (uint8_t(lazy.Lhs + 1) == 0)
+            { flags |= FlagMaskZ; }
+            if ((lazy.Lhs & 0x0F) == 0x0F)
+            { flags |= FlagMaskH; }
+            if (lazy.Carry)
+            { flags |= FlagMaskC; }
+        }
+        break;
+
+    case FLAG_OP_DEC:
+        {
+            flags |= FlagMaskN;
+            if (uint8_t(lazy.Lhs - 1) == 0)
+            { flags |= FlagMaskZ; }
+            if ((lazy.Lhs & 0x0F) == 0x00)
+            { flags |= FlagMaskH; }
+            if (lazy.Carry)
+            { flags |= FlagMaskC; }
+        }
         break;
     }
+
+    return flags;
 }
 
-void Cpu::ExecutePrefixCommand(uint8_t opCode)
+//-----------------------------------------------------------------------------
+//      未評価の演算を含めたCフラグの値を求めます.
+//-----------------------------------------------------------------------------
+uint8_t Cpu::ComputeCarry() const
 {
-    switch(opCode)
+    auto& lazy = m_LazyFlags;
+    switch(lazy.Op)
     {
-    case 0x00: {} break;
-    case 0x01: {} break;
-    case 0x02: {} break;
-    case 0x03: {} break;
-    case 0x04: {} break;
-    case 0x05: {} break;
-    case 0x06: {} break;
-    case 0x07: {} break;
-    case 0x08: {} break;
-    case 0x09: {} break;
-    case 0x0A: {} break;
-    case 0x0B: {} break;
-    case 0x0C: {} break;
-    case 0x0D: {} break;
-    case 0x0E: {} break;
-    case 0x0F: {} break;
-
-    case 0x10: {} break;
-    case 0x11: {} break;
-    case 0x12: {} break;
-    case 0x13: {} break;
-    case 0x14: {} break;
-    case 0x15: {} break;
-    case 0x16: {} break;
-    case 0x17: {} break;
-    case 0x18: {} break;
-    case 0x19: {} break;
-    case 0x1A: {} break;
-    case 0x1B: {} break;
-    case 0x1C: {} break;
-    case 0x1D: {} break;
-    case 0x1E: {} break;
-    case 0x1F: {} break;
-
-    case 0x20: {} break;
-    case 0x21: {} break;
-    case 0x22: {} break;
-    case 0x23: {} break;
-    case 0x24: {} break;
-    case 0x25: {} break;
-    case 0x26: {} break;
-    case 0x27: {} break;
-    case 0x28: {} break;
-    case 0x29: {} break;
-    case 0x2A: {} break;
-    case 0x2B: {} break;
-    case 0x2C: {} break;
-    case 0x2D: {} break;
-    case 0x2E: {} break;
-    case 0x2F: {} break;
-
-    case 0x30: {} break;
-    case 0x31: {} break;
-    case 0x32: {} break;
-    case 0x33: {} break;
-    case 0x34: {} break;
-    case 0x35: {} break;
-    case 0x36: {} break;
-    case 0x37: {} break;
-    case 0x38: {} break;
-    case 0x39: {} break;
-    case 0x3A: {} break;
-    case 0x3B: {} break;
-    case 0x3C: {} break;
-    case 0x3D: {} break;
-    case 0x3E: {} break;
-    case 0x3F: {} break;
-
-    case 0x40: {} break;
-    case 0x41: {} break;
-    case 0x42: {} break;
-    case 0x43: {} break;
-    case 0x44: {} break;
-    case 0x45: {} break;
-    case 0x46: {} break;
-    case 0x47: {} break;
-    case 0x48: {} break;
-    case 0x49: {} break;
-    case 0x4A: {} break;
-    case 0x4B: {} break;
-    case 0x4C: {} break;
-    case 0x4D: {} break;
-    case 0x4E: {} break;
-    case 0x4F: {} break;
-
-    case 0x50: {} break;
-    case 0x51: {} break;
-    case 0x52: {} break;
-    case 0x53: {} break;
-    case 0x54: {} break;
-    case 0x55: {} break;
-    case 0x56: {} break;
-    case 0x57: {} break;
-    case 0x58: {} break;
-    case 0x59: {} break;
-    case 0x5A: {} break;
-    case 0x5B: {} break;
-    case 0x5C: {} break;
-    case 0x5D: {} break;
-    case 0x5E: {} break;
-    case 0x5F: {} break;
-
-    case 0x60: {} break;
-    case 0x61: {} break;
-    case 0x62: {} break;
-    case 0x63: {} break;
-    case 0x64: {} break;
-    case 0x65: {} break;
-    case 0x66: {} break;
-    case 0x67: {} break;
-    case 0x68: {} break;
-    case 0x69: {} break;
-    case 0x6A: {} break;
-    case 0x6B: {} break;
-    case 0x6C: {} break;
-    case 0x6D: {} break;
-    case 0x6E: {} break;
-    case 0x6F: {} break;
-
-    case 0x70: {} break;
-    case 0x71: {} break;
-    case 0x72: {} break;
-    case 0x73: {} break;
-    case 0x74: {} break;
-    case 0x75: {} break;
-    case 0x76: {} break;
-    case 0x77: {} break;
-    case 0x78: {} break;
-    case 0x79: {} break;
-    case 0x7A: {} break;
-    case 0x7B: {} break;
-    case 0x7C: {} break;
-    case 0x7D: {} break;
-    case 0x7E: {} break;
-    case 0x7F: {} break;
-
-    case 0x80: {} break;
-    case 0x81: {} break;
-    case 0x82: {} break;
-    case 0x83: {} break;
-    case 0x84: {} break;
-    case 0x85: {} break;
-    case 0x86: {} break;
-    case 0x87: {} break;
-    case 0x88: {} break;
-    case 0x89: {} break;
-    case 0x8A: {} break;
-    case 0x8B: {} break;
-    case 0x8C: {} break;
-    case 0x8D: {} break;
-    case 0x8E: {} break;
-    case 0x8F: {} break;
-
-    case 0x90: {} break;
-    case 0x91: {} break;
-    case 0x92: {} break;
-    case 0x93: {} break;
-    case 0x94: {} break;
-    case 0x95: {} break;
-    case 0x96: {} break;
-    case 0x97: {} break;
-    case 0x98: {} break;
-    case 0x99: {} break;
-    case 0x9A: {} break;
-    case 0x9B: {} break;
-    case 0x9C: {} break;
-    case 0x9D: {} break;
-    case 0x9E: {} break;
-    case 0x9F: {} break;
-
-    case 0xA0: {} break;
-    case 0xA1: {} break;
-    case 0xA2: {} break;
-    case 0xA3: {} break;
-    case 0xA4: {} break;
-    case 0xA5: {} break;
-    case 0xA6: {} break;
-    case 0xA7: {} break;
-    case 0xA8: {} break;
-    case 0xA9: {} break;
-    case 0xAA: {} break;
-    case 0xAB: {} break;
-    case 0xAC: {} break;
-    case 0xAD: {} break;
-    case 0xAE: {} break;
-    case 0xAF: {} break;
-
-    case 0xB0: {} break;
-    case 0xB1: {} break;
-    case 0xB2: {} break;
-    case 0xB3: {} break;
-    case 0xB4: {} break;
-    case 0xB5: {} break;
-    case 0xB6: {} break;
-    case 0xB7: {} break;
-    case 0xB8: {} break;
-    case 0xB9: {} break;
-    case 0xBA: {} break;
-    case 0xBB: {} break;
-    case 0xBC: {} break;
-    case 0xBD: {} break;
-    case 0xBE: {} break;
-    case 0xBF: {} break;
-
-    case 0xC0: {} break;
-    case 0xC1: {} break;
-    case 0xC2: {} break;
-    case 0xC3: {} break;
-    case 0xC4: {} break;
-    case 0xC5: {} break;
-    case 0xC6: {} break;
-    case 0xC7: {} break;
-    case 0xC8: {} break;
-    case 0xC9: {} break;
-    case 0xCA: {} break;
-    case 0xCB: {} break;
-    case 0xCC: {} break;
-    case 0xCD: {} break;
-    case 0xCE: {} break;
-    case 0xCF: {} break;
-
-    case 0xD0: {} break;
-    case 0xD1: {} break;
-    case 0xD2: {} break;
-    case 0xD3: {} break;
-    case 0xD4: {} break;
-    case 0xD5: {} break;
-    case 0xD6: {} break;
-    case 0xD7: {} break;
-    case 0xD8: {} break;
-    case 0xD9: {} break;
-    case 0xDA: {} break;
-    case 0xDB: {} break;
-    case 0xDC: {} break;
-    case 0xDD: {} break;
-    case 0xDE: {} break;
-    case 0xDF: {} break;
-
-    case 0xE0: {} break;
-    case 0xE1: {} break;
-    case 0xE2: {} break;
-    case 0xE3: {} break;
-    case 0xE4: {} break;
-    case 0xE5: {} break;
-    case 0xE6: {} break;
-    case 0xE7: {} break;
-    case 0xE8: {} break;
-    case 0xE9: {} break;
-    case 0xEA: {} break;
-    case 0xEB: {} break;
-    case 0xEC: {} break;
-    case 0xED: {} break;
-    case 0xEE: {} break;
-    case 0xEF: {} break;
-
-    case 0xF0: {} break;
-    case 0xF1: {} break;
-    case 0xF2: {} break;
-    case 0xF3: {} break;
-    case 0xF4: {} break;
-    case 0xF5: {} break;
-    case 0xF6: {} break;
-    case 0xF7: {} break;
-    case 0xF8: {} break;
-    case 0xF9: {} break;
-    case 0xFA: {} break;
-    case 0xFB: {} break;
-    case 0xFC: {} break;
-    case 0xFD: {} break;
-    case 0xFE: {} break;
-    case 0xFF: {} break;
+    case FLAG_OP_ADD:
+        return (uint32_t(lazy.Lhs) + lazy.Rhs + lazy.Carry > 0xFF) ? 1 : 0;
+
+    case FLAG_OP_SUB:
+        return (int(lazy.Lhs) - int(lazy.Rhs) - lazy.Carry < 0) ? 1 : 0;
+
+    case FLAG_OP_AND:
+    case FLAG_OP_OR:
+        return 0;
+
+    case FLAG_OP_INC:
+    case FLAG_OP_DEC:
+        return lazy.Carry;
 
     default:
-        break;
+        return m_Register.F.C;
     }
 }
 
-uint8_t Cpu::n() const
-{ return Read8(m_Register.PC + 1); }
+//-----------------------------------------------------------------------------
+//      未評価の演算を含めたZフラグの値を求めます.
+//-----------------------------------------------------------------------------
+bool Cpu::ComputeZero() const
+{
+    auto& lazy = m_LazyFlags;
+    switch(lazy.Op)
+    {
+    case FLAG_OP_ADD:
+        return uint8_t(lazy.Lhs + lazy.Rhs + lazy.Carry) == 0;
 
-uint16_t Cpu::nn() const
-{ return Read16(m_Register.PC + 1); }
+    case FLAG_OP_SUB:
+        return uint8_t(lazy.Lhs - lazy.Rhs - lazy.Carry) == 0;
 
-void Cpu::Carry(uint8_t lhs, uint8_t rhs)
-{
-    bool carryH = (lhs & 0x0F) + (rhs & 0x0F) > 0x0F;
-    bool carryC = (lhs & 0xFF) + (rhs & 0xFF) > 0xFF;
-    m_Register.H = carryH;
-    m_Register.C = carryC;
+    case FLAG_OP_AND:
+    case FLAG_OP_OR:
+        return lazy.Lhs == 0;
+
+    case FLAG_OP_INC:
+        return uint8_t(lazy.Lhs + 1) == 0;
+
+    case FLAG_OP_DEC:
+        return uint8_t(lazy.Lhs - 1) == 0;
+
+    default:
+        return m_Register.F.Z != 0;
+    }
 }
 
-void Cpu::Borrow(uint8_t lhs, uint8_t rhs)
+//-----------------------------------------------------------------------------
+//      未評価の演算をFレジスタに反映します.
+//-----------------------------------------------------------------------------
+void Cpu::MaterializeFlags()
 {
-    bool borrowH = int(lhs & 0xf) - int(rhs & 0xf) < 0;
-    bool borrowC = (lhs < rhs);
-    m_Register.H = borrowH;
-    m_Register.C = borrowC;
+    if (m_LazyFlags.Op == FLAG_OP_NONE)
+    { return; }
+
+    m_Register.F.Value = ComputeFlags();
+    m_LazyFlags.Op = FLAG_OP_NONE;
 }
 
 //=============================================================================
@@ -1594,24 +1365,24 @@ void Cpu::LD(uint8_t& lhs, uint8_t rhs)
 void Cpu::LD(uint16_t& lhs, uint16_t rhs)
 { lhs = rhs; }
 
-void Cpu::LDHL(uint16_t lhs, uint8_t rhs)
-{
-    uint16_t addr = lhs + rhs;
-    SetHL(addr);
-    m_Register.F.Z = 0;
-    m_Register.F.N = 0;
-    Carry(uint8_t(lhs), rhs);
-}
+void Cpu::LDHL(uint8_t rhs)
+{ m_Register.HL = OffsetSP(rhs); }
 
+// 内部動作の1Mサイクルの後, 上位バイトから書き込む.
+template<ACCURACY Accuracy>
 void Cpu::PUSH(uint16_t value)
 {
-    Write16(m_Register.SP, value);
-    m_Register.SP -= 2;
+    Idle<Accuracy>();
+    m_Register.SP--;
+    BusWrite8<Accuracy>(m_Register.SP, uint8_t(value >> 8));
+    m_Register.SP--;
+    BusWrite8<Accuracy>(m_Register.SP, uint8_t(value));
 }
 
+template<ACCURACY Accuracy>
 void Cpu::POP(uint16_t& value)
 {
-    value = Read16(m_Register.SP);
+    value = BusRead16<Accuracy>(m_Register.SP);
     m_Register.SP += 2;
 }
 
@@ -1619,87 +1390,84 @@ void Cpu::POP(uint16_t& value)
 // 8-Bit ALU.
 //=============================================================================
 
+// フラグはRecordFlags()で演算とオペランドだけを記録し,
+// 条件分岐やPUSH AF等で読み取られた時点でComputeFlags()により求める.
+
+template<uint8_t Op>
+inline void Cpu::ALU(uint8_t rhs)
+{
+    static_assert(Op < 8, "Invalid ALU operation.");
+    if constexpr (Op == 0) { ADD(m_Register.A, rhs); }
+    if constexpr (Op == 1) { ADC(m_Register.A, rhs); }
+    if constexpr (Op == 2) { SUB(m_Register.A, rhs); }
+    if constexpr (Op == 3) { SBC(m_Register.A, rhs); }
+    if constexpr (Op == 4) { AND(m_Register.A, rhs); }
+    if constexpr (Op == 5) { XOR(m_Register.A, rhs); }
+    if constexpr (Op == 6) { OR (m_Register.A, rhs); }
+    if constexpr (Op == 7) { CP (m_Register.A, rhs); }
+}
+
 void Cpu::ADD(uint8_t& lhs, uint8_t rhs)
 {
+    RecordFlags(FLAG_OP_ADD, lhs, rhs, 0);
     lhs += rhs;
-    CheckZero(lhs);
-    m_Register.F.N = 0;
-    Carry(lhs, rhs);
 }
 
 void Cpu::ADC(uint8_t& lhs, uint8_t rhs)
 {
-    lhs += (rhs + m_Register.C);
-    CheckZero(lhs);
-    m_Register.F.N = 0;
-    Carry(lhs, rhs + m_Register.C);
+    uint8_t carry = ComputeCarry();
+    RecordFlags(FLAG_OP_ADD, lhs, rhs, carry);
+    lhs += (rhs + carry);
 }
 
 void Cpu::SUB(uint8_t& lhs, uint8_t rhs)
 {
+    RecordFlags(FLAG_OP_SUB, lhs, rhs, 0);
     lhs -= rhs;
-    CheckZero(lhs);
-    m_Register.F.N = 0;
-    Borrow(lhs, rhs);
 }
 
 void Cpu::SBC(uint8_t& lhs, uint8_t rhs)
 {
-    lhs -= (rhs + m_Register.F.C);
-    CheckZero(lhs);
-    m_Register.F.N = 0;
-    Borrow(lhs, rhs);
+    uint8_t borrow = ComputeCarry();
+    RecordFlags(FLAG_OP_SUB, lhs, rhs, borrow);
+    lhs -= (rhs + borrow);
 }
 
 void Cpu::AND(uint8_t& lhs, uint8_t rhs)
 {
     lhs = lhs & rhs;
-    CheckZero(lhs);
-    m_Register.F.N = 0;
-    m_Register.F.H = 1;
-    m_Register.F.C = 0;
+    RecordFlags(FLAG_OP_AND, lhs, 0, 0);
 }
 
 void Cpu::OR(uint8_t& lhs, uint8_t rhs)
 {
     lhs = lhs | rhs;
-    CheckZero(lhs);
-    m_Register.F.N = 0;
-    m_Register.F.H = 0;
-    m_Register.F.C = 0;
+    RecordFlags(FLAG_OP_OR, lhs, 0, 0);
 }
 
 void Cpu::XOR(uint8_t& lhs, uint8_t rhs)
 {
     lhs = lhs ^ rhs;
-    CheckZero(lhs);
-    m_Register.F.N = 0;
-    m_Register.F.H = 0;
-    m_Register.F.C = 0;
+    RecordFlags(FLAG_OP_OR, lhs, 0, 0);
 }
 
 void Cpu::CP(uint8_t lhs, uint8_t rhs)
 {
-    auto ret = (lhs == rhs);
-    SetFlagZ(ret);
-    m_Register.F.N = 1;
-    Borrow(lhs, rhs);
+    RecordFlags(FLAG_OP_SUB, lhs, rhs, 0);
 }
 
 void Cpu::INC(uint8_t& val)
 {
-    Carry(val, 1);
+    // Cフラグは変化しない.
+    RecordFlags(FLAG_OP_INC, val, 0, ComputeCarry());
     val++;
-    CheckZero(val);
-    m_Register.F.N = 0;
 }
 
 void Cpu::DEC(uint8_t& val)
 {
-    Borrow(val, 1);
+    // Cフラグは変化しない.
+    RecordFlags(FLAG_OP_DEC, val, 0, ComputeCarry());
     val--;
-    CheckZero(val);
-    m_Register.F.N = 0;
 }
 
 //=============================================================================
@@ -1707,38 +1475,89 @@ void Cpu::DEC(uint8_t& val)
 //=============================================================================
 void Cpu::ADD(uint16_t& lhs, uint16_t rhs)
 {
+    // Zフラグは変化しない.
+    MaterializeFlags();
+    m_Register.F.N = 0;
+    m_Register.F.H = ((lhs & 0x0FFF) + (rhs & 0x0FFF) > 0x0FFF) ? 1 : 0;
+    m_Register.F.C = (uint32_t(lhs) + rhs > 0xFFFF) ? 1 : 0;
+    lhs += rhs;
 }
 
 void Cpu::INC(uint16_t& val)
-{
-}
+{ val++; }
 
 void Cpu::DEC(uint16_t& val)
+{ val--; }
+
+uint16_t Cpu::OffsetSP(uint8_t rhs)
 {
+    // 符号付きで加算し, フラグは下位バイトの符号なし加算で決まる.
+    auto sp = m_Register.SP;
+    SetF(MakeFlags(false, false, (sp & 0x0F) + (rhs & 0x0F) > 0x0F, (sp & 0xFF) + rhs > 0xFF));
+    return uint16_t(sp + int8_t(rhs));
 }
 
-
 //=============================================================================
 // Miscellaneous.
 //=============================================================================
-void Cpu::SWAP(uint8_t& lhs, uint8_t& rhs)
+void Cpu::SWAP(uint8_t& val)
 {
+    val = uint8_t((val << 4) | (val >> 4));
+    SetF(MakeFlags(val == 0, false, false, false));
 }
 
 void Cpu::DAA()
 {
+    MaterializeFlags();
+    auto a = m_Register.A;
+    bool c = m_Register.F.C != 0;
+
+    if (m_Register.F.N == 0)
+    {
+        if (c || a > 0x99)
+        {
+            a += 0x60;
+            c = true;
+        }
+        if (m_Register.F.H || (a & 0x0F) > 0x09)
+        { a += 0x06; }
+    }
+    else
+    {
+        if (c)
+        { a -= 0x60; }
+        if (m_Register.F.H)
+        { a -= 0x06; }
+    }
+
+    m_Register.A   = a;
+    m_Register.F.Z = (a == 0) ? 1 : 0;
+    m_Register.F.H = 0;
+    m_Register.F.C = c ? 1 : 0;
 }
 
 void Cpu::CPL()
 {
+    MaterializeFlags();
+    m_Register.A = ~m_Register.A;
+    m_Register.F.N = 1;
+    m_Register.F.H = 1;
 }
 
 void Cpu::CCF()
 {
+    MaterializeFlags();
+    m_Register.F.N = 0;
+    m_Register.F.H = 0;
+    m_Register.F.C = m_Register.F.C ^ 1;
 }
 
 void Cpu::SCF()
 {
+    MaterializeFlags();
+    m_Register.F.N = 0;
+    m_Register.F.H = 0;
+    m_Register.F.C = 1;
 }
 
 void Cpu::NOP()
@@ -1746,117 +1565,333 @@ void Cpu::NOP()
 }
 
 void Cpu::HALT()
-{
-}
+{ m_EnablePowerSave = true; }
 
 void Cpu::STOP()
-{
-}
+{ m_EnablePowerSave = true; }
 
 void Cpu::DI()
 {
+    m_EnableInterrputs = false;
+    m_DeferredEI       = false;
 }
 
 void Cpu::EI()
 {
+    // 次の命令を実行してから有効にする.
+    if (!m_EnableInterrputs)
+    { m_DeferredEI = true; }
 }
 
 //=============================================================================
 // Rotates & Shifts.
 //=============================================================================
 
-void Cpu::RLCA()
-{
-}
-
-void Cpu::RLA()
-{
-}
-
-void Cpu::RRCA()
-{
-}
+// 結果に応じてZフラグを設定し, N, Hフラグは0にする.
 
-void Cpu::RRA()
+template<uint8_t Op>
+inline void Cpu::ROT(uint8_t& val)
 {
+    static_assert(Op < 8, "Invalid rotate operation.");
+    if constexpr (Op == 0) { RLC (val); }
+    if constexpr (Op == 1) { RRC (val); }
+    if constexpr (Op == 2) { RL  (val); }
+    if constexpr (Op == 3) { RR  (val); }
+    if constexpr (Op == 4) { SLA (val); }
+    if constexpr (Op == 5) { SRA (val); }
+    if constexpr (Op == 6) { SWAP(val); }
+    if constexpr (Op == 7) { SRL (val); }
 }
 
-void Cpu::RLC(uint8_t& lhs, uint8_t rhs)
+void Cpu::RLC(uint8_t& val)
 {
+    bool carry = (val & 0x80) != 0;
+    val = uint8_t((val << 1) | (val >> 7));
+    SetF(MakeFlags(val == 0, false, false, carry));
 }
 
-void Cpu::RL(uint8_t& lhs, uint8_t rhs)
+void Cpu::RL(uint8_t& val)
 {
+    bool carry = (val & 0x80) != 0;
+    val = uint8_t((val << 1) | ComputeCarry());
+    SetF(MakeFlags(val == 0, false, false, carry));
 }
 
-void Cpu::RRC(uint8_t& lhs, uint8_t rhs)
+void Cpu::RRC(uint8_t& val)
 {
+    bool carry = (val & 0x01) != 0;
+    val = uint8_t((val >> 1) | (val << 7));
+    SetF(MakeFlags(val == 0, false, false, carry));
 }
 
-void Cpu::RR(uint8_t& lhs, uint8_t rhs)
+void Cpu::RR(uint8_t& val)
 {
+    bool carry = (val & 0x01) != 0;
+    val = uint8_t((val >> 1) | (ComputeCarry() << 7));
+    SetF(MakeFlags(val == 0, false, false, carry));
 }
 
-void Cpu::SLA(uint8_t& lhs, uint8_t rhs)
+void Cpu::SLA(uint8_t& val)
 {
+    bool carry = (val & 0x80) != 0;
+    val = uint8_t(val << 1);
+    SetF(MakeFlags(val == 0, false, false, carry));
 }
 
-void Cpu::SAR(uint8_t& lhs, uint8_t rhs)
+void Cpu::SRA(uint8_t& val)
 {
+    // 最上位ビットは保持する.
+    bool carry = (val & 0x01) != 0;
+    val = uint8_t((val >> 1) | (val & 0x80));
+    SetF(MakeFlags(val == 0, false, false, carry));
 }
 
-void Cpu::SRL(uint8_t& lhs, uint8_t rhs)
+void Cpu::SRL(uint8_t& val)
 {
+    bool carry = (val & 0x01) != 0;
+    val = uint8_t(val >> 1);
+    SetF(MakeFlags(val == 0, false, false, carry));
 }
 
-
 //=============================================================================
 // Bit OpCodes.
 //=============================================================================
-void Cpu::BIT(uint8_t& lhs, uint8_t rhs)
+void Cpu::BIT(uint8_t bit, uint8_t val)
 {
+    // Cフラグは変化しない.
+    bool carry = ComputeCarry() != 0;
+    SetF(MakeFlags((val & (1 << bit)) == 0, false, true, carry));
 }
 
-void Cpu::SET(uint8_t& lhs, uint8_t rhs)
-{
-}
+void Cpu::SET(uint8_t bit, uint8_t& val)
+{ val |= uint8_t(1 << bit); }
 
-void Cpu::RES(uint8_t& lhs, uint8_t rhs)
-{
-}
+void Cpu::RES(uint8_t bit, uint8_t& val)
+{ val &= uint8_t(~(1 << bit)); }
 
 //=============================================================================
 // Jumps.
 //=============================================================================
-void Cpu::JP(bool flag, uint8_t addr)
+
+// ACCURACY_INSTRUCTIONでは条件分岐が成立した場合の追加サイクルをここで加算し,
+// ACCURACY_MCYCLEでは成立時の内部動作のMサイクルを進める.
+
+template<ACCURACY Accuracy, uint8_t Cond>
+inline void Cpu::JP(uint16_t addr)
 {
+    if (!Condition<Cond>())
+    { return; }
+
+    m_Register.PC = addr;
+    Idle<Accuracy>();
+    if constexpr (Accuracy == ACCURACY_INSTRUCTION && Cond != CONDITION_ALWAYS)
+    { m_ConsumedCycles += 4; }
 }
 
-void Cpu::JP(bool flag, uint16_t addr)
+template<ACCURACY Accuracy, uint8_t Cond>
+inline void Cpu::JR(uint8_t offset)
 {
+    if (!Condition<Cond>())
+    { return; }
+
+    m_Register.PC += int8_t(offset);
+    Idle<Accuracy>();
+    if constexpr (Accuracy == ACCURACY_INSTRUCTION && Cond != CONDITION_ALWAYS)
+    { m_ConsumedCycles += 4; }
 }
 
 //=============================================================================
 // Calls.
 //=============================================================================
-void Cpu::CALL(bool flag, uint16_t addr)
+template<ACCURACY Accuracy, uint8_t Cond>
+inline void Cpu::CALL(uint16_t addr)
 {
+    if (!Condition<Cond>())
+    { return; }
+
+    PUSH<Accuracy>(m_Register.PC);
+    m_Register.PC = addr;
+    if constexpr (Accuracy == ACCURACY_INSTRUCTION && Cond != CONDITION_ALWAYS)
+    { m_ConsumedCycles += 12; }
 }
 
 //=============================================================================
 // Restarts.
 //=============================================================================
-void Cpu::RST(uint8_t addr)
+template<ACCURACY Accuracy>
+void Cpu::RST(uint16_t addr)
 {
+    PUSH<Accuracy>(m_Register.PC);
+    m_Register.PC = addr;
 }
 
 //=============================================================================
 // Returns.
 //=============================================================================
-void Cpu::RET(bool flag)
+template<ACCURACY Accuracy, uint8_t Cond>
+inline void Cpu::RET()
 {
+    // 条件判定に1Mサイクル.
+    if constexpr (Cond != CONDITION_ALWAYS)
+    { Idle<Accuracy>(); }
+
+    if (!Condition<Cond>())
+    { return; }
+
+    POP<Accuracy>(m_Register.PC);
+    Idle<Accuracy>();
+    if constexpr (Accuracy == ACCURACY_INSTRUCTION && Cond != CONDITION_ALWAYS)
+    { m_ConsumedCycles += 12; }
 }
 
+template<ACCURACY Accuracy>
 void Cpu::RETI()
 {
+    POP<Accuracy>(m_Register.PC);
+    Idle<Accuracy>();
+    m_EnableInterrputs = true;
+}
+
+
+//=============================================================================
+// Dispatch Tables.
+//=============================================================================
+template<ACCURACY Accuracy, size_t... Index>
+constexpr Cpu::HandlerTable Cpu::MakeCommandTable(std::index_sequence<Index...>)
+{ return HandlerTable{ { &Cpu::Command<Accuracy, uint8_t(Index)>... } }; }
+
+template<ACCURACY Accuracy, size_t... Index>
+constexpr Cpu::HandlerTable Cpu::MakePrefixTable(std::index_sequence<Index...>)
+{ return HandlerTable{ { &Cpu::PrefixCommand<Accuracy, uint8_t(Index)>... } }; }
+
+const Cpu::HandlerTable Cpu::s_CommandTable[2] = {
+    Cpu::MakeCommandTable<ACCURACY_INSTRUCTION>(std::make_index_sequence<256>()),
+    Cpu::MakeCommandTable<ACCURACY_MCYCLE>     (std::make_index_sequence<256>()),
+};
+
+const Cpu::HandlerTable Cpu::s_PrefixTable[2] = {
+    Cpu::MakePrefixTable<ACCURACY_INSTRUCTION>(std::make_index_sequence<256>()),
+    Cpu::MakePrefixTable<ACCURACY_MCYCLE>     (std::make_index_sequence<256>()),
+};
+
+
+//=============================================================================
+// Block Dispatch.
+//=============================================================================
+#if CPU_ENABLE_THREADED_DISPATCH
+
+// 全オペコードを列挙するマクロ.
+#define CPU_OPCODE_LIST(X) \
+    X(0x00) X(0x01) X(0x02) X(0x03) X(0x04) X(0x05) X(0x06) X(0x07) X(0x08) X(0x09) X(0x0A) X(0x0B) X(0x0C) X(0x0D) X(0x0E) X(0x0F) \
+    X(0x10) X(0x11) X(0x12) X(0x13) X(0x14) X(0x15) X(0x16) X(0x17) X(0x18) X(0x19) X(0x1A) X(0x1B) X(0x1C) X(0x1D) X(0x1E) X(0x1F) \
+    X(0x20) X(0x21) X(0x22) X(0x23) X(0x24) X(0x25) X(0x26) X(0x27) X(0x28) X(0x29) X(0x2A) X(0x2B) X(0x2C) X(0x2D) X(0x2E) X(0x2F) \
+    X(0x30) X(0x31) X(0x32) X(0x33) X(0x34) X(0x35) X(0x36) X(0x37) X(0x38) X(0x39) X(0x3A) X(0x3B) X(0x3C) X(0x3D) X(0x3E) X(0x3F) \
+    X(0x40) X(0x41) X(0x42) X(0x43) X(0x44) X(0x45) X(0x46) X(0x47) X(0x48) X(0x49) X(0x4A) X(0x4B) X(0x4C) X(0x4D) X(0x4E) X(0x4F) \
+    X(0x50) X(0x51) X(0x52) X(0x53) X(0x54) X(0x55) X(0x56) X(0x57) X(0x58) X(0x59) X(0x5A) X(0x5B) X(0x5C) X(0x5D) X(0x5E) X(0x5F) \
+    X(0x60) X(0x61) X(0x62) X(0x63) X(0x64) X(0x65) X(0x66) X(0x67) X(0x68) X(0x69) X(0x6A) X(0x6B) X(0x6C) X(0x6D) X(0x6E) X(0x6F) \
+    X(0x70) X(0x71) X(0x72) X(0x73) X(0x74) X(0x75) X(0x76) X(0x77) X(0x78) X(0x79) X(0x7A) X(0x7B) X(0x7C) X(0x7D) X(0x7E) X(0x7F) \
+    X(0x80) X(0x81) X(0x82) X(0x83) X(0x84) X(0x85) X(0x86) X(0x87) X(0x88) X(0x89) X(0x8A) X(0x8B) X(0x8C) X(0x8D) X(0x8E) X(0x8F) \
+    X(0x90) X(0x91) X(0x92) X(0x93) X(0x94) X(0x95) X(0x96) X(0x97) X(0x98) X(0x99) X(0x9A) X(0x9B) X(0x9C) X(0x9D) X(0x9E) X(0x9F) \
+    X(0xA0) X(0xA1) X(0xA2) X(0xA3) X(0xA4) X(0xA5) X(0xA6) X(0xA7) X(0xA8) X(0xA9) X(0xAA) X(0xAB) X(0xAC) X(0xAD) X(0xAE) X(0xAF) \
+    X(0xB0) X(0xB1) X(0xB2) X(0xB3) X(0xB4) X(0xB5) X(0xB6) X(0xB7) X(0xB8) X(0xB9) X(0xBA) X(0xBB) X(0xBC) X(0xBD) X(0xBE) X(0xBF) \
+    X(0xC0) X(0xC1) X(0xC2) X(0xC3) X(0xC4) X(0xC5) X(0xC6) X(0xC7) X(0xC8) X(0xC9) X(0xCA) X(0xCB) X(0xCC) X(0xCD) X(0xCE) X(0xCF) \
+    X(0xD0) X(0xD1) X(0xD2) X(0xD3) X(0xD4) X(0xD5) X(0xD6) X(0xD7) X(0xD8) X(0xD9) X(0xDA) X(0xDB) X(0xDC) X(0xDD) X(0xDE) X(0xDF) \
+    X(0xE0) X(0xE1) X(0xE2) X(0xE3) X(0xE4) X(0xE5) X(0xE6) X(0xE7) X(0xE8) X(0xE9) X(0xEA) X(0xEB) X(0xEC) X(0xED) X(0xEE) X(0xEF) \
+    X(0xF0) X(0xF1) X(0xF2) X(0xF3) X(0xF4) X(0xF5) X(0xF6) X(0xF7) X(0xF8) X(0xF9) X(0xFA) X(0xFB) X(0xFC) X(0xFD) X(0xFE) X(0xFF)
+
+//-----------------------------------------------------------------------------
+//      デコード済みの命令を実行します(ハンドラはインライン展開される).
+//-----------------------------------------------------------------------------
+template<uint8_t OpCode>
+inline void Cpu::ExecuteDecoded(const DecodedCommand& cmd)
+{
+    m_Operand = cmd.Operand;
+    m_Register.PC += kCommandLength[OpCode];
+    Command<ACCURACY_INSTRUCTION, OpCode>();
+    m_ConsumedCycles += kCommandCycles[OpCode];
+}
+
+// CBプレフィックス命令はデコード時に解決したハンドラを呼ぶ.
+template<>
+inline void Cpu::ExecuteDecoded<0xCB>(const DecodedCommand& cmd)
+{
+    m_Operand = cmd.Operand;
+    m_Register.PC += cmd.Length;
+    (this->*cmd.Func)();
+    m_ConsumedCycles += cmd.Cycles;
+}
+
+//-----------------------------------------------------------------------------
+//      デコード済みブロックを実行します.
+//-----------------------------------------------------------------------------
+void Cpu::ExecuteBlock(const DecodedBlock& block, uint32_t index, uint64_t limit)
+{
+    // 各命令の末尾から次の命令のラベルへ直接ジャンプすることで,
+    // 分岐予測がオペコードの並びを学習できるようにする.
+    #define CPU_LABEL_ADDRESS(op) &&LABEL_##op,
+    static void* const kLabels[256] = { CPU_OPCODE_LIST(CPU_LABEL_ADDRESS) };
+    #undef CPU_LABEL_ADDRESS
+
+    auto cmd = block.Commands + index;
+    auto end = block.Commands + block.Count;
+    if (cmd >= end)
+    { return; }
+
+    auto interrupts = m_pMemory->GetInterruptVersion();
+    goto *kLabels[cmd->OpCode];
+
+    // 自己書き換えやバンク切り替えで残りの命令が古くなった場合は打ち切る.
+    // IE/IFに書き込んだ場合も, 割り込みを次の命令の前に判定できるよう打ち切る.
+    // どちらも書き込みでしか起きないので, 書き込まない命令の後は判定しない.
+    #define CPU_LABEL_BODY(op) \
+    LABEL_##op: \
+        ExecuteDecoded<op>(*cmd); \
+        if (++cmd == end || m_ConsumedCycles >= limit) \
+        { return; } \
+        if constexpr (IsMemoryWrite(op)) \
+        { \
+            if (!IsValidBlock(block) || m_pMemory->GetInterruptVersion() != interrupts) \
+            { return; } \
+        } \
+        goto *kLabels[cmd->OpCode];
+
+    CPU_OPCODE_LIST(CPU_LABEL_BODY)
+    #undef CPU_LABEL_BODY
+}
+
+#undef CPU_OPCODE_LIST
+
+#else
+
+//-----------------------------------------------------------------------------
+//      デコード済みブロックを実行します.
+//-----------------------------------------------------------------------------
+void Cpu::ExecuteBlock(const DecodedBlock& block, uint32_t index, uint64_t limit)
+{
+    auto interrupts = m_pMemory->GetInterruptVersion();
+    for(auto i=index; i<block.Count; ++i)
+    {
+        auto& cmd = block.Commands[i];
+        m_Operand = cmd.Operand;
+        m_Register.PC += cmd.Length;
+        (this->*cmd.Func)();
+        m_ConsumedCycles += cmd.Cycles;
+
+        if (m_ConsumedCycles >= limit)
+        { break; }
+
+        // 以降の判定が必要になるのは書き込みの後だけ.
+        if (!IsMemoryWrite(cmd.OpCode))
+        { continue; }
+
+        // 自己書き換えやバンク切り替えで残りの命令が古くなった場合は打ち切る.
+        if (!IsValidBlock(block))
+        { break; }
+
+        // IE/IFに書き込んだ場合も, 割り込みを次の命令の前に判定できるよう打ち切る.
+        if (m_pMemory->GetInterruptVersion() != interrupts)
+        { break; }
+    }
 }
+
+#endif
@@ -35,14 +35,20 @@ bool Emulator::Init()
     if (!m_Memory.Init())
     { return false; }
 
+    if (!m_CPU.Init())
+    { return false; }
+
     m_CPU.SetMemory(&m_Memory);
     m_PPU.SetMemory(&m_Memory);
 
-    m_ROM = nullptr;
-
-    if (!InitWnd(640, 480))
+    // PPUはCPUの累積サイクル数まで遅延して追いつく.
+    m_PPU.SetClock(&Emulator::OnGetCycles, this);
+    m_PPU.SetScheduler(&Emulator::OnSchedule, this);
+    if (!m_PPU.Init())
     { return false; }
 
+    m_ROM = nullptr;
+
     return true;
 }
 
@@ -51,11 +57,13 @@ bool Emulator::Init()
 //-----------------------------------------------------------------------------
 void Emulator::Term()
 {
-    TermWnd();
-
+    m_PPU.Term();
     m_CPU.SetMemory(nullptr);
     m_PPU.SetMemory(nullptr);
 
+    // 終了時はセーブファイルへの書き出しを待つ.
+    m_Mapper.Term();
+    m_CPU.Term();
     m_Memory.Term();
 }
 
@@ -65,10 +73,98 @@ void Emulator::Term()
 //-----------------------------------------------------------------------------
 void Emulator::Run()
 {
-    if (Init())
+#if PLATFORM_WIN64
+    if (Init() && InitWnd(640, 480))
     { MainLoop(); }
 
+    TermWnd();
     Term();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      次のVBlank開始まで実行します.
+//-----------------------------------------------------------------------------
+void Emulator::RunFrame()
+{
+    // フレーム境界はPPUのフレーム周期で決まるので, 超過分は次のフレームで吸収される.
+    auto vblank = m_PPU.GetNextVBlankCycle(m_CPU.GetConsumedCycles());
+
+    // 命令単位ではなく, PPUのモード切り替えまでまとめて実行してから周辺機器を追いつかせる.
+    // VBlank・STAT割り込みはPPUが追いついた時点で要求する.
+    while(m_CPU.GetConsumedCycles() < vblank)
+    {
+        auto next = m_PPU.GetNextEventCycle();
+        m_CPU.SetNextEventCycle((next < vblank) ? next : vblank);
+        m_CPU.RunCycles(vblank - m_CPU.GetConsumedCycles());
+        m_PPU.Execute();
+        m_APU.Execute();
+    }
+
+    // 描画スレッドが残りのラインを描き終えるまで待ち, フレームバッファを揃える.
+    m_PPU.Flush();
+
+    // セーブファイルへの書き出しは完了を待たずに予約だけ行う.
+    if (m_SaveInterval != 0 && ++m_SaveFrames >= m_SaveInterval)
+    {
+        m_Mapper.FlushRam(false);
+        m_SaveFrames = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      指定フレーム数を実行します.
+//-----------------------------------------------------------------------------
+void Emulator::RunFrames(uint32_t count, uint32_t renderFrames)
+{
+    // 描画を無効にした一括実行でも, 最後の画面だけは得られるようにする.
+    auto enable = m_PPU.IsRenderEnabled();
+    for(auto i=0u; i<count; ++i)
+    {
+        m_PPU.SetRenderEnable(enable || count - i <= renderFrames);
+        RunFrame();
+    }
+
+    m_PPU.SetRenderEnable(enable);
+}
+
+//-----------------------------------------------------------------------------
+//      CPUの精度を設定します.
+//-----------------------------------------------------------------------------
+void Emulator::SetAccuracy(ACCURACY value)
+{
+    // Mサイクル単位の場合はメモリアクセスのたびに周辺機器を追いつかせる.
+    m_CPU.SetAccuracy(value);
+    if (value == ACCURACY_MCYCLE)
+    { m_CPU.SetTickHandler(&Emulator::OnTick, this); }
+    else
+    { m_CPU.SetTickHandler(nullptr, nullptr); }
+}
+
+//-----------------------------------------------------------------------------
+//      Mサイクルごとの更新処理です.
+//-----------------------------------------------------------------------------
+void Emulator::OnTick(void* pUser, uint64_t)
+{
+    auto pEmu = static_cast<Emulator*>(pUser);
+    pEmu->m_PPU.Execute();
+    pEmu->m_APU.Execute();
+}
+
+//-----------------------------------------------------------------------------
+//      累積サイクル数を取得します.
+//-----------------------------------------------------------------------------
+uint64_t Emulator::OnGetCycles(void* pUser)
+{ return static_cast<Emulator*>(pUser)->m_CPU.GetConsumedCycles(); }
+
+//-----------------------------------------------------------------------------
+//      周辺機器のイベントに合わせてCPUの実行範囲を縮めます.
+//-----------------------------------------------------------------------------
+void Emulator::OnSchedule(void* pUser, uint64_t cycle)
+{
+    auto pEmu = static_cast<Emulator*>(pUser);
+    if (cycle < pEmu->m_CPU.GetNextEventCycle())
+    { pEmu->m_CPU.SetNextEventCycle(cycle); }
 }
 
 //-----------------------------------------------------------------------------
@@ -77,22 +173,32 @@ void Emulator::Run()
 void Emulator::Update()
 {
     // GameBoy更新処理.
-    m_CPU.Execute();
-    m_PPU.Execute();
-    m_APU.Execute();
+    RunFrame();
 
     // フレームバッファを描画.
-    //RenderPixels(m_PPU.GetFrameBuffer());
+    RenderPixels(m_PPU.GetFrameBuffer());
 }
 
 //-----------------------------------------------------------------------------
 //      ROMを設定します.
 //-----------------------------------------------------------------------------
-void Emulator::SetRom(const Cartridge* rom)
+bool Emulator::SetRom(const Cartridge* rom, const char* savePath)
 {
-    m_ROM = rom;
+    m_Mapper.Term();
+    m_ROM = nullptr;
+    if (rom == nullptr)
+    { return true; }
 
-    // TODO
+    // RTCはホストの時刻ではなくCPUの累積サイクル数で進める.
+    m_Mapper.SetClock(&Emulator::OnGetCycles, this);
+
+    // マッパーの種類はここで1回だけ決まり, 以降はバンクレジスタへの書き込みでページを差し替える.
+    // ROMイメージを直接参照するので, 実行中はカートリッジデータを解放しないこと.
+    if (!m_Mapper.Init(rom, &m_Memory, savePath))
+    { return false; }
+
+    m_ROM = rom;
+    return true;
 }
 
 //-----------------------------------------------------------------------------
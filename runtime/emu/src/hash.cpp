@@ -0,0 +1,428 @@
+﻿//-----------------------------------------------------------------------------
+// File   : hash.cpp
+// Desc   : CRC32 / SHA-1.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstring>
+#include <platform.h>
+#include <hash.h>
+
+#if ARCH_X64
+#include <immintrin.h>
+#if PLATFORM_WIN64
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif//ARCH_X64
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+// GCC/Clangでは拡張命令を使う関数だけ個別に有効にする(MSVCは指定不要).
+#if defined(__GNUC__)
+    #define TARGET_ATTRIBUTE(x)     __attribute__((target(x)))
+#else
+    #define TARGET_ATTRIBUTE(x)
+#endif
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// Crc32Table structure
+///////////////////////////////////////////////////////////////////////////////
+struct Crc32Table
+{
+    uint32_t Value[8][256];
+
+    constexpr Crc32Table()
+    : Value()
+    {
+        for(uint32_t i=0; i<256; ++i)
+        {
+            auto crc = i;
+            for(auto j=0; j<8; ++j)
+            { crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0u); }
+            Value[0][i] = crc;
+        }
+
+        // 8バイトずつ処理するためのテーブル(slicing-by-8).
+        for(uint32_t i=0; i<256; ++i)
+        {
+            for(auto j=1; j<8; ++j)
+            { Value[j][i] = (Value[j - 1][i] >> 8) ^ Value[0][Value[j - 1][i] & 0xFF]; }
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr Crc32Table kCrc32Table;
+static constexpr uint32_t   kSha1BlockSize = 64;
+static constexpr uint32_t   kSha1InitState[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+using Crc32Func = uint32_t (*)(const uint8_t* data, size_t size, uint32_t state);
+using Sha1Func  = void     (*)(uint32_t state[5], const uint8_t* data, size_t blocks);
+
+//-----------------------------------------------------------------------------
+//      32bitビッグエンディアンで読み込みます.
+//-----------------------------------------------------------------------------
+inline uint32_t LoadBE32(const uint8_t* data)
+{
+    return (uint32_t(data[0]) << 24)
+         | (uint32_t(data[1]) << 16)
+         | (uint32_t(data[2]) << 8)
+         |  uint32_t(data[3]);
+}
+
+//-----------------------------------------------------------------------------
+//      左ローテートします.
+//-----------------------------------------------------------------------------
+inline uint32_t Rotl(uint32_t value, uint32_t shift)
+{ return (value << shift) | (value >> (32 - shift)); }
+
+//-----------------------------------------------------------------------------
+//      CRC32をテーブル参照で計算します.
+//-----------------------------------------------------------------------------
+uint32_t Crc32Scalar(const uint8_t* data, size_t size, uint32_t state)
+{
+    const auto& t = kCrc32Table.Value;
+    while(size >= 8)
+    {
+        auto lo = state ^ (uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24));
+        auto hi = uint32_t(data[4]) | (uint32_t(data[5]) << 8) | (uint32_t(data[6]) << 16) | (uint32_t(data[7]) << 24);
+        state = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+              ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        data += 8;
+        size -= 8;
+    }
+
+    while(size > 0)
+    {
+        state = (state >> 8) ^ t[0][(state ^ *data) & 0xFF];
+        data++;
+        size--;
+    }
+
+    return state;
+}
+
+//-----------------------------------------------------------------------------
+//      SHA-1のブロックを処理します.
+//-----------------------------------------------------------------------------
+void Sha1Scalar(uint32_t state[5], const uint8_t* data, size_t blocks)
+{
+    uint32_t w[80];
+    for(; blocks > 0; --blocks, data += kSha1BlockSize)
+    {
+        for(auto i=0; i<16; ++i)
+        { w[i] = LoadBE32(data + i * 4); }
+        for(auto i=16; i<80; ++i)
+        { w[i] = Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1); }
+
+        auto a = state[0];
+        auto b = state[1];
+        auto c = state[2];
+        auto d = state[3];
+        auto e = state[4];
+
+        for(auto i=0; i<80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+
+            auto temp = Rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = Rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#if ARCH_X64
+//-----------------------------------------------------------------------------
+//      CPUID命令の結果を取得します.
+//-----------------------------------------------------------------------------
+void GetCpuId(uint32_t leaf, uint32_t subLeaf, uint32_t regs[4])
+{
+#if PLATFORM_WIN64
+    int values[4] = {};
+    __cpuidex(values, int(leaf), int(subLeaf));
+    for(auto i=0; i<4; ++i)
+    { regs[i] = uint32_t(values[i]); }
+#else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    if (leaf > __get_cpuid_max(0, nullptr))
+    { return; }
+    __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      CRC32を128bit単位の畳み込みで計算します.
+//-----------------------------------------------------------------------------
+TARGET_ATTRIBUTE("pclmul,sse4.1")
+uint32_t Crc32Clmul(const uint8_t* data, size_t size, uint32_t state)
+{
+    // 64バイト未満は畳み込みの準備の方が高くつく.
+    if (size < 64)
+    { return Crc32Scalar(data, size, state); }
+
+    // x^(n*128±32) mod P(x) を反転したビット順で並べた定数.
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442BD4, 0x01C6E41596 };  // 512bit先へ畳み込む.
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997D0, 0x00CCAA009E };  // 128bit先へ畳み込む.
+    alignas(16) static const uint64_t k5k0[] = { 0x0163CD6124, 0x0000000000 };  // 64bitへ縮める.
+    alignas(16) static const uint64_t poly[] = { 0x01DB710641, 0x01F7011641 };  // Barrett還元.
+
+    auto x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+    auto x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+    auto x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+    auto x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int(state)));
+
+    auto x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+    data += 64;
+    size -= 64;
+
+    // 4本の128bitレーンを並列に畳み込む.
+    while(size >= 64)
+    {
+        auto x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        auto x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        auto x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        auto x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30)));
+
+        data += 64;
+        size -= 64;
+    }
+
+    // 4本を1本にまとめる.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+    const __m128i lanes[3] = { x2, x3, x4 };
+    for(auto& lane : lanes)
+    {
+        auto x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, lane), x5);
+    }
+
+    // 残りの16バイト単位.
+    while(size >= 16)
+    {
+        auto x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data))), x5);
+        data += 16;
+        size -= 16;
+    }
+
+    // 128bitから64bitへ.
+    auto mask = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett還元で32bitへ.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    state = uint32_t(_mm_extract_epi32(x1, 1));
+    return Crc32Scalar(data, size, state);
+}
+
+//-----------------------------------------------------------------------------
+//      SHA-1のブロックをSHA拡張命令で処理します.
+//-----------------------------------------------------------------------------
+TARGET_ATTRIBUTE("sha,ssse3,sse4.1")
+void Sha1Native(uint32_t state[5], const uint8_t* data, size_t blocks)
+{
+    const auto shuffle = _mm_set_epi64x(0x0001020304050607ll, 0x08090A0B0C0D0E0Fll);
+
+    auto abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+    auto e0   = _mm_set_epi32(int(state[4]), 0, 0, 0);
+
+    for(; blocks > 0; --blocks, data += kSha1BlockSize)
+    {
+        auto abcdSave = abcd;
+        auto e0Save   = e0;
+
+        __m128i msg[4];
+        for(auto i=0; i<4; ++i)
+        { msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), shuffle); }
+
+        // 4ラウンドずつ. メッセージスケジュールは4本のレジスタを回しながら先行して計算する.
+        __m128i e1;
+        e0   = _mm_add_epi32(e0, msg[0]);
+        e1   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        e1   = _mm_sha1nexte_epu32(e1, msg[1]);
+        e0   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg[0] = _mm_sha1msg1_epu32(msg[0], msg[1]);
+
+        e0   = _mm_sha1nexte_epu32(e0, msg[2]);
+        e1   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg[1] = _mm_sha1msg1_epu32(msg[1], msg[2]);
+        msg[0] = _mm_xor_si128(msg[0], msg[2]);
+
+        // 以降は同じ形の繰り返し(終盤では使われないレジスタも更新するが, 結果には影響しない).
+        #define SHA1_ROUNDS4(i, eCur, eNext)                                            \
+            eCur = _mm_sha1nexte_epu32(eCur, msg[(i) & 3]);                             \
+            eNext = abcd;                                                               \
+            msg[((i) + 1) & 3] = _mm_sha1msg2_epu32(msg[((i) + 1) & 3], msg[(i) & 3]);  \
+            abcd = _mm_sha1rnds4_epu32(abcd, eCur, (i) / 5);                            \
+            msg[((i) + 3) & 3] = _mm_sha1msg1_epu32(msg[((i) + 3) & 3], msg[(i) & 3]);  \
+            msg[((i) + 2) & 3] = _mm_xor_si128(msg[((i) + 2) & 3], msg[(i) & 3])
+
+        SHA1_ROUNDS4( 3, e1, e0);
+        SHA1_ROUNDS4( 4, e0, e1);
+        SHA1_ROUNDS4( 5, e1, e0);
+        SHA1_ROUNDS4( 6, e0, e1);
+        SHA1_ROUNDS4( 7, e1, e0);
+        SHA1_ROUNDS4( 8, e0, e1);
+        SHA1_ROUNDS4( 9, e1, e0);
+        SHA1_ROUNDS4(10, e0, e1);
+        SHA1_ROUNDS4(11, e1, e0);
+        SHA1_ROUNDS4(12, e0, e1);
+        SHA1_ROUNDS4(13, e1, e0);
+        SHA1_ROUNDS4(14, e0, e1);
+        SHA1_ROUNDS4(15, e1, e0);
+        SHA1_ROUNDS4(16, e0, e1);
+        SHA1_ROUNDS4(17, e1, e0);
+        SHA1_ROUNDS4(18, e0, e1);
+        SHA1_ROUNDS4(19, e1, e0);
+
+        #undef SHA1_ROUNDS4
+
+        e0   = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = uint32_t(_mm_extract_epi32(e0, 3));
+}
+#endif//ARCH_X64
+
+//-----------------------------------------------------------------------------
+//      CRC32の実装を選択します.
+//-----------------------------------------------------------------------------
+Crc32Func SelectCrc32()
+{
+#if ARCH_X64
+    uint32_t regs[4];
+    GetCpuId(1, 0, regs);
+    auto pclmul = (regs[2] & (1u << 1))  != 0;
+    auto sse41  = (regs[2] & (1u << 19)) != 0;
+    if (pclmul && sse41)
+    { return &Crc32Clmul; }
+#endif
+    return &Crc32Scalar;
+}
+
+//-----------------------------------------------------------------------------
+//      SHA-1の実装を選択します.
+//-----------------------------------------------------------------------------
+Sha1Func SelectSha1()
+{
+#if ARCH_X64
+    uint32_t regs[4];
+    GetCpuId(1, 0, regs);
+    auto ssse3 = (regs[2] & (1u << 9))  != 0;
+    auto sse41 = (regs[2] & (1u << 19)) != 0;
+
+    GetCpuId(7, 0, regs);
+    auto sha = (regs[1] & (1u << 29)) != 0;
+    if (ssse3 && sse41 && sha)
+    { return &Sha1Native; }
+#endif
+    return &Sha1Scalar;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      CRC32を計算します.
+//-----------------------------------------------------------------------------
+uint32_t Crc32(const void* data, size_t size, uint32_t crc)
+{
+    static const auto func = SelectCrc32();
+    return ~func(static_cast<const uint8_t*>(data), size, ~crc);
+}
+
+//-----------------------------------------------------------------------------
+//      SHA-1を計算します.
+//-----------------------------------------------------------------------------
+void Sha1(const void* data, size_t size, uint8_t digest[20])
+{
+    static const auto func = SelectSha1();
+
+    uint32_t state[5];
+    memcpy(state, kSha1InitState, sizeof(state));
+
+    // 完全なブロックはそのまま処理する.
+    auto bytes  = static_cast<const uint8_t*>(data);
+    auto blocks = size / kSha1BlockSize;
+    func(state, bytes, blocks);
+
+    // 残りのデータに終端の1ビットとビット長を付加する.
+    uint8_t tail[kSha1BlockSize * 2] = {};
+    auto rest = size - blocks * kSha1BlockSize;
+    memcpy(tail, bytes + blocks * kSha1BlockSize, rest);
+    tail[rest] = 0x80;
+
+    auto tailSize = (rest < kSha1BlockSize - 8) ? kSha1BlockSize : kSha1BlockSize * 2;
+    auto bits = uint64_t(size) * 8;
+    for(auto i=0; i<8; ++i)
+    { tail[tailSize - 1 - i] = uint8_t(bits >> (i * 8)); }
+
+    func(state, tail, tailSize / kSha1BlockSize);
+
+    for(auto i=0; i<5; ++i)
+    {
+        digest[i * 4 + 0] = uint8_t(state[i] >> 24);
+        digest[i * 4 + 1] = uint8_t(state[i] >> 16);
+        digest[i * 4 + 2] = uint8_t(state[i] >> 8);
+        digest[i * 4 + 3] = uint8_t(state[i]);
+    }
+}
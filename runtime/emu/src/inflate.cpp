@@ -0,0 +1,567 @@
+﻿//-----------------------------------------------------------------------------
+// File   : inflate.cpp
+// Desc   : Streaming DEFLATE Decoder.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <inflate.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint32_t kMaxCodeLength    = 15;   // 符号長の最大値.
+static constexpr uint32_t kEndOfBlock       = 256;  // ブロック終端のシンボル.
+
+// 長さ符号(257-285)の基準値と追加ビット数.
+static constexpr uint16_t kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static constexpr uint8_t kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// 距離符号(0-29)の基準値と追加ビット数.
+static constexpr uint16_t kDistanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static constexpr uint8_t kDistanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// 符号長符号の並び順.
+static constexpr uint8_t kCodeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+//-----------------------------------------------------------------------------
+//      ビット順を反転します.
+//-----------------------------------------------------------------------------
+inline uint32_t ReverseBits(uint32_t code, uint32_t length)
+{
+    uint32_t result = 0;
+    for(uint32_t i=0; i<length; ++i)
+    {
+        result = (result << 1) | (code & 1);
+        code >>= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Inflater class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool Inflater::Init(ReadHandler pRead, void* pUser)
+{
+    assert(pRead != nullptr);
+    Term();
+
+    m_pInput = static_cast<uint8_t*>(malloc(InputBufferSize));
+    if (m_pInput == nullptr)
+    { return false; }
+
+    m_pRead         = pRead;
+    m_pUser         = pUser;
+    m_InputPos      = 0;
+    m_InputSize     = 0;
+    m_InputEnd      = false;
+    m_BitBuffer     = 0;
+    m_BitCount      = 0;
+    m_Overrun       = false;
+    m_State         = STATE_HEADER;
+    m_Final         = false;
+    m_StoredLength  = 0;
+    m_CopyLength    = 0;
+    m_CopyDistance  = 0;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void Inflater::Term()
+{
+    free(m_pInput);
+    m_pInput = nullptr;
+    m_pRead  = nullptr;
+    m_pUser  = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      DEFLATEストリームを展開します.
+//-----------------------------------------------------------------------------
+INFLATE_RESULT Inflater::Inflate(uint8_t* output, size_t outputSize, size_t& position)
+{
+    auto pos = position;
+    for(;;)
+    {
+        // 出力先が一杯で中断した一致の続き.
+        if (m_CopyLength > 0)
+        {
+            if (pos == outputSize)
+            {
+                position = pos;
+                return INFLATE_MORE_OUTPUT;
+            }
+
+            auto count = std::min<size_t>(m_CopyLength, outputSize - pos);
+            auto src   = output + pos - m_CopyDistance;
+            for(size_t i=0; i<count; ++i)
+            { output[pos + i] = src[i]; }    // 距離が長さより短い場合は繰り返しになるので1バイトずつ.
+
+            pos          += count;
+            m_CopyLength -= uint32_t(count);
+            continue;
+        }
+
+        switch(m_State)
+        {
+        case STATE_HEADER:
+            if (m_Final)
+            {
+                m_State = STATE_DONE;
+                break;
+            }
+
+            if (!ReadBlockHeader())
+            { return INFLATE_ERROR; }
+            break;
+
+        case STATE_STORED:
+            if (m_StoredLength == 0)
+            {
+                m_State = STATE_HEADER;
+                break;
+            }
+
+            if (pos == outputSize)
+            {
+                position = pos;
+                return INFLATE_MORE_OUTPUT;
+            }
+
+            {
+                auto count = std::min<size_t>(m_StoredLength, outputSize - pos);
+                if (!Read(output + pos, count))
+                { return INFLATE_ERROR; }
+
+                pos            += count;
+                m_StoredLength -= uint32_t(count);
+            }
+            break;
+
+        case STATE_HUFFMAN:
+            for(;;)
+            {
+                // 出力先が一杯でもブロック終端なら進められるので, 消費せずに先読みする.
+                uint32_t length = 0;
+                auto symbol = Peek(m_LitLen, length);
+                if (symbol < 0)
+                { return INFLATE_ERROR; }
+
+                if (symbol < int(kEndOfBlock))
+                {
+                    if (pos == outputSize)
+                    {
+                        position = pos;
+                        return m_Overrun ? INFLATE_ERROR : INFLATE_MORE_OUTPUT;
+                    }
+
+                    ReadBits(length);
+                    output[pos++] = uint8_t(symbol);
+                    continue;
+                }
+
+                ReadBits(length);
+                if (symbol == int(kEndOfBlock))
+                {
+                    m_State = STATE_HEADER;
+                    break;
+                }
+
+                // 長さと距離.
+                symbol -= 257;
+                if (symbol >= 29)
+                { return INFLATE_ERROR; }
+
+                auto matchLength = kLengthBase[symbol] + ReadBits(kLengthExtra[symbol]);
+
+                auto distSymbol = Decode(m_Distance);
+                if (distSymbol < 0 || distSymbol >= 30)
+                { return INFLATE_ERROR; }
+
+                auto distance = kDistanceBase[distSymbol] + ReadBits(kDistanceExtra[distSymbol]);
+                if (distance > pos || m_Overrun)
+                { return INFLATE_ERROR; }
+
+                // 重なりが無く出力先に収まる一致はまとめてコピーする.
+                if (distance >= matchLength && pos + matchLength <= outputSize)
+                {
+                    memcpy(output + pos, output + pos - distance, matchLength);
+                    pos += matchLength;
+                    continue;
+                }
+
+                m_CopyLength   = matchLength;
+                m_CopyDistance = distance;
+                break;
+            }
+
+            if (m_Overrun)
+            { return INFLATE_ERROR; }
+            break;
+
+        case STATE_DONE:
+            position = pos;
+            return INFLATE_DONE;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮されていないデータを読み込みます.
+//-----------------------------------------------------------------------------
+bool Inflater::Read(void* buffer, size_t size)
+{
+    auto dst = static_cast<uint8_t*>(buffer);
+
+    // バイト境界に揃えてから, ビットバッファに残っているバイトを先に使う.
+    ReadBits(m_BitCount & 7);
+    while(size > 0 && m_BitCount >= 8)
+    {
+        if (dst != nullptr)
+        { *dst++ = uint8_t(m_BitBuffer); }
+
+        m_BitBuffer >>= 8;
+        m_BitCount   -= 8;
+        size--;
+    }
+
+    while(size > 0)
+    {
+        if (m_InputPos == m_InputSize && !FillInput())
+        { return false; }
+
+        auto count = std::min(size, m_InputSize - m_InputPos);
+        if (dst != nullptr)
+        {
+            memcpy(dst, m_pInput + m_InputPos, count);
+            dst += count;
+        }
+
+        m_InputPos += count;
+        size       -= count;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      入力バッファを補充します.
+//-----------------------------------------------------------------------------
+bool Inflater::FillInput()
+{
+    if (m_InputEnd)
+    { return false; }
+
+    m_InputPos  = 0;
+    m_InputSize = m_pRead(m_pUser, m_pInput, InputBufferSize);
+    if (m_InputSize == 0)
+    {
+        m_InputEnd = true;
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ビットバッファを補充します.
+//-----------------------------------------------------------------------------
+void Inflater::FillBits()
+{
+    // 入力バッファに8バイト以上残っていれば, まとめて読み込んで入る分だけ進める.
+    if (m_InputSize - m_InputPos >= 8)
+    {
+        uint64_t value;
+        memcpy(&value, m_pInput + m_InputPos, sizeof(value));   // リトルエンディアン前提.
+
+        auto bytes = (63 - m_BitCount) >> 3;
+        m_BitBuffer |= value << m_BitCount;
+        m_BitCount  += bytes * 8;
+        m_InputPos  += bytes;
+        m_BitBuffer &= (uint64_t(1) << m_BitCount) - 1;     // 進めなかったバイトは次回に読み直す.
+        return;
+    }
+
+    while(m_BitCount <= 56)
+    {
+        if (m_InputPos == m_InputSize && !FillInput())
+        { return; }
+
+        m_BitBuffer |= uint64_t(m_pInput[m_InputPos++]) << m_BitCount;
+        m_BitCount  += 8;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ビットを消費せずに取得します(入力の終端以降は0).
+//-----------------------------------------------------------------------------
+uint32_t Inflater::PeekBits(uint32_t count)
+{
+    if (m_BitCount < count)
+    { FillBits(); }
+
+    return uint32_t(m_BitBuffer & ((uint64_t(1) << count) - 1));
+}
+
+//-----------------------------------------------------------------------------
+//      ビットを読み込みます.
+//-----------------------------------------------------------------------------
+uint32_t Inflater::ReadBits(uint32_t count)
+{
+    auto value = PeekBits(count);
+    if (m_BitCount < count)
+    {
+        m_Overrun   = true;
+        m_BitBuffer = 0;
+        m_BitCount  = 0;
+        return value;
+    }
+
+    m_BitBuffer >>= count;
+    m_BitCount   -= count;
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+//      ハフマン符号を1つ復号します.
+//-----------------------------------------------------------------------------
+int Inflater::Decode(const Huffman& huffman)
+{
+    uint32_t length = 0;
+    auto symbol = Peek(huffman, length);
+    if (symbol >= 0)
+    { ReadBits(length); }
+
+    return symbol;
+}
+
+//-----------------------------------------------------------------------------
+//      ハフマン符号をビットを消費せずに復号します.
+//-----------------------------------------------------------------------------
+int Inflater::Peek(const Huffman& huffman, uint32_t& length)
+{
+    auto bits  = PeekBits(kMaxCodeLength);
+    auto entry = huffman.Fast[bits & ((1u << FastBits) - 1)];
+    if (entry != 0)
+    {
+        length = entry & 0xF;
+        return entry >> 4;
+    }
+
+    // 表に収まらない長い符号は1ビットずつ辿る.
+    int code  = 0;
+    int first = 0;
+    int index = 0;
+    for(uint32_t i=1; i<=kMaxCodeLength; ++i)
+    {
+        code |= (bits >> (i - 1)) & 1;
+        int count = huffman.Count[i];
+        if (code - count < first)
+        {
+            length = i;
+            return huffman.Symbol[index + (code - first)];
+        }
+
+        index += count;
+        first += count;
+        first <<= 1;
+        code  <<= 1;
+    }
+
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックヘッダーを読み込みます.
+//-----------------------------------------------------------------------------
+bool Inflater::ReadBlockHeader()
+{
+    m_Final   = ReadBits(1) != 0;
+    auto type = ReadBits(2);
+
+    switch(type)
+    {
+    case 0: // 非圧縮.
+        {
+            ReadBits(m_BitCount & 7);
+            auto length  = ReadBits(16);
+            auto nlength = ReadBits(16);
+            if (length != (~nlength & 0xFFFF))
+            { return false; }
+
+            m_StoredLength = length;
+            m_State        = STATE_STORED;
+        }
+        break;
+
+    case 1: // 固定ハフマン符号.
+        {
+            uint8_t lengths[288 + 30];
+            memset(lengths +   0, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 30);
+
+            Build(m_LitLen,   lengths, 288);
+            Build(m_Distance, lengths + 288, 30);
+            m_State = STATE_HUFFMAN;
+        }
+        break;
+
+    case 2: // 動的ハフマン符号.
+        if (!ReadDynamicTables())
+        { return false; }
+        m_State = STATE_HUFFMAN;
+        break;
+
+    default:
+        return false;
+    }
+
+    return !m_Overrun;
+}
+
+//-----------------------------------------------------------------------------
+//      動的ハフマン符号の表を読み込みます.
+//-----------------------------------------------------------------------------
+bool Inflater::ReadDynamicTables()
+{
+    auto litCount  = ReadBits(5) + 257;
+    auto distCount = ReadBits(5) + 1;
+    auto codeCount = ReadBits(4) + 4;
+    if (litCount > 286 || distCount > 30)
+    { return false; }
+
+    // 符号長を表す符号.
+    uint8_t lengths[286 + 30] = {};
+    for(uint32_t i=0; i<codeCount; ++i)
+    { lengths[kCodeLengthOrder[i]] = uint8_t(ReadBits(3)); }
+
+    Huffman codeLength;
+    if (!Build(codeLength, lengths, 19))
+    { return false; }
+
+    // リテラル・長さと距離の符号長は連続した列として符号化されている.
+    memset(lengths, 0, sizeof(lengths));
+    uint32_t index = 0;
+    while(index < litCount + distCount)
+    {
+        auto symbol = Decode(codeLength);
+        if (symbol < 0 || m_Overrun)
+        { return false; }
+
+        if (symbol < 16)
+        {
+            lengths[index++] = uint8_t(symbol);
+            continue;
+        }
+
+        uint8_t  value  = 0;
+        uint32_t repeat = 0;
+        if (symbol == 16)
+        {
+            if (index == 0)
+            { return false; }
+            value  = lengths[index - 1];
+            repeat = 3 + ReadBits(2);
+        }
+        else if (symbol == 17)
+        { repeat = 3 + ReadBits(3); }
+        else
+        { repeat = 11 + ReadBits(7); }
+
+        if (index + repeat > litCount + distCount)
+        { return false; }
+
+        while(repeat-- > 0)
+        { lengths[index++] = value; }
+    }
+
+    // ブロック終端の符号が無ければ終われない.
+    if (lengths[kEndOfBlock] == 0)
+    { return false; }
+
+    return Build(m_LitLen,   lengths, litCount)
+        && Build(m_Distance, lengths + litCount, distCount);
+}
+
+//-----------------------------------------------------------------------------
+//      符号長から正規ハフマン符号の表を作成します.
+//-----------------------------------------------------------------------------
+bool Inflater::Build(Huffman& huffman, const uint8_t* lengths, uint32_t count)
+{
+    memset(huffman.Count, 0, sizeof(huffman.Count));
+    for(uint32_t i=0; i<count; ++i)
+    { huffman.Count[lengths[i]]++; }
+    huffman.Count[0] = 0;
+
+    // 符号が多すぎる場合は不正. 足りない場合は使われない符号があるだけなので許容する.
+    int left = 1;
+    for(uint32_t length=1; length<=kMaxCodeLength; ++length)
+    {
+        left <<= 1;
+        left -= huffman.Count[length];
+        if (left < 0)
+        { return false; }
+    }
+
+    uint16_t offsets[kMaxCodeLength + 2] = {};
+    for(uint32_t length=1; length<=kMaxCodeLength; ++length)
+    { offsets[length + 1] = offsets[length] + huffman.Count[length]; }
+
+    for(uint32_t i=0; i<count; ++i)
+    {
+        if (lengths[i] != 0)
+        { huffman.Symbol[offsets[lengths[i]]++] = uint16_t(i); }
+    }
+
+    // 短い符号は表引きで復号できるように, 後続ビットの全パターンに登録する.
+    memset(huffman.Fast, 0, sizeof(huffman.Fast));
+    uint32_t code  = 0;
+    uint32_t index = 0;
+    for(uint32_t length=1; length<=FastBits; ++length)
+    {
+        for(uint32_t i=0; i<huffman.Count[length]; ++i, ++code, ++index)
+        {
+            auto entry = uint16_t((huffman.Symbol[index] << 4) | length);
+            for(auto j=ReverseBits(code, length); j<(1u << FastBits); j += (1u << length))
+            { huffman.Fast[j] = entry; }
+        }
+        code <<= 1;
+    }
+
+    return true;
+}
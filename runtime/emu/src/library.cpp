@@ -0,0 +1,398 @@
+﻿//-----------------------------------------------------------------------------
+// File   : library.cpp
+// Desc   : ROM Library Index.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <platform.h>
+#include <cartridge.h>
+#include <hash.h>
+#include <library.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint32_t kIndexMagic   = 0x494C4247;   // 'GBLI'.
+static constexpr uint32_t kIndexVersion = 1;
+static constexpr uint64_t kMaxRomSize   = 8 * 1024 * 1024;  // これより大きいファイルはROMとして扱わない.
+
+///////////////////////////////////////////////////////////////////////////////
+// IndexHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct IndexHeader
+{
+    uint32_t    Magic;          //!< kIndexMagic.
+    uint32_t    Version;        //!< kIndexVersion.
+    uint32_t    EntryCount;     //!< エントリ数.
+    uint32_t    StringSize;     //!< 文字列テーブルのサイズ.
+};
+// 以降に LibraryEntry[EntryCount], char[StringSize] が続く(リトルエンディアン).
+
+///////////////////////////////////////////////////////////////////////////////
+// ScanItem structure
+///////////////////////////////////////////////////////////////////////////////
+struct ScanItem
+{
+    std::string     Path;           //!< ファイルパス(UTF-8).
+    uint64_t        Size;           //!< ファイルサイズ.
+    int64_t         ModifiedTime;   //!< 更新日時.
+};
+
+//=== サイズチェック ===.
+static_assert(sizeof(LibraryEntry) == 64);
+
+//-----------------------------------------------------------------------------
+//      ファイルを開きます.
+//-----------------------------------------------------------------------------
+FILE* OpenFile(const char* path, const char* mode)
+{
+    FILE* fp = nullptr;
+#if PLATFORM_WIN64
+    if (fopen_s(&fp, path, mode) != 0)
+    { fp = nullptr; }
+#else
+    fp = fopen(path, mode);
+#endif
+    return fp;
+}
+
+//-----------------------------------------------------------------------------
+//      ROMファイルの拡張子かどうか判定します.
+//-----------------------------------------------------------------------------
+bool IsRomExtension(const std::filesystem::path& path)
+{
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return char((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c); });
+    return ext == ".gb" || ext == ".gbc" || ext == ".sgb";
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを読み込んでハッシュとヘッダー情報を求めます.
+//-----------------------------------------------------------------------------
+bool HashFile(const char* path, LibraryEntry& entry, std::vector<uint8_t>& buffer)
+{
+    auto fp = OpenFile(path, "rb");
+    if (fp == nullptr)
+    { return false; }
+
+    // 走査してからの間に書き換えられた場合はサイズが合わないので失敗にする.
+    auto size = size_t(entry.Size);
+    buffer.resize(size + 1);
+    auto read = fread(buffer.data(), 1, size + 1, fp);
+    fclose(fp);
+
+    if (read != size)
+    { return false; }
+
+    auto binary = buffer.data();
+    entry.Crc32 = Crc32(binary, size);
+    Sha1(binary, size, entry.Sha1);
+
+    memset(entry.Title, 0, sizeof(entry.Title));
+    entry.CartridgeType = 0;
+    entry.RomSize       = 0;
+    entry.RamSize       = 0;
+    entry.Flags         = 0;
+
+    if (size < sizeof(Cartridge))
+    { return true; }
+
+    const auto& header = reinterpret_cast<const Cartridge*>(binary)->Header;
+    memcpy(entry.Title, header.Title, sizeof(entry.Title));
+    entry.CartridgeType = header.CartridgeType;
+    entry.RomSize       = header.RomSize;
+    entry.RamSize       = header.RamSize;
+
+    if (IsValidLogo(header))
+    { entry.Flags |= LIBRARY_FLAG_VALID_LOGO; }
+
+    if (CalcHeaderCheckSum(header) == header.HeaderCheckSum)
+    { entry.Flags |= LIBRARY_FLAG_VALID_HEADER_SUM; }
+
+    auto globalSum = uint16_t((header.GlobalCheckSum[0] << 8) | header.GlobalCheckSum[1]);
+    if (CalcGlobalCheckSum(binary, size) == globalSum)
+    { entry.Flags |= LIBRARY_FLAG_VALID_GLOBAL_SUM; }
+
+    if (header.RomSize < 16 && GetRomSize(reinterpret_cast<const Cartridge*>(binary)) == size)
+    { entry.Flags |= LIBRARY_FLAG_VALID_SIZE; }
+
+    return true;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Library class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void Library::Term()
+{
+    free(m_pEntries);
+    free(m_pStrings);
+
+    m_pEntries    = nullptr;
+    m_pStrings    = nullptr;
+    m_Count       = 0;
+    m_StringSize  = 0;
+    m_HashedCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      インデックスファイルを読み込みます.
+//-----------------------------------------------------------------------------
+bool Library::Load(const char* path)
+{
+    assert(path != nullptr);
+
+    auto fp = OpenFile(path, "rb");
+    if (fp == nullptr)
+    { return false; }
+
+    IndexHeader header = {};
+    if (fread(&header, sizeof(header), 1, fp) != 1
+     || header.Magic   != kIndexMagic
+     || header.Version != kIndexVersion)
+    {
+        fclose(fp);
+        printf("Error : Invalid Library Index. path = %s\n", path);
+        return false;
+    }
+
+    auto entries = static_cast<LibraryEntry*>(malloc(sizeof(LibraryEntry) * (header.EntryCount + 1)));
+    auto strings = static_cast<char*>(malloc(header.StringSize + 1));
+    if (entries == nullptr || strings == nullptr)
+    {
+        fclose(fp);
+        free(entries);
+        free(strings);
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    auto result = (header.EntryCount == 0 || fread(entries, sizeof(LibraryEntry) * header.EntryCount, 1, fp) == 1)
+               && (header.StringSize == 0 || fread(strings, header.StringSize, 1, fp) == 1);
+    fclose(fp);
+
+    // 壊れたファイルで範囲外を参照しないように, パスの位置を確認しておく.
+    strings[header.StringSize] = '\0';
+    for(auto i=0u; result && i<header.EntryCount; ++i)
+    { result = entries[i].PathOffset < header.StringSize; }
+
+    if (!result)
+    {
+        free(entries);
+        free(strings);
+        printf("Error : Invalid Library Index. path = %s\n", path);
+        return false;
+    }
+
+    Term();
+    m_pEntries   = entries;
+    m_pStrings   = strings;
+    m_Count      = header.EntryCount;
+    m_StringSize = header.StringSize;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      インデックスファイルに書き出します.
+//-----------------------------------------------------------------------------
+bool Library::Save(const char* path) const
+{
+    assert(path != nullptr);
+
+    auto fp = OpenFile(path, "wb");
+    if (fp == nullptr)
+    {
+        printf("Error : Save Library Index Failed. path = %s\n", path);
+        return false;
+    }
+
+    IndexHeader header = {};
+    header.Magic      = kIndexMagic;
+    header.Version    = kIndexVersion;
+    header.EntryCount = m_Count;
+    header.StringSize = m_StringSize;
+
+    auto result = fwrite(&header, sizeof(header), 1, fp) == 1
+               && (m_Count      == 0 || fwrite(m_pEntries, sizeof(LibraryEntry) * m_Count, 1, fp) == 1)
+               && (m_StringSize == 0 || fwrite(m_pStrings, m_StringSize, 1, fp) == 1);
+
+    fclose(fp);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ディレクトリ以下のROMを走査してインデックスを更新します.
+//-----------------------------------------------------------------------------
+bool Library::Scan(const char* directory, uint32_t threadCount)
+{
+    assert(directory != nullptr);
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    fs::recursive_directory_iterator it(fs::u8path(directory), fs::directory_options::skip_permission_denied, error);
+    if (error)
+    {
+        printf("Error : Open Directory Failed. path = %s\n", directory);
+        return false;
+    }
+
+    // ファイル一覧を集める. 順序はファイルシステムに依存するのでパスで並べ替える.
+    std::vector<ScanItem> items;
+    for(; it != fs::recursive_directory_iterator(); it.increment(error))
+    {
+        if (error)
+        { break; }
+
+        if (!it->is_regular_file(error) || !IsRomExtension(it->path()))
+        { continue; }
+
+        auto size  = it->file_size(error);
+        if (error || size == 0 || size > kMaxRomSize)
+        { continue; }
+
+        auto mtime = it->last_write_time(error);
+        if (error)
+        { continue; }
+
+        items.push_back({ it->path().u8string(), uint64_t(size), int64_t(mtime.time_since_epoch().count()) });
+    }
+
+    std::sort(items.begin(), items.end(), [](const ScanItem& lhs, const ScanItem& rhs) { return lhs.Path < rhs.Path; });
+
+    // 前回の結果をパスで引けるようにしておく.
+    std::unordered_map<std::string_view, uint32_t> previous;
+    previous.reserve(m_Count);
+    for(auto i=0u; i<m_Count; ++i)
+    { previous.emplace(GetPath(i), i); }
+
+    std::vector<LibraryEntry>   entries(items.size());
+    std::vector<uint32_t>       jobs;
+
+    for(size_t i=0; i<items.size(); ++i)
+    {
+        const auto& item  = items[i];
+        auto&       entry = entries[i];
+
+        // パス・サイズ・更新日時が一致すれば, ファイルを読まずに前回の結果を使う.
+        auto found = previous.find(item.Path);
+        if (found != previous.end()
+         && m_pEntries[found->second].Size         == item.Size
+         && m_pEntries[found->second].ModifiedTime == item.ModifiedTime)
+        { entry = m_pEntries[found->second]; }
+        else
+        {
+            entry = {};
+            entry.Size         = item.Size;
+            entry.ModifiedTime = item.ModifiedTime;
+            jobs.push_back(uint32_t(i));
+        }
+    }
+
+    // 変更されたファイルだけを全コアで分担してハッシュ計算する.
+    // 各ジョブは別々のエントリに書き込むので, ジョブの取り出し以外に同期は要らない.
+    std::vector<uint8_t>  succeeded(jobs.size(), 0);
+    std::atomic<uint32_t> next(0);
+
+    auto worker = [&]()
+    {
+        std::vector<uint8_t> buffer;
+        for(;;)
+        {
+            auto job = next.fetch_add(1, std::memory_order_relaxed);
+            if (job >= jobs.size())
+            { break; }
+
+            auto index = jobs[job];
+            succeeded[job] = HashFile(items[index].Path.c_str(), entries[index], buffer) ? 1 : 0;
+        }
+    };
+
+    if (threadCount == 0)
+    { threadCount = std::max(1u, std::thread::hardware_concurrency()); }
+    threadCount = std::min(threadCount, std::max(1u, uint32_t(jobs.size())));
+
+    std::vector<std::thread> threads;
+    for(auto i=1u; i<threadCount; ++i)
+    { threads.emplace_back(worker); }
+
+    worker();
+
+    for(auto& thread : threads)
+    { thread.join(); }
+
+    // 読み込めなかったファイルは一覧から外す.
+    uint32_t hashed = 0;
+    for(size_t i=0; i<jobs.size(); ++i)
+    {
+        if (succeeded[i])
+        {
+            hashed++;
+            continue;
+        }
+
+        printf("Warning : Read Rom Failed. path = %s\n", items[jobs[i]].Path.c_str());
+        entries[jobs[i]].Size = UINT64_MAX;
+    }
+
+    // 残ったエントリのパスだけを文字列テーブルに詰める.
+    // 外したファイルのパスを残すと, 参照されないままSave()で書き出されてしまう.
+    std::string strings;
+    size_t      count = 0;
+    for(size_t i=0; i<entries.size(); ++i)
+    {
+        if (entries[i].Size == UINT64_MAX)
+        { continue; }
+
+        entries[count] = entries[i];
+        entries[count].PathOffset = uint32_t(strings.size());
+        strings.append(items[i].Path);
+        strings.push_back('\0');
+        count++;
+    }
+    entries.resize(count);
+
+    auto pEntries = static_cast<LibraryEntry*>(malloc(sizeof(LibraryEntry) * (entries.size() + 1)));
+    auto pStrings = static_cast<char*>(malloc(strings.size() + 1));
+    if (pEntries == nullptr || pStrings == nullptr)
+    {
+        free(pEntries);
+        free(pStrings);
+        printf("Error : Out of Memory.\n");
+        return false;
+    }
+
+    memcpy(pEntries, entries.data(), sizeof(LibraryEntry) * entries.size());
+    memcpy(pStrings, strings.data(), strings.size() + 1);
+
+    Term();
+    m_pEntries    = pEntries;
+    m_pStrings    = pStrings;
+    m_Count       = uint32_t(entries.size());
+    m_StringSize  = uint32_t(strings.size());
+    m_HashedCount = hashed;
+    return true;
+}
@@ -0,0 +1,577 @@
+﻿//-----------------------------------------------------------------------------
+// File   : mapper.cpp
+// Desc   : Memory Bank Controller.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <mapper.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint32_t kRomBankSize  = 0x4000;   // ROMバンクのサイズ.
+static constexpr uint32_t kRamBankSize  = 0x2000;   // RAMバンクのサイズ.
+static constexpr uint32_t kMBC2RamSize  = 0x200;    // MBC2内蔵RAMのサイズ(下位4bitのみ有効).
+
+//-----------------------------------------------------------------------------
+//      ヘッダーのRAMサイズから外部RAMのバイト数を求めます.
+//-----------------------------------------------------------------------------
+uint32_t GetRamSizeInBytes(uint8_t ramSize)
+{
+    switch(ramSize)
+    {
+    case RAM_SIZE_2KB:   return 2   * 1024;
+    case RAM_SIZE_8KB:   return 8   * 1024;
+    case RAM_SIZE_32KB:  return 32  * 1024;
+    case RAM_SIZE_128KB: return 128 * 1024;
+    case 0x05:           return 64  * 1024;
+    default:             return 0;
+    }
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Mapper class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      カートリッジタイプからマッパーの種類を取得します.
+//-----------------------------------------------------------------------------
+bool Mapper::GetMapperType(uint8_t cartridgeType, MAPPER_TYPE& type)
+{
+    switch(cartridgeType)
+    {
+    case CARTRIDGE_ROM_ONLY:
+    case CARTRIDGE_ROM_RAM:
+    case CARTRIDGE_ROM_RAM_BATTERY:
+        type = MAPPER_ROM_ONLY;
+        return true;
+
+    case CARTRIDGE_MBC1:
+    case CARTRIDGE_MBC1_RAM:
+    case CARTRIDGE_MBC1_RAM_BATTERY:
+        type = MAPPER_MBC1;
+        return true;
+
+    case CARTRIDGE_MBC2:
+    case CARTRIDGE_MBC2_BATTERY:
+        type = MAPPER_MBC2;
+        return true;
+
+    case CARTRIDGE_MBC3_TIMER_BATTERY:
+    case CARTRIDGE_MBC3_TIMER_RAM_BATTERY:
+    case CARTRIDGE_MBC3:
+    case CARTRIDGE_MBC3_RAM:
+    case CARTRIDGE_MBC3_RAM_BATTERY:
+        type = MAPPER_MBC3;
+        return true;
+
+    case CARTRIDGE_MBC5:
+    case CARTRIDGE_MBC5_RAM:
+    case CARTRIDGE_MBC5_RAM_BATTERY:
+    case CARTRIDGE_MBC5_RUMBLE:
+    case CARTRIDGE_MBC5_RUMBLE_RAM:
+    case CARTRIDGE_MBC5_RUMBLE_RAM_BATTERY:
+        type = MAPPER_MBC5;
+        return true;
+
+    case CARTRIDGE_HUC1_RAM_BATTERY:
+        type = MAPPER_HUC1;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      バッテリーバックアップ付きかどうか判定します.
+//-----------------------------------------------------------------------------
+bool Mapper::HasBattery(uint8_t cartridgeType)
+{
+    switch(cartridgeType)
+    {
+    case CARTRIDGE_MBC1_RAM_BATTERY:
+    case CARTRIDGE_MBC2_BATTERY:
+    case CARTRIDGE_ROM_RAM_BATTERY:
+    case CARTRIDGE_MMM01_RAM_BATTERY:
+    case CARTRIDGE_MBC3_TIMER_BATTERY:
+    case CARTRIDGE_MBC3_TIMER_RAM_BATTERY:
+    case CARTRIDGE_MBC3_RAM_BATTERY:
+    case CARTRIDGE_MBC5_RAM_BATTERY:
+    case CARTRIDGE_MBC5_RUMBLE_RAM_BATTERY:
+    case CARTRIDGE_MBC7_SENSOR_RUMBLE_RAM_BATTERY:
+    case CARTRIDGE_HUC1_RAM_BATTERY:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      RTCを搭載しているか判定します.
+//-----------------------------------------------------------------------------
+bool Mapper::HasTimer(uint8_t cartridgeType)
+{
+    return cartridgeType == CARTRIDGE_MBC3_TIMER_BATTERY
+        || cartridgeType == CARTRIDGE_MBC3_TIMER_RAM_BATTERY;
+}
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool Mapper::Init(const Cartridge* rom, Memory* memory, const char* savePath)
+{
+    assert(rom    != nullptr);
+    assert(memory != nullptr);
+
+    if (m_pMemory != nullptr)
+    { Term(); }
+
+    // カートリッジタイプの判定はロード時の1回だけ. 以降はハンドラの差し替えで区別する.
+    MAPPER_TYPE type;
+    if (!GetMapperType(rom->Header.CartridgeType, type))
+    {
+        printf("Error : Unsupported Cartridge Type. type = 0x%02X\n", rom->Header.CartridgeType);
+        return false;
+    }
+
+    m_RamSize = (type == MAPPER_MBC2) ? kMBC2RamSize : GetRamSizeInBytes(rom->Header.RamSize);
+    m_HasRtc  = HasTimer(rom->Header.CartridgeType);
+
+    // バッテリーバックアップ付きならセーブファイルをそのままRAMとして使う.
+    // RTCの状態はRAMの後ろに付加する.
+    if ((m_RamSize > 0 || m_HasRtc) && savePath != nullptr && HasBattery(rom->Header.CartridgeType))
+    {
+        if (!m_Battery.Init(savePath, m_RamSize + (m_HasRtc ? Rtc::SaveSize : 0)))
+        {
+            m_RamSize = 0;
+            m_HasRtc  = false;
+            return false;
+        }
+
+        if (m_RamSize > 0)
+        { m_pRam = m_Battery.GetData(); }
+    }
+    else if (m_RamSize > 0)
+    {
+        m_pRam = static_cast<uint8_t*>(malloc(m_RamSize));
+        if (m_pRam == nullptr)
+        {
+            m_RamSize = 0;
+            printf("Error : Out of Memory.\n");
+            return false;
+        }
+
+        memset(m_pRam, 0xFF, m_RamSize);
+    }
+
+    m_pRom          = rom;
+    m_pMemory       = memory;
+    m_Type          = type;
+    m_RomBankCount  = GetRomBankCount(rom);
+    m_RamBankCount  = (m_RamSize + kRamBankSize - 1) / kRamBankSize;
+    m_RamEnable     = false;
+    m_BankLow       = 1;
+    m_BankHigh      = 0;
+    m_RamBank       = 0;
+    m_BankMode      = 0;
+
+    if (m_HasRtc)
+    {
+        m_Rtc.Init(m_RtcMode, m_pClock, m_pClockUser);
+        if (m_Battery.GetData() != nullptr)
+        { m_Rtc.Load(m_Battery.GetData() + m_RamSize); }
+    }
+
+    // バンクレジスタへの書き込みはROM領域への書き込みとして届く.
+    // マッパーごとに特殊化したハンドラを選ぶので, 書き込み時に種類による分岐は発生しない.
+    static constexpr Memory::WriteHandler kRegisterHandlers[] = {
+        nullptr,                                // MAPPER_ROM_ONLY
+        &OnWriteRegister<MAPPER_MBC1>,          // MAPPER_MBC1
+        &OnWriteRegister<MAPPER_MBC2>,          // MAPPER_MBC2
+        &OnWriteRegister<MAPPER_MBC3>,          // MAPPER_MBC3
+        &OnWriteRegister<MAPPER_MBC5>,          // MAPPER_MBC5
+        &OnWriteRegister<MAPPER_HUC1>,          // MAPPER_HUC1
+    };
+    m_pMemory->SetPageHandler(0x0000, 0x8000, nullptr, kRegisterHandlers[type], this);
+
+    // MBC2の内蔵RAMは4bit幅なのでハンドラで処理する.
+    // RTCのレジスタはRAMを切り離している間だけハンドラに届く.
+    if (type == MAPPER_MBC2)
+    { m_pMemory->SetPageHandler(0xA000, 0x2000, &ReadMBC2Ram, &WriteMBC2Ram, this); }
+    else if (m_HasRtc)
+    { m_pMemory->SetPageHandler(0xA000, 0x2000, &ReadRtc, &WriteRtc, this); }
+    else
+    { m_pMemory->SetPageHandler(0xA000, 0x2000, nullptr, nullptr, nullptr); }
+
+    // ROMのみのカートリッジはRAMが常に有効.
+    m_CurrentBank0  = UINT32_MAX;
+    m_CurrentBank1  = UINT32_MAX;
+    m_MappedRamBank = UINT32_MAX;
+    m_pMemory->MountRam(nullptr, 0);
+    MountRom(0, 1);
+    MountRam(type == MAPPER_ROM_ONLY, 0);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void Mapper::Term()
+{
+    if (m_pMemory != nullptr)
+    {
+        // 解放するRAMを参照しないように切り離す.
+        CollectRamWrites();
+        SaveRtc();
+        m_pMemory->SetPageHandler(0x0000, 0x8000, nullptr, nullptr, nullptr);
+        m_pMemory->SetPageHandler(0xA000, 0x2000, nullptr, nullptr, nullptr);
+        m_pMemory->MountRam(nullptr, 0);
+        m_pMemory = nullptr;
+    }
+
+    // セーブファイルは残りの変更を書き出してから閉じる.
+    if (m_pRam != nullptr && m_pRam != m_Battery.GetData())
+    { free(m_pRam); }
+
+    m_Battery.Term();
+    m_pRam          = nullptr;
+    m_MappedRamBank = UINT32_MAX;
+
+    m_pRom      = nullptr;
+    m_RamSize   = 0;
+    m_HasRtc    = false;
+}
+
+//-----------------------------------------------------------------------------
+//      ROMバンクをマウントします.
+//-----------------------------------------------------------------------------
+void Mapper::MountRom(uint32_t bank0, uint32_t bank1)
+{
+    // バンク数は2のべき乗なので, 存在しないバンクは上位ビットを無視する.
+    bank0 &= (m_RomBankCount - 1);
+    bank1 &= (m_RomBankCount - 1);
+
+    // ページテーブルのポインタを差し替えるだけなので, コピーは発生しない.
+    if (bank0 != m_CurrentBank0)
+    {
+        m_pMemory->MountRomBank0(GetRomBank(m_pRom, bank0), kRomBankSize);
+        m_CurrentBank0 = bank0;
+    }
+
+    if (bank1 != m_CurrentBank1)
+    {
+        m_pMemory->MountRomBank1(GetRomBank(m_pRom, bank1), kRomBankSize, uint16_t(bank1));
+        m_CurrentBank1 = bank1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      外部RAMをマウントします.
+//-----------------------------------------------------------------------------
+void Mapper::MountRam(bool enable, uint32_t bank)
+{
+    // MBC2はハンドラで処理するのでページは割り当てない.
+    auto mapped = UINT32_MAX;
+    if (enable && m_pRam != nullptr && m_Type != MAPPER_MBC2)
+    { mapped = bank % m_RamBankCount; }
+
+    // 同じ状態の再設定ではページテーブルもデコードキャッシュも触らない.
+    if (mapped == m_MappedRamBank)
+    { return; }
+
+    // 切り替える前に, マウント中のバンクへの書き込みを記録しておく.
+    CollectRamWrites();
+
+    if (mapped == UINT32_MAX)
+    {
+        m_pMemory->MountRam(nullptr, 0);
+        m_MappedRamBank = UINT32_MAX;
+        return;
+    }
+
+    bank = mapped;
+    auto size = (m_RamSize < kRamBankSize) ? m_RamSize : kRamBankSize;
+    m_pMemory->MountRam(m_pRam + bank * kRamBankSize, size);
+
+    m_MappedRamBank = bank;
+    m_RamVersion    = GetRamVersion();
+}
+
+//-----------------------------------------------------------------------------
+//      マウント中のRAMバンクが書き換えられていれば変更として記録します.
+//-----------------------------------------------------------------------------
+void Mapper::CollectRamWrites()
+{
+    // RAMへの書き込みはページテーブル経由で直接行われるので, 書き込みのたびではなく
+    // バンク切り替えと書き出しの時点でページの書き込み世代を比べる.
+    if (m_Battery.GetData() == nullptr || m_MappedRamBank == UINT32_MAX)
+    { return; }
+
+    auto version = GetRamVersion();
+    if (version == m_RamVersion)
+    { return; }
+
+    m_Battery.MarkDirty(m_MappedRamBank * kRamBankSize, kRamBankSize);
+    m_RamVersion = version;
+}
+
+//-----------------------------------------------------------------------------
+//      外部RAMのページの書き込み世代を取得します.
+//-----------------------------------------------------------------------------
+uint32_t Mapper::GetRamVersion() const
+{
+    uint32_t version = 0;
+    for(uint32_t page=0xA0; page<=0xBF; ++page)
+    { version += m_pMemory->GetPageVersion(uint8_t(page)); }
+
+    return version;
+}
+
+//-----------------------------------------------------------------------------
+//      バッテリーバックアップ付きRAMの変更を書き出します.
+//-----------------------------------------------------------------------------
+void Mapper::FlushRam(bool wait)
+{
+    if (m_pMemory == nullptr || m_Battery.GetData() == nullptr)
+    { return; }
+
+    CollectRamWrites();
+    SaveRtc();
+    m_Battery.Flush(wait);
+}
+
+//-----------------------------------------------------------------------------
+//      RTCの状態をセーブファイルに反映します.
+//-----------------------------------------------------------------------------
+void Mapper::SaveRtc()
+{
+    if (!m_HasRtc || m_Battery.GetData() == nullptr)
+    { return; }
+
+    if (m_Rtc.Save(m_Battery.GetData() + m_RamSize))
+    { m_Battery.MarkDirty(m_RamSize, Rtc::SaveSize); }
+}
+
+//-----------------------------------------------------------------------------
+//      RTCの進め方を設定します.
+//-----------------------------------------------------------------------------
+void Mapper::SetRtcMode(RTC_MODE mode)
+{
+    m_RtcMode = mode;
+    if (m_HasRtc)
+    { m_Rtc.SetMode(mode); }
+}
+
+//-----------------------------------------------------------------------------
+//      バンクレジスタに書き込みます.
+//-----------------------------------------------------------------------------
+template<MAPPER_TYPE Type>
+void Mapper::OnWriteRegister(void* pUser, uint16_t address, uint8_t value)
+{ static_cast<Mapper*>(pUser)->WriteRegister<Type>(address, value); }
+
+template<MAPPER_TYPE Type>
+void Mapper::WriteRegister(uint16_t address, uint8_t value)
+{
+    if constexpr (Type == MAPPER_MBC1)
+    {
+        switch(address >> 13)
+        {
+        case 0: // 0x0000-0x1FFF : RAM有効化.
+            m_RamEnable = (value & 0x0F) == 0x0A;
+            break;
+
+        case 1: // 0x2000-0x3FFF : BANK1(5bit, 0は1として扱う).
+            m_BankLow = value & 0x1F;
+            if (m_BankLow == 0)
+            { m_BankLow = 1; }
+            break;
+
+        case 2: // 0x4000-0x5FFF : BANK2(2bit).
+            m_BankHigh = value & 0x03;
+            break;
+
+        case 3: // 0x6000-0x7FFF : バンキングモード.
+            m_BankMode = value & 0x01;
+            break;
+        }
+
+        // モード1ではBANK2が0x0000-0x3FFFのROMとRAMのバンクにも効く.
+        auto high  = uint32_t(m_BankHigh);
+        auto bank0 = (m_BankMode != 0) ? (high << 5) : 0u;
+        auto bank1 = (high << 5) | m_BankLow;
+        MountRom(bank0, bank1);
+
+        // BANK1はRAMに影響しないので, ROMバンクの切り替えではRAMを触らない.
+        if ((address >> 13) != 1)
+        { MountRam(m_RamEnable, (m_BankMode != 0) ? high : 0u); }
+    }
+    else if constexpr (Type == MAPPER_MBC2)
+    {
+        // 0x0000-0x3FFFのみ有効. アドレスのbit8でレジスタを選択する.
+        // 内蔵RAMはハンドラで処理するので, 許可フラグを変えるだけでよい.
+        if (address >= 0x4000)
+        { return; }
+
+        if ((address & 0x0100) == 0)
+        {
+            m_RamEnable = (value & 0x0F) == 0x0A;
+            return;
+        }
+
+        m_BankLow = value & 0x0F;
+        if (m_BankLow == 0)
+        { m_BankLow = 1; }
+
+        MountRom(0, m_BankLow);
+    }
+    else if constexpr (Type == MAPPER_MBC3)
+    {
+        switch(address >> 13)
+        {
+        case 0: // 0x0000-0x1FFF : RAM・RTC有効化.
+            m_RamEnable = (value & 0x0F) == 0x0A;
+            break;
+
+        case 1: // 0x2000-0x3FFF : ROMバンク(7bit, 0は1として扱う).
+            m_BankLow = value & 0x7F;
+            if (m_BankLow == 0)
+            { m_BankLow = 1; }
+            MountRom(0, m_BankLow);
+            return;
+
+        case 2: // 0x4000-0x5FFF : RAMバンク(0x00-0x03)・RTCレジスタ(0x08-0x0C)選択.
+            m_RamBank = value & 0x0F;
+            break;
+
+        case 3: // 0x6000-0x7FFF : RTCラッチ.
+            if (m_HasRtc)
+            { m_Rtc.WriteLatch(value); }
+            return;
+        }
+
+        // RTCレジスタの選択中はRAMを切り離す.
+        MountRam(m_RamEnable && m_RamBank < 0x08, m_RamBank);
+    }
+    else if constexpr (Type == MAPPER_MBC5)
+    {
+        switch(address >> 12)
+        {
+        case 0: // 0x0000-0x1FFF : RAM有効化.
+        case 1:
+            m_RamEnable = (value == 0x0A);
+            break;
+
+        case 2: // 0x2000-0x2FFF : ROMバンク下位8bit(0も選択可能).
+            m_BankLow = value;
+            MountRom(0, (uint32_t(m_BankHigh) << 8) | m_BankLow);
+            return;
+
+        case 3: // 0x3000-0x3FFF : ROMバンク上位1bit.
+            m_BankHigh = value & 0x01;
+            MountRom(0, (uint32_t(m_BankHigh) << 8) | m_BankLow);
+            return;
+
+        case 4: // 0x4000-0x5FFF : RAMバンク(4bit. 振動カートリッジはbit3がモーター).
+        case 5:
+            m_RamBank = value & 0x0F;
+            break;
+
+        default:
+            return;
+        }
+
+        MountRam(m_RamEnable, m_RamBank);
+    }
+    else if constexpr (Type == MAPPER_HUC1)
+    {
+        switch(address >> 13)
+        {
+        case 0: // 0x0000-0x1FFF : RAM有効化(0x0Eは赤外線モードだが非対応).
+            m_RamEnable = (value & 0x0F) == 0x0A;
+            break;
+
+        case 1: // 0x2000-0x3FFF : ROMバンク(6bit).
+            m_BankLow = value & 0x3F;
+            MountRom(0, m_BankLow);
+            return;
+
+        case 2: // 0x4000-0x5FFF : RAMバンク(2bit).
+            m_RamBank = value & 0x03;
+            break;
+
+        default:
+            return;
+        }
+
+        MountRam(m_RamEnable, m_RamBank);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      MBC2の内蔵RAMから読み取ります.
+//-----------------------------------------------------------------------------
+uint8_t Mapper::ReadMBC2Ram(void* pUser, uint16_t address)
+{
+    // 512バイトが0xA000-0xBFFFで繰り返され, 上位4bitは1が読める.
+    auto pThis = static_cast<Mapper*>(pUser);
+    if (!pThis->m_RamEnable)
+    { return 0xFF; }
+
+    return pThis->m_pRam[address & (kMBC2RamSize - 1)] | 0xF0;
+}
+
+//-----------------------------------------------------------------------------
+//      MBC2の内蔵RAMに書き込みます.
+//-----------------------------------------------------------------------------
+void Mapper::WriteMBC2Ram(void* pUser, uint16_t address, uint8_t value)
+{
+    auto pThis = static_cast<Mapper*>(pUser);
+    if (!pThis->m_RamEnable)
+    { return; }
+
+    auto offset = address & (kMBC2RamSize - 1);
+    pThis->m_pRam[offset] = value & 0x0F;
+    pThis->m_pMemory->Invalidate(0xA000, 0x2000);
+
+    if (pThis->m_Battery.GetData() != nullptr)
+    { pThis->m_Battery.MarkDirty(offset, 1); }
+}
+
+//-----------------------------------------------------------------------------
+//      RTCのレジスタを読み取ります.
+//-----------------------------------------------------------------------------
+uint8_t Mapper::ReadRtc(void* pUser, uint16_t)
+{
+    auto pThis = static_cast<Mapper*>(pUser);
+    if (!pThis->m_RamEnable || pThis->m_RamBank < 0x08)
+    { return 0xFF; }
+
+    return pThis->m_Rtc.Read(pThis->m_RamBank);
+}
+
+//-----------------------------------------------------------------------------
+//      RTCのレジスタに書き込みます.
+//-----------------------------------------------------------------------------
+void Mapper::WriteRtc(void* pUser, uint16_t, uint8_t value)
+{
+    auto pThis = static_cast<Mapper*>(pUser);
+    if (!pThis->m_RamEnable || pThis->m_RamBank < 0x08)
+    { return; }
+
+    pThis->m_Rtc.Write(pThis->m_RamBank, value);
+}
@@ -13,6 +13,20 @@
 #include <mem.h>
 
 
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint16_t kAddressIF   = 0xFF0F;    // 割り込み要求フラグ.
+static constexpr uint16_t kAddressDMA  = 0xFF46;    // OAM DMA転送元.
+static constexpr uint16_t kAddressIE   = 0xFFFF;    // 割り込み許可フラグ.
+static constexpr uint16_t kOamEnd      = 0xFEA0;    // OAMの終端(以降0xFEFFまでは使用禁止領域).
+static constexpr uint16_t kOamSize     = 0xA0;      // OAMのサイズ.
+
+} // namespace
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Memory class
 ///////////////////////////////////////////////////////////////////////////////
@@ -25,12 +39,39 @@ bool Memory::Init()
     if (m_Buffer != nullptr)
     { Term(); }
 
-    m_Buffer = static_cast<uint8_t*>(malloc(0xFFFF));
+    // IEレジスタ(0xFFFF)を含むアドレス空間全体.
+    m_Buffer = static_cast<uint8_t*>(malloc(0x10000));
     if (m_Buffer == nullptr)
     { return false; }
 
-    m_SizeInBytes = 0xFFFF;
+    m_SizeInBytes = 0x10000;
     memset(m_Buffer, 0, m_SizeInBytes);
+    memset(m_PageHandlers, 0, sizeof(m_PageHandlers));
+    memset(m_IoHandlers,   0, sizeof(m_IoHandlers));
+
+    // ROM(0x0000-0x7FFF)はマウントされるまでオープンバス. 書き込みはマッパーが処理する.
+    MapPages(0x0000, 0x8000, nullptr, nullptr);
+
+    // VRAM, 外部RAM, WRAM.
+    MapPages(0x8000, 0x6000, m_Buffer + 0x8000, m_Buffer + 0x8000);
+
+    // エコーRAM(0xE000-0xFDFF)はWRAMを参照する.
+    // 書き込みはWRAM側のページの世代を進めるためハンドラ経由.
+    MapPages(0xE000, 0x1E00, m_Buffer + 0xC000, nullptr);
+    SetPageHandler(0xE000, 0x1E00, nullptr, &Memory::WriteEcho, this);
+
+    // OAMと使用禁止領域.
+    MapPages(0xFE00, PageSize, nullptr, nullptr);
+    SetPageHandler(0xFE00, PageSize, &Memory::ReadOam, &Memory::WriteOam, this);
+
+    // I/Oレジスタ, HRAM, IEレジスタ.
+    MapPages(0xFF00, PageSize, nullptr, nullptr);
+    SetPageHandler(0xFF00, PageSize, &Memory::ReadHigh, &Memory::WriteHigh, this);
+    SetIoHandler(kAddressDMA, nullptr, &Memory::WriteDMA, this);
+
+    // 全ページを書き換えたものとして扱う.
+    Touch(0x0000, m_SizeInBytes);
+    m_RomBank = 1;
     return true;
 }
 
@@ -45,107 +86,251 @@ void Memory::Term()
         m_Buffer = nullptr;
     }
 
+    memset(m_pReadPages,  0, sizeof(m_pReadPages));
+    memset(m_pWritePages, 0, sizeof(m_pWritePages));
     m_SizeInBytes = 0;
 }
 
 //-----------------------------------------------------------------------------
-//      指定アドレスの8bitデータを読み取ります.
+//      ROMバンク0にマウントします.
 //-----------------------------------------------------------------------------
-uint8_t Memory::Read8(uint16_t address) const
+void Memory::MountRomBank0(const uint8_t* data, uint32_t sizeInBytes)
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    return m_Buffer[address];
+    assert(data != nullptr);
+    MountRom(0x0000, data, sizeInBytes);
+
+    // バンク0の差し替えはカートリッジの交換なので, ROM領域全体を無効化.
+    Touch(0x0000, 0x8000);
 }
 
 //-----------------------------------------------------------------------------
-//      指定アドレスの16bitデータを読み取ります.
+//      切り替え可能なROMバンクにマウントします.
 //-----------------------------------------------------------------------------
-uint16_t Memory::Read16(uint16_t address) const
+void Memory::MountRomBank1(const uint8_t* data, uint32_t sizeInBytes, uint16_t bank)
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    uint16_t result = 0;
-    memcpy(&result, m_Buffer + address, sizeof(result));
-    return result;
+    if (data == nullptr)
+    { return; }
+
+    MountRom(0x4000, data, sizeInBytes);
+
+    // 同一カートリッジ内ではバンク番号で内容が決まるので,
+    // デコードキャッシュはバンク番号をキーに区別する.
+    m_RomBank = bank;
 }
 
 //-----------------------------------------------------------------------------
-//      指定アドレスに8bitデータを書き込みます.
+//      外部RAMをマウントします.
 //-----------------------------------------------------------------------------
-void Memory::Write8(uint16_t address, uint8_t value)
+void Memory::MountRam(uint8_t* data, uint32_t sizeInBytes)
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    assert(address >= 0x8000);  // ROM領域を除く.
-    m_Buffer[address] = value;
+    if (data == nullptr || sizeInBytes == 0)
+    { MapPages(0xA000, 0x2000, nullptr, nullptr); }
+    else
+    {
+        assert((sizeInBytes % PageSize) == 0);
+        for(uint32_t offset=0; offset<0x2000; offset+=PageSize)
+        {
+            auto page = data + (offset % sizeInBytes);
+            MapPages(uint16_t(0xA000 + offset), PageSize, page, page);
+        }
+    }
+
+    // バンクの切り替えで内容が変わるので, デコードキャッシュを無効化.
+    Touch(0xA000, 0x2000);
 }
 
 //-----------------------------------------------------------------------------
-//      指定アドレスに16bitデータを書き込みます.
+//      ROMデータを指定アドレスから16KBの範囲にマウントします.
 //-----------------------------------------------------------------------------
-void Memory::Write16(uint16_t address, uint16_t value)
+void Memory::MountRom(uint16_t address, const uint8_t* data, uint32_t sizeInBytes)
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    assert(address >= 0x8000); // ROM領域を除く.
-    memcpy(m_Buffer + address, &value, sizeof(value));
+    // コピーせずにページテーブルから直接参照する. データに満たないページはオープンバス.
+    assert(sizeInBytes <= 0x4000);
+    assert((sizeInBytes % PageSize) == 0);
+    MapPages(address, sizeInBytes, data, nullptr);
+    if (sizeInBytes < 0x4000)
+    { MapPages(uint16_t(address + sizeInBytes), 0x4000 - sizeInBytes, nullptr, nullptr); }
 }
 
-void Memory::Inc8(uint16_t address)
+//-----------------------------------------------------------------------------
+//      指定範囲のページを直接参照するメモリを設定します.
+//-----------------------------------------------------------------------------
+void Memory::MapPages(uint16_t address, uint32_t sizeInBytes, const uint8_t* pRead, uint8_t* pWrite)
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    assert(address >= 0x8000);  // ROM領域を除く.
-    auto& val = m_Buffer[address];
-    val++;
+    assert((address     % PageSize) == 0);
+    assert((sizeInBytes % PageSize) == 0);
+    assert(address + sizeInBytes <= 0x10000);
+
+    auto first = address >> 8;
+    auto count = sizeInBytes / PageSize;
+    for(auto i=0u; i<count; ++i)
+    {
+        m_pReadPages [first + i] = (pRead  != nullptr) ? pRead  + i * PageSize : nullptr;
+        m_pWritePages[first + i] = (pWrite != nullptr) ? pWrite + i * PageSize : nullptr;
+    }
 }
 
-void Memory::Inc16(uint16_t address)
+//-----------------------------------------------------------------------------
+//      指定範囲のページのハンドラを設定します.
+//-----------------------------------------------------------------------------
+void Memory::SetPageHandler
+(
+    uint16_t        address,
+    uint32_t        sizeInBytes,
+    ReadHandler     pRead,
+    WriteHandler    pWrite,
+    void*           pUser
+)
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    assert(address >= 0x8000);  // ROM領域を除く.
-    uint16_t* val = reinterpret_cast<uint16_t*>(m_Buffer+ address);
-    (*val)++;
+    assert((address     % PageSize) == 0);
+    assert((sizeInBytes % PageSize) == 0);
+    assert(address + sizeInBytes <= 0x10000);
+
+    auto first = address >> 8;
+    auto count = sizeInBytes / PageSize;
+    for(auto i=0u; i<count; ++i)
+    {
+        auto& handler = m_PageHandlers[first + i];
+        handler.pRead  = pRead;
+        handler.pWrite = pWrite;
+        handler.pUser  = pUser;
+    }
 }
 
-void Memory::Dec8(uint16_t address)
+//-----------------------------------------------------------------------------
+//      I/Oレジスタのハンドラを設定します.
+//-----------------------------------------------------------------------------
+void Memory::SetIoHandler(uint16_t address, ReadHandler pRead, WriteHandler pWrite, void* pUser)
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    assert(address >= 0x8000);  // ROM領域を除く.
-    auto& val = m_Buffer[address];
-    val--;
+    assert(address >= 0xFF00 && address < 0xFF00 + IoRegisterCount);
+
+    auto& handler = m_IoHandlers[address - 0xFF00];
+    handler.pRead  = pRead;
+    handler.pWrite = pWrite;
+    handler.pUser  = pUser;
 }
 
-void Memory::Dec16(uint16_t address)
+//-----------------------------------------------------------------------------
+//      直接参照できないページから読み取ります.
+//-----------------------------------------------------------------------------
+uint8_t Memory::ReadHandled(uint16_t address) const
 {
-    assert(m_Buffer != nullptr);
-    assert(address < m_SizeInBytes);
-    assert(address >= 0x8000);  // ROM領域を除く.
-    uint16_t* val = reinterpret_cast<uint16_t*>(m_Buffer + address);
-    (*val)--;
+    auto& handler = m_PageHandlers[address >> 8];
+    if (handler.pRead == nullptr)
+    { return 0xFF; }    // 何も接続されていないバスはプルアップされている.
+
+    return handler.pRead(handler.pUser, address);
 }
 
 //-----------------------------------------------------------------------------
-//      ROMバンク0にマウントします.
+//      直接参照できないページに書き込みます.
 //-----------------------------------------------------------------------------
-void Memory::MountRomBank0(const uint8_t* data, uint32_t sizeInBytes)
+void Memory::WriteHandled(uint16_t address, uint8_t value)
 {
-    assert(data != nullptr);
-    assert(sizeInBytes <= 0x4000);
-    memcpy(m_Buffer, data, sizeInBytes);
+    auto& handler = m_PageHandlers[address >> 8];
+    if (handler.pWrite == nullptr)
+    { return; }
+
+    handler.pWrite(handler.pUser, address, value);
 }
 
 //-----------------------------------------------------------------------------
-//      切り替え可能なROMバンクにマウントします.
+//      指定範囲のページの書き込み世代を進めます.
 //-----------------------------------------------------------------------------
-void Memory::MountRomBank1(const uint8_t* data, uint32_t sizeInBytes)
+void Memory::Touch(uint16_t address, uint32_t sizeInBytes)
 {
-    if (data == nullptr)
-    { return; }
+    assert(sizeInBytes > 0);
+    uint32_t first = address >> 8;
+    uint32_t last  = (address + sizeInBytes - 1) >> 8;
+    for(auto i=first; i<=last && i<256; ++i)
+    { m_PageVersion[i]++; }
+}
 
-    assert(sizeInBytes <= 0x4000);
-    memcpy(m_Buffer + 0x4000, data, sizeInBytes);
-}
\ No newline at end of file
+//-----------------------------------------------------------------------------
+//      エコーRAMに書き込みます.
+//-----------------------------------------------------------------------------
+void Memory::WriteEcho(void* pUser, uint16_t address, uint8_t value)
+{
+    auto pThis = static_cast<Memory*>(pUser);
+    pThis->Write8(uint16_t(address - 0x2000), value);
+}
+
+//-----------------------------------------------------------------------------
+//      OAMから読み取ります.
+//-----------------------------------------------------------------------------
+uint8_t Memory::ReadOam(void* pUser, uint16_t address)
+{
+    // 使用禁止領域は0を返す.
+    auto pThis = static_cast<Memory*>(pUser);
+    return (address < kOamEnd) ? pThis->m_Buffer[address] : 0x00;
+}
+
+//-----------------------------------------------------------------------------
+//      OAMに書き込みます.
+//-----------------------------------------------------------------------------
+void Memory::WriteOam(void* pUser, uint16_t address, uint8_t value)
+{
+    // 使用禁止領域への書き込みは無視する.
+    auto pThis = static_cast<Memory*>(pUser);
+    if (address < kOamEnd)
+    {
+        pThis->m_Buffer[address] = value;
+        pThis->Touch(address);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      I/Oレジスタ, HRAM, IEレジスタから読み取ります.
+//-----------------------------------------------------------------------------
+uint8_t Memory::ReadHigh(void* pUser, uint16_t address)
+{
+    auto pThis = static_cast<Memory*>(pUser);
+    if (address < 0xFF00 + IoRegisterCount)
+    {
+        auto& handler = pThis->m_IoHandlers[address - 0xFF00];
+        if (handler.pRead != nullptr)
+        { return handler.pRead(handler.pUser, address); }
+    }
+
+    return pThis->m_Buffer[address];
+}
+
+//-----------------------------------------------------------------------------
+//      I/Oレジスタ, HRAM, IEレジスタに書き込みます.
+//-----------------------------------------------------------------------------
+void Memory::WriteHigh(void* pUser, uint16_t address, uint8_t value)
+{
+    auto pThis = static_cast<Memory*>(pUser);
+
+    // 割り込み要求が変わるかもしれないので, CPUにブロックの途中で判定させる.
+    if (address == kAddressIF || address == kAddressIE)
+    { pThis->m_InterruptVersion++; }
+
+    if (address < 0xFF00 + IoRegisterCount)
+    {
+        auto& handler = pThis->m_IoHandlers[address - 0xFF00];
+        if (handler.pWrite != nullptr)
+        {
+            handler.pWrite(handler.pUser, address, value);
+            return;
+        }
+    }
+
+    pThis->m_Buffer[address] = value;
+}
+
+//-----------------------------------------------------------------------------
+//      OAM DMA転送を行います.
+//-----------------------------------------------------------------------------
+void Memory::WriteDMA(void* pUser, uint16_t address, uint8_t value)
+{
+    // 転送期間中のバス競合は再現せず, 書き込み時点でまとめて転送する.
+    auto pThis = static_cast<Memory*>(pUser);
+    pThis->m_Buffer[address] = value;
+
+    auto src = uint16_t(value << 8);
+    for(uint16_t i=0; i<kOamSize; ++i)
+    { pThis->m_Buffer[0xFE00 + i] = pThis->Read8(uint16_t(src + i)); }
+
+    pThis->Touch(0xFE00, kOamSize);
+}
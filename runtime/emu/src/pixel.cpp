@@ -0,0 +1,352 @@
+﻿//-----------------------------------------------------------------------------
+// File   : pixel.cpp
+// Desc   : Pixel Conversion Kernels.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstring>
+#include <platform.h>
+#include <pixel.h>
+
+#if ARCH_X64
+#include <immintrin.h>
+#if PLATFORM_WIN64
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif//ARCH_X64
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+// GCC/Clangでは拡張命令を使う関数だけ個別に有効にする(MSVCは指定不要).
+#if defined(__GNUC__)
+    #define TARGET_ATTRIBUTE(x)     __attribute__((target(x)))
+#else
+    #define TARGET_ATTRIBUTE(x)
+#endif
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// SpreadTable structure
+///////////////////////////////////////////////////////////////////////////////
+struct SpreadTable
+{
+    uint8_t Value[256][8];
+
+    constexpr SpreadTable()
+    : Value()
+    {
+        // 最上位ビットが左端のピクセル.
+        for(uint32_t i=0; i<256; ++i)
+        {
+            for(auto j=0; j<8; ++j)
+            { Value[i][j] = uint8_t((i >> (7 - j)) & 0x1); }
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr SpreadTable kSpreadTable;
+
+using DecodeTileFunc    = void (*)(const uint8_t* data, uint8_t* pixels);
+using ConvertPixelsFunc = void (*)(const uint8_t* indices, const uint32_t* palette, uint32_t* pixels, size_t count);
+
+//-----------------------------------------------------------------------------
+//      タイルを1行ずつ表引きで変換します.
+//-----------------------------------------------------------------------------
+void DecodeTileScalar(const uint8_t* data, uint8_t* pixels)
+{
+    for(auto row=0; row<8; ++row)
+    {
+        auto low  = kSpreadTable.Value[data[row * 2 + 0]];
+        auto high = kSpreadTable.Value[data[row * 2 + 1]];
+        for(auto i=0; i<8; ++i)
+        { pixels[row * 8 + i] = uint8_t(low[i] | (high[i] << 1)); }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      カラー番号を1ピクセルずつ変換します.
+//-----------------------------------------------------------------------------
+void ConvertPixelsScalar(const uint8_t* indices, const uint32_t* palette, uint32_t* pixels, size_t count)
+{
+    for(size_t i=0; i<count; ++i)
+    { pixels[i] = palette[indices[i] & 0xF]; }
+}
+
+#if ARCH_X64
+//-----------------------------------------------------------------------------
+//      CPUID命令の結果を取得します.
+//-----------------------------------------------------------------------------
+void GetCpuId(uint32_t leaf, uint32_t subLeaf, uint32_t regs[4])
+{
+#if PLATFORM_WIN64
+    int values[4] = {};
+    __cpuidex(values, int(leaf), int(subLeaf));
+    for(auto i=0; i<4; ++i)
+    { regs[i] = uint32_t(values[i]); }
+#else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    if (leaf > __get_cpuid_max(0, nullptr))
+    { return; }
+    __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      OSがYMMレジスタを保存するかどうかを取得します.
+//-----------------------------------------------------------------------------
+TARGET_ATTRIBUTE("xsave")
+bool IsYmmEnabled()
+{ return (_xgetbv(0) & 0x6) == 0x6; }
+
+//-----------------------------------------------------------------------------
+//      タイルを2行ずつ変換します.
+//-----------------------------------------------------------------------------
+TARGET_ATTRIBUTE("ssse3")
+void DecodeTileSsse3(const uint8_t* data, uint8_t* pixels)
+{
+    auto src  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    auto bits = _mm_setr_epi8(char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                              char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    auto lowMask  = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2);
+    auto highMask = _mm_setr_epi8(1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3, 3);
+    auto one  = _mm_set1_epi8(1);
+    auto two  = _mm_set1_epi8(2);
+
+    for(auto i=0; i<4; ++i)
+    {
+        // 2行分の各プレーンのバイトを8ピクセルに複製し, 各ピクセルのビットを取り出す.
+        auto offset = _mm_set1_epi8(char(i * 4));
+        auto low  = _mm_shuffle_epi8(src, _mm_add_epi8(lowMask,  offset));
+        auto high = _mm_shuffle_epi8(src, _mm_add_epi8(highMask, offset));
+        low  = _mm_cmpeq_epi8(_mm_and_si128(low,  bits), bits);
+        high = _mm_cmpeq_epi8(_mm_and_si128(high, bits), bits);
+
+        auto result = _mm_or_si128(_mm_and_si128(low, one), _mm_and_si128(high, two));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i * 16), result);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      パレットをチャンネルごとの16バイトの表に並べ替えます.
+//-----------------------------------------------------------------------------
+TARGET_ATTRIBUTE("ssse3")
+inline void SplitChannels(const uint32_t* palette, __m128i (&channels)[4])
+{
+    // 4色ずつチャンネル順に並べ替えてから4x4で転置する.
+    auto order = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    auto c0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(palette +  0)), order);
+    auto c1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(palette +  4)), order);
+    auto c2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(palette +  8)), order);
+    auto c3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(palette + 12)), order);
+
+    auto t0 = _mm_unpacklo_epi32(c0, c1);
+    auto t1 = _mm_unpacklo_epi32(c2, c3);
+    auto t2 = _mm_unpackhi_epi32(c0, c1);
+    auto t3 = _mm_unpackhi_epi32(c2, c3);
+
+    channels[0] = _mm_unpacklo_epi64(t0, t1);
+    channels[1] = _mm_unpackhi_epi64(t0, t1);
+    channels[2] = _mm_unpacklo_epi64(t2, t3);
+    channels[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+//-----------------------------------------------------------------------------
+//      カラー番号を16ピクセルずつ変換します.
+//-----------------------------------------------------------------------------
+TARGET_ATTRIBUTE("ssse3")
+void ConvertPixelsSsse3(const uint8_t* indices, const uint32_t* palette, uint32_t* pixels, size_t count)
+{
+    __m128i channels[4];
+    SplitChannels(palette, channels);
+
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        // チャンネルごとに表を引いてから, バイト単位で交互に並べる.
+        auto index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+        auto r = _mm_shuffle_epi8(channels[0], index);
+        auto g = _mm_shuffle_epi8(channels[1], index);
+        auto b = _mm_shuffle_epi8(channels[2], index);
+        auto a = _mm_shuffle_epi8(channels[3], index);
+
+        auto rg0 = _mm_unpacklo_epi8(r, g);
+        auto rg1 = _mm_unpackhi_epi8(r, g);
+        auto ba0 = _mm_unpacklo_epi8(b, a);
+        auto ba1 = _mm_unpackhi_epi8(b, a);
+
+        auto dst = reinterpret_cast<__m128i*>(pixels + i);
+        _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(rg0, ba0));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(rg0, ba0));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(rg1, ba1));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(rg1, ba1));
+    }
+
+    ConvertPixelsScalar(indices + i, palette, pixels + i, count - i);
+}
+
+//-----------------------------------------------------------------------------
+//      カラー番号を32ピクセルずつ変換します.
+//-----------------------------------------------------------------------------
+TARGET_ATTRIBUTE("avx2")
+void ConvertPixelsAvx2(const uint8_t* indices, const uint32_t* palette, uint32_t* pixels, size_t count)
+{
+    __m128i channels[4];
+    SplitChannels(palette, channels);
+
+    // バイト単位のシャッフルは128bitレーンごとなので, 両方のレーンに同じ表を置く.
+    auto tr = _mm256_broadcastsi128_si256(channels[0]);
+    auto tg = _mm256_broadcastsi128_si256(channels[1]);
+    auto tb = _mm256_broadcastsi128_si256(channels[2]);
+    auto ta = _mm256_broadcastsi128_si256(channels[3]);
+
+    size_t i = 0;
+    for(; i + 32 <= count; i += 32)
+    {
+        auto index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+        auto r = _mm256_shuffle_epi8(tr, index);
+        auto g = _mm256_shuffle_epi8(tg, index);
+        auto b = _mm256_shuffle_epi8(tb, index);
+        auto a = _mm256_shuffle_epi8(ta, index);
+
+        // 下位レーンに0-15, 上位レーンに16-31番目のピクセルが並ぶ.
+        auto rg0 = _mm256_unpacklo_epi8(r, g);
+        auto rg1 = _mm256_unpackhi_epi8(r, g);
+        auto ba0 = _mm256_unpacklo_epi8(b, a);
+        auto ba1 = _mm256_unpackhi_epi8(b, a);
+        auto p0  = _mm256_unpacklo_epi16(rg0, ba0);    //  0- 3, 16-19
+        auto p1  = _mm256_unpackhi_epi16(rg0, ba0);    //  4- 7, 20-23
+        auto p2  = _mm256_unpacklo_epi16(rg1, ba1);    //  8-11, 24-27
+        auto p3  = _mm256_unpackhi_epi16(rg1, ba1);    // 12-15, 28-31
+
+        auto dst = reinterpret_cast<__m256i*>(pixels + i);
+        _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+
+    // VEX符号化されていないSSE命令に切り替えると遅くなるので, 端数は1ピクセルずつ変換する.
+    ConvertPixelsScalar(indices + i, palette, pixels + i, count - i);
+}
+
+//-----------------------------------------------------------------------------
+//      SSSE3が使えるかどうかを取得します.
+//-----------------------------------------------------------------------------
+bool HasSsse3()
+{
+    uint32_t regs[4];
+    GetCpuId(1, 0, regs);
+    return (regs[2] & (1u << 9)) != 0;
+}
+
+//-----------------------------------------------------------------------------
+//      AVX2が使えるかどうかを取得します.
+//-----------------------------------------------------------------------------
+bool HasAvx2()
+{
+    uint32_t regs[4];
+    GetCpuId(1, 0, regs);
+    auto osxsave = (regs[2] & (1u << 27)) != 0;
+    auto avx     = (regs[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx || !IsYmmEnabled())
+    { return false; }
+
+    GetCpuId(7, 0, regs);
+    return (regs[1] & (1u << 5)) != 0;
+}
+#endif//ARCH_X64
+
+//-----------------------------------------------------------------------------
+//      CPUが対応する最上位の命令セットを取得します.
+//-----------------------------------------------------------------------------
+PIXEL_KERNEL GetSupportedKernel()
+{
+#if ARCH_X64
+    if (HasAvx2())
+    { return PIXEL_KERNEL_AVX2; }
+    if (HasSsse3())
+    { return PIXEL_KERNEL_SSSE3; }
+#endif
+    return PIXEL_KERNEL_SCALAR;
+}
+
+//-----------------------------------------------------------------------------
+//      タイル変換の実装を選択します.
+//-----------------------------------------------------------------------------
+DecodeTileFunc SelectDecodeTile(PIXEL_KERNEL kernel)
+{
+#if ARCH_X64
+    if (kernel >= PIXEL_KERNEL_SSSE3)
+    { return &DecodeTileSsse3; }
+#endif
+    return &DecodeTileScalar;
+}
+
+//-----------------------------------------------------------------------------
+//      ピクセル変換の実装を選択します.
+//-----------------------------------------------------------------------------
+ConvertPixelsFunc SelectConvertPixels(PIXEL_KERNEL kernel)
+{
+#if ARCH_X64
+    if (kernel == PIXEL_KERNEL_AVX2)
+    { return &ConvertPixelsAvx2; }
+    if (kernel == PIXEL_KERNEL_SSSE3)
+    { return &ConvertPixelsSsse3; }
+#endif
+    return &ConvertPixelsScalar;
+}
+
+//-----------------------------------------------------------------------------
+// Global Variables.
+//-----------------------------------------------------------------------------
+// 1ラインごとに呼ばれるので, 関数内の静的変数の初期化判定を避けて起動時に選択する.
+const PIXEL_KERNEL  g_SupportedKernel   = GetSupportedKernel();
+PIXEL_KERNEL        g_Kernel            = g_SupportedKernel;
+DecodeTileFunc      g_DecodeTile        = SelectDecodeTile(g_Kernel);
+ConvertPixelsFunc   g_ConvertPixels     = SelectConvertPixels(g_Kernel);
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      タイルをカラー番号に変換します.
+//-----------------------------------------------------------------------------
+void DecodeTile(const uint8_t* data, uint8_t* pixels)
+{ g_DecodeTile(data, pixels); }
+
+//-----------------------------------------------------------------------------
+//      カラー番号をピクセルに変換します.
+//-----------------------------------------------------------------------------
+void ConvertPixels(const uint8_t* indices, const uint32_t palette[16], uint32_t* pixels, size_t count)
+{ g_ConvertPixels(indices, palette, pixels, count); }
+
+//-----------------------------------------------------------------------------
+//      変換に使う命令セットを切り替えます.
+//-----------------------------------------------------------------------------
+bool SetPixelKernel(PIXEL_KERNEL kernel)
+{
+    if (kernel > g_SupportedKernel)
+    { return false; }
+
+    g_Kernel        = kernel;
+    g_DecodeTile    = SelectDecodeTile(kernel);
+    g_ConvertPixels = SelectConvertPixels(kernel);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      変換に使っている命令セットを取得します.
+//-----------------------------------------------------------------------------
+PIXEL_KERNEL GetPixelKernel()
+{ return g_Kernel; }
@@ -7,5 +7,757 @@
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
+#include <cstring>
 #include <ppu.h>
+#include <cpu.h>
 
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint16_t kAddressIF    = 0xFF0F;   // 割り込み要求フラグ.
+static constexpr uint16_t kAddressLCDC  = 0xFF40;   // LCD制御.
+static constexpr uint16_t kAddressSTAT  = 0xFF41;   // LCDステータス.
+static constexpr uint16_t kAddressSCY   = 0xFF42;   // BGのスクロールY.
+static constexpr uint16_t kAddressSCX   = 0xFF43;   // BGのスクロールX.
+static constexpr uint16_t kAddressLY    = 0xFF44;   // 現在のライン.
+static constexpr uint16_t kAddressLYC   = 0xFF45;   // LYの比較値.
+static constexpr uint16_t kAddressBGP   = 0xFF47;   // BGパレット.
+static constexpr uint16_t kAddressOBP0  = 0xFF48;   // スプライトパレット0.
+static constexpr uint16_t kAddressOBP1  = 0xFF49;   // スプライトパレット1.
+static constexpr uint16_t kAddressWY    = 0xFF4A;   // ウィンドウの表示位置Y.
+static constexpr uint16_t kAddressWX    = 0xFF4B;   // ウィンドウの表示位置X(+7).
+static constexpr uint16_t kAddressOAM   = 0xFE00;   // OAM.
+static constexpr uint16_t kAddressTile  = 0x8000;   // タイルデータ.
+
+static constexpr uint8_t kLcdcBgEnable      = 0x01; // BG・ウィンドウを表示.
+static constexpr uint8_t kLcdcObjEnable     = 0x02; // スプライトを表示.
+static constexpr uint8_t kLcdcObjSize       = 0x04; // スプライトを8x16にする.
+static constexpr uint8_t kLcdcBgMap         = 0x08; // BGのタイルマップを0x9C00にする.
+static constexpr uint8_t kLcdcTileData      = 0x10; // タイルデータを0x8000から符号無しで参照する.
+static constexpr uint8_t kLcdcWindowEnable  = 0x20; // ウィンドウを表示.
+static constexpr uint8_t kLcdcWindowMap     = 0x40; // ウィンドウのタイルマップを0x9C00にする.
+static constexpr uint8_t kLcdcEnable        = 0x80; // LCDを有効にする.
+
+static constexpr uint8_t kStatCoincidence   = 0x04; // LY == LYC.
+static constexpr uint8_t kStatHBlank        = 0x08; // モード0で割り込み.
+static constexpr uint8_t kStatVBlank        = 0x10; // モード1で割り込み.
+static constexpr uint8_t kStatOamScan       = 0x20; // モード2で割り込み.
+static constexpr uint8_t kStatLyc           = 0x40; // LY == LYCで割り込み.
+static constexpr uint8_t kStatWritable      = 0x78; // 書き込み可能なビット.
+
+static constexpr uint8_t kAttrPalette       = 0x10; // OBP1を使う.
+static constexpr uint8_t kAttrFlipX         = 0x20; // 左右反転.
+static constexpr uint8_t kAttrFlipY         = 0x40; // 上下反転.
+static constexpr uint8_t kAttrBehindBg      = 0x80; // BGのカラー1-3の後ろに表示.
+
+// 自前で保持するLCDレジスタ.
+static constexpr uint16_t kRegisters[] = {
+    kAddressLCDC, kAddressSTAT, kAddressSCY, kAddressSCX, kAddressLY, kAddressLYC,
+    kAddressBGP, kAddressOBP0, kAddressOBP1, kAddressWY, kAddressWX,
+};
+
+// BGフェッチャーがタイル番号・下位・上位プレーンを取得して転送待ちになるまでのドット数.
+static constexpr uint8_t kFetchReady        = 6;
+
+// スプライトのタイルデータ取得に掛かるドット数.
+static constexpr uint8_t kObjFetchCycles    = 6;
+
+//-----------------------------------------------------------------------------
+//      タイルデータの1行からピクセルのカラー番号を取り出します.
+//-----------------------------------------------------------------------------
+inline uint8_t GetTilePixel(uint8_t low, uint8_t high, uint32_t x)
+{
+    auto shift = 7 - x;
+    return uint8_t((((high >> shift) & 0x1) << 1) | ((low >> shift) & 0x1));
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Ppu class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool Ppu::Init()
+{
+    if (m_Memory == nullptr)
+    { return false; }
+
+    // LCDレジスタはモードの進行と連動し, ライン途中の書き込みも反映できるように自前で保持する.
+    // VRAM・OAMは描画時にメモリから直接読む.
+    for(auto address : kRegisters)
+    { m_Memory->SetIoHandler(address, &Ppu::ReadRegister, &Ppu::WriteRegister, this); }
+
+    m_Mode              = PPU_MODE_HBLANK;
+    m_NextEventCycle    = UINT64_MAX;
+    m_FrameStart        = GetCycles();
+    m_LineStart         = m_FrameStart;
+    m_LineRenderer      = m_Renderer;
+    m_Lcdc              = 0;
+    m_Stat              = 0;
+    m_LY                = 0;
+    m_Lyc               = 0;
+    m_Scy               = 0;
+    m_Scx               = 0;
+    m_Bgp               = 0;
+    m_Obp0              = 0;
+    m_Obp1              = 0;
+    m_Wy                = 0;
+    m_Wx                = 0;
+    m_WindowLine        = 0;
+    m_StatLine          = false;
+    m_Fifo              = {};
+
+    m_Thread.Flush();
+    for(auto& pixel : m_FrameBuffer)
+    { pixel = LineRenderer::Shades[0]; }
+
+    m_Lines.SetSource(m_Memory->GetBuffer(), m_Memory->GetPageVersions());
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void Ppu::Term()
+{
+    if (m_Memory == nullptr)
+    { return; }
+
+    m_Thread.Term();
+
+    for(auto address : kRegisters)
+    { m_Memory->SetIoHandler(address, nullptr, nullptr, nullptr); }
+
+    m_NextEventCycle = UINT64_MAX;
+}
+
+//-----------------------------------------------------------------------------
+//      現在のサイクルまでモードを進めます.
+//-----------------------------------------------------------------------------
+void Ppu::Execute()
+{
+    // LCDが無効な間はイベントが無いので何もしない.
+    if (m_NextEventCycle == UINT64_MAX)
+    { return; }
+
+    auto cycles = GetCycles();
+    for(;;)
+    {
+        while(m_NextEventCycle <= cycles)
+        { Step(); }
+
+        // ピクセルFIFOは途中まで進めておき, ラインを描き終えたらその時点でモード0に移る.
+        if (m_Mode != PPU_MODE_TRANSFER || m_LineRenderer != PPU_RENDERER_FIFO)
+        { break; }
+
+        RunFifo(cycles);
+        if (m_Fifo.X < DisplayWidth)
+        { break; }
+
+        m_NextEventCycle = m_Fifo.Cycle;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      次のVBlank開始サイクルを取得します.
+//-----------------------------------------------------------------------------
+uint64_t Ppu::GetNextVBlankCycle(uint64_t cycles) const
+{
+    // フレーム周期はLCDを有効にした時点から数えるので, 超過分は次のフレームで吸収される.
+    auto vblank = m_FrameStart + VBlankCycle;
+    if (cycles >= vblank)
+    { vblank += ((cycles - vblank) / CyclesPerFrame + 1) * CyclesPerFrame; }
+
+    return vblank;
+}
+
+//-----------------------------------------------------------------------------
+//      スキャンライン方式の描画を別スレッドで行うかどうかを設定します.
+//-----------------------------------------------------------------------------
+bool Ppu::SetThreadEnable(bool value)
+{
+    if (value == m_Thread.IsRunning())
+    { return true; }
+
+    if (!value)
+    {
+        m_Thread.Term();
+        return true;
+    }
+
+    if (m_Memory == nullptr)
+    { return false; }
+
+    return m_Thread.Init(m_Memory->GetBuffer(), m_Memory->GetPageVersions(), m_FrameBuffer);
+}
+
+//-----------------------------------------------------------------------------
+//      累積サイクル数を取得します.
+//-----------------------------------------------------------------------------
+uint64_t Ppu::GetCycles() const
+{ return (m_pClock != nullptr) ? m_pClock(m_pClockUser) : 0; }
+
+//-----------------------------------------------------------------------------
+//      次のモードに切り替えます.
+//-----------------------------------------------------------------------------
+void Ppu::Step()
+{
+    // 切り替えは予定したサイクルちょうどに起きたものとして次の予定を決める.
+    auto cycle = m_NextEventCycle;
+    switch(m_Mode)
+    {
+    case PPU_MODE_OAM_SCAN:
+        {
+            m_Mode         = PPU_MODE_TRANSFER;
+            m_LineRenderer = m_Renderer;
+            if (m_LineRenderer == PPU_RENDERER_FIFO)
+            {
+                // 終了サイクルは進めてみるまで分からないので, 最短の160ドット後に確認する.
+                BeginFifo(cycle);
+                m_NextEventCycle = cycle + DisplayWidth;
+            }
+            else
+            { m_NextEventCycle = cycle + TransferCycles; }
+        }
+        break;
+
+    case PPU_MODE_TRANSFER:
+        {
+            if (m_LineRenderer == PPU_RENDERER_FIFO)
+            {
+                RunFifo(cycle);
+                if (m_Fifo.X < DisplayWidth)
+                {
+                    // 残りのピクセル数だけ先を次の確認サイクルにする.
+                    m_NextEventCycle = m_Fifo.Cycle + (DisplayWidth - m_Fifo.X);
+                    return;
+                }
+
+                if (m_Fifo.Window)
+                { m_WindowLine++; }
+            }
+            else
+            {
+                // 画素転送の終了時点のレジスタで1ライン分をまとめて描画する.
+                // 描画スレッドがあれば, レジスタとVRAM・OAMの変更を積んで後から描画させる.
+                auto regs = LatchRegisters();
+                if (m_RenderEnable)
+                {
+                    if (m_Thread.IsRunning())
+                    { m_Thread.Submit(regs); }
+                    else
+                    { m_Lines.Render(regs, m_FrameBuffer + m_LY * DisplayWidth); }
+                }
+
+                // 内部ラインカウンタはウィンドウを表示したラインだけ進む(描画しない場合も).
+                if (LineRenderer::IsWindowLine(regs))
+                { m_WindowLine++; }
+            }
+
+            // モード3の長さに関わらずラインの周期は一定.
+            m_Mode           = PPU_MODE_HBLANK;
+            m_NextEventCycle = m_LineStart + CyclesPerLine;
+        }
+        break;
+
+    case PPU_MODE_HBLANK:
+        {
+            m_LY++;
+            if (m_LY == DisplayHeight)
+            {
+                m_Mode           = PPU_MODE_VBLANK;
+                m_NextEventCycle = cycle + CyclesPerLine;
+                RequestInterrupt(INTERRUPT_VBLANK);
+            }
+            else
+            {
+                m_Mode           = PPU_MODE_OAM_SCAN;
+                m_LineStart      = cycle;
+                m_NextEventCycle = cycle + OamScanCycles;
+            }
+        }
+        break;
+
+    case PPU_MODE_VBLANK:
+        {
+            m_LY++;
+            if (m_LY == LinesPerFrame)
+            {
+                m_LY             = 0;
+                m_WindowLine     = 0;
+                m_FrameStart     = cycle;
+                m_LineStart      = cycle;
+                m_Mode           = PPU_MODE_OAM_SCAN;
+                m_NextEventCycle = cycle + OamScanCycles;
+            }
+            else
+            { m_NextEventCycle = cycle + CyclesPerLine; }
+        }
+        break;
+    }
+
+    UpdateStatLine();
+}
+
+//-----------------------------------------------------------------------------
+//      LCDCを設定します.
+//-----------------------------------------------------------------------------
+void Ppu::SetLcdc(uint8_t value)
+{
+    auto prev = m_Lcdc;
+    m_Lcdc = value;
+    if (((prev ^ value) & kLcdcEnable) == 0)
+    { return; }
+
+    m_LY = 0;
+    if (value & kLcdcEnable)
+    {
+        // 有効にした時点からライン0を始める.
+        auto cycles = GetCycles();
+        m_FrameStart     = cycles;
+        m_LineStart      = cycles;
+        m_WindowLine     = 0;
+        m_Mode           = PPU_MODE_OAM_SCAN;
+        m_NextEventCycle = cycles + OamScanCycles;
+        UpdateStatLine();
+
+        // 無効な間に決めたCPUの実行範囲を, 最初のモード切り替えまでに縮める.
+        if (m_pSchedule != nullptr)
+        { m_pSchedule(m_pScheduleUser, m_NextEventCycle); }
+    }
+    else
+    {
+        // 無効な間はモード0のまま止まり, 画面は白くなる.
+        m_Mode           = PPU_MODE_HBLANK;
+        m_NextEventCycle = UINT64_MAX;
+        m_StatLine       = false;
+
+        m_Thread.Flush();
+        for(auto& pixel : m_FrameBuffer)
+        { pixel = LineRenderer::Shades[0]; }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      STAT割り込み信号を更新します.
+//-----------------------------------------------------------------------------
+void Ppu::UpdateStatLine()
+{
+    if ((m_Lcdc & kLcdcEnable) == 0)
+    { return; }
+
+    if (m_LY == m_Lyc)
+    { m_Stat |= kStatCoincidence; }
+    else
+    { m_Stat &= ~kStatCoincidence; }
+
+    // 各要因の論理和が立ち上がったときだけ割り込みを要求する.
+    auto line = ((m_Stat & kStatLyc) && (m_Stat & kStatCoincidence))
+             || ((m_Stat & kStatHBlank ) && m_Mode == PPU_MODE_HBLANK)
+             || ((m_Stat & kStatVBlank ) && m_Mode == PPU_MODE_VBLANK)
+             || ((m_Stat & kStatOamScan) && m_Mode == PPU_MODE_OAM_SCAN);
+
+    if (line && !m_StatLine)
+    { RequestInterrupt(INTERRUPT_LCD_STAT); }
+
+    m_StatLine = line;
+}
+
+//-----------------------------------------------------------------------------
+//      割り込みを要求します.
+//-----------------------------------------------------------------------------
+void Ppu::RequestInterrupt(uint8_t value)
+{ m_Memory->Write8(kAddressIF, m_Memory->Read8(kAddressIF) | value); }
+
+//-----------------------------------------------------------------------------
+//      現在のラインの描画に使うレジスタを取得します.
+//-----------------------------------------------------------------------------
+LineRegisters Ppu::LatchRegisters() const
+{
+    LineRegisters regs;
+    regs.LY         = m_LY;
+    regs.Lcdc       = m_Lcdc;
+    regs.Scy        = m_Scy;
+    regs.Scx        = m_Scx;
+    regs.Bgp        = m_Bgp;
+    regs.Obp0       = m_Obp0;
+    regs.Obp1       = m_Obp1;
+    regs.Wy         = m_Wy;
+    regs.Wx         = m_Wx;
+    regs.WindowLine = m_WindowLine;
+    return regs;
+}
+
+//-----------------------------------------------------------------------------
+//      ピクセルFIFOで画素転送を始めます.
+//-----------------------------------------------------------------------------
+void Ppu::BeginFifo(uint64_t cycle)
+{
+    auto& f = m_Fifo;
+    f = {};
+    f.Cycle     = cycle;
+    f.Discard   = m_Scx & 0x7;  // SCXの端数は画素転送の開始時に決まる.
+    f.Dummy     = true;
+    f.ObjSprite = -1;
+
+    // 描画スレッドが前のラインを描き終えてからフレームバッファに書き込む.
+    m_Thread.Flush();
+
+    if (m_Lcdc & kLcdcObjEnable)
+    {
+        uint32_t count;
+        auto sprites = m_Lines.GetSprites(m_LY, m_Lcdc, count);
+        f.SpriteCount = uint8_t(count);
+        memcpy(f.Sprites, sprites, count);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      指定サイクルまでピクセルFIFOを進めます.
+//-----------------------------------------------------------------------------
+void Ppu::RunFifo(uint64_t cycles)
+{
+    auto& f = m_Fifo;
+    while(f.Cycle < cycles && f.X < DisplayWidth)
+    {
+        TickFifo();
+        f.Cycle++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ピクセルFIFOを1ドット進めます.
+//-----------------------------------------------------------------------------
+void Ppu::TickFifo()
+{
+    auto& f = m_Fifo;
+
+    // スプライトが見つかった位置では, BGフェッチャーが上位プレーンの取得に入るのを待ってから
+    // スプライトのタイルデータを取得する. その間ピクセルは出力されない.
+    // BGのFIFOは空でないので, 残りの1ステップは転送に影響しない.
+    if (f.ObjSprite < 0 && f.BgCount > 0 && f.Discard == 0 && (m_Lcdc & kLcdcObjEnable))
+    { f.ObjSprite = int8_t(FindSprite()); }
+
+    if (f.ObjSprite >= 0)
+    {
+        if (f.FetchStep < kFetchReady - 1)
+        {
+            StepFetcher();
+            return;
+        }
+
+        if (++f.ObjFetch < kObjFetchCycles)
+        { return; }
+
+        MergeSprite();
+        return;
+    }
+
+    if (f.BgCount > 0)
+    {
+        // ウィンドウの開始位置に来たら, BGのFIFOを捨ててウィンドウの先頭から取得し直す.
+        if (!f.Window
+          && (m_Lcdc & kLcdcWindowEnable) && (m_Lcdc & kLcdcBgEnable)
+          && m_LY >= m_Wy && f.X + 7 >= m_Wx)
+        {
+            f.Window    = true;
+            f.BgCount   = 0;
+            f.FetchStep = 0;
+            f.FetchX    = 0;
+            f.Dummy     = false;
+            f.Discard   = (m_Wx < 7) ? uint8_t(7 - m_Wx) : 0;
+            StepFetcher();
+            return;
+        }
+
+        auto bg = f.BgPixels[8 - f.BgCount];
+        f.BgCount--;
+
+        if (f.Discard > 0)
+        { f.Discard--; }
+        else if (!m_RenderEnable)
+        {
+            // モード3の長さはピクセルの値に依らないので, 位置だけ進める.
+            f.X++;
+        }
+        else
+        {
+            auto& obj = f.ObjPixels[f.ObjHead];
+
+            // DMGではBG・ウィンドウが無効だと白になり, スプライトはカラー0の上に出る.
+            auto color = LineRenderer::Shades[0];
+            if (m_Lcdc & kLcdcBgEnable)
+            { color = LineRenderer::Shades[(m_Bgp >> (bg * 2)) & 0x3]; }
+            else
+            { bg = 0; }
+
+            if (obj.Color != 0 && !((obj.Attr & kAttrBehindBg) && bg != 0))
+            {
+                auto obp = (obj.Attr & kAttrPalette) ? m_Obp1 : m_Obp0;
+                color = LineRenderer::Shades[(obp >> (obj.Color * 2)) & 0x3];
+            }
+
+            m_FrameBuffer[m_LY * DisplayWidth + f.X] = color;
+            f.X++;
+
+            obj.Color = 0;
+            f.ObjHead = (f.ObjHead + 1) & 0x7;
+        }
+    }
+
+    StepFetcher();
+}
+
+//-----------------------------------------------------------------------------
+//      BGフェッチャーを1ドット進めます.
+//-----------------------------------------------------------------------------
+void Ppu::StepFetcher()
+{
+    auto& f   = m_Fifo;
+    auto  mem = m_Memory->GetBuffer();
+
+    // タイル番号, 下位プレーン, 上位プレーンをそれぞれ2ドットずつ掛けて取得する.
+    // 描画しない場合は取得に掛かるドット数だけ数える.
+    if (m_RenderEnable && (f.FetchStep == 0 || f.FetchStep == 2 || f.FetchStep == 4))
+    {
+        uint32_t row;
+        if (f.Window)
+        {
+            auto map = (m_Lcdc & kLcdcWindowMap) ? 0x9C00 : 0x9800;
+            row = m_WindowLine & 0x7;
+            if (f.FetchStep == 0)
+            { f.FetchTile = mem[map + (m_WindowLine >> 3) * 32 + (f.FetchX & 0x1F)]; }
+        }
+        else
+        {
+            auto map = (m_Lcdc & kLcdcBgMap) ? 0x9C00 : 0x9800;
+            auto y   = uint8_t(m_LY + m_Scy);
+            row = y & 0x7;
+            if (f.FetchStep == 0)
+            { f.FetchTile = mem[map + (y >> 3) * 32 + (((m_Scx >> 3) + f.FetchX) & 0x1F)]; }
+        }
+
+        auto tileBase = (m_Lcdc & kLcdcTileData) ? 0u : 256u;
+        auto address  = kAddressTile + LineRenderer::GetTileIndex(f.FetchTile, tileBase) * 16 + row * 2;
+        if (f.FetchStep == 2)
+        { f.FetchLow = mem[address]; }
+        else if (f.FetchStep == 4)
+        { f.FetchHigh = mem[address + 1]; }
+    }
+
+    if (f.FetchStep < kFetchReady)
+    { f.FetchStep++; }
+
+    // FIFOが空になるまで転送を待つ.
+    if (f.FetchStep == kFetchReady && f.BgCount == 0)
+    { PushPixel(); }
+}
+
+//-----------------------------------------------------------------------------
+//      取得したタイルの1行をBGのFIFOに転送します.
+//-----------------------------------------------------------------------------
+void Ppu::PushPixel()
+{
+    auto& f = m_Fifo;
+    f.FetchStep = 0;
+
+    // ライン先頭の1回目の取得は捨てられる.
+    if (f.Dummy)
+    {
+        f.Dummy = false;
+        return;
+    }
+
+    for(auto i=0u; i<8; ++i)
+    { f.BgPixels[i] = GetTilePixel(f.FetchLow, f.FetchHigh, i); }
+
+    f.BgCount = 8;
+    f.FetchX++;
+}
+
+//-----------------------------------------------------------------------------
+//      現在の位置から表示が始まるスプライトを探します.
+//-----------------------------------------------------------------------------
+int Ppu::FindSprite() const
+{
+    auto& f   = m_Fifo;
+    auto  oam = m_Memory->GetBuffer() + kAddressOAM;
+
+    // 画面左端にはみ出すスプライトは全て位置0で取得する. リストは優先度の順なので,
+    // 同じ位置では手前のスプライトを先に取得し, 先に取得した方が手前になる.
+    for(auto i=0u; i<f.SpriteCount; ++i)
+    {
+        if (f.ObjDone & (1u << i))
+        { continue; }
+
+        auto x     = oam[f.Sprites[i] * 4 + 1];
+        auto start = (x < 8) ? 0 : x - 8;
+        if (start == f.X)
+        { return int(i); }
+    }
+
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+//      取得したスプライトの1行をスプライトのFIFOに重ねます.
+//-----------------------------------------------------------------------------
+void Ppu::MergeSprite()
+{
+    auto& f     = m_Fifo;
+    auto  index = f.Sprites[f.ObjSprite];
+    f.ObjDone  |= uint16_t(1u << f.ObjSprite);
+    f.ObjSprite = -1;
+    f.ObjFetch  = 0;
+
+    if (!m_RenderEnable)
+    { return; }
+
+    auto  mem    = m_Memory->GetBuffer();
+    auto  sprite = mem + kAddressOAM + index * 4;
+    int   height = (m_Lcdc & kLcdcObjSize) ? 16 : 8;
+
+    auto x    = sprite[1];
+    auto tile = sprite[2];
+    auto attr = sprite[3];
+    auto row  = int(m_LY) - (int(sprite[0]) - 16);
+    if (attr & kAttrFlipY)
+    { row = height - 1 - row; }
+    if (height == 16)
+    { tile &= 0xFE; }
+
+    // 8x16の下半分は次のタイル.
+    auto address = kAddressTile + (tile + (row >> 3)) * 16 + (row & 0x7) * 2;
+    auto low     = mem[address];
+    auto high    = mem[address + 1];
+
+    // 先に入っている不透明なピクセルの方が手前なので, 透明な位置だけ埋める.
+    auto skip = (x < 8) ? 8u - x : 0u;
+    for(auto i=skip; i<8; ++i)
+    {
+        auto color = GetTilePixel(low, high, (attr & kAttrFlipX) ? 7 - i : i);
+        auto& obj  = f.ObjPixels[(f.ObjHead + i - skip) & 0x7];
+        if (obj.Color != 0 || color == 0)
+        { continue; }
+
+        obj.Color = color;
+        obj.Attr  = attr;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      LCDレジスタを読み取ります.
+//-----------------------------------------------------------------------------
+uint8_t Ppu::ReadRegister(void* pUser, uint16_t address)
+{
+    // 読み取った時点のモードとLYを返すため, 先に追いつかせる.
+    auto pThis = static_cast<Ppu*>(pUser);
+    pThis->Execute();
+
+    switch(address)
+    {
+    case kAddressLCDC:
+        return pThis->m_Lcdc;
+
+    case kAddressSTAT:
+        return uint8_t(0x80 | pThis->m_Stat | pThis->m_Mode);
+
+    case kAddressLY:
+        return pThis->m_LY;
+
+    case kAddressLYC:
+        return pThis->m_Lyc;
+
+    case kAddressSCY:
+        return pThis->m_Scy;
+
+    case kAddressSCX:
+        return pThis->m_Scx;
+
+    case kAddressBGP:
+        return pThis->m_Bgp;
+
+    case kAddressOBP0:
+        return pThis->m_Obp0;
+
+    case kAddressOBP1:
+        return pThis->m_Obp1;
+
+    case kAddressWY:
+        return pThis->m_Wy;
+
+    case kAddressWX:
+        return pThis->m_Wx;
+
+    default:
+        break;
+    }
+
+    return 0xFF;
+}
+
+//-----------------------------------------------------------------------------
+//      LCDレジスタに書き込みます.
+//-----------------------------------------------------------------------------
+void Ppu::WriteRegister(void* pUser, uint16_t address, uint8_t value)
+{
+    // 書き込み前の期間は変更前の設定で進める(ピクセルFIFOは書き込んだドットまで描く).
+    auto pThis = static_cast<Ppu*>(pUser);
+    pThis->Execute();
+
+    switch(address)
+    {
+    case kAddressLCDC:
+        pThis->SetLcdc(value);
+        break;
+
+    case kAddressSTAT:
+        pThis->m_Stat = uint8_t((pThis->m_Stat & ~kStatWritable) | (value & kStatWritable));
+        pThis->UpdateStatLine();
+        break;
+
+    case kAddressLYC:
+        pThis->m_Lyc = value;
+        pThis->UpdateStatLine();
+        break;
+
+    case kAddressSCY:
+        pThis->m_Scy = value;
+        break;
+
+    case kAddressSCX:
+        pThis->m_Scx = value;
+        break;
+
+    case kAddressBGP:
+        pThis->m_Bgp = value;
+        break;
+
+    case kAddressOBP0:
+        pThis->m_Obp0 = value;
+        break;
+
+    case kAddressOBP1:
+        pThis->m_Obp1 = value;
+        break;
+
+    case kAddressWY:
+        pThis->m_Wy = value;
+        break;
+
+    case kAddressWX:
+        pThis->m_Wx = value;
+        break;
+
+    default:
+        // LYは読み取り専用.
+        break;
+    }
+}
@@ -0,0 +1,433 @@
+﻿//-----------------------------------------------------------------------------
+// File   : profiler.cpp
+// Desc   : Guest Instruction Profiler.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <platform.h>
+#include <profiler.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint32_t kDumpMagic   = 0x46504247;    // 'GBPF'.
+static constexpr uint32_t kDumpVersion = 1;
+
+///////////////////////////////////////////////////////////////////////////////
+// DumpHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct DumpHeader
+{
+    uint32_t            Magic;          //!< kDumpMagic.
+    uint32_t            Version;        //!< kDumpVersion.
+    uint32_t            OpCodeCount;    //!< オペコード別の集計数.
+    uint32_t            EntryCount;     //!< アドレス別の集計数.
+    Profiler::Counter   Interrupt;      //!< 割り込み処理.
+    Profiler::Counter   Halt;           //!< 停止期間.
+};
+// 以降に Counter[OpCodeCount], Entry[EntryCount] が続く(リトルエンディアン).
+
+//-----------------------------------------------------------------------------
+//      ハッシュテーブルのインデックスを求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t GetHashIndex(uint16_t bank, uint16_t pc, uint32_t capacity)
+{
+    auto key = (uint32_t(bank) << 16) | pc;
+    return ((key ^ (key >> 13)) * 0x9E3779B1u >> 8) & (capacity - 1);
+}
+
+//-----------------------------------------------------------------------------
+//      全体に対する割合を求めます.
+//-----------------------------------------------------------------------------
+inline double GetRatio(uint64_t value, uint64_t total)
+{ return (total != 0) ? double(value) * 100.0 / double(total) : 0.0; }
+
+//-----------------------------------------------------------------------------
+//      ファイルを開きます.
+//-----------------------------------------------------------------------------
+FILE* OpenFile(const char* path, const char* mode)
+{
+    FILE* fp = nullptr;
+#if PLATFORM_WIN64
+    if (fopen_s(&fp, path, mode) != 0)
+    { fp = nullptr; }
+#else
+    fp = fopen(path, mode);
+#endif
+    return fp;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Profiler class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool Profiler::Init(uint32_t capacity)
+{
+    if (m_pEntries != nullptr)
+    { Term(); }
+
+    // 2のべき乗に切り上げる.
+    uint32_t size = 16;
+    while (size < capacity)
+    { size <<= 1; }
+
+    m_pEntries = static_cast<Entry*>(malloc(sizeof(Entry) * size));
+    if (m_pEntries == nullptr)
+    { return false; }
+
+    m_Capacity = size;
+    Reset();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void Profiler::Term()
+{
+    if (m_pEntries != nullptr)
+    {
+        free(m_pEntries);
+        m_pEntries = nullptr;
+    }
+
+    m_Capacity = 0;
+    m_Count    = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      集計結果を破棄します.
+//-----------------------------------------------------------------------------
+void Profiler::Reset()
+{
+    if (m_pEntries != nullptr)
+    { memset(m_pEntries, 0, sizeof(Entry) * m_Capacity); }
+
+    m_Count = 0;
+    memset(m_OpCodes, 0, sizeof(m_OpCodes));
+    m_Interrupt = {};
+    m_Halt      = {};
+}
+
+//-----------------------------------------------------------------------------
+//      命令の実行を記録します.
+//-----------------------------------------------------------------------------
+void Profiler::Record(uint16_t bank, uint16_t pc, uint16_t opCode, uint64_t cycles)
+{
+    assert(opCode < OpCodeCount);
+    m_OpCodes[opCode].Count++;
+    m_OpCodes[opCode].Cycles += cycles;
+
+    auto entry = Find(bank, pc);
+    if (entry == nullptr)
+    { return; }
+
+    entry->OpCode = opCode;
+    entry->Value.Count++;
+    entry->Value.Cycles += cycles;
+}
+
+//-----------------------------------------------------------------------------
+//      エントリを検索し, 無ければ追加します.
+//-----------------------------------------------------------------------------
+Profiler::Entry* Profiler::Find(uint16_t bank, uint16_t pc)
+{
+    if (m_pEntries == nullptr)
+    { return nullptr; }
+
+    auto mask  = m_Capacity - 1;
+    auto index = GetHashIndex(bank, pc, m_Capacity);
+    while (m_pEntries[index].Value.Count != 0)
+    {
+        auto& entry = m_pEntries[index];
+        if (entry.Bank == bank && entry.PC == pc)
+        { return &entry; }
+
+        index = (index + 1) & mask;
+    }
+
+    // 使用率が3/4を超えたら拡張する. 拡張できなければ空きがある限り詰める.
+    if ((m_Count + 1) * 4 > m_Capacity * 3)
+    {
+        if (Grow())
+        { return Find(bank, pc); }
+
+        if (m_Count + 1 >= m_Capacity)
+        { return nullptr; }
+    }
+
+    auto& entry = m_pEntries[index];
+    entry.Bank     = bank;
+    entry.PC       = pc;
+    entry.OpCode   = 0;
+    entry.Reserved = 0;
+    m_Count++;
+    return &entry;
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュテーブルを2倍に拡張します.
+//-----------------------------------------------------------------------------
+bool Profiler::Grow()
+{
+    auto capacity = m_Capacity * 2;
+    auto entries  = static_cast<Entry*>(malloc(sizeof(Entry) * capacity));
+    if (entries == nullptr)
+    { return false; }
+
+    memset(entries, 0, sizeof(Entry) * capacity);
+
+    auto mask = capacity - 1;
+    for(auto i=0u; i<m_Capacity; ++i)
+    {
+        auto& entry = m_pEntries[i];
+        if (entry.Value.Count == 0)
+        { continue; }
+
+        auto index = GetHashIndex(entry.Bank, entry.PC, capacity);
+        while (entries[index].Value.Count != 0)
+        { index = (index + 1) & mask; }
+
+        entries[index] = entry;
+    }
+
+    free(m_pEntries);
+    m_pEntries = entries;
+    m_Capacity = capacity;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      テキストレポートを出力します.
+//-----------------------------------------------------------------------------
+bool Profiler::WriteReport(const char* path, uint32_t maxEntries) const
+{
+    assert(path != nullptr);
+
+    // 消費サイクル数の多い順に並べる. 同じ場合はアドレス順.
+    auto entries = static_cast<Entry*>(malloc(sizeof(Entry) * (m_Count + 1)));
+    if (entries == nullptr)
+    { return false; }
+
+    uint32_t count = 0;
+    for(auto i=0u; i<m_Capacity; ++i)
+    {
+        if (m_pEntries[i].Value.Count != 0)
+        { entries[count++] = m_pEntries[i]; }
+    }
+
+    std::sort(entries, entries + count, [](const Entry& lhs, const Entry& rhs)
+    {
+        if (lhs.Value.Cycles != rhs.Value.Cycles)
+        { return lhs.Value.Cycles > rhs.Value.Cycles; }
+        if (lhs.Bank != rhs.Bank)
+        { return lhs.Bank < rhs.Bank; }
+        return lhs.PC < rhs.PC;
+    });
+
+    uint16_t opCodes[OpCodeCount];
+    for(auto i=0u; i<OpCodeCount; ++i)
+    { opCodes[i] = uint16_t(i); }
+
+    std::sort(opCodes, opCodes + OpCodeCount, [this](uint16_t lhs, uint16_t rhs)
+    {
+        if (m_OpCodes[lhs].Cycles != m_OpCodes[rhs].Cycles)
+        { return m_OpCodes[lhs].Cycles > m_OpCodes[rhs].Cycles; }
+        return lhs < rhs;
+    });
+
+    auto fp = OpenFile(path, "w");
+    if (fp == nullptr)
+    {
+        free(entries);
+        printf("Error : Write Profile Report Failed. path = %s\n", path);
+        return false;
+    }
+
+    uint64_t instructions = 0;
+    uint64_t executed     = 0;
+    for(auto i=0u; i<OpCodeCount; ++i)
+    {
+        instructions += m_OpCodes[i].Count;
+        executed     += m_OpCodes[i].Cycles;
+    }
+
+    auto total = executed + m_Interrupt.Cycles + m_Halt.Cycles;
+
+    fprintf(fp, "=== Summary ===\n");
+    fprintf(fp, "Total Cycles     : %12llu\n", (unsigned long long)total);
+    fprintf(fp, "Instructions     : %12llu (%llu cycles, %6.2f%%)\n",
+        (unsigned long long)instructions, (unsigned long long)executed, GetRatio(executed, total));
+    fprintf(fp, "Interrupts       : %12llu (%llu cycles, %6.2f%%)\n",
+        (unsigned long long)m_Interrupt.Count, (unsigned long long)m_Interrupt.Cycles, GetRatio(m_Interrupt.Cycles, total));
+    fprintf(fp, "Halted           : %12s (%llu cycles, %6.2f%%)\n",
+        "-", (unsigned long long)m_Halt.Cycles, GetRatio(m_Halt.Cycles, total));
+    fprintf(fp, "Unique Addresses : %12u\n", count);
+    fprintf(fp, "\n");
+
+    if (maxEntries == 0 || maxEntries > count)
+    { maxEntries = count; }
+
+    fprintf(fp, "=== Hot Spots ===\n");
+    fprintf(fp, "Bank:Addr  OpCode         Count         Cycles        %%   Cum.%%   Avg\n");
+    uint64_t cumulative = 0;
+    for(auto i=0u; i<maxEntries; ++i)
+    {
+        auto& entry = entries[i];
+        cumulative += entry.Value.Cycles;
+        fprintf(fp, "%04X:%04X  %s%02X  %14llu %14llu  %6.2f  %6.2f  %5.2f\n",
+            entry.Bank,
+            entry.PC,
+            (entry.OpCode >= 0x100) ? "CB " : "   ",
+            entry.OpCode & 0xFF,
+            (unsigned long long)entry.Value.Count,
+            (unsigned long long)entry.Value.Cycles,
+            GetRatio(entry.Value.Cycles, total),
+            GetRatio(cumulative, total),
+            double(entry.Value.Cycles) / double(entry.Value.Count));
+    }
+    fprintf(fp, "\n");
+
+    fprintf(fp, "=== OpCodes ===\n");
+    fprintf(fp, "OpCode          Count         Cycles        %%\n");
+    for(auto i=0u; i<OpCodeCount; ++i)
+    {
+        auto& counter = m_OpCodes[opCodes[i]];
+        if (counter.Count == 0)
+        { break; }
+
+        fprintf(fp, "%s%02X  %14llu %14llu  %6.2f\n",
+            (opCodes[i] >= 0x100) ? "CB " : "   ",
+            opCodes[i] & 0xFF,
+            (unsigned long long)counter.Count,
+            (unsigned long long)counter.Cycles,
+            GetRatio(counter.Cycles, total));
+    }
+
+    fclose(fp);
+    free(entries);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      集計結果をバイナリ形式で保存します.
+//-----------------------------------------------------------------------------
+bool Profiler::Save(const char* path) const
+{
+    assert(path != nullptr);
+
+    auto fp = OpenFile(path, "wb");
+    if (fp == nullptr)
+    {
+        printf("Error : Save Profile Failed. path = %s\n", path);
+        return false;
+    }
+
+    DumpHeader header = {};
+    header.Magic       = kDumpMagic;
+    header.Version     = kDumpVersion;
+    header.OpCodeCount = OpCodeCount;
+    header.EntryCount  = m_Count;
+    header.Interrupt   = m_Interrupt;
+    header.Halt        = m_Halt;
+
+    auto result = fwrite(&header, sizeof(header), 1, fp) == 1
+               && fwrite(m_OpCodes, sizeof(m_OpCodes), 1, fp) == 1;
+
+    for(auto i=0u; result && i<m_Capacity; ++i)
+    {
+        if (m_pEntries[i].Value.Count != 0)
+        { result = fwrite(&m_pEntries[i], sizeof(Entry), 1, fp) == 1; }
+    }
+
+    fclose(fp);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      保存済みの集計結果を現在の集計に加算します.
+//-----------------------------------------------------------------------------
+bool Profiler::Merge(const char* path)
+{
+    assert(path != nullptr);
+
+    auto fp = OpenFile(path, "rb");
+    if (fp == nullptr)
+    {
+        printf("Error : Load Profile Failed. path = %s\n", path);
+        return false;
+    }
+
+    DumpHeader header = {};
+    if (fread(&header, sizeof(header), 1, fp) != 1
+     || header.Magic       != kDumpMagic
+     || header.Version     != kDumpVersion
+     || header.OpCodeCount != OpCodeCount)
+    {
+        fclose(fp);
+        printf("Error : Invalid Profile Data. path = %s\n", path);
+        return false;
+    }
+
+    Counter opCodes[OpCodeCount];
+    if (fread(opCodes, sizeof(opCodes), 1, fp) != 1)
+    {
+        fclose(fp);
+        printf("Error : Invalid Profile Data. path = %s\n", path);
+        return false;
+    }
+
+    for(auto i=0u; i<OpCodeCount; ++i)
+    {
+        m_OpCodes[i].Count  += opCodes[i].Count;
+        m_OpCodes[i].Cycles += opCodes[i].Cycles;
+    }
+
+    m_Interrupt.Count  += header.Interrupt.Count;
+    m_Interrupt.Cycles += header.Interrupt.Cycles;
+    m_Halt.Count       += header.Halt.Count;
+    m_Halt.Cycles      += header.Halt.Cycles;
+
+    auto result = true;
+    for(auto i=0u; i<header.EntryCount; ++i)
+    {
+        Entry src = {};
+        if (fread(&src, sizeof(src), 1, fp) != 1)
+        {
+            printf("Error : Invalid Profile Data. path = %s\n", path);
+            result = false;
+            break;
+        }
+
+        if (src.Value.Count == 0)
+        { continue; }
+
+        auto dst = Find(src.Bank, src.PC);
+        if (dst == nullptr)
+        { continue; }
+
+        dst->OpCode        = src.OpCode;
+        dst->Value.Count  += src.Value.Count;
+        dst->Value.Cycles += src.Value.Cycles;
+    }
+
+    fclose(fp);
+    return result;
+}
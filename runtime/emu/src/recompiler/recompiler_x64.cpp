@@ -0,0 +1,1487 @@
+﻿//-----------------------------------------------------------------------------
+// File   : recompiler_x64.cpp
+// Desc   : Dynamic Recompiler for x86-64.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <initializer_list>
+#include <platform.h>
+#include <recompiler.h>
+#include <cpu.h>
+
+#if PLATFORM_LINUX && ARCH_X64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+#if PLATFORM_LINUX && ARCH_X64
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+
+// ホストレジスタ番号.
+enum HOST_REG
+{
+    HOST_RAX = 0,
+    HOST_RCX = 1,
+    HOST_RDX = 2,
+    HOST_RBX = 3,
+    HOST_RBP = 5,
+    HOST_RSI = 6,
+    HOST_RDI = 7,
+    HOST_R8  = 8,
+    HOST_R9  = 9,
+    HOST_R10 = 10,
+    HOST_R11 = 11,
+    HOST_R12 = 12,
+    HOST_R13 = 13,
+    HOST_R14 = 14,
+    HOST_R15 = 15,
+};
+
+// ゲストレジスタ番号(オペコードのビットフィールド順).
+enum GUEST_REG
+{
+    GUEST_B     = 0,
+    GUEST_C     = 1,
+    GUEST_D     = 2,
+    GUEST_E     = 3,
+    GUEST_H     = 4,
+    GUEST_L     = 5,
+    GUEST_HL    = 6,    // (HL)はメモリアクセス.
+    GUEST_A     = 7,
+    GUEST_F     = 8,
+};
+
+// x86の条件コード(Jcc, SETccの下位4ビット).
+enum HOST_CC
+{
+    HOST_CC_C   = 0x2,
+    HOST_CC_NC  = 0x3,
+    HOST_CC_Z   = 0x4,
+    HOST_CC_NZ  = 0x5,
+    HOST_CC_A   = 0x7,
+};
+
+// ゲストレジスタのホストレジスタへの割り当て.
+// RDIはCpu::Registerへのポインタ, RAXとRBPは作業レジスタとして使う.
+// R12は読み取り用, R14は書き込み用のページテーブル, R15はページの書き込み世代, R13はContext.
+static constexpr uint8_t kHostReg[9] = {
+    HOST_R10,   // B
+    HOST_R11,   // C
+    HOST_RSI,   // D
+    HOST_RDX,   // E
+    HOST_RCX,   // H
+    HOST_RBX,   // L
+    0xFF,       // (HL)
+    HOST_R8,    // A
+    HOST_R9,    // F
+};
+
+// Cpu::Register内のオフセット.
+static const uint8_t kGuestOffset[9] = {
+    uint8_t(offsetof(Cpu::Register, B)),
+    uint8_t(offsetof(Cpu::Register, C)),
+    uint8_t(offsetof(Cpu::Register, D)),
+    uint8_t(offsetof(Cpu::Register, E)),
+    uint8_t(offsetof(Cpu::Register, H)),
+    uint8_t(offsetof(Cpu::Register, L)),
+    0xFF,
+    uint8_t(offsetof(Cpu::Register, A)),
+    uint8_t(offsetof(Cpu::Register, F)),
+};
+
+static const uint8_t kOffsetBC = uint8_t(offsetof(Cpu::Register, BC));
+static const uint8_t kOffsetDE = uint8_t(offsetof(Cpu::Register, DE));
+static const uint8_t kOffsetHL = uint8_t(offsetof(Cpu::Register, HL));
+static const uint8_t kOffsetSP = uint8_t(offsetof(Cpu::Register, SP));
+static const uint8_t kOffsetPC = uint8_t(offsetof(Cpu::Register, PC));
+
+// Recompiler::Context内のオフセット.
+static const uint8_t kContextRegister    = uint8_t(offsetof(Recompiler::Context, pRegister));
+static const uint8_t kContextReadPages   = uint8_t(offsetof(Recompiler::Context, pReadPages));
+static const uint8_t kContextWritePages  = uint8_t(offsetof(Recompiler::Context, pWritePages));
+static const uint8_t kContextVersions    = uint8_t(offsetof(Recompiler::Context, pPageVersions));
+static const uint8_t kContextRead        = uint8_t(offsetof(Recompiler::Context, pRead));
+static const uint8_t kContextWrite       = uint8_t(offsetof(Recompiler::Context, pWrite));
+static const uint8_t kContextUser        = uint8_t(offsetof(Recompiler::Context, pUser));
+static const uint8_t kContextCycles      = uint8_t(offsetof(Recompiler::Context, Cycles));
+static const uint8_t kContextLimit       = uint8_t(offsetof(Recompiler::Context, Limit));
+static const uint8_t kContextLink        = uint8_t(offsetof(Recompiler::Context, pLink));
+static const uint8_t kContextRomBank     = uint8_t(offsetof(Recompiler::Context, RomBank));
+
+// 1命令あたりのコードサイズの上限(メモリアクセスの低速経路を含む).
+static constexpr uint32_t kMaxCommandCode = 320;
+
+// 入口・出口・ブロック末尾の分岐のコードサイズの上限.
+static constexpr uint32_t kMaxBlockCode = 256;
+
+// SM83のALU命令(ADD, ADC, SUB, SBC, AND, XOR, OR, CP)に対応するx86命令.
+static constexpr uint8_t kAluOpRR[8] = { 0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38 };  // op r/m8, r8
+static constexpr uint8_t kAluOpRI[8] = { 0, 2, 5, 3, 4, 6, 1, 7 };                          // 80 /digit ib
+
+// CBプレフィックスのシフト・ローテート命令(RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL)に対応するx86命令.
+static constexpr uint8_t kShiftOp[8] = { 0, 1, 2, 3, 4, 7, 0, 5 };                          // D0 /digit
+
+// SM83のALU命令の種類.
+enum ALU_OP
+{
+    ALU_OP_ADD = 0,
+    ALU_OP_ADC = 1,
+    ALU_OP_SUB = 2,
+    ALU_OP_SBC = 3,
+    ALU_OP_AND = 4,
+    ALU_OP_XOR = 5,
+    ALU_OP_OR  = 6,
+    ALU_OP_CP  = 7,
+};
+
+// フラグ(Z=bit7, N=bit6, H=bit5, C=bit4)の計算方法.
+enum FLAG_MODE
+{
+    FLAG_MODE_ZHC,      // ADD, ADC.
+    FLAG_MODE_ZHC_N,    // SUB, SBC, CP.
+    FLAG_MODE_Z_H,      // AND(H=1, C=0).
+    FLAG_MODE_Z,        // XOR, OR.
+    FLAG_MODE_ZH,       // INC(Cは保持).
+    FLAG_MODE_ZH_N,     // DEC(Cは保持).
+    FLAG_MODE_HC,       // ADD HL,rr(Zは保持).
+};
+
+// メモリアクセスのアドレス指定.
+enum ADDRESS_MODE
+{
+    ADDRESS_BC,         // (BC)
+    ADDRESS_DE,         // (DE)
+    ADDRESS_HL,         // (HL)
+    ADDRESS_HLI,        // (HL+)
+    ADDRESS_HLD,        // (HL-)
+    ADDRESS_IMM,        // (nn)
+    ADDRESS_HIGH_C,     // (0xFF00 + C)
+    ADDRESS_HIGH_IMM,   // (0xFF00 + n)
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Emitter class
+///////////////////////////////////////////////////////////////////////////////
+class Emitter
+{
+public:
+    Emitter(uint8_t* pBegin, uint8_t* pEnd)
+    : m_pCur(pBegin), m_pEnd(pEnd)
+    { /* DO_NOTHING */ }
+
+    bool IsOverflow() const { return m_Overflow; }
+    uint8_t* GetCurrent() const { return m_pCur; }
+
+    void Byte(uint8_t value)
+    {
+        if (m_pCur >= m_pEnd)
+        {
+            m_Overflow = true;
+            return;
+        }
+        *m_pCur++ = value;
+    }
+
+    void Bytes(std::initializer_list<uint8_t> values)
+    {
+        for(auto value : values)
+        { Byte(value); }
+    }
+
+    void Imm16(uint16_t value)
+    { Bytes({ uint8_t(value), uint8_t(value >> 8) }); }
+
+    void Imm32(uint32_t value)
+    {
+        for(auto i=0; i<4; ++i)
+        { Byte(uint8_t(value >> (i * 8))); }
+    }
+
+    void Imm64(uint64_t value)
+    {
+        for(auto i=0; i<8; ++i)
+        { Byte(uint8_t(value >> (i * 8))); }
+    }
+
+    //-------------------------------------------------------------------------
+    // 分岐.
+    //-------------------------------------------------------------------------
+
+    // jmp rel32 (飛び先は後でBind()で決める). rel32の位置を返す.
+    uint8_t* Jump()
+    {
+        Byte(0xE9);
+        Imm32(0);
+        return m_pCur - 4;
+    }
+
+    // jcc rel32 (飛び先は後でBind()で決める). rel32の位置を返す.
+    uint8_t* JumpIf(uint8_t cc)
+    {
+        Bytes({ 0x0F, uint8_t(0x80 | cc) });
+        Imm32(0);
+        return m_pCur - 4;
+    }
+
+    // 前方分岐の飛び先を現在位置にする.
+    void Bind(uint8_t* pRel)
+    {
+        if (m_Overflow)
+        { return; }
+
+        auto rel = int32_t(m_pCur - (pRel + 4));
+        memcpy(pRel, &rel, sizeof(rel));
+    }
+
+    // jmp rel32 (既に出力した位置へ).
+    void JumpTo(const uint8_t* pTarget)
+    {
+        Byte(0xE9);
+        Imm32(uint32_t(int32_t(pTarget - (m_pCur + 4))));
+    }
+
+    // jcc rel32 (既に出力した位置へ).
+    void JumpIfTo(uint8_t cc, const uint8_t* pTarget)
+    {
+        Bytes({ 0x0F, uint8_t(0x80 | cc) });
+        Imm32(uint32_t(int32_t(pTarget - (m_pCur + 4))));
+    }
+
+    //-------------------------------------------------------------------------
+    // ゲストレジスタ([rdi + disp8]).
+    //-------------------------------------------------------------------------
+
+    // movzx r32, byte [rdi + disp8]
+    void LoadGuest(uint8_t host, uint8_t offset)
+    {
+        if (host >= 8)
+        { Byte(0x44); }
+        Bytes({ 0x0F, 0xB6, uint8_t(0x40 | ((host & 7) << 3) | HOST_RDI), offset });
+    }
+
+    // movzx r32, word [rdi + disp8]
+    void LoadGuest16(uint8_t host, uint8_t offset)
+    {
+        if (host >= 8)
+        { Byte(0x44); }
+        Bytes({ 0x0F, 0xB7, uint8_t(0x40 | ((host & 7) << 3) | HOST_RDI), offset });
+    }
+
+    // mov byte [rdi + disp8], r8
+    void StoreGuest(uint8_t host, uint8_t offset)
+    { Bytes({ Rex(host, HOST_RDI), 0x88, uint8_t(0x40 | ((host & 7) << 3) | HOST_RDI), offset }); }
+
+    // mov word [rdi + disp8], imm16
+    void StoreImm16(uint8_t offset, uint16_t value)
+    { Bytes({ 0x66, 0xC7, uint8_t(0x40 | HOST_RDI), offset, uint8_t(value), uint8_t(value >> 8) }); }
+
+    // inc word [rdi + disp8] / dec word [rdi + disp8]
+    void IncGuest16(uint8_t offset) { Bytes({ 0x66, 0xFF, uint8_t(0x40 | HOST_RDI), offset }); }
+    void DecGuest16(uint8_t offset) { Bytes({ 0x66, 0xFF, uint8_t(0x48 | HOST_RDI), offset }); }
+
+    //-------------------------------------------------------------------------
+    // レジスタ間演算.
+    //-------------------------------------------------------------------------
+
+    // mov r8, r8
+    void MovRR8(uint8_t dst, uint8_t src)
+    { Bytes({ Rex(src, dst), 0x88, ModRM(src, dst) }); }
+
+    // mov r8, imm8
+    void MovRI8(uint8_t dst, uint8_t value)
+    { Bytes({ Rex(0, dst), uint8_t(0xB0 + (dst & 7)), value }); }
+
+    // mov r32, imm32
+    void MovRI32(uint8_t dst, uint32_t value)
+    {
+        if (dst >= 8)
+        { Byte(0x41); }
+        Byte(uint8_t(0xB8 + (dst & 7)));
+        Imm32(value);
+    }
+
+    // movzx r32, r8
+    void MovzxRR8(uint8_t dst, uint8_t src)
+    { Bytes({ Rex(dst, src), 0x0F, 0xB6, ModRM(dst, src) }); }
+
+    // op r8, r8
+    void AluRR8(uint8_t alu, uint8_t dst, uint8_t src)
+    { Bytes({ Rex(src, dst), kAluOpRR[alu], ModRM(src, dst) }); }
+
+    // op r8, imm8
+    void AluRI8(uint8_t alu, uint8_t dst, uint8_t value)
+    { Bytes({ Rex(0, dst), 0x80, ModRM(kAluOpRI[alu], dst), value }); }
+
+    // inc r8 / dec r8
+    void IncR8(uint8_t dst) { Bytes({ Rex(0, dst), 0xFE, ModRM(0, dst) }); }
+    void DecR8(uint8_t dst) { Bytes({ Rex(0, dst), 0xFE, ModRM(1, dst) }); }
+
+    // not r8
+    void NotR8(uint8_t dst) { Bytes({ Rex(0, dst), 0xF6, ModRM(2, dst) }); }
+
+    // rol/ror/rcl/rcr/shl/shr/sar r8, 1
+    void ShiftR8(uint8_t digit, uint8_t dst) { Bytes({ Rex(0, dst), 0xD0, ModRM(digit, dst) }); }
+
+    // rol r8, 4
+    void SwapR8(uint8_t dst) { Bytes({ Rex(0, dst), 0xC0, ModRM(0, dst), 0x04 }); }
+
+    // test r8, r8 / test r8, imm8
+    void TestR8(uint8_t reg) { Bytes({ Rex(reg, reg), 0x84, ModRM(reg, reg) }); }
+    void TestRI8(uint8_t reg, uint8_t value) { Bytes({ Rex(0, reg), 0xF6, ModRM(0, reg), value }); }
+
+    // setcc al; movzx eax, al; shl eax, shift
+    void SetFlagBit(uint8_t cc, uint8_t shift)
+    { Bytes({ 0x0F, uint8_t(0x90 | cc), 0xC0, 0x0F, 0xB6, 0xC0, 0xC1, 0xE0, shift }); }
+
+    // bt r9d, 4 (ゲストのCフラグをホストのCFへ).
+    void LoadCarry()
+    { Bytes({ 0x41, 0x0F, 0xBA, 0xE1, 0x04 }); }
+
+    // ホストのフラグからゲストのFレジスタ(R9)を求める.
+    void StoreFlags(FLAG_MODE mode)
+    {
+        // lahf; movzx eax, ah   (AH = SF:ZF:0:AF:0:PF:1:CF)
+        Bytes({ 0x9F, 0x0F, 0xB6, 0xC4 });
+
+        switch(mode)
+        {
+        case FLAG_MODE_ZHC:
+        case FLAG_MODE_ZHC_N:
+            {
+                Bytes({ 0x41, 0x89, 0xC1 });        // mov r9d, eax
+                Bytes({ 0x41, 0x83, 0xE1, 0x50 });  // and r9d, 0x50
+                Bytes({ 0x41, 0xD1, 0xE1 });        // shl r9d, 1
+                Bytes({ 0x83, 0xE0, 0x01 });        // and eax, 0x01
+                Bytes({ 0xC1, 0xE0, 0x04 });        // shl eax, 4
+                Bytes({ 0x41, 0x09, 0xC1 });        // or  r9d, eax
+            }
+            break;
+
+        case FLAG_MODE_Z_H:
+        case FLAG_MODE_Z:
+            {
+                Bytes({ 0x83, 0xE0, 0x40 });        // and eax, 0x40
+                Bytes({ 0xD1, 0xE0 });              // shl eax, 1
+                Bytes({ 0x41, 0x89, 0xC1 });        // mov r9d, eax
+            }
+            break;
+
+        case FLAG_MODE_ZH:
+        case FLAG_MODE_ZH_N:
+            {
+                Bytes({ 0x83, 0xE0, 0x50 });        // and eax, 0x50
+                Bytes({ 0xD1, 0xE0 });              // shl eax, 1
+                Bytes({ 0x41, 0x83, 0xE1, 0x10 });  // and r9d, 0x10
+                Bytes({ 0x41, 0x09, 0xC1 });        // or  r9d, eax
+            }
+            break;
+
+        case FLAG_MODE_HC:
+            {
+                Bytes({ 0x41, 0x83, 0xE1, 0x80 });  // and r9d, 0x80 (符号拡張で0xFFFFFF80)
+                Bytes({ 0x89, 0xC5 });              // mov ebp, eax
+                Bytes({ 0x83, 0xE5, 0x10 });        // and ebp, 0x10
+                Bytes({ 0xD1, 0xE5 });              // shl ebp, 1
+                Bytes({ 0x41, 0x09, 0xE9 });        // or  r9d, ebp
+                Bytes({ 0x83, 0xE0, 0x01 });        // and eax, 0x01
+                Bytes({ 0xC1, 0xE0, 0x04 });        // shl eax, 4
+                Bytes({ 0x41, 0x09, 0xC1 });        // or  r9d, eax
+            }
+            break;
+        }
+
+        if (mode == FLAG_MODE_ZHC_N || mode == FLAG_MODE_ZH_N)
+        { Bytes({ 0x41, 0x83, 0xC9, 0x40 }); }      // or r9d, 0x40 (N)
+        else if (mode == FLAG_MODE_Z_H)
+        { Bytes({ 0x41, 0x83, 0xC9, 0x20 }); }      // or r9d, 0x20 (H)
+    }
+
+    //-------------------------------------------------------------------------
+    // ページテーブル経由のメモリアクセス(RBP = ページ番号 → ページ先頭, EAX = ページ内オフセット).
+    //-------------------------------------------------------------------------
+
+    // mov rbp, [base + rbp * 8]
+    void LoadPage(uint8_t base)
+    { Bytes({ uint8_t(0x48 | (base >> 3)), 0x8B, 0x2C, uint8_t(0xE8 | (base & 7)) }); }
+
+    // cmp qword [base + rbp * 8], 0
+    void TestPage(uint8_t base)
+    { Bytes({ uint8_t(0x48 | (base >> 3)), 0x83, 0x3C, uint8_t(0xE8 | (base & 7)), 0x00 }); }
+
+    // test rbp, rbp
+    void TestRbp()
+    { Bytes({ 0x48, 0x85, 0xED }); }
+
+    // inc dword [r15 + rbp * 4]
+    void TouchPage()
+    { Bytes({ 0x41, 0xFF, 0x04, 0xAF }); }
+
+    // cmp rbp, [r14 + page * 8]
+    void ComparePage(uint8_t page)
+    {
+        Bytes({ 0x49, 0x3B, 0xAE });
+        Imm32(uint32_t(page) * 8);
+    }
+
+    // cmp dword [r15 + page * 4], imm32
+    void CompareVersion(uint8_t page, uint32_t version)
+    {
+        Bytes({ 0x41, 0x81, 0xBF });
+        Imm32(uint32_t(page) * 4);
+        Imm32(version);
+    }
+
+    // mov r8, [rax + rbp]
+    void LoadMem8(uint8_t dst)
+    { Bytes({ Rex(dst, 0), 0x8A, uint8_t(0x04 | ((dst & 7) << 3)), 0x28 }); }
+
+    // mov [rax + rbp], r8
+    void StoreMem8(uint8_t src)
+    { Bytes({ Rex(src, 0), 0x88, uint8_t(0x04 | ((src & 7) << 3)), 0x28 }); }
+
+    // mov byte [rax + rbp], imm8
+    void StoreMemImm8(uint8_t value)
+    { Bytes({ 0xC6, 0x04, 0x28, value }); }
+
+    //-------------------------------------------------------------------------
+    // Context([r13 + disp8]).
+    //-------------------------------------------------------------------------
+
+    // mov r64, [r13 + disp8]
+    void LoadContext(uint8_t dst, uint8_t offset)
+    { Bytes({ uint8_t(0x49 | ((dst >> 3) << 2)), 0x8B, uint8_t(0x45 | ((dst & 7) << 3)), offset }); }
+
+    // mov [r13 + disp8], rax
+    void StoreContextRax(uint8_t offset)
+    { Bytes({ 0x49, 0x89, 0x45, offset }); }
+
+    // add qword [r13 + disp8], imm32 / sub qword [r13 + disp8], imm32
+    void AddContext(uint8_t offset, uint32_t value)
+    {
+        Bytes({ 0x49, 0x81, 0x45, offset });
+        Imm32(value);
+    }
+
+    void SubContext(uint8_t offset, uint32_t value)
+    {
+        Bytes({ 0x49, 0x81, 0x6D, offset });
+        Imm32(value);
+    }
+
+    // call qword [r13 + disp8]
+    void CallContext(uint8_t offset)
+    { Bytes({ 0x41, 0xFF, 0x55, offset }); }
+
+    // cmp rax, [r13 + disp8]
+    void CompareRaxContext(uint8_t offset)
+    { Bytes({ 0x49, 0x3B, 0x45, offset }); }
+
+    // cmp word [r13 + disp8], imm16
+    void CompareContext16(uint8_t offset, uint16_t value)
+    {
+        Bytes({ 0x66, 0x41, 0x81, 0x7D, offset });
+        Imm16(value);
+    }
+
+private:
+    uint8_t*    m_pCur      = nullptr;
+    uint8_t*    m_pEnd      = nullptr;
+    bool        m_Overflow  = false;
+
+    // REXプレフィックス(SIL/DILを使うため常に付加する).
+    static uint8_t Rex(uint8_t reg, uint8_t rm)
+    { return uint8_t(0x40 | ((reg >> 3) << 2) | (rm >> 3)); }
+
+    static uint8_t ModRM(uint8_t reg, uint8_t rm)
+    { return uint8_t(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+};
+
+//-----------------------------------------------------------------------------
+//      レジスタペア(BC, DE, HL)の上位・下位のゲストレジスタ番号を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t GetPairMask(uint32_t p)
+{ return (1u << (p * 2)) | (1u << (p * 2 + 1)); }
+
+//-----------------------------------------------------------------------------
+//      条件分岐命令かどうか判定します.
+//-----------------------------------------------------------------------------
+inline bool IsConditionalBranch(uint8_t opCode)
+{
+    switch(opCode)
+    {
+    case 0x20: case 0x28: case 0x30: case 0x38:     // JR cc
+    case 0xC2: case 0xCA: case 0xD2: case 0xDA:     // JP cc
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック末尾で変換する分岐命令かどうか判定します.
+//-----------------------------------------------------------------------------
+inline bool IsBranch(uint8_t opCode)
+{ return opCode == 0x18 || opCode == 0xC3 || IsConditionalBranch(opCode); }
+
+//-----------------------------------------------------------------------------
+//      命令が使用するゲストレジスタのマスクを求めます(変換不可なら0).
+//-----------------------------------------------------------------------------
+uint32_t GetRegisterMask(const Recompiler::Command& cmd)
+{
+    static constexpr uint32_t kNone = 1u << 31;    // 変換可能だがレジスタを使わない.
+    static constexpr uint32_t kA    = 1u << GUEST_A;
+    static constexpr uint32_t kC    = 1u << GUEST_C;
+    static constexpr uint32_t kF    = 1u << GUEST_F;
+    static constexpr uint32_t kHL   = (1u << GUEST_H) | (1u << GUEST_L);
+
+    auto opCode = cmd.OpCode;
+    auto x = opCode >> 6;
+    auto y = (opCode >> 3) & 7;
+    auto z = opCode & 7;
+    auto p = y >> 1;
+    auto q = y & 1;
+
+    switch(opCode)
+    {
+    case 0x00:                                      // NOP
+    case 0x18:                                      // JR e
+    case 0xC3:                                      // JP nn
+    case 0x31:                                      // LD SP,nn
+    case 0x33: case 0x3B:                           // INC SP, DEC SP
+        return kNone;
+
+    case 0x20: case 0x28: case 0x30: case 0x38:     // JR cc,e
+    case 0xC2: case 0xCA: case 0xD2: case 0xDA:     // JP cc,nn
+    case 0x37: case 0x3F:                           // SCF, CCF
+        return kF;
+
+    case 0x02: case 0x0A:                           // LD (BC),A  LD A,(BC)
+        return kA | GetPairMask(0);
+
+    case 0x12: case 0x1A:                           // LD (DE),A  LD A,(DE)
+        return kA | GetPairMask(1);
+
+    case 0x22: case 0x2A: case 0x32: case 0x3A:     // LD (HL+),A  LD A,(HL+)  LD (HL-),A  LD A,(HL-)
+        return kA | kHL;
+
+    case 0x36:                                      // LD (HL),n
+        return kHL;
+
+    case 0x07: case 0x0F: case 0x17: case 0x1F:     // RLCA, RRCA, RLA, RRA
+    case 0x2F:                                      // CPL
+        return kA | kF;
+
+    case 0xE0: case 0xF0:                           // LDH (n),A  LDH A,(n)
+    case 0xEA: case 0xFA:                           // LD (nn),A  LD A,(nn)
+        return kA;
+
+    case 0xE2: case 0xF2:                           // LD (C),A  LD A,(C)
+        return kA | kC;
+
+    case 0xCB:
+        {
+            // (HL)を書き換える命令は変換しない.
+            auto prefix = uint8_t(cmd.Operand);
+            auto target = prefix & 7;
+            if (target == GUEST_HL)
+            { return 0; }
+
+            // RES, SETはフラグを変えない.
+            return (1u << target) | ((prefix < 0x80) ? kF : 0);
+        }
+
+    default:
+        break;
+    }
+
+    // LD r,r'  LD r,(HL)  LD (HL),r
+    if (x == 1)
+    {
+        if (opCode == 0x76)
+        { return 0; }
+        if (y == GUEST_HL)
+        { return kHL | (1u << z); }
+        if (z == GUEST_HL)
+        { return kHL | (1u << y); }
+        return (1u << y) | (1u << z);
+    }
+
+    // ALU A,r  ALU A,(HL)
+    if (x == 2)
+    {
+        if (z == GUEST_HL)
+        { return kA | kF | kHL; }
+        return kA | kF | (1u << z);
+    }
+
+    if (x == 0)
+    {
+        // LD rr,nn  ADD HL,rr (SPは除く)
+        if (z == 1 && p != 3)
+        { return (q == 0) ? GetPairMask(p) : (GetPairMask(p) | kHL | kF); }
+
+        // INC rr  DEC rr
+        if (z == 3 && p != 3)
+        { return GetPairMask(p); }
+
+        if (y != GUEST_HL)
+        {
+            // LD r,n
+            if (z == 6)
+            { return 1u << y; }
+
+            // INC r / DEC r
+            if (z == 4 || z == 5)
+            { return (1u << y) | kF; }
+        }
+    }
+
+    // ALU A,n
+    if (x == 3 && z == 6)
+    { return kA | kF; }
+
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Translator class
+///////////////////////////////////////////////////////////////////////////////
+class Translator
+{
+public:
+    Translator(Emitter& emitter, const Recompiler::Block& block, uint32_t mask, const uint8_t* pExit)
+    : m_Emitter (emitter)
+    , m_Block   (block)
+    , m_Mask    (mask)
+    , m_pExit   (pExit)
+    { /* DO_NOTHING */ }
+
+    // 使用するゲストレジスタをホストレジスタへ読み込む.
+    void LoadRegisters()
+    {
+        for(auto i=0u; i<9; ++i)
+        {
+            if ((m_Mask & (1u << i)) && kHostReg[i] != 0xFF)
+            { m_Emitter.LoadGuest(kHostReg[i], kGuestOffset[i]); }
+        }
+    }
+
+    // ホストレジスタをゲストレジスタへ書き戻す.
+    void StoreRegisters()
+    {
+        for(auto i=0u; i<9; ++i)
+        {
+            if ((m_Mask & (1u << i)) && kHostReg[i] != 0xFF)
+            { m_Emitter.StoreGuest(kHostReg[i], kGuestOffset[i]); }
+        }
+    }
+
+    // 1命令分を変換する. pcは次の命令のアドレス.
+    void EmitCommand(const Recompiler::Command& cmd, uint16_t pc);
+
+    // 変換できない命令の手前で止まる.
+    void EmitStop(uint16_t pc)
+    {
+        StoreRegisters();
+        FlushCycles(0);
+        m_Emitter.StoreImm16(kOffsetPC, pc);
+        m_Emitter.MovRI32(HOST_RAX, 1);
+        m_Emitter.JumpTo(m_pExit);
+    }
+
+    // ブロックの末尾から次のブロックへ進む.
+    void EmitFallThrough(uint16_t pc)
+    {
+        StoreRegisters();
+        FlushCycles(0);
+        EmitLinkExit(pc);
+    }
+
+private:
+    Emitter&                    m_Emitter;
+    const Recompiler::Block&    m_Block;
+    uint32_t                    m_Mask;
+    const uint8_t*              m_pExit;
+    uint32_t                    m_Pending = 0;  // まだ加算していない消費サイクル数.
+
+    // 未加算のサイクル数に追加分を加えてContextに反映する.
+    void FlushCycles(uint32_t extra)
+    {
+        auto cycles = m_Pending + extra;
+        if (cycles != 0)
+        { m_Emitter.AddContext(kContextCycles, cycles); }
+        m_Pending = 0;
+    }
+
+    // 変換済みのブロックへつなげる分岐を出力し, 未接続の間はディスパッチャへ戻る.
+    void EmitLinkExit(uint16_t pc)
+    {
+        if (m_Block.Chainable)
+        {
+            // 最初は直後の命令へ飛ぶだけ. 接続すると飛び先が分岐先ブロックの入口に書き換わる.
+            auto site = m_Emitter.GetCurrent();
+            m_Emitter.Jump();
+            m_Emitter.Bytes({ 0x48, 0xB8 });                // mov rax, imm64
+            m_Emitter.Imm64(reinterpret_cast<uint64_t>(site));
+            m_Emitter.StoreContextRax(kContextLink);
+        }
+
+        m_Emitter.StoreImm16(kOffsetPC, pc);
+        m_Emitter.Bytes({ 0x31, 0xC0 });                    // xor eax, eax
+        m_Emitter.JumpTo(m_pExit);
+    }
+
+    // 命令の完了後に止まる. ゲストレジスタとサイクル数は反映済みであること.
+    void EmitExit(uint16_t pc)
+    {
+        m_Emitter.StoreImm16(kOffsetPC, pc);
+        m_Emitter.Bytes({ 0x31, 0xC0 });                    // xor eax, eax
+        m_Emitter.JumpTo(m_pExit);
+    }
+
+    void EmitBranch(const Recompiler::Command& cmd, uint16_t pc);
+    void EmitRead (ADDRESS_MODE mode, uint16_t address, uint8_t dst);
+    void EmitWrite(ADDRESS_MODE mode, uint16_t address, uint8_t src, uint8_t value, const Recompiler::Command& cmd, uint16_t pc);
+    void EmitAddressArgument(ADDRESS_MODE mode, uint16_t address);
+    void EmitAddressSetup(ADDRESS_MODE mode, uint16_t address, bool page);
+    void EmitIncrement(ADDRESS_MODE mode);
+    void EmitCall(uint8_t function);
+};
+
+//-----------------------------------------------------------------------------
+//      ページ番号(RBP)またはページ内オフセット(EAX)を求めます.
+//-----------------------------------------------------------------------------
+void Translator::EmitAddressSetup(ADDRESS_MODE mode, uint16_t address, bool page)
+{
+    auto dst = page ? HOST_RBP : HOST_RAX;
+    switch(mode)
+    {
+    case ADDRESS_BC:
+        m_Emitter.MovzxRR8(dst, kHostReg[page ? GUEST_B : GUEST_C]);
+        break;
+
+    case ADDRESS_DE:
+        m_Emitter.MovzxRR8(dst, kHostReg[page ? GUEST_D : GUEST_E]);
+        break;
+
+    case ADDRESS_HL:
+    case ADDRESS_HLI:
+    case ADDRESS_HLD:
+        m_Emitter.MovzxRR8(dst, kHostReg[page ? GUEST_H : GUEST_L]);
+        break;
+
+    default:
+        m_Emitter.MovRI32(dst, page ? uint32_t(address >> 8) : uint32_t(address & 0xFF));
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ハンドラに渡すアドレスをESIに設定します(ゲストレジスタは書き戻し済み).
+//-----------------------------------------------------------------------------
+void Translator::EmitAddressArgument(ADDRESS_MODE mode, uint16_t address)
+{
+    switch(mode)
+    {
+    case ADDRESS_BC:
+        m_Emitter.LoadGuest16(HOST_RSI, kOffsetBC);
+        break;
+
+    case ADDRESS_DE:
+        m_Emitter.LoadGuest16(HOST_RSI, kOffsetDE);
+        break;
+
+    case ADDRESS_HL:
+    case ADDRESS_HLI:
+    case ADDRESS_HLD:
+        m_Emitter.LoadGuest16(HOST_RSI, kOffsetHL);
+        break;
+
+    case ADDRESS_HIGH_C:
+        m_Emitter.LoadGuest(HOST_RSI, kGuestOffset[GUEST_C]);
+        m_Emitter.Bytes({ 0x81, 0xCE, 0x00, 0xFF, 0x00, 0x00 });  // or esi, 0xFF00
+        break;
+
+    case ADDRESS_IMM:
+    case ADDRESS_HIGH_IMM:
+        m_Emitter.MovRI32(HOST_RSI, address);
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      HL+, HL-のHLを更新します(ホストレジスタ).
+//-----------------------------------------------------------------------------
+void Translator::EmitIncrement(ADDRESS_MODE mode)
+{
+    if (mode == ADDRESS_HLI)
+    {
+        m_Emitter.AluRI8(ALU_OP_ADD, kHostReg[GUEST_L], 1);
+        m_Emitter.AluRI8(ALU_OP_ADC, kHostReg[GUEST_H], 0);
+    }
+    else if (mode == ADDRESS_HLD)
+    {
+        m_Emitter.AluRI8(ALU_OP_SUB, kHostReg[GUEST_L], 1);
+        m_Emitter.AluRI8(ALU_OP_SBC, kHostReg[GUEST_H], 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      Contextの関数を呼び出します(ESI, EDXに引数を設定済みであること).
+//-----------------------------------------------------------------------------
+void Translator::EmitCall(uint8_t function)
+{
+    m_Emitter.LoadContext(HOST_RDI, kContextUser);
+    m_Emitter.CallContext(function);
+    m_Emitter.LoadContext(HOST_RDI, kContextRegister);
+}
+
+//-----------------------------------------------------------------------------
+//      メモリからホストレジスタへ読み込みます.
+//-----------------------------------------------------------------------------
+void Translator::EmitRead(ADDRESS_MODE mode, uint16_t address, uint8_t dst)
+{
+    // 直接参照できるページはテーブル引きだけで読む.
+    uint8_t* slow = nullptr;
+    uint8_t* done = nullptr;
+    if (mode != ADDRESS_HIGH_C && mode != ADDRESS_HIGH_IMM)
+    {
+        EmitAddressSetup(mode, address, true);
+        m_Emitter.LoadPage(HOST_R12);
+        m_Emitter.TestRbp();
+        slow = m_Emitter.JumpIf(HOST_CC_Z);
+        EmitAddressSetup(mode, address, false);
+        m_Emitter.LoadMem8(dst);
+        done = m_Emitter.Jump();
+        m_Emitter.Bind(slow);
+    }
+
+    // I/Oレジスタ等はハンドラを呼ぶ. 呼び出し中も累積サイクル数が命令の開始時点を指すようにする.
+    StoreRegisters();
+    if (m_Pending != 0)
+    { m_Emitter.AddContext(kContextCycles, m_Pending); }
+    EmitAddressArgument(mode, address);
+    EmitCall(kContextRead);
+    if (m_Pending != 0)
+    { m_Emitter.SubContext(kContextCycles, m_Pending); }
+    LoadRegisters();
+    if (dst != HOST_RAX)
+    { m_Emitter.MovRR8(dst, HOST_RAX); }
+
+    if (done != nullptr)
+    { m_Emitter.Bind(done); }
+
+    EmitIncrement(mode);
+}
+
+//-----------------------------------------------------------------------------
+//      ホストレジスタ(srcが0xFFならvalue)をメモリに書き込みます.
+//-----------------------------------------------------------------------------
+void Translator::EmitWrite
+(
+    ADDRESS_MODE                mode,
+    uint16_t                    address,
+    uint8_t                     src,
+    uint8_t                     value,
+    const Recompiler::Command&  cmd,
+    uint16_t                    pc
+)
+{
+    // 書き込んだページにブロック自身が含まれる場合は, 残りの命令が古くなるので止まる.
+    // ROMのページは直接書き込めないので判定しない.
+    auto page      = uint8_t(m_Block.PC >> 8);
+    auto checkSelf = (m_Block.PC >= 0x8000);
+
+    auto     pending = m_Pending;
+    uint8_t* done    = nullptr;
+    if (mode != ADDRESS_HIGH_C && mode != ADDRESS_HIGH_IMM)
+    {
+        EmitAddressSetup(mode, address, true);
+        m_Emitter.TestPage(HOST_R14);
+        auto slow = m_Emitter.JumpIf(HOST_CC_Z);
+        m_Emitter.TouchPage();
+        m_Emitter.LoadPage(HOST_R14);
+        EmitAddressSetup(mode, address, false);
+        if (src != 0xFF)
+        { m_Emitter.StoreMem8(src); }
+        else
+        { m_Emitter.StoreMemImm8(value); }
+        EmitIncrement(mode);
+
+        if (checkSelf)
+        {
+            m_Emitter.ComparePage(page);
+            done = m_Emitter.JumpIf(HOST_CC_NZ);
+            StoreRegisters();
+            m_Emitter.AddContext(kContextCycles, pending + cmd.Cycles);
+            EmitExit(pc);
+        }
+        else
+        { done = m_Emitter.Jump(); }
+
+        m_Emitter.Bind(slow);
+    }
+
+    // ハンドラ経由. 割り込み要求・ROMバンク・次のイベントが変わった場合は止まる.
+    StoreRegisters();
+    if (pending != 0)
+    { m_Emitter.AddContext(kContextCycles, pending); }
+    EmitAddressArgument(mode, address);
+    if (src != 0xFF)
+    {
+        // ESIを設定した後なので, 書き戻したゲストレジスタから読む.
+        auto guest = 0u;
+        while (kHostReg[guest] != src)
+        { guest++; }
+        m_Emitter.LoadGuest(HOST_RDX, kGuestOffset[guest]);
+    }
+    else
+    { m_Emitter.MovRI32(HOST_RDX, value); }
+
+    if (mode == ADDRESS_HLI)
+    { m_Emitter.IncGuest16(kOffsetHL); }
+    else if (mode == ADDRESS_HLD)
+    { m_Emitter.DecGuest16(kOffsetHL); }
+
+    EmitCall(kContextWrite);
+    m_Emitter.Bytes({ 0x84, 0xC0 });                        // test al, al
+    auto stop = m_Emitter.JumpIf(HOST_CC_Z);
+
+    uint8_t* stale = nullptr;
+    if (checkSelf)
+    {
+        // エコーRAM経由でブロック自身を書き換えた場合.
+        m_Emitter.CompareVersion(page, m_Block.Version);
+        stale = m_Emitter.JumpIf(HOST_CC_NZ);
+    }
+
+    if (pending != 0)
+    { m_Emitter.SubContext(kContextCycles, pending); }
+    LoadRegisters();
+    auto resume = m_Emitter.Jump();
+
+    m_Emitter.Bind(stop);
+    if (stale != nullptr)
+    { m_Emitter.Bind(stale); }
+    m_Emitter.AddContext(kContextCycles, cmd.Cycles);
+    EmitExit(pc);
+
+    m_Emitter.Bind(resume);
+    if (done != nullptr)
+    { m_Emitter.Bind(done); }
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック末尾の分岐を変換します.
+//-----------------------------------------------------------------------------
+void Translator::EmitBranch(const Recompiler::Command& cmd, uint16_t pc)
+{
+    uint16_t target = cmd.Operand;
+    if (cmd.OpCode < 0x40)
+    { target = uint16_t(pc + int8_t(cmd.Operand)); }
+
+    StoreRegisters();
+    FlushCycles(cmd.Cycles);
+
+    if (!IsConditionalBranch(cmd.OpCode))
+    {
+        EmitLinkExit(target);
+        return;
+    }
+
+    // 条件はNZ, Z, NC, Cの順. 成立時は1Mサイクル多い.
+    auto cond = (cmd.OpCode >> 3) & 3;
+    auto mask = uint8_t((cond < 2) ? 0x80 : 0x10);
+    m_Emitter.Bytes({ 0x41, 0xF6, 0xC1, mask });            // test r9b, mask
+    auto skip = m_Emitter.JumpIf((cond & 1) ? HOST_CC_Z : HOST_CC_NZ);
+    m_Emitter.AddContext(kContextCycles, 4);
+    EmitLinkExit(target);
+
+    m_Emitter.Bind(skip);
+    EmitLinkExit(pc);
+}
+
+//-----------------------------------------------------------------------------
+//      1命令分を変換します.
+//-----------------------------------------------------------------------------
+void Translator::EmitCommand(const Recompiler::Command& cmd, uint16_t pc)
+{
+    static constexpr FLAG_MODE kAluFlags[8] = {
+        FLAG_MODE_ZHC,      // ADD
+        FLAG_MODE_ZHC,      // ADC
+        FLAG_MODE_ZHC_N,    // SUB
+        FLAG_MODE_ZHC_N,    // SBC
+        FLAG_MODE_Z_H,      // AND
+        FLAG_MODE_Z,        // XOR
+        FLAG_MODE_Z,        // OR
+        FLAG_MODE_ZHC_N,    // CP
+    };
+
+    auto opCode = cmd.OpCode;
+    auto x = opCode >> 6;
+    auto y = (opCode >> 3) & 7;
+    auto z = opCode & 7;
+    auto p = y >> 1;
+
+    auto regA = kHostReg[GUEST_A];
+
+    switch(opCode)
+    {
+    case 0x00:                                      // NOP
+        break;
+
+    case 0x18:                                      // JR e
+    case 0x20: case 0x28: case 0x30: case 0x38:     // JR cc,e
+    case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA:  // JP cc,nn  JP nn
+        EmitBranch(cmd, pc);
+        return;
+
+    case 0x02: EmitWrite(ADDRESS_BC,  0, regA, 0, cmd, pc); break;     // LD (BC),A
+    case 0x12: EmitWrite(ADDRESS_DE,  0, regA, 0, cmd, pc); break;     // LD (DE),A
+    case 0x22: EmitWrite(ADDRESS_HLI, 0, regA, 0, cmd, pc); break;     // LD (HL+),A
+    case 0x32: EmitWrite(ADDRESS_HLD, 0, regA, 0, cmd, pc); break;     // LD (HL-),A
+    case 0x0A: EmitRead (ADDRESS_BC,  0, regA); break;                 // LD A,(BC)
+    case 0x1A: EmitRead (ADDRESS_DE,  0, regA); break;                 // LD A,(DE)
+    case 0x2A: EmitRead (ADDRESS_HLI, 0, regA); break;                 // LD A,(HL+)
+    case 0x3A: EmitRead (ADDRESS_HLD, 0, regA); break;                 // LD A,(HL-)
+
+    case 0x36:                                      // LD (HL),n
+        EmitWrite(ADDRESS_HL, 0, 0xFF, uint8_t(cmd.Operand), cmd, pc);
+        break;
+
+    case 0xE0:                                      // LDH (n),A
+        EmitWrite(ADDRESS_HIGH_IMM, uint16_t(0xFF00 | uint8_t(cmd.Operand)), regA, 0, cmd, pc);
+        break;
+
+    case 0xF0:                                      // LDH A,(n)
+        EmitRead(ADDRESS_HIGH_IMM, uint16_t(0xFF00 | uint8_t(cmd.Operand)), regA);
+        break;
+
+    case 0xE2: EmitWrite(ADDRESS_HIGH_C, 0, regA, 0, cmd, pc); break;  // LD (C),A
+    case 0xF2: EmitRead (ADDRESS_HIGH_C, 0, regA); break;              // LD A,(C)
+    case 0xEA: EmitWrite(ADDRESS_IMM, cmd.Operand, regA, 0, cmd, pc); break;   // LD (nn),A
+    case 0xFA: EmitRead (ADDRESS_IMM, cmd.Operand, regA); break;               // LD A,(nn)
+
+    case 0x31:                                      // LD SP,nn
+        m_Emitter.StoreImm16(kOffsetSP, cmd.Operand);
+        break;
+
+    case 0x33: m_Emitter.IncGuest16(kOffsetSP); break;                 // INC SP
+    case 0x3B: m_Emitter.DecGuest16(kOffsetSP); break;                 // DEC SP
+
+    case 0x07: case 0x0F: case 0x17: case 0x1F:     // RLCA, RRCA, RLA, RRA
+        {
+            if (y >= 2)
+            { m_Emitter.LoadCarry(); }
+            m_Emitter.ShiftR8(kShiftOp[y], regA);
+            m_Emitter.SetFlagBit(HOST_CC_C, 4);
+            m_Emitter.Bytes({ 0x41, 0x89, 0xC1 });  // mov r9d, eax
+        }
+        break;
+
+    case 0x2F:                                      // CPL
+        m_Emitter.NotR8(regA);
+        m_Emitter.Bytes({ 0x41, 0x83, 0xC9, 0x60 });    // or r9d, 0x60
+        break;
+
+    case 0x37:                                      // SCF
+        m_Emitter.Bytes({ 0x41, 0x83, 0xE1, 0x80 });    // and r9d, 0x80 (符号拡張で0xFFFFFF80)
+        m_Emitter.Bytes({ 0x41, 0x83, 0xC9, 0x10 });    // or  r9d, 0x10
+        break;
+
+    case 0x3F:                                      // CCF
+        m_Emitter.Bytes({ 0x41, 0x83, 0xE1, 0x90 });    // and r9d, 0x90 (符号拡張で0xFFFFFF90)
+        m_Emitter.Bytes({ 0x41, 0x83, 0xF1, 0x10 });    // xor r9d, 0x10
+        break;
+
+    case 0xCB:
+        {
+            auto prefix = uint8_t(cmd.Operand);
+            auto op     = (prefix >> 3) & 7;
+            auto reg    = kHostReg[prefix & 7];
+            switch(prefix >> 6)
+            {
+            case 0:     // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL
+                {
+                    if (op == 6)
+                    {
+                        m_Emitter.SwapR8(reg);
+                        m_Emitter.Bytes({ 0x31, 0xC0 });        // xor eax, eax
+                    }
+                    else
+                    {
+                        if (op == 2 || op == 3)
+                        { m_Emitter.LoadCarry(); }
+                        m_Emitter.ShiftR8(kShiftOp[op], reg);
+                        m_Emitter.SetFlagBit(HOST_CC_C, 4);
+                    }
+
+                    // F = (Z << 7) | (C << 4)
+                    m_Emitter.TestR8(reg);
+                    m_Emitter.Bytes({ 0x41, 0x0F, 0x94, 0xC1 });    // setz r9b
+                    m_Emitter.Bytes({ 0x45, 0x0F, 0xB6, 0xC9 });    // movzx r9d, r9b
+                    m_Emitter.Bytes({ 0x41, 0xC1, 0xE1, 0x07 });    // shl r9d, 7
+                    m_Emitter.Bytes({ 0x41, 0x09, 0xC1 });          // or  r9d, eax
+                }
+                break;
+
+            case 1:     // BIT
+                m_Emitter.TestRI8(reg, uint8_t(1 << op));
+                m_Emitter.SetFlagBit(HOST_CC_Z, 7);
+                m_Emitter.Bytes({ 0x41, 0x83, 0xE1, 0x10 });        // and r9d, 0x10
+                m_Emitter.Bytes({ 0x41, 0x83, 0xC9, 0x20 });        // or  r9d, 0x20
+                m_Emitter.Bytes({ 0x41, 0x09, 0xC1 });              // or  r9d, eax
+                break;
+
+            case 2:     // RES
+                m_Emitter.AluRI8(ALU_OP_AND, reg, uint8_t(~(1 << op)));
+                break;
+
+            case 3:     // SET
+                m_Emitter.AluRI8(ALU_OP_OR, reg, uint8_t(1 << op));
+                break;
+            }
+        }
+        break;
+
+    default:
+        if (x == 1)
+        {
+            if (y == GUEST_HL)                      // LD (HL),r
+            { EmitWrite(ADDRESS_HL, 0, kHostReg[z], 0, cmd, pc); }
+            else if (z == GUEST_HL)                 // LD r,(HL)
+            { EmitRead(ADDRESS_HL, 0, kHostReg[y]); }
+            else                                    // LD r,r'
+            { m_Emitter.MovRR8(kHostReg[y], kHostReg[z]); }
+            break;
+        }
+
+        if (x == 2 || x == 3)
+        {
+            // ALU A,(HL)はEAXに読み込んでから演算する.
+            auto src = kHostReg[z];
+            if (x == 2 && z == GUEST_HL)
+            {
+                EmitRead(ADDRESS_HL, 0, HOST_RAX);
+                src = HOST_RAX;
+            }
+
+            if (y == ALU_OP_ADC || y == ALU_OP_SBC)
+            { m_Emitter.LoadCarry(); }
+
+            if (x == 2)
+            { m_Emitter.AluRR8(uint8_t(y), regA, src); }
+            else
+            { m_Emitter.AluRI8(uint8_t(y), regA, uint8_t(cmd.Operand)); }
+
+            m_Emitter.StoreFlags(kAluFlags[y]);
+            break;
+        }
+
+        if (z == 1)
+        {
+            auto hi = kHostReg[p * 2];
+            auto lo = kHostReg[p * 2 + 1];
+            if ((y & 1) == 0)                       // LD rr,nn
+            {
+                m_Emitter.MovRI8(lo, uint8_t(cmd.Operand));
+                m_Emitter.MovRI8(hi, uint8_t(cmd.Operand >> 8));
+            }
+            else                                    // ADD HL,rr
+            {
+                m_Emitter.AluRR8(ALU_OP_ADD, kHostReg[GUEST_L], lo);
+                m_Emitter.AluRR8(ALU_OP_ADC, kHostReg[GUEST_H], hi);
+                m_Emitter.StoreFlags(FLAG_MODE_HC);
+            }
+            break;
+        }
+
+        if (z == 3)                                 // INC rr / DEC rr
+        {
+            auto hi = kHostReg[p * 2];
+            auto lo = kHostReg[p * 2 + 1];
+            m_Emitter.AluRI8((y & 1) ? ALU_OP_SUB : ALU_OP_ADD, lo, 1);
+            m_Emitter.AluRI8((y & 1) ? ALU_OP_SBC : ALU_OP_ADC, hi, 0);
+            break;
+        }
+
+        if (z == 6)                                 // LD r,n
+        {
+            m_Emitter.MovRI8(kHostReg[y], uint8_t(cmd.Operand));
+            break;
+        }
+
+        if (z == 4)                                 // INC r
+        {
+            m_Emitter.IncR8(kHostReg[y]);
+            m_Emitter.StoreFlags(FLAG_MODE_ZH);
+        }
+        else                                        // DEC r
+        {
+            m_Emitter.DecR8(kHostReg[y]);
+            m_Emitter.StoreFlags(FLAG_MODE_ZH_N);
+        }
+        break;
+    }
+
+    m_Pending += cmd.Cycles;
+}
+
+} // namespace
+#endif//PLATFORM_LINUX && ARCH_X64
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Recompiler class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      動的再コンパイルが利用可能かどうか判定します.
+//-----------------------------------------------------------------------------
+bool Recompiler::IsSupported()
+{
+#if PLATFORM_LINUX && ARCH_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool Recompiler::Init(uint32_t sizeInBytes)
+{
+#if PLATFORM_LINUX && ARCH_X64
+    if (m_pCode != nullptr)
+    { Term(); }
+
+    auto ptr = mmap(nullptr, sizeInBytes, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+    { return false; }
+
+    m_pCode       = static_cast<uint8_t*>(ptr);
+    m_SizeInBytes = sizeInBytes;
+    m_Offset      = 0;
+    m_Generation++;
+    return true;
+#else
+    (void)sizeInBytes;
+    return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void Recompiler::Term()
+{
+#if PLATFORM_LINUX && ARCH_X64
+    if (m_pCode != nullptr)
+    {
+        munmap(m_pCode, m_SizeInBytes);
+        m_pCode = nullptr;
+    }
+#endif
+
+    m_SizeInBytes = 0;
+    m_Offset      = 0;
+    m_Generation++;
+}
+
+//-----------------------------------------------------------------------------
+//      変換済みコードを全て破棄します.
+//-----------------------------------------------------------------------------
+void Recompiler::Reset()
+{
+    m_Offset = 0;
+    m_Generation++;
+}
+
+//-----------------------------------------------------------------------------
+//      指定範囲を含むページの保護属性を切り替えます.
+//-----------------------------------------------------------------------------
+bool Recompiler::Protect(uint8_t* pBegin, uint8_t* pEnd, bool writable)
+{
+#if PLATFORM_LINUX && ARCH_X64
+    static const auto kPageSize = uintptr_t(sysconf(_SC_PAGESIZE));
+
+    auto begin = reinterpret_cast<uintptr_t>(pBegin) & ~(kPageSize - 1);
+    auto end   = (reinterpret_cast<uintptr_t>(pEnd) + kPageSize - 1) & ~(kPageSize - 1);
+    auto prot  = writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC);
+    return mprotect(reinterpret_cast<void*>(begin), end - begin, prot) == 0;
+#else
+    (void)pBegin;
+    (void)pEnd;
+    (void)writable;
+    return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      基本ブロックをネイティブコードに変換します.
+//-----------------------------------------------------------------------------
+bool Recompiler::Compile(const Block& block, Result& result)
+{
+#if PLATFORM_LINUX && ARCH_X64
+    assert(block.pCommands != nullptr);
+
+    if (m_pCode == nullptr)
+    { return false; }
+
+    // 先頭から変換可能な命令を数える.
+    auto     commands = block.pCommands;
+    uint32_t mask     = 0;
+    uint8_t  num      = 0;
+    uint8_t  length   = 0;
+    uint16_t cycles   = 0;
+    for(; num<block.Count; ++num)
+    {
+        auto bits = GetRegisterMask(commands[num]);
+        if (bits == 0)
+        { break; }
+
+        mask   |= bits;
+        length += commands[num].Length;
+        cycles += commands[num].Cycles;
+    }
+
+    if (num == 0)
+    { return false; }
+
+    // 条件分岐は成立時の方が1Mサイクル多い.
+    if (IsConditionalBranch(commands[num - 1].OpCode))
+    { cycles += 4; }
+
+    // 書き込むページだけを書き込み可能にする.
+    auto begin = m_pCode + m_Offset;
+    auto end   = m_pCode + m_SizeInBytes;
+    auto bound = kMaxBlockCode + uint32_t(num) * kMaxCommandCode;
+    if (uint32_t(end - begin) > bound)
+    { end = begin + bound; }
+
+    if (!Protect(begin, end, true))
+    { return false; }
+
+    Emitter emitter(begin, end);
+
+    // 出口(全ブロック共通の後始末). ブロック内の全ての出口からここへ後方分岐する.
+    auto exit = emitter.GetCurrent();
+    emitter.Bytes({ 0x48, 0x83, 0xC4, 0x08 });              // add rsp, 8
+    emitter.Bytes({ 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B });   // pop r15, r14, r13, r12, rbp, rbx
+    emitter.Byte(0xC3);                                     // ret
+
+    // 入口の判定に失敗した場合は, ブロックの先頭から実行し直せるようにして戻る.
+    auto fail = emitter.GetCurrent();
+    emitter.StoreImm16(kOffsetPC, block.PC);
+    emitter.Bytes({ 0x31, 0xC0 });                          // xor eax, eax
+    emitter.JumpTo(exit);
+
+    // ディスパッチャからの入口. 呼び出し規約で保存するレジスタを退避し, スタックを16バイト境界に揃える.
+    auto entry = emitter.GetCurrent();
+    emitter.Bytes({ 0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57 });   // push rbx, rbp, r12, r13, r14, r15
+    emitter.Bytes({ 0x48, 0x83, 0xEC, 0x08 });              // sub rsp, 8
+    emitter.Bytes({ 0x49, 0x89, 0xFD });                    // mov r13, rdi
+    emitter.LoadContext(HOST_R12, kContextReadPages);
+    emitter.LoadContext(HOST_R14, kContextWritePages);
+    emitter.LoadContext(HOST_R15, kContextVersions);
+    emitter.LoadContext(HOST_RDI, kContextRegister);
+
+    // 他のブロックからの入口. 予算を超える場合と, ブロックが古くなった場合はディスパッチャへ戻る.
+    auto chain = emitter.GetCurrent();
+    emitter.LoadContext(HOST_RAX, kContextCycles);
+    emitter.Bytes({ 0x48, 0x05 });                          // add rax, imm32
+    emitter.Imm32(cycles);
+    emitter.CompareRaxContext(kContextLimit);
+    emitter.JumpIfTo(HOST_CC_A, fail);
+
+    emitter.CompareVersion(uint8_t(block.PC >> 8), block.Version);
+    emitter.JumpIfTo(HOST_CC_NZ, fail);
+
+    if (block.PC >= 0x4000 && block.PC < 0x8000)
+    {
+        emitter.CompareContext16(kContextRomBank, block.Bank);
+        emitter.JumpIfTo(HOST_CC_NZ, fail);
+    }
+
+    Translator translator(emitter, block, mask, exit);
+    translator.LoadRegisters();
+
+    auto pc = block.PC;
+    for(auto i=0u; i<num; ++i)
+    {
+        pc = uint16_t(pc + commands[i].Length);
+        translator.EmitCommand(commands[i], pc);
+    }
+
+    // 分岐で終わらなかった場合.
+    if (num < block.Count)
+    { translator.EmitStop(pc); }
+    else if (!IsBranch(commands[num - 1].OpCode))
+    { translator.EmitFallThrough(pc); }
+
+    auto overflow = emitter.IsOverflow();
+    auto written  = emitter.GetCurrent();
+
+    // 実行可能に戻す.
+    if (!Protect(begin, end, false))
+    { return false; }
+
+    if (overflow)
+    {
+        // 領域不足. 全て破棄して次回から詰め直す.
+        Reset();
+        return false;
+    }
+
+    m_Offset = uint32_t(written - m_pCode);
+
+    result.pEntry = reinterpret_cast<Entry>(entry);
+    result.pChain = chain;
+    result.Count  = num;
+    result.Length = length;
+    result.Cycles = cycles;
+    return true;
+#else
+    (void)block;
+    (void)result;
+    return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      未接続の分岐を変換済みブロックの入口へつなぎます.
+//-----------------------------------------------------------------------------
+bool Recompiler::Link(uint8_t* pSite, uint8_t* pTarget)
+{
+#if PLATFORM_LINUX && ARCH_X64
+    assert(pSite >= m_pCode && pSite + 5 <= m_pCode + m_Offset);
+
+    // jmp rel32の飛び先だけを書き換える.
+    if (!Protect(pSite, pSite + 5, true))
+    { return false; }
+
+    auto rel = int32_t(pTarget - (pSite + 5));
+    memcpy(pSite + 1, &rel, sizeof(rel));
+
+    return Protect(pSite, pSite + 5, false);
+#else
+    (void)pSite;
+    (void)pTarget;
+    return false;
+#endif
+}
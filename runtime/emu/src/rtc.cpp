@@ -0,0 +1,313 @@
+﻿//-----------------------------------------------------------------------------
+// File   : rtc.cpp
+// Desc   : MBC3 Real Time Clock.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstring>
+#include <ctime>
+#include <rtc.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint8_t kDayHighMask   = 0xC1; // 有効なビット.
+static constexpr uint8_t kHaltBit       = 0x40; // 停止フラグ.
+static constexpr uint8_t kCarryBit      = 0x80; // 日の桁あふれフラグ.
+static constexpr uint32_t kFieldCount   = 10;   // セーブ形式のレジスタ数(動作中5個+ラッチ5個).
+
+//-----------------------------------------------------------------------------
+//      32bitリトルエンディアンで書き込みます.
+//-----------------------------------------------------------------------------
+void StoreU32(uint8_t* data, uint32_t value)
+{
+    data[0] = uint8_t(value);
+    data[1] = uint8_t(value >> 8);
+    data[2] = uint8_t(value >> 16);
+    data[3] = uint8_t(value >> 24);
+}
+
+//-----------------------------------------------------------------------------
+//      32bitリトルエンディアンで読み込みます.
+//-----------------------------------------------------------------------------
+uint32_t LoadU32(const uint8_t* data)
+{
+    return uint32_t(data[0])
+        | (uint32_t(data[1]) << 8)
+        | (uint32_t(data[2]) << 16)
+        | (uint32_t(data[3]) << 24);
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Rtc class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      時計を初期化します.
+//-----------------------------------------------------------------------------
+void Rtc::Init(RTC_MODE mode, ClockHandler pClock, void* pUser)
+{
+    m_Mode          = mode;
+    m_pClock        = pClock;
+    m_pUser         = pUser;
+    m_Counter       = {};
+    m_Latched       = {};
+    m_LatchValue    = 0xFF;
+    m_SubCycles     = 0;
+    m_LastCycle     = GetCycles();
+    m_LastTime      = (mode == RTC_MODE_HOST) ? int64_t(time(nullptr)) : 0;
+}
+
+//-----------------------------------------------------------------------------
+//      時計の進め方を設定します.
+//-----------------------------------------------------------------------------
+void Rtc::SetMode(RTC_MODE mode)
+{
+    // 切り替えまでの経過分はこれまでの進め方で反映しておく.
+    Update();
+
+    m_Mode      = mode;
+    m_SubCycles = 0;
+    m_LastCycle = GetCycles();
+    m_LastTime  = (mode == RTC_MODE_HOST) ? int64_t(time(nullptr)) : 0;
+}
+
+//-----------------------------------------------------------------------------
+//      ラッチレジスタへの書き込みを処理します.
+//-----------------------------------------------------------------------------
+void Rtc::WriteLatch(uint8_t value)
+{
+    // カウンタはラッチとレジスタ書き込みの時点でまとめて進めるので,
+    // 実行中に毎秒更新したりホストの時刻を問い合わせたりする必要は無い.
+    if (m_LatchValue == 0x00 && value == 0x01)
+    {
+        Update();
+        m_Latched = m_Counter;
+    }
+
+    m_LatchValue = value;
+}
+
+//-----------------------------------------------------------------------------
+//      ラッチされたレジスタを読み取ります.
+//-----------------------------------------------------------------------------
+uint8_t Rtc::Read(uint8_t index) const
+{
+    switch(index)
+    {
+    case 0x08: return m_Latched.Seconds & 0x3F;
+    case 0x09: return m_Latched.Minutes & 0x3F;
+    case 0x0A: return m_Latched.Hours   & 0x1F;
+    case 0x0B: return m_Latched.DayLow;
+    case 0x0C: return m_Latched.DayHigh & kDayHighMask;
+    default:   return 0xFF;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      カウンタに書き込みます.
+//-----------------------------------------------------------------------------
+void Rtc::Write(uint8_t index, uint8_t value)
+{
+    // 書き込み前までの経過時間を反映してから値を置き換える.
+    // 停止フラグの切り替えも, ここで基準が揃うので特別な処理は要らない.
+    Update();
+
+    switch(index)
+    {
+    case 0x08:
+        // 秒を書き込むと1秒未満の分周カウンタもリセットされる.
+        m_Counter.Seconds = value & 0x3F;
+        m_SubCycles = 0;
+        break;
+
+    case 0x09: m_Counter.Minutes = value & 0x3F; break;
+    case 0x0A: m_Counter.Hours   = value & 0x1F; break;
+    case 0x0B: m_Counter.DayLow  = value; break;
+    case 0x0C: m_Counter.DayHigh = value & kDayHighMask; break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      状態をセーブ形式で書き出します.
+//-----------------------------------------------------------------------------
+bool Rtc::Save(uint8_t* data)
+{
+    // 他のエミュレータと同じ形式 : 動作中とラッチのレジスタを32bitずつ, 最後に64bitのUNIX時刻.
+    Update();
+
+    const Registers* regs[2] = { &m_Counter, &m_Latched };
+    uint8_t fields[kFieldCount * 4];
+    for(auto i=0u; i<2; ++i)
+    {
+        auto dst = fields + i * 20;
+        StoreU32(dst +  0, regs[i]->Seconds);
+        StoreU32(dst +  4, regs[i]->Minutes);
+        StoreU32(dst +  8, regs[i]->Hours);
+        StoreU32(dst + 12, regs[i]->DayLow);
+        StoreU32(dst + 16, regs[i]->DayHigh);
+    }
+
+    // 変化が無ければ書き換えず, セーブファイルを汚さない.
+    if (memcmp(data, fields, sizeof(fields)) == 0)
+    { return false; }
+
+    memcpy(data, fields, sizeof(fields));
+
+    auto now = uint64_t(time(nullptr));
+    StoreU32(data + 40, uint32_t(now));
+    StoreU32(data + 44, uint32_t(now >> 32));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      セーブ形式から状態を読み込みます.
+//-----------------------------------------------------------------------------
+bool Rtc::Load(const uint8_t* data)
+{
+    // 作成したばかりのセーブファイルは0xFFで埋まっているので, 値の範囲で判定する.
+    for(auto i=0u; i<kFieldCount; ++i)
+    {
+        if (LoadU32(data + i * 4) > 0xFF)
+        { return false; }
+    }
+
+    Registers* regs[2] = { &m_Counter, &m_Latched };
+    for(auto i=0u; i<2; ++i)
+    {
+        auto src = data + i * 20;
+        regs[i]->Seconds = uint8_t(LoadU32(src +  0)) & 0x3F;
+        regs[i]->Minutes = uint8_t(LoadU32(src +  4)) & 0x3F;
+        regs[i]->Hours   = uint8_t(LoadU32(src +  8)) & 0x1F;
+        regs[i]->DayLow  = uint8_t(LoadU32(src + 12));
+        regs[i]->DayHigh = uint8_t(LoadU32(src + 16)) & kDayHighMask;
+    }
+
+    m_SubCycles = 0;
+    m_LastCycle = GetCycles();
+
+    // ホスト時刻に同期する場合は, 保存してから経過した時間を反映する.
+    if (m_Mode == RTC_MODE_HOST)
+    {
+        auto saved = int64_t(uint64_t(LoadU32(data + 40)) | (uint64_t(LoadU32(data + 44)) << 32));
+        auto now   = int64_t(time(nullptr));
+        if ((m_Counter.DayHigh & kHaltBit) == 0 && now > saved)
+        { Advance(uint64_t(now - saved)); }
+
+        m_LastTime = now;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      前回から経過した時間だけカウンタを進めます.
+//-----------------------------------------------------------------------------
+void Rtc::Update()
+{
+    uint64_t seconds = 0;
+    if (m_Mode == RTC_MODE_HOST)
+    {
+        auto now = int64_t(time(nullptr));
+        if (now > m_LastTime)
+        { seconds = uint64_t(now - m_LastTime); }
+        m_LastTime = now;
+    }
+    else
+    {
+        auto now = GetCycles();
+        m_SubCycles += now - m_LastCycle;
+        m_LastCycle  = now;
+
+        seconds      = m_SubCycles / CyclesPerSecond;
+        m_SubCycles %= CyclesPerSecond;
+    }
+
+    // 停止中は経過時間を捨てる.
+    if (m_Counter.DayHigh & kHaltBit)
+    {
+        m_SubCycles = 0;
+        return;
+    }
+
+    Advance(seconds);
+}
+
+//-----------------------------------------------------------------------------
+//      指定秒数だけカウンタを進めます.
+//-----------------------------------------------------------------------------
+void Rtc::Advance(uint64_t seconds)
+{
+    // 範囲外の値が書き込まれている間は, 実機と同じく1秒ずつ回り込ませる.
+    while(seconds > 0 && (m_Counter.Seconds >= 60 || m_Counter.Minutes >= 60 || m_Counter.Hours >= 24))
+    {
+        Tick();
+        --seconds;
+    }
+
+    if (seconds == 0)
+    { return; }
+
+    // 値が正しい範囲にあれば, 早送り後の長い経過時間もまとめて計算できる.
+    auto total = seconds
+        + m_Counter.Seconds
+        + m_Counter.Minutes * 60ull
+        + m_Counter.Hours   * 3600ull;
+
+    m_Counter.Seconds = uint8_t(total % 60); total /= 60;
+    m_Counter.Minutes = uint8_t(total % 60); total /= 60;
+    m_Counter.Hours   = uint8_t(total % 24); total /= 24;
+
+    auto days = total + m_Counter.DayLow + ((m_Counter.DayHigh & 0x01) << 8);
+    if (days > 0x1FF)
+    { m_Counter.DayHigh |= kCarryBit; }
+
+    m_Counter.DayLow  = uint8_t(days);
+    m_Counter.DayHigh = uint8_t((m_Counter.DayHigh & ~0x01) | ((days >> 8) & 0x01));
+}
+
+//-----------------------------------------------------------------------------
+//      カウンタを1秒進めます.
+//-----------------------------------------------------------------------------
+void Rtc::Tick()
+{
+    // 各カウンタはビット幅で回り込み, 規定値に達した時だけ桁上がりする.
+    m_Counter.Seconds = (m_Counter.Seconds + 1) & 0x3F;
+    if (m_Counter.Seconds != 60)
+    { return; }
+    m_Counter.Seconds = 0;
+
+    m_Counter.Minutes = (m_Counter.Minutes + 1) & 0x3F;
+    if (m_Counter.Minutes != 60)
+    { return; }
+    m_Counter.Minutes = 0;
+
+    m_Counter.Hours = (m_Counter.Hours + 1) & 0x1F;
+    if (m_Counter.Hours != 24)
+    { return; }
+    m_Counter.Hours = 0;
+
+    m_Counter.DayLow++;
+    if (m_Counter.DayLow != 0)
+    { return; }
+
+    if (m_Counter.DayHigh & 0x01)
+    { m_Counter.DayHigh = (m_Counter.DayHigh & ~0x01) | kCarryBit; }
+    else
+    { m_Counter.DayHigh |= 0x01; }
+}
+
+//-----------------------------------------------------------------------------
+//      累積サイクル数を取得します.
+//-----------------------------------------------------------------------------
+uint64_t Rtc::GetCycles() const
+{ return (m_pClock != nullptr) ? m_pClock(m_pUser) : 0; }
@@ -0,0 +1,485 @@
+﻿//-----------------------------------------------------------------------------
+// File   : scanline.cpp
+// Desc   : Scanline Renderer.
+// Author : Pocol.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstring>
+#include <cstdlib>
+#include <scanline.h>
+#include <pixel.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint16_t kAddressOAM   = 0xFE00;   // OAM.
+static constexpr uint16_t kAddressTile  = 0x8000;   // タイルデータ.
+static constexpr uint32_t kPageSize     = 0x100;    // 書き込み世代の単位.
+
+static constexpr uint8_t kLcdcBgEnable      = 0x01; // BG・ウィンドウを表示.
+static constexpr uint8_t kLcdcObjEnable     = 0x02; // スプライトを表示.
+static constexpr uint8_t kLcdcObjSize       = 0x04; // スプライトを8x16にする.
+static constexpr uint8_t kLcdcBgMap         = 0x08; // BGのタイルマップを0x9C00にする.
+static constexpr uint8_t kLcdcTileData      = 0x10; // タイルデータを0x8000から符号無しで参照する.
+static constexpr uint8_t kLcdcWindowEnable  = 0x20; // ウィンドウを表示.
+static constexpr uint8_t kLcdcWindowMap     = 0x40; // ウィンドウのタイルマップを0x9C00にする.
+
+static constexpr uint32_t kSpriteCount      = 40;   // OAMのスプライト数.
+
+static constexpr uint8_t kAttrPalette       = 0x10; // OBP1を使う.
+static constexpr uint8_t kAttrFlipX         = 0x20; // 左右反転.
+static constexpr uint8_t kAttrFlipY         = 0x40; // 上下反転.
+static constexpr uint8_t kAttrBehindBg      = 0x80; // BGのカラー1-3の後ろに表示.
+
+// 1ラインのパレット番号の割り当て(BGP, OBP0, OBP1の順に4色ずつ).
+static constexpr uint8_t kSlotBg            = 0;
+static constexpr uint8_t kSlotObp0          = 4;
+static constexpr uint8_t kSlotObp1          = 8;
+
+// 描画スレッドに送るページ(VRAMとOAM).
+static constexpr uint32_t kVramFirstPage    = 0x80;
+static constexpr uint32_t kVramLastPage     = 0x9F;
+static constexpr uint32_t kOamPage          = 0xFE;
+
+// キューが空になってから待機するまでに譲る回数.
+static constexpr uint32_t kSpinCount        = 1024;
+
+//-----------------------------------------------------------------------------
+//      パレットレジスタから各カラー番号の色を求めます.
+//-----------------------------------------------------------------------------
+inline void MakePalette(uint8_t value, uint32_t* colors)
+{
+    for(auto i=0; i<4; ++i)
+    { colors[i] = LineRenderer::Shades[(value >> (i * 2)) & 0x3]; }
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LineRenderer class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      参照するメモリを設定します.
+//-----------------------------------------------------------------------------
+void LineRenderer::SetSource(const uint8_t* mem, const uint32_t* versions)
+{
+    m_pMemory   = mem;
+    m_pVersions = versions;
+    Reset();
+}
+
+//-----------------------------------------------------------------------------
+//      1ライン分を描画します.
+//-----------------------------------------------------------------------------
+void LineRenderer::Render(const LineRegisters& regs, uint32_t* pixels)
+{
+    auto mem  = m_pMemory;
+    auto lcdc = regs.Lcdc;
+
+    // 前のラインからタイルデータが書き換えられていれば展開し直す.
+    UpdateTiles();
+
+    // 0x8800方式の符号付きタイル番号は0x9000を基準にする.
+    auto tileBase = (lcdc & kLcdcTileData) ? 0u : 256u;
+
+    // BG・ウィンドウのカラー番号に, 手前に出るスプライトのパレット番号を重ねる.
+    // タイル単位で書き込むので, 左端のはみ出し分と右端の余りを確保しておく.
+    uint8_t  line[8 + Width + 8];
+    uint8_t* bg = line + 8;
+
+    // 使わない番号も含めて16色分を変換カーネルに渡す.
+    uint32_t palette[16] = {};
+    MakePalette(regs.Obp0, palette + kSlotObp0);
+    MakePalette(regs.Obp1, palette + kSlotObp1);
+
+    if (lcdc & kLcdcBgEnable)
+    {
+        MakePalette(regs.Bgp, palette + kSlotBg);
+
+        // BG.
+        auto scx  = regs.Scx;
+        auto y    = uint8_t(regs.LY + regs.Scy);
+        auto map  = mem + ((lcdc & kLcdcBgMap) ? 0x9C00 : 0x9800) + (y >> 3) * 32;
+        auto row  = y & 0x7;
+        auto col  = scx >> 3;
+        for(int x = -(scx & 0x7); x < int(Width); x += 8)
+        {
+            auto tile = GetTileIndex(map[col], tileBase);
+            memcpy(bg + x, m_TileCache[tile][row], 8);
+            col = (col + 1) & 0x1F;
+        }
+
+        // ウィンドウ.
+        if (IsWindowLine(regs))
+        {
+            auto wmap = mem + ((lcdc & kLcdcWindowMap) ? 0x9C00 : 0x9800) + (regs.WindowLine >> 3) * 32;
+            auto wrow = regs.WindowLine & 0x7;
+            auto wcol = 0;
+            for(int x = regs.Wx - 7; x < int(Width); x += 8)
+            {
+                auto tile = GetTileIndex(wmap[wcol++], tileBase);
+                memcpy(bg + x, m_TileCache[tile][wrow], 8);
+            }
+        }
+    }
+    else
+    {
+        // DMGではBG・ウィンドウが無効だと白になる.
+        memset(bg, 0, Width);
+        for(auto i=0; i<4; ++i)
+        { palette[kSlotBg + i] = Shades[0]; }
+    }
+
+    if (lcdc & kLcdcObjEnable)
+    { MergeSprites(regs, bg); }
+
+    ConvertPixels(bg, palette, pixels, Width);
+}
+
+//-----------------------------------------------------------------------------
+//      ラインに掛かるスプライトを優先度の順に取得します.
+//-----------------------------------------------------------------------------
+const uint8_t* LineRenderer::GetSprites(uint32_t ly, uint8_t lcdc, uint32_t& count)
+{
+    UpdateSprites(lcdc);
+    count = m_LineSpriteCount[ly];
+    return m_LineSprites[ly];
+}
+
+//-----------------------------------------------------------------------------
+//      ウィンドウが表示されるラインかどうかを判定します.
+//-----------------------------------------------------------------------------
+bool LineRenderer::IsWindowLine(const LineRegisters& regs)
+{
+    // DMGではBG・ウィンドウの表示ビットでウィンドウも消える.
+    return (regs.Lcdc & kLcdcBgEnable)
+        && (regs.Lcdc & kLcdcWindowEnable)
+        && regs.LY >= regs.Wy
+        && regs.Wx < Width + 7;
+}
+
+//-----------------------------------------------------------------------------
+//      1ライン分のスプライトをBG・ウィンドウに重ねます.
+//-----------------------------------------------------------------------------
+void LineRenderer::MergeSprites(const LineRegisters& regs, uint8_t* line)
+{
+    uint32_t count;
+    auto sprites = GetSprites(regs.LY, regs.Lcdc, count);
+    if (count == 0)
+    { return; }
+
+    auto oam    = m_pMemory + kAddressOAM;
+    int  height = (regs.Lcdc & kLcdcObjSize) ? 16 : 8;
+
+    // 奥から順に不透明なピクセルだけ上書きし, 最前面のスプライトを決める.
+    uint8_t objIndex[Width] = {};
+    uint8_t objAttr [Width];
+    for(auto i=count; i-- > 0;)
+    {
+        auto sprite = oam + sprites[i] * 4;
+        auto x      = int(sprite[1]) - 8;
+        auto tile   = sprite[2];
+        auto attr   = sprite[3];
+        auto row    = int(regs.LY) - (int(sprite[0]) - 16);
+        if (attr & kAttrFlipY)
+        { row = height - 1 - row; }
+        if (height == 16)
+        { tile &= 0xFE; }
+
+        // 8x16の下半分は次のタイル.
+        auto pixels = m_TileCache[tile + (row >> 3)][row & 0x7];
+
+        for(auto j=0; j<8; ++j)
+        {
+            auto px = x + ((attr & kAttrFlipX) ? 7 - j : j);
+            if (px < 0 || px >= int(Width) || pixels[j] == 0)
+            { continue; }
+
+            objIndex[px] = pixels[j];
+            objAttr [px] = attr;
+        }
+    }
+
+    // 最前面のスプライトがBGの後ろ指定なら, BGのカラー0の位置にだけ表示する.
+    for(auto x=0u; x<Width; ++x)
+    {
+        if (objIndex[x] == 0)
+        { continue; }
+        if ((objAttr[x] & kAttrBehindBg) && line[x] != 0)
+        { continue; }
+
+        line[x] = uint8_t(((objAttr[x] & kAttrPalette) ? kSlotObp1 : kSlotObp0) + objIndex[x]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      タイルデータの展開キャッシュを更新します.
+//-----------------------------------------------------------------------------
+void LineRenderer::UpdateTiles()
+{
+    auto mem   = m_pMemory;
+    auto force = m_TileDirty;
+    m_TileDirty = false;
+
+    // ページ単位で書き込みの有無を調べ, 書き込まれたページは16タイルの内容を比較する.
+    for(auto page=0u; page<TilePageCount; ++page)
+    {
+        auto version = m_pVersions[(kAddressTile >> 8) + page];
+        if (!force && version == m_TileVersion[page])
+        { continue; }
+
+        m_TileVersion[page] = version;
+
+        auto first = page * (kPageSize / 16);
+        for(auto i=first; i<first + kPageSize / 16; ++i)
+        {
+            auto data = mem + kAddressTile + i * 16;
+            if (!force && memcmp(m_TileData[i], data, 16) == 0)
+            { continue; }
+
+            memcpy(m_TileData[i], data, 16);
+            DecodeTile(data, m_TileCache[i][0]);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ラインごとのスプライトのリストを更新します.
+//-----------------------------------------------------------------------------
+void LineRenderer::UpdateSprites(uint8_t lcdc)
+{
+    // スプライトの高さが変わるとラインごとのリストも変わる.
+    auto version = m_pVersions[kAddressOAM >> 8];
+    auto objSize = uint8_t(lcdc & kLcdcObjSize);
+    if (!m_SpriteDirty && version == m_OamVersion && objSize == m_ObjSize)
+    { return; }
+
+    m_OamVersion  = version;
+    m_ObjSize     = objSize;
+    m_SpriteDirty = false;
+    memset(m_LineSpriteCount, 0, sizeof(m_LineSpriteCount));
+
+    // 各ラインに掛かるスプライトをOAMの順に最大10個まで選ぶ.
+    auto oam    = m_pMemory + kAddressOAM;
+    int  height = objSize ? 16 : 8;
+    for(auto i=0u; i<kSpriteCount; ++i)
+    {
+        auto top    = int(oam[i * 4]) - 16;
+        auto first  = (top < 0) ? 0 : top;
+        auto last   = (top + height < int(Height)) ? top + height : int(Height);
+        for(auto ly=first; ly<last; ++ly)
+        {
+            auto& count = m_LineSpriteCount[ly];
+            if (count < SpritesPerLine)
+            { m_LineSprites[ly][count++] = uint8_t(i); }
+        }
+    }
+
+    // DMGではX座標が小さい方, 同じならOAMの番号が小さい方が手前.
+    for(auto ly=0u; ly<Height; ++ly)
+    {
+        auto sprites = m_LineSprites[ly];
+        auto count   = m_LineSpriteCount[ly];
+        for(auto i=1u; i<count; ++i)
+        {
+            auto index = sprites[i];
+            auto j = i;
+            for(; j > 0 && oam[sprites[j - 1] * 4 + 1] > oam[index * 4 + 1]; --j)
+            { sprites[j] = sprites[j - 1]; }
+            sprites[j] = index;
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// RenderThread class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      描画スレッドを開始します.
+//-----------------------------------------------------------------------------
+bool RenderThread::Init(const uint8_t* mem, const uint32_t* versions, uint32_t* pixels)
+{
+    if (IsRunning())
+    { Term(); }
+
+    if (!m_Queue.Init(QueueSize))
+    { return false; }
+
+    m_pShadow = static_cast<uint8_t*>(calloc(1, 0x10000));
+    if (m_pShadow == nullptr)
+    {
+        m_Queue.Term();
+        return false;
+    }
+
+    m_pMemory   = mem;
+    m_pVersions = versions;
+    m_pPixels   = pixels;
+    m_Submitted = 0;
+    m_Done.store(0, std::memory_order_relaxed);
+    m_Sleeping.store(false, std::memory_order_relaxed);
+
+    // 最初の描画で全てのページを送る.
+    for(auto page=0u; page<256; ++page)
+    {
+        m_ShadowVersion[page] = 0;
+        m_SentVersion  [page] = versions[page] - 1;
+    }
+
+    m_Renderer.SetSource(m_pShadow, m_ShadowVersion);
+    m_Thread = std::thread(&RenderThread::Main, this);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      描画スレッドを終了します.
+//-----------------------------------------------------------------------------
+void RenderThread::Term()
+{
+    if (!IsRunning())
+    { return; }
+
+    auto cmd = Reserve();
+    cmd->Type = COMMAND_QUIT;
+    Push();
+    m_Thread.join();
+
+    m_Queue.Term();
+    free(m_pShadow);
+    m_pShadow = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      1ライン分の描画を積みます.
+//-----------------------------------------------------------------------------
+void RenderThread::Submit(const LineRegisters& regs)
+{
+    // 前回から書き換えられたVRAM・OAMのページを先に送る.
+    auto send = [this](uint32_t page)
+    {
+        auto version = m_pVersions[page];
+        if (version == m_SentVersion[page])
+        { return; }
+
+        auto cmd = Reserve();
+        cmd->Type = COMMAND_PAGE;
+        cmd->Page = uint8_t(page);
+        memcpy(cmd->Data, m_pMemory + page * kPageSize, kPageSize);
+        Push();
+        m_SentVersion[page] = version;
+    };
+
+    for(auto page=kVramFirstPage; page<=kVramLastPage; ++page)
+    { send(page); }
+    send(kOamPage);
+
+    auto cmd = Reserve();
+    cmd->Type = COMMAND_LINE;
+    cmd->Regs = regs;
+    Push();
+}
+
+//-----------------------------------------------------------------------------
+//      積んだ描画が全て終わるまで待ちます.
+//-----------------------------------------------------------------------------
+void RenderThread::Flush()
+{
+    if (!IsRunning())
+    { return; }
+
+    while(m_Done.load(std::memory_order_acquire) != m_Submitted)
+    { std::this_thread::yield(); }
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドの書き込み先を取得します.
+//-----------------------------------------------------------------------------
+RenderThread::Command* RenderThread::Reserve()
+{
+    // 一杯なら描画スレッドが追いつくまで待つ.
+    Command* cmd;
+    while((cmd = m_Queue.Reserve()) == nullptr)
+    { std::this_thread::yield(); }
+
+    return cmd;
+}
+
+//-----------------------------------------------------------------------------
+//      書き込んだコマンドを公開します.
+//-----------------------------------------------------------------------------
+void RenderThread::Push()
+{
+    m_Queue.Push();
+    m_Submitted++;
+
+    // 描画スレッドが待機に入ろうとしていれば起こす.
+    // 待機側のフラグ設定とキューの確認の順序と対になるようにフェンスを挟む.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_Sleeping.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> locker(m_Lock);
+        m_Wakeup.notify_one();
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      描画スレッドのメインループです.
+//-----------------------------------------------------------------------------
+void RenderThread::Main()
+{
+    uint32_t spin = 0;
+    for(;;)
+    {
+        auto cmd = m_Queue.Peek();
+        if (cmd == nullptr)
+        {
+            // フレームの途中は次のラインがすぐに積まれるので, しばらくは譲るだけにする.
+            if (++spin < kSpinCount)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> locker(m_Lock);
+            m_Sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_Wakeup.wait(locker, [this] { return !m_Queue.IsEmpty(); });
+            m_Sleeping.store(false, std::memory_order_relaxed);
+            spin = 0;
+            continue;
+        }
+
+        spin = 0;
+        auto type = cmd->Type;
+        switch(type)
+        {
+        case COMMAND_PAGE:
+            memcpy(m_pShadow + cmd->Page * kPageSize, cmd->Data, kPageSize);
+            m_ShadowVersion[cmd->Page]++;
+            break;
+
+        case COMMAND_LINE:
+            m_Renderer.Render(cmd->Regs, m_pPixels + cmd->Regs.LY * LineRenderer::Width);
+            break;
+
+        default:
+            break;
+        }
+
+        m_Queue.Pop();
+        m_Done.fetch_add(1, std::memory_order_release);
+
+        if (type == COMMAND_QUIT)
+        { return; }
+    }
+}